@@ -134,7 +134,7 @@ namespace FIFE {
 		returnValue = m_sclipHandleMap.insert ( SoundClipHandleMapPair(res->getHandle(), resptr));
 
 		if (returnValue.second) {
-			m_sclipNameMap.insert ( SoundClipNameMapPair(returnValue.first->second->getName(), returnValue.first->second) );
+			m_sclipNameMap.insert ( SoundClipNameMapPair(returnValue.first->second->getName(), returnValue.first->second), res->getNameHash() );
 		}
 		else {
 			FL_WARN(_log, LMsg("SoundClipManager::add(IResource*) - ") << "Resource " << res->getName() << " already exists.... ignoring.");
@@ -274,7 +274,7 @@ namespace FIFE {
 
 	void SoundClipManager::remove(SoundClipPtr& resource) {
 		SoundClipHandleMapIterator it = m_sclipHandleMap.find(resource->getHandle());
-		SoundClipNameMapIterator nit = m_sclipNameMap.find(resource->getName());
+		SoundClipNameMapIterator nit = m_sclipNameMap.find(resource->getName(), resource->getNameHash());
 
 		if (it != m_sclipHandleMap.end()) {
 			m_sclipHandleMap.erase(it);
@@ -313,11 +313,13 @@ namespace FIFE {
 
 	void SoundClipManager::remove(ResourceHandle handle) {
 		std::string name;
+		size_t nameHash = 0;
 
 		SoundClipHandleMapIterator it = m_sclipHandleMap.find(handle);
 
 		if (it != m_sclipHandleMap.end()) {
 			name = it->second->getName();
+			nameHash = it->second->getNameHash();
 			m_sclipHandleMap.erase(it);
 		}
 		else {
@@ -325,7 +327,7 @@ namespace FIFE {
 			return;
 		}
 
-		SoundClipNameMapIterator nit = m_sclipNameMap.find(name);
+		SoundClipNameMapIterator nit = m_sclipNameMap.find(name, nameHash);
 		if ( nit != m_sclipNameMap.end() ) {
 			m_sclipNameMap.erase(nit);
 			return;
@@ -36,6 +36,7 @@
 #include "util/base/singleton.h"
 #include "util/resource/resource.h"
 #include "util/resource/resourcemanager.h"
+#include "util/structures/openhashmap.h"
 
 #include "soundclip.h"
 
@@ -353,14 +354,14 @@ namespace FIFE {
 		virtual ResourceHandle getResourceHandle(const std::string& name);
 
 	private:
-		typedef std::map< ResourceHandle, SoundClipPtr > SoundClipHandleMap;
-		typedef std::map< ResourceHandle, SoundClipPtr >::iterator SoundClipHandleMapIterator;
-		typedef std::map< ResourceHandle, SoundClipPtr >::const_iterator SoundClipHandleMapConstIterator;
+		typedef OpenHashMap< ResourceHandle, SoundClipPtr, IntegerHash > SoundClipHandleMap;
+		typedef OpenHashMap< ResourceHandle, SoundClipPtr, IntegerHash >::iterator SoundClipHandleMapIterator;
+		typedef OpenHashMap< ResourceHandle, SoundClipPtr, IntegerHash >::const_iterator SoundClipHandleMapConstIterator;
 		typedef std::pair< ResourceHandle, SoundClipPtr > SoundClipHandleMapPair;
 
-		typedef std::map< std::string, SoundClipPtr > SoundClipNameMap;
-		typedef std::map< std::string, SoundClipPtr >::iterator SoundClipNameMapIterator;
-		typedef std::map< std::string, SoundClipPtr >::const_iterator SoundClipNameMapConstIterator;
+		typedef OpenHashMap< std::string, SoundClipPtr, StringHash > SoundClipNameMap;
+		typedef OpenHashMap< std::string, SoundClipPtr, StringHash >::iterator SoundClipNameMapIterator;
+		typedef OpenHashMap< std::string, SoundClipPtr, StringHash >::const_iterator SoundClipNameMapConstIterator;
 		typedef std::pair< std::string, SoundClipPtr > SoundClipNameMapPair;
 
 		SoundClipHandleMap m_sclipHandleMap;
@@ -220,6 +220,8 @@ namespace FIFE {
 		m_renderbackend->setImageCompressingEnabled(m_settings.isGLCompressImages());
 		m_renderbackend->setFramebufferEnabled(m_settings.isGLUseFramebuffer());
 		m_renderbackend->setNPOTEnabled(m_settings.isGLUseNPOT());
+		m_renderbackend->setVertexBufferEnabled(m_settings.isGLUseVertexBuffer());
+		m_renderbackend->setShadersEnabled(m_settings.isGLUseShaders());
 		m_renderbackend->setTextureFiltering(m_settings.getGLTextureFiltering());
 		m_renderbackend->setMipmappingEnabled(m_settings.isGLUseMipmapping());
 		m_renderbackend->setMonochromeEnabled(m_settings.isGLUseMonochrome());
@@ -365,6 +367,12 @@ namespace FIFE {
 		m_eventmanager->processEvents();
 		m_timemanager->update();
 		m_soundmanager->update();
+		// upload the images that were decoded in the background
+		m_imagemanager->processAsyncLoads();
+		// pack frequently used images before anything references their textures
+		m_imagemanager->packAtlasCandidates();
+		// free images if they need more memory than allowed
+		m_imagemanager->enforceMemoryBudget();
 
 		m_targetrenderer->render();
 		if (m_model->getActiveCameraCount() == 0) {
@@ -76,6 +76,10 @@ namespace FIFE {
 		bool isGLUseFramebuffer() const;
 		void setGLUseNPOT(bool oglusenpot);
 		bool isGLUseNPOT() const;
+		void setGLUseVertexBuffer(bool oglusevbo);
+		bool isGLUseVertexBuffer() const;
+		void setGLUseShaders(bool ogluseshaders);
+		bool isGLUseShaders() const;
 		void setGLTextureFiltering(FIFE::TextureFiltering filter);
 		FIFE::TextureFiltering getGLTextureFiltering() const;
 		void setGLUseMipmapping(bool mipmapping);
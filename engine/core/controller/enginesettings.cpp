@@ -56,6 +56,8 @@ namespace FIFE {
 		m_oglcompressimages(false),
 		m_ogluseframebuffer(true),
 		m_oglusenpot(true),
+		m_oglusevbo(false),
+		m_ogluseshaders(false),
 		m_oglMipmapping(false),
 		m_oglMonochrome(false),
 		m_oglTextureFilter(TEXTURE_FILTER_NONE),
@@ -173,6 +175,14 @@ namespace FIFE {
 		m_oglusenpot = oglusenpot;
 	}
 
+	void EngineSettings::setGLUseVertexBuffer(bool oglusevbo) {
+		m_oglusevbo = oglusevbo;
+	}
+
+	void EngineSettings::setGLUseShaders(bool ogluseshaders) {
+		m_ogluseshaders = ogluseshaders;
+	}
+
 	void EngineSettings::setGLTextureFiltering(TextureFiltering filter) {
 		m_oglTextureFilter = filter;
 	}
@@ -206,6 +206,26 @@ namespace FIFE {
 			return m_oglusenpot;
 		}
 
+		/** Sets if OpenGL renderbackend should submit vertex data through vertex buffer objects (when available)
+		*/
+		void setGLUseVertexBuffer(bool oglusevbo);
+
+		/** Tells if OpenGL renderbackend should submit vertex data through vertex buffer objects
+		*/
+		bool isGLUseVertexBuffer() const {
+			return m_oglusevbo;
+		}
+
+		/** Sets if OpenGL renderbackend should render outlines and color overlays with shaders (when available)
+		*/
+		void setGLUseShaders(bool ogluseshaders);
+
+		/** Tells if OpenGL renderbackend should render outlines and color overlays with shaders
+		*/
+		bool isGLUseShaders() const {
+			return m_ogluseshaders;
+		}
+
 		/** Sets texture filtering method for OpenGL renderbackend.
 		 */
 		void setGLTextureFiltering(TextureFiltering filter);
@@ -445,6 +465,8 @@ namespace FIFE {
 		bool m_oglcompressimages;
 		bool m_ogluseframebuffer;
 		bool m_oglusenpot;
+		bool m_oglusevbo;
+		bool m_ogluseshaders;
 		bool m_oglMipmapping;
 		bool m_oglMonochrome;
 		TextureFiltering m_oglTextureFilter;
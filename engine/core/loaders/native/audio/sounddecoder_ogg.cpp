@@ -45,8 +45,8 @@ namespace FIFE {
 	namespace OGG_cb {
 		static size_t read(void *ptr, size_t size, size_t nmemb, void *datasource) {
 			RawData* rdp = reinterpret_cast<RawData*>(datasource);
-			size_t restlen = rdp->getDataLength()-rdp->getCurrentIndex();
-			size_t len = (restlen<=size*nmemb)?restlen:size*nmemb;
+			uint64_t restlen = rdp->getDataLength()-rdp->getCurrentIndex();
+			size_t len = (restlen<=size*nmemb)?static_cast<size_t>(restlen):size*nmemb;
 			if (len) {
 				rdp->readInto(reinterpret_cast<uint8_t *>(ptr), len);
 			}
@@ -57,13 +57,13 @@ namespace FIFE {
 			RawData* rdp = reinterpret_cast<RawData*>(datasource);
 			switch (whence) {
 				case SEEK_SET:
-					(*rdp).setIndex(static_cast<uint32_t>(offset));
+					(*rdp).setIndex(static_cast<uint64_t>(offset));
 					return 0;
 				case SEEK_CUR:
-					(*rdp).moveIndex(static_cast<uint32_t>(offset));
+					(*rdp).moveIndex(static_cast<int64_t>(offset));
 					return 0;
 				case SEEK_END:
-					(*rdp).setIndex( (*rdp).getDataLength() -1 + static_cast<uint32_t>(offset));
+					(*rdp).setIndex( (*rdp).getDataLength() -1 + static_cast<int64_t>(offset));
 					return 0;
 			}
 			return -1;
@@ -40,10 +40,7 @@ namespace FIFE {
 		VFS* vfs = VFS::instance();
 
 		std::unique_ptr<RawData> data(vfs->open(filename));
-		size_t datalen = data->getDataLength();
-		std::unique_ptr<uint8_t[]> darray(new uint8_t[datalen]);
-		data->readInto(darray.get(), datalen);
-		SDL_RWops* rwops = SDL_RWFromConstMem(darray.get(), static_cast<int>(datalen));
+		SDL_RWops* rwops = SDL_RWFromConstMem(data->getDataView(), static_cast<int>(data->getDataLength()));
 		if (SDL_GameControllerAddMappingsFromRW(rwops, 0) == -1) {
 			throw SDLException(std::string("Error when loading gamecontroller mappings: ") + SDL_GetError());
 		}
@@ -65,7 +65,7 @@ namespace FIFE {
 			if (data) {
 				if (data->getDataLength() != 0) {
 					// TODO - this could be expanded to do more checks
-					animFile.Parse(data->readString(data->getDataLength()).c_str());
+					animFile.Parse(data->getDataAsText());
 
 					if (animFile.Error()) {
 						return false;
@@ -82,8 +82,10 @@ namespace FIFE {
 		}
 		
 		// if we get here then loading the file went well
-		TiXmlElement* root = animFile.RootElement();
+		return isLoadable(animFile.RootElement());
+	}
 
+	bool AnimationLoader::isLoadable(const TiXmlElement* root) const {
 		if (root && root->ValueStr() == "assets") {
 			if (root->FirstChildElement("animation")) {
 				return true;
@@ -107,7 +109,7 @@ namespace FIFE {
 
 			if (data) {
 				if (data->getDataLength() != 0) {
-					doc.Parse(data->readString(data->getDataLength()).c_str());
+					doc.Parse(data->getDataAsText());
 
 					if (doc.Error()) {
 						return animation;
@@ -154,7 +156,7 @@ namespace FIFE {
 
 			if (data) {
 				if (data->getDataLength() != 0) {
-					doc.Parse(data->readString(data->getDataLength()).c_str());
+					doc.Parse(data->getDataAsText());
 
 					if (doc.Error()) {
 						return animationVector;
@@ -178,7 +180,11 @@ namespace FIFE {
 
 		// if we get here then everything loaded properly
 		// so we can just parse out the contents
-		TiXmlElement* root = doc.RootElement();
+		return loadMultiple(filename, doc.RootElement());
+	}
+
+	std::vector<AnimationPtr> AnimationLoader::loadMultiple(const std::string& filename, TiXmlElement* root) {
+		std::vector<AnimationPtr> animationVector;
 
 		if (root && root->ValueStr() == "assets") {
 			for (TiXmlElement* animationElem = root->FirstChildElement("animation"); animationElem; animationElem = animationElem->NextSiblingElement("animation")) {
@@ -62,6 +62,15 @@ namespace FIFE {
 		*/
 		virtual std::vector<AnimationPtr> loadMultiple(const std::string& filename);
 
+		/** checks if the root element of an already parsed file contains animations
+		*/
+		bool isLoadable(const TiXmlElement* root) const;
+
+		/** loads all animations of an already parsed file, filename is only
+		* used to resolve the paths inside of the file
+		*/
+		std::vector<AnimationPtr> loadMultiple(const std::string& filename, TiXmlElement* root);
+
 	private:
 		AnimationPtr loadAnimation(const std::string& filename, TiXmlElement* animationElem);
 
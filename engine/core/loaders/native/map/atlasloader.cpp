@@ -102,7 +102,7 @@ namespace FIFE {
 
 			if (data) {
 				if (data->getDataLength() != 0) {
-					atlasFile.Parse(data->readString(data->getDataLength()).c_str());
+					atlasFile.Parse(data->getDataAsText());
 
 					if (atlasFile.Error()) {
 						return false;
@@ -120,8 +120,10 @@ namespace FIFE {
 		}
 
 		// if we get here then loading the file went well
-		TiXmlElement* root = atlasFile.RootElement();
+		return isLoadable(atlasFile.RootElement());
+	}
 
+	bool AtlasLoader::isLoadable(const TiXmlElement* root) const {
 		if (root && root->ValueStr() == "assets") {
 			if (root->FirstChildElement("atlas")) {
 				return true;
@@ -149,7 +151,7 @@ namespace FIFE {
 
 			if (data) {
 				if (data->getDataLength() != 0) {
-					doc.Parse(data->readString(data->getDataLength()).c_str());
+					doc.Parse(data->getDataAsText());
 
 					if (doc.Error()) {
 						return atlas;
@@ -200,7 +202,7 @@ namespace FIFE {
 
 			if (data) {
 				if (data->getDataLength() != 0) {
-					doc.Parse(data->readString(data->getDataLength()).c_str());
+					doc.Parse(data->getDataAsText());
 
 					if (doc.Error()) {
 						return atlasVector;
@@ -224,7 +226,11 @@ namespace FIFE {
 
 		// if we get here then everything loaded properly
 		// so we can just parse out the contents
-		TiXmlElement* root = doc.RootElement();
+		return loadMultiple(filename, doc.RootElement());
+	}
+
+	std::vector<AtlasPtr> AtlasLoader::loadMultiple(const std::string& filename, TiXmlElement* root) {
+		std::vector<AtlasPtr> atlasVector;
 
 		if (root && root->ValueStr() == "assets") {
 			for (TiXmlElement* atlasElem = root->FirstChildElement("atlas"); atlasElem; atlasElem = atlasElem->NextSiblingElement("atlas")) {
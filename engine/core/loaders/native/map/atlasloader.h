@@ -113,6 +113,15 @@ namespace FIFE {
 		*/
 		virtual std::vector<AtlasPtr> loadMultiple(const std::string& filename);
 
+		/** checks if the root element of an already parsed file contains atlass
+		*/
+		bool isLoadable(const TiXmlElement* root) const;
+
+		/** loads all atlass of an already parsed file, filename is only
+		* used to resolve the paths inside of the file
+		*/
+		std::vector<AtlasPtr> loadMultiple(const std::string& filename, TiXmlElement* root);
+
 	private:
 		AtlasPtr loadAtlas(const std::string& filename, TiXmlElement* atlasElem);
 
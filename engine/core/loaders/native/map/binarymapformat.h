@@ -0,0 +1,118 @@
+/**************************************************************************
+*   Copyright (C) 2005-2019 by the FIFE team                              *
+*   http://www.fifengine.net                                              *
+*   This file is part of FIFE.                                            *
+*                                                                         *
+*   FIFE is free software; you can redistribute it and/or                 *
+*   modify it under the terms of the GNU Lesser General Public            *
+*   License as published by the Free Software Foundation; either          *
+*   version 2.1 of the License, or (at your option) any later version.    *
+*                                                                         *
+*   This library is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+*   Lesser General Public License for more details.                       *
+*                                                                         *
+*   You should have received a copy of the GNU Lesser General Public      *
+*   License along with this library; if not, write to the                 *
+*   Free Software Foundation, Inc.,                                       *
+*   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+***************************************************************************/
+
+#ifndef FIFE_BINARYMAPFORMAT_H_
+#define FIFE_BINARYMAPFORMAT_H_
+
+// Standard C++ library includes
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/base/fife_stdint.h"
+
+namespace FIFE {
+	/** Layout of the binary map files written by BinaryMapSaver and read by BinaryMapLoader.
+	 *
+	 * All values are stored in the byte order of the machine that wrote the file,
+	 * a file with another byte order is rejected. The file consists of:
+	 *  - the header
+	 *  - the string table: count, then length and characters of each string.
+	 *    All names in the file are indices into this table, index 0 is the empty string.
+	 *  - the object table: count, then namespace and id of each object
+	 *  - the imports: count, then directory and file of each import
+	 *  - the layers: count, then for each layer its properties, the instance count
+	 *    and the packed instance array
+	 *  - the cell caches: count, then for each cache its properties and the cells.
+	 *    Each cell starts with its coordinates and a set of BinaryMapCellFlags,
+	 *    only the flagged values follow.
+	 *  - the triggers
+	 *  - the cameras
+	 */
+	namespace BinaryMap {
+		const char MAGIC[4] = { 'F', 'B', 'M', 'F' };
+		// detects files written on a machine with other byte order
+		const uint32_t BYTE_ORDER_MARK = 0x01020304;
+		// increase if the layout changes
+		const uint32_t VERSION = 1;
+		const char* const EXTENSION = ".fbm";
+
+		struct Header {
+			char magic[4];
+			uint32_t byteOrder;
+			uint32_t version;
+			// number of layers, instances and cameras, for the PercentDoneListener
+			uint32_t elements;
+		};
+
+		enum LayerType {
+			LAYER_DEFAULT = 0,
+			LAYER_WALKABLE,
+			LAYER_INTERACT
+		};
+
+		enum InstanceFlags {
+			INSTANCE_BLOCKING = 0x01,
+			// the cell stack position differs from the one of the object
+			INSTANCE_CELLSTACK = 0x02,
+			// costId and cost are set
+			INSTANCE_COST = 0x04
+		};
+
+		/** One entry of the instance array of a layer.
+		 * The records are read with one copy each, so the size is a multiple of 8.
+		 */
+		struct PackedInstance {
+			double x;
+			double y;
+			double z;
+			double cost;
+			// index into the object table
+			uint32_t object;
+			// string indices
+			uint32_t id;
+			uint32_t costId;
+			int32_t rotation;
+			int32_t stackPosition;
+			uint8_t cellStack;
+			uint8_t flags;
+			uint16_t reserved;
+		};
+
+		enum CellFlags {
+			CELL_COST_MULTIPLIER = 0x01,
+			CELL_SPEED_MULTIPLIER = 0x02,
+			CELL_BLOCKER = 0x04,
+			CELL_NO_BLOCKER = 0x08,
+			CELL_NARROW = 0x10,
+			// followed by the count and the id and value of each cost
+			CELL_COSTS = 0x20,
+			// followed by the count and the ids of the areas
+			CELL_AREAS = 0x40,
+			CELL_TRANSITION = 0x80
+		};
+	}
+}
+
+#endif
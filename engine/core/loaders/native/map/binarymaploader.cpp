@@ -0,0 +1,507 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 3rd party includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "model/model.h"
+#include "model/structures/layer.h"
+#include "model/structures/instance.h"
+#include "model/structures/cell.h"
+#include "model/structures/cellcache.h"
+#include "model/structures/trigger.h"
+#include "model/structures/triggercontroller.h"
+#include "model/metamodel/grids/cellgrid.h"
+#include "model/metamodel/modelcoords.h"
+#include "model/metamodel/object.h"
+#include "vfs/fife_boost_filesystem.h"
+#include "vfs/vfs.h"
+#include "vfs/raw/rawdata.h"
+#include "util/base/exception.h"
+#include "util/log/logger.h"
+#include "util/structures/rect.h"
+#include "video/renderbackend.h"
+#include "view/visual.h"
+#include "view/camera.h"
+#include "view/renderers/instancerenderer.h"
+
+#include "binarymapformat.h"
+#include "binarymaploader.h"
+
+namespace FIFE {
+	/** Logger to use for this source file.
+	 *  @relates Logger
+	 */
+	static Logger _log(LM_NATIVE_LOADERS);
+
+	static_assert(sizeof(BinaryMap::PackedInstance) == 56, "PackedInstance must not contain padding");
+
+	namespace {
+		/** Reads values from the data of a binary map.
+		 * Every read is checked against the end of the data, so a truncated
+		 * or damaged file throws InvalidFormat instead of reading past the end.
+		 */
+		class BinaryReader {
+		public:
+			BinaryReader(const uint8_t* data, uint64_t length):
+				m_pos(data),
+				m_end(data + length) {
+			}
+
+			void readInto(void* buffer, size_t len) {
+				if (static_cast<size_t>(m_end - m_pos) < len) {
+					throw InvalidFormat("unexpected end of the binary map");
+				}
+				std::memcpy(buffer, m_pos, len);
+				m_pos += len;
+			}
+
+			template <typename T> T read() {
+				T value;
+				readInto(&value, sizeof(T));
+				return value;
+			}
+
+			/** reads a count and checks that at least count records of recordSize bytes follow
+			 */
+			uint32_t readCount(size_t recordSize) {
+				uint32_t count = read<uint32_t>();
+				if (static_cast<uint64_t>(count) * recordSize > static_cast<uint64_t>(m_end - m_pos)) {
+					throw InvalidFormat("count exceeds the size of the binary map");
+				}
+				return count;
+			}
+
+			void readStringTable() {
+				uint32_t count = readCount(sizeof(uint32_t));
+				m_strings.reserve(count);
+				for (uint32_t i = 0; i < count; ++i) {
+					uint32_t length = readCount(1);
+					m_strings.push_back(std::string(reinterpret_cast<const char*>(m_pos), length));
+					m_pos += length;
+				}
+				if (m_strings.empty()) {
+					m_strings.push_back(std::string());
+				}
+			}
+
+			const std::string& string(uint32_t index) const {
+				if (index >= m_strings.size()) {
+					throw InvalidFormat("invalid string index in the binary map");
+				}
+				return m_strings[index];
+			}
+
+			const std::string& readString() {
+				return string(read<uint32_t>());
+			}
+
+		private:
+			const uint8_t* m_pos;
+			const uint8_t* m_end;
+			std::vector<std::string> m_strings;
+		};
+
+		bool readHeader(RawData* data, BinaryMap::Header& header) {
+			if (data->getDataLength() < sizeof(header)) {
+				return false;
+			}
+			data->readAt(0, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+			return std::memcmp(header.magic, BinaryMap::MAGIC, sizeof(BinaryMap::MAGIC)) == 0;
+		}
+
+		struct PendingTransition {
+			Cell* cell;
+			Layer* layer;
+			ModelCoordinate target;
+			bool immediate;
+		};
+	}
+
+	BinaryMapLoader::BinaryMapLoader(Model* model, VFS* vfs, ImageManager* imageManager, RenderBackend* renderBackend)
+	: MapLoader(model, vfs, imageManager, renderBackend) {
+	}
+
+	BinaryMapLoader::~BinaryMapLoader() {
+	}
+
+	bool BinaryMapLoader::isLoadable(const std::string& filename) const {
+		try {
+			std::unique_ptr<RawData> data(m_vfs->open(filename));
+			BinaryMap::Header header;
+			return data && readHeader(data.get(), header);
+		}
+		catch (NotFound& e) {
+			FL_ERR(_log, e.what());
+		}
+		return false;
+	}
+
+	Map* BinaryMapLoader::load(const std::string& filename) {
+		// reset percent done listener just in case
+		// it has residual data from last load
+		m_percentDoneListener.reset();
+
+		bfs::path mapPath(filename);
+		if (HasParentPath(mapPath)) {
+			m_mapDirectory = GetParentPath(mapPath).string();
+		}
+		std::string mapFilename = mapPath.string();
+
+		std::unique_ptr<RawData> data;
+		try {
+			data.reset(m_vfs->open(mapFilename));
+		}
+		catch (NotFound& e) {
+			FL_ERR(_log, e.what());
+			return NULL;
+		}
+
+		BinaryMap::Header header;
+		if (!data || !readHeader(data.get(), header)) {
+			FL_ERR(_log, LMsg("BinaryMapLoader::load() - ") << mapFilename << " is no binary map");
+			return NULL;
+		}
+		if (header.byteOrder != BinaryMap::BYTE_ORDER_MARK || header.version != BinaryMap::VERSION) {
+			FL_ERR(_log, LMsg("BinaryMapLoader::load() - ") << mapFilename
+				<< " was written with another byte order or version, convert it again");
+			return NULL;
+		}
+		m_percentDoneListener.setTotalNumberOfElements(header.elements);
+
+		BinaryReader reader(data->getDataView(), data->getDataLength());
+		Map* map = NULL;
+		try {
+			reader.readInto(&header, sizeof(header));
+			reader.readStringTable();
+
+			map = m_model->createMap(reader.readString());
+			map->setFilename(mapFilename);
+
+			// objects are looked up once the imports are loaded
+			const uint32_t objectCount = reader.readCount(2 * sizeof(uint32_t));
+			std::vector<std::pair<uint32_t, uint32_t> > objectNames(objectCount);
+			for (uint32_t i = 0; i < objectCount; ++i) {
+				objectNames[i].first = reader.read<uint32_t>();
+				objectNames[i].second = reader.read<uint32_t>();
+			}
+
+			const uint32_t importCount = reader.readCount(2 * sizeof(uint32_t));
+			std::vector<std::string> importFiles;
+			for (uint32_t i = 0; i < importCount; ++i) {
+				const std::string& directory = reader.readString();
+				const std::string& file = reader.readString();
+				collectImport(directory, file, importFiles);
+			}
+			loadImportFiles(importFiles);
+			linkMultiObjects();
+
+			std::vector<Object*> objects(objectCount);
+			for (uint32_t i = 0; i < objectCount; ++i) {
+				const std::string& ns = reader.string(objectNames[i].first);
+				const std::string& id = reader.string(objectNames[i].second);
+				objects[i] = m_model->getObject(id, ns);
+				if (!objects[i]) {
+					FL_ERR(_log, LMsg("BinaryMapLoader::load() - ") << "Object " << ns << ":" << id
+						<< " is not loaded, its instances are skipped");
+				}
+			}
+
+			const uint32_t layerCount = reader.read<uint32_t>();
+			for (uint32_t l = 0; l < layerCount; ++l) {
+				const std::string& layerId = reader.readString();
+				const std::string& gridType = reader.readString();
+				double gridValues[7];
+				reader.readInto(gridValues, sizeof(gridValues));
+				uint8_t pathing = reader.read<uint8_t>();
+				uint8_t sorting = reader.read<uint8_t>();
+				uint8_t spatialIndex = reader.read<uint8_t>();
+				uint8_t transparency = reader.read<uint8_t>();
+				uint8_t layerType = reader.read<uint8_t>();
+				const std::string& interactId = reader.readString();
+				const uint32_t instanceCount = reader.readCount(sizeof(BinaryMap::PackedInstance));
+
+				CellGrid* grid = m_model->getCellGrid(gridType);
+				if (!grid) {
+					throw InvalidFormat("unknown grid type " + gridType);
+				}
+				grid->setXShift(gridValues[0]);
+				grid->setYShift(gridValues[1]);
+				grid->setZShift(gridValues[2]);
+				grid->setXScale(gridValues[3]);
+				grid->setYScale(gridValues[4]);
+				grid->setZScale(gridValues[5]);
+				grid->setRotation(gridValues[6]);
+
+				Layer* layer = map->createLayer(layerId, grid);
+				layer->setPathingStrategy(pathing == CELL_EDGES_AND_DIAGONALS ? CELL_EDGES_AND_DIAGONALS : CELL_EDGES_ONLY);
+				if (sorting == SORTING_LOCATION || sorting == SORTING_CAMERA_AND_LOCATION) {
+					layer->setSortingStrategy(static_cast<SortingStrategy>(sorting));
+				} else {
+					layer->setSortingStrategy(SORTING_CAMERA);
+				}
+				if (spatialIndex == SPATIAL_INDEX_LOOSE_QUADTREE) {
+					layer->setSpatialIndexStrategy(SPATIAL_INDEX_LOOSE_QUADTREE);
+				}
+				layer->setLayerTransparency(transparency);
+				if (layerType == BinaryMap::LAYER_WALKABLE) {
+					layer->setWalkable(true);
+				} else if (layerType == BinaryMap::LAYER_INTERACT) {
+					layer->setInteract(true, interactId);
+				}
+
+				std::vector<BinaryMap::PackedInstance> packedInstances(instanceCount);
+				if (instanceCount > 0) {
+					reader.readInto(&packedInstances[0], instanceCount * sizeof(BinaryMap::PackedInstance));
+				}
+
+				// the instances of the layer are created in one go, the
+				// packed instances of unknown objects are skipped
+				std::vector<InstanceDescriptor> descriptors;
+				std::vector<const BinaryMap::PackedInstance*> createdPacked;
+				descriptors.reserve(instanceCount);
+				createdPacked.reserve(instanceCount);
+				for (uint32_t i = 0; i < instanceCount; ++i) {
+					const BinaryMap::PackedInstance& packed = packedInstances[i];
+					if (packed.object >= objectCount) {
+						throw InvalidFormat("invalid object index in the binary map");
+					}
+					Object* object = objects[packed.object];
+					if (object) {
+						descriptors.push_back(InstanceDescriptor(object, ExactModelCoordinate(packed.x, packed.y, packed.z),
+							reader.string(packed.id)));
+						createdPacked.push_back(&packed);
+					} else {
+						// increment % done counter
+						m_percentDoneListener.incrementCount();
+					}
+				}
+
+				std::vector<Instance*> created = layer->createInstances(descriptors);
+				for (size_t i = 0; i < created.size(); ++i) {
+					Instance* inst = created[i];
+					const BinaryMap::PackedInstance& packed = *createdPacked[i];
+					inst->setRotation(packed.rotation);
+					InstanceVisual* instVisual = InstanceVisual::create(inst);
+					instVisual->setStackPosition(packed.stackPosition);
+					if (packed.flags & BinaryMap::INSTANCE_CELLSTACK) {
+						inst->setCellStackPosition(packed.cellStack);
+					}
+					if (packed.flags & BinaryMap::INSTANCE_COST) {
+						inst->setCost(reader.string(packed.costId), packed.cost);
+					}
+					bool blocking = (packed.flags & BinaryMap::INSTANCE_BLOCKING) != 0;
+					if (blocking != inst->isBlocking()) {
+						inst->setOverrideBlocking(true);
+						inst->setBlocking(blocking);
+					}
+					if (inst->getObject()->getAction("default")) {
+						Location target(layer);
+
+						inst->actRepeat("default", target);
+					}
+
+					// increment % done counter
+					m_percentDoneListener.incrementCount();
+				}
+
+				// increment % done counter
+				m_percentDoneListener.incrementCount();
+			}
+
+			// init CellCaches
+			map->initializeCellCaches();
+			// transitions are created after the caches are finalized
+			std::vector<PendingTransition> transitions;
+			const uint32_t cacheCount = reader.read<uint32_t>();
+			for (uint32_t c = 0; c < cacheCount; ++c) {
+				Layer* layer = map->getLayer(reader.readString());
+				double cacheCost = reader.read<double>();
+				double cacheSpeed = reader.read<double>();
+				uint8_t searchNarrow = reader.read<uint8_t>();
+				CellCache* cache = layer ? layer->getCellCache() : NULL;
+				if (!cache) {
+					throw InvalidFormat("cell cache without walkable layer in the binary map");
+				}
+				cache->setSearchNarrowCells(searchNarrow != 0);
+				cache->setDefaultCostMultiplier(cacheCost);
+				cache->setDefaultSpeedMultiplier(cacheSpeed);
+
+				const uint32_t cellCount = reader.read<uint32_t>();
+				for (uint32_t i = 0; i < cellCount; ++i) {
+					int32_t cellX = reader.read<int32_t>();
+					int32_t cellY = reader.read<int32_t>();
+					uint8_t flags = reader.read<uint8_t>();
+					Cell* cell = cache->createCell(ModelCoordinate(cellX, cellY));
+
+					if (flags & BinaryMap::CELL_NO_BLOCKER) {
+						cell->setCellType(CTYPE_CELL_NO_BLOCKER);
+					} else if (flags & BinaryMap::CELL_BLOCKER) {
+						cell->setCellType(CTYPE_CELL_BLOCKER);
+					}
+					if (flags & BinaryMap::CELL_COST_MULTIPLIER) {
+						cell->setCostMultiplier(reader.read<double>());
+					}
+					if (flags & BinaryMap::CELL_SPEED_MULTIPLIER) {
+						cell->setSpeedMultiplier(reader.read<double>());
+					}
+					if (flags & BinaryMap::CELL_NARROW) {
+						cache->addNarrowCell(cell);
+					}
+					if (flags & BinaryMap::CELL_COSTS) {
+						const uint32_t costCount = reader.readCount(sizeof(uint32_t) + sizeof(double));
+						for (uint32_t j = 0; j < costCount; ++j) {
+							const std::string& costId = reader.readString();
+							double cost = reader.read<double>();
+							cache->registerCost(costId, cost);
+							cache->addCellToCost(costId, cell);
+						}
+					}
+					if (flags & BinaryMap::CELL_AREAS) {
+						const uint32_t areaCount = reader.readCount(sizeof(uint32_t));
+						for (uint32_t j = 0; j < areaCount; ++j) {
+							cache->addCellToArea(reader.readString(), cell);
+						}
+					}
+					if (flags & BinaryMap::CELL_TRANSITION) {
+						PendingTransition transition;
+						transition.cell = cell;
+						transition.layer = map->getLayer(reader.readString());
+						if (!transition.layer) {
+							transition.layer = layer;
+						}
+						transition.target.x = reader.read<int32_t>();
+						transition.target.y = reader.read<int32_t>();
+						transition.target.z = reader.read<int32_t>();
+						transition.immediate = reader.read<uint8_t>() != 0;
+						transitions.push_back(transition);
+					}
+				}
+			}
+			// finalize CellCaches
+			map->finalizeCellCaches();
+			// add Transistions
+			for (std::vector<PendingTransition>::iterator it = transitions.begin(); it != transitions.end(); ++it) {
+				it->cell->createTransition(it->layer, it->target, it->immediate);
+			}
+
+			TriggerController* triggerController = map->getTriggerController();
+			const uint32_t triggerCount = reader.read<uint32_t>();
+			for (uint32_t t = 0; t < triggerCount; ++t) {
+				Trigger* trigger = triggerController->createTrigger(reader.readString());
+				if (reader.read<uint8_t>() != 0) {
+					trigger->setTriggered();
+				}
+				if (reader.read<uint8_t>() != 0) {
+					trigger->enableForAllInstances();
+				}
+				const std::string& attachedId = reader.readString();
+				Layer* attachedLayer = map->getLayer(reader.readString());
+				if (attachedLayer && !attachedId.empty()) {
+					Instance* instance = attachedLayer->getInstance(attachedId);
+					if (instance) {
+						trigger->attach(instance);
+					}
+				}
+				const uint32_t cellCount = reader.readCount(3 * sizeof(uint32_t));
+				for (uint32_t i = 0; i < cellCount; ++i) {
+					Layer* layer = map->getLayer(reader.readString());
+					int32_t x = reader.read<int32_t>();
+					int32_t y = reader.read<int32_t>();
+					if (layer) {
+						trigger->assign(layer, ModelCoordinate(x, y));
+					}
+				}
+				const uint32_t instanceCount = reader.readCount(2 * sizeof(uint32_t));
+				for (uint32_t i = 0; i < instanceCount; ++i) {
+					Layer* layer = map->getLayer(reader.readString());
+					const std::string& instanceId = reader.readString();
+					Instance* instance = layer ? layer->getInstance(instanceId) : NULL;
+					if (instance) {
+						trigger->enableForInstance(instance);
+					}
+				}
+				const uint32_t conditionCount = reader.readCount(sizeof(int32_t));
+				for (uint32_t i = 0; i < conditionCount; ++i) {
+					trigger->addTriggerCondition(static_cast<TriggerCondition>(reader.read<int32_t>()));
+				}
+			}
+
+			const uint32_t cameraCount = reader.read<uint32_t>();
+			for (uint32_t c = 0; c < cameraCount; ++c) {
+				const std::string& cameraId = reader.readString();
+				double zoom = reader.read<double>();
+				double tilt = reader.read<double>();
+				double rotation = reader.read<double>();
+				bool zToYEnabled = reader.read<uint8_t>() != 0;
+				double zToY = reader.read<double>();
+				int32_t viewport[4];
+				reader.readInto(viewport, sizeof(viewport));
+				int32_t refCellWidth = reader.read<int32_t>();
+				int32_t refCellHeight = reader.read<int32_t>();
+				float lightingColor[3];
+				reader.readInto(lightingColor, sizeof(lightingColor));
+
+				Camera* cam = map->addCamera(cameraId, Rect(viewport[0], viewport[1], viewport[2], viewport[3]));
+				cam->setCellImageDimensions(refCellWidth, refCellHeight);
+				cam->setRotation(rotation);
+				cam->setTilt(tilt);
+				cam->setZoom(zoom);
+				if (zToYEnabled) {
+					cam->setZToY(zToY);
+				}
+				if (lightingColor[0] < 1.0f || lightingColor[1] < 1.0f || lightingColor[2] < 1.0f) {
+					cam->setLightingColor(lightingColor[0], lightingColor[1], lightingColor[2]);
+				}
+
+				// active instance renderer for camera
+				InstanceRenderer* instanceRenderer = InstanceRenderer::getInstance(cam);
+				if (instanceRenderer) {
+					instanceRenderer->activateAllLayers(map);
+				}
+
+				// increment % done counter
+				m_percentDoneListener.incrementCount();
+			}
+		}
+		catch (Exception& e) {
+			FL_ERR(_log, LMsg("BinaryMapLoader::load() - ") << "Failed to load " << mapFilename << ": " << e.what());
+			if (map) {
+				m_model->deleteMap(map);
+			} else if (dynamic_cast<NameClash*>(&e)) {
+				// the map exists already, rethrow to client like MapLoader
+				throw;
+			}
+			return NULL;
+		}
+
+		return map;
+	}
+}
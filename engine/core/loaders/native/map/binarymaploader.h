@@ -1,4 +1,4 @@
-/***************************************************************************
+/**************************************************************************
 *   Copyright (C) 2005-2019 by the FIFE team                              *
 *   http://www.fifengine.net                                              *
 *   This file is part of FIFE.                                            *
@@ -18,13 +18,12 @@
 *   Free Software Foundation, Inc.,                                       *
 *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
 ***************************************************************************/
-#ifndef FIFE_VFS_ZIP_ZIPTREE_H
-#define FIFE_VFS_ZIP_ZIPTREE_H
+
+#ifndef FIFE_BINARYMAPLOADER_H_
+#define FIFE_BINARYMAPLOADER_H_
 
 // Standard C++ library includes
 #include <string>
-#include <vector>
-#include <ostream>
 
 // 3rd party library includes
 
@@ -33,53 +32,33 @@
 // First block: files included from the FIFE root src directory
 // Second block: files included from the same folder
 
+#include "maploader.h"
 
 namespace FIFE {
 
-    class ZipNode;
-
-    class ZipTree {
-    public:
-        /** constructor
-         */
-        ZipTree();
-
-        /** destructor
-         */
-        ~ZipTree();
+	/** Loads maps written by BinaryMapSaver.
+	*
+	* The map content is read from packed arrays instead of xml elements, the
+	* imports are loaded like the ones of xml maps, with the object, animation
+	* and atlas loaders of MapLoader.
+	* @see BinaryMap
+	*/
+	class BinaryMapLoader : public MapLoader {
+	public:
+		BinaryMapLoader(Model* model, VFS* vfs, ImageManager* imageManager, RenderBackend* renderBackend);
 
-        /** adds a node to the proper place in the tree
-         *  based on the node path name
-         *  @param nodePath the node description
-         *  @return ZipNode of the most derived path added
-                    (value after the last path separator)
-                    or NULL if the path could not be added
-         */
-         ZipNode* addNode(const std::string& nodePath);
+		~BinaryMapLoader();
 
-        /** accessor for getting a node by name
-         *  @param name the name to search for
-         *  @ param ZipNode pointer, or NULL if not found
-         */
-        ZipNode* getNode(const std::string& name) const;
+		/** 
+		* @see IMapLoader::isLoadable
+		*/
+		bool isLoadable(const std::string& filename) const;
 
-        /** accessor for the root node of the tree
-         *  mostly used for debugging purposes
-         *  @return ZipNode pointer to the root node
-         */
-        ZipNode* getRootNode() const;
-    private:
-        ZipNode* m_rootNode;
-    };
+		/** 
+		* @see IMapLoader::load
+		*/
+		Map* load(const std::string& filename);
+	};
 }
 
-/** debug stream for a zip tree
- *  useful for debugging
- *  @param os output stream
- *  @param zipTree the ZipTree to output
- *  @return os output stream to allow for chaining
- */
-std::ostream& operator<<(std::ostream& os, const FIFE::ZipTree& zipTree);
-
-
 #endif
@@ -20,7 +20,11 @@
  ***************************************************************************/
 
 // Standard C++ library includes
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 // 3rd party includes
@@ -68,6 +72,76 @@ namespace FIFE {
 	 */
 	static Logger _log(LM_NATIVE_LOADERS);
 
+	namespace {
+		/** an import file parsed ahead of registering its contents
+		 */
+		struct ParsedImport {
+			ParsedImport() : parsed(false) {}
+
+			TiXmlDocument document;
+			bool parsed;
+		};
+
+		bool parseImportFile(VFS* vfs, const std::string& file, TiXmlDocument& document) {
+			// runs on the worker threads, so nothing may escape from here
+			try {
+				std::unique_ptr<RawData> data(vfs->open(file));
+				if (!data || data->getDataLength() == 0) {
+					return false;
+				}
+				document.Parse(data->getDataAsText());
+				return !document.Error();
+			} catch (std::exception&) {
+				return false;
+			}
+		}
+
+		/** attributes of an instance element, applied after Layer::createInstances
+		 */
+		struct InstanceAttributes {
+			InstanceAttributes()
+				: element(NULL), costId(NULL), r(0), rRetVal(TIXML_NO_ATTRIBUTE), stackpos(0), stackRetVal(TIXML_NO_ATTRIBUTE),
+				  cellStack(0), cellStackRetVal(TIXML_NO_ATTRIBUTE) {}
+
+			const TiXmlElement* element;
+			const std::string* costId;
+			int r;
+			int rRetVal;
+			int stackpos;
+			int stackRetVal;
+			int cellStack;
+			int cellStackRetVal;
+		};
+
+		/** worker of parseImportFiles, takes the next unparsed file until all are done
+		 */
+		void parseImportFilesWorker(VFS* vfs, const std::vector<std::string>* files, std::vector<ParsedImport>* imports, std::atomic<size_t>* next) {
+			for (size_t i = (*next)++; i < files->size(); i = (*next)++) {
+				(*imports)[i].parsed = parseImportFile(vfs, (*files)[i], (*imports)[i].document);
+			}
+		}
+
+		/** parses the import files on several threads, the documents
+		 * are independent of each other and the vfs can be read concurrently
+		 */
+		void parseImportFiles(VFS* vfs, const std::vector<std::string>& files, std::vector<ParsedImport>& imports) {
+			size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), 8);
+			threads = std::min(threads, files.size());
+
+			std::atomic<size_t> next(0);
+			std::vector<std::thread> workers;
+			for (size_t t = 1; t < threads; ++t) {
+				workers.push_back(std::thread(parseImportFilesWorker, vfs, &files, &imports, &next));
+			}
+			// the calling thread parses as well
+			parseImportFilesWorker(vfs, &files, &imports, &next);
+
+			for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it) {
+				it->join();
+			}
+		}
+	}
+
 	MapLoader::MapLoader(Model* model, VFS* vfs, ImageManager* imageManager, RenderBackend* renderBackend)
 	: m_model(model), m_vfs(vfs), m_imageManager(imageManager), m_animationManager(AnimationManager::instance()), m_renderBackend(renderBackend),
 	  m_loaderName("fife"), m_mapDirectory("") {
@@ -105,7 +179,7 @@ namespace FIFE {
 
 			if (data) {
 				if (data->getDataLength() != 0) {
-					mapFile.Parse(data->readString(data->getDataLength()).c_str());
+					mapFile.Parse(data->getDataAsText());
 
 					if (mapFile.Error()) {
 						std::ostringstream oss;
@@ -168,59 +242,15 @@ namespace FIFE {
 					map->setFilename(mapFilename);
 
 					std::string ns = "";
+					std::vector<std::string> importFiles;
 					for (const TiXmlElement *importElement = root->FirstChildElement("import"); importElement; importElement = importElement->NextSiblingElement("import")) {
 						const std::string* importDir = importElement->Attribute(std::string("dir"));
 						const std::string* importFile = importElement->Attribute(std::string("file"));
 
-						std::string directory = "";
-						if (importDir) {
-							directory = *importDir;
-						}
-
-						std::string file = "";
-						if (importFile) {
-							file = *importFile;
-						}
-
-						if (importDir && !importFile) {
-							bfs::path fullPath(m_mapDirectory);
-							fullPath /= directory;
-							loadImportDirectory(fullPath.string());
-						}
-						else if (importFile) {
-							bfs::path fullFilePath(file);
-							bfs::path fullDirPath(directory);
-							if (importDir) {
-								fullDirPath = bfs::path(m_mapDirectory);
-								fullDirPath /= directory;
-							}
-							else {
-								fullFilePath = bfs::path(m_mapDirectory);
-								fullFilePath /= file;
-							}
-							loadImportFile(fullFilePath.string(), fullDirPath.string());
-						}
-					}
-					// converts multiobject part id to object pointer
-					std::list<std::string> namespaces = m_model->getNamespaces();
-					std::list<std::string>::iterator name_it = namespaces.begin();
-					for (; name_it != namespaces.end(); ++name_it) {
-						std::list<Object*> objects = m_model->getObjects(*name_it);
-						std::list<Object*>::iterator object_it = objects.begin();
-						for (; object_it != objects.end(); ++object_it) {
-							if ((*object_it)->isMultiObject()) {
-								const std::list<std::string>& multiParts = (*object_it)->getMultiPartIds();
-								std::list<std::string>::const_iterator multi_it = multiParts.begin();
-								for (; multi_it != multiParts.end(); ++multi_it) {
-									Object* partObj = m_model->getObject(*multi_it, *name_it);
-									if (partObj) {
-										partObj->setMultiPart(true);
-										(*object_it)->addMultiPart(partObj);
-									}
-								}
-							}
-						}
+						collectImport(importDir ? *importDir : "", importFile ? *importFile : "", importFiles);
 					}
+					loadImportFiles(importFiles);
+					linkMultiObjects();
 
 					// iterate over elements looking for layers
 					for (const TiXmlElement* layerElement = root->FirstChildElement("layer"); layerElement; layerElement = layerElement->NextSiblingElement("layer")) {
@@ -244,6 +274,7 @@ namespace FIFE {
 						const std::string* layerName = layerElement->Attribute(std::string("id"));
 						const std::string* pathing = layerElement->Attribute(std::string("pathing"));
 						const std::string* sorting = layerElement->Attribute(std::string("sorting"));
+						const std::string* spatialIndex = layerElement->Attribute(std::string("spatial_index"));
 						const std::string* gridType = layerElement->Attribute(std::string("grid_type"));
 						const std::string* layerType = layerElement->Attribute(std::string("layer_type"));
 						const std::string* layerTypeName = layerElement->Attribute(std::string("layer_type_id"));
@@ -300,6 +331,9 @@ namespace FIFE {
 								if (layer) {
 									layer->setPathingStrategy(pathStrategy);
 									layer->setSortingStrategy(sortStrategy);
+									if (spatialIndex && *spatialIndex == "loose_quadtree") {
+										layer->setSpatialIndexStrategy(SPATIAL_INDEX_LOOSE_QUADTREE);
+									}
 									if (layerType) {
 										if (*layerType == "walkable") {
 											layer->setWalkable(true);
@@ -311,18 +345,22 @@ namespace FIFE {
 									double curr_x = 0;
 									double curr_y = 0;
 
+									// the instances of the layer are created in one go,
+									// their attributes are applied afterwards
+									std::vector<InstanceDescriptor> descriptors;
+									std::vector<InstanceAttributes> attributes;
+
 									for (const TiXmlElement* instances = layerElement->FirstChildElement("instances"); instances; instances = instances->NextSiblingElement("instances")) {
 										for (const TiXmlElement* instance = instances->FirstChildElement("i"); instance; instance = instance->NextSiblingElement("i")) {
 											double x = 0;
 											double y = 0;
 											double z = 0;
-											int r = 0;
-											int stackpos = 0;
-											int cellStack = 0;
+											InstanceAttributes attribute;
+											attribute.element = instance;
 
 											const std::string* instanceId = instance->Attribute(std::string("id"));
 											const std::string* objectId = instance->Attribute(std::string("o"));
-											const std::string* costId = instance->Attribute(std::string("cost_id"));
+											attribute.costId = instance->Attribute(std::string("cost_id"));
 
 											if (!objectId) {
 												objectId = instance->Attribute(std::string("object"));
@@ -341,7 +379,7 @@ namespace FIFE {
 											int xRetVal = instance->QueryValueAttribute("x", &x);
 											int yRetVal = instance->QueryValueAttribute("y", &y);
 											instance->QueryValueAttribute("z", &z);
-											int rRetVal = instance->QueryValueAttribute("r", &r);
+											attribute.rRetVal = instance->QueryValueAttribute("r", &attribute.r);
 
 											if (xRetVal == TIXML_SUCCESS) {
 												curr_x = x;
@@ -357,81 +395,78 @@ namespace FIFE {
 												y = curr_y;
 											}
 
-											if (rRetVal != TIXML_SUCCESS) {
-												rRetVal = instance->QueryValueAttribute("rotation", &r);
+											if (attribute.rRetVal != TIXML_SUCCESS) {
+												attribute.rRetVal = instance->QueryValueAttribute("rotation", &attribute.r);
 											}
 
-											int stackRetVal = instance->QueryValueAttribute("stackpos", &stackpos);
-											int cellStackRetVal = instance->QueryValueAttribute("cellstack", &cellStack);
+											attribute.stackRetVal = instance->QueryValueAttribute("stackpos", &attribute.stackpos);
+											attribute.cellStackRetVal = instance->QueryValueAttribute("cellstack", &attribute.cellStack);
 
+											Object* object = NULL;
 											if (objectId) {
 												if (namespaceId) {
 													ns = *namespaceId;
 												}
 
-												Object* object = m_model->getObject(*objectId, ns);
-
-												if (object) {
-													Instance* inst = NULL;
-													if (instanceId) {
-														inst = layer->createInstance(object, ExactModelCoordinate(x,y,z), *instanceId);
-													}
-													else {
-														inst = layer->createInstance(object, ExactModelCoordinate(x,y,z));
-													}
-
-													if (inst) {
-														if (rRetVal != TIXML_SUCCESS) {
-															ObjectVisual* objVisual = object->getVisual<ObjectVisual>();
-															std::vector<int> angles;
-															objVisual->getStaticImageAngles(angles);
-															if (!angles.empty()) {
-																r = angles[0];
-															}
-														}
+												object = m_model->getObject(*objectId, ns);
+											}
 
-														inst->setRotation(r);
+											if (object) {
+												descriptors.push_back(InstanceDescriptor(object, ExactModelCoordinate(x,y,z), instanceId ? *instanceId : ""));
+												attributes.push_back(attribute);
+											}
+											else {
+												// increment % done counter
+												m_percentDoneListener.incrementCount();
+											}
+										}
+									}
 
-														InstanceVisual* instVisual = InstanceVisual::create(inst);
+									std::vector<Instance*> created = layer->createInstances(descriptors);
+									assert(created.size() == attributes.size());
+									for (size_t index = 0; index < created.size(); ++index) {
+										Instance* inst = created[index];
+										Object* object = inst->getObject();
+										const InstanceAttributes& attribute = attributes[index];
+
+										int r = attribute.r;
+										if (attribute.rRetVal != TIXML_SUCCESS) {
+											ObjectVisual* objVisual = object->getVisual<ObjectVisual>();
+											std::vector<int> angles;
+											objVisual->getStaticImageAngles(angles);
+											if (!angles.empty()) {
+												r = angles[0];
+											}
+										}
 
-														if  (instVisual && (stackRetVal == TIXML_SUCCESS)) {
-															instVisual->setStackPosition(stackpos);
-														}
+										inst->setRotation(r);
 
-														if  (cellStackRetVal == TIXML_SUCCESS) {
-															inst->setCellStackPosition(cellStack);
-														}
+										InstanceVisual* instVisual = InstanceVisual::create(inst);
 
-														if (costId) {
-															double cost = 0;
-															int costRetVal = instance->QueryValueAttribute("cost", &cost);
-															if (costRetVal == TIXML_SUCCESS) {
-																inst->setCost(*costId, cost);
-															}
-														}
+										if  (instVisual && (attribute.stackRetVal == TIXML_SUCCESS)) {
+											instVisual->setStackPosition(attribute.stackpos);
+										}
 
-														if (object->getAction("default")) {
-															Location target(layer);
+										if  (attribute.cellStackRetVal == TIXML_SUCCESS) {
+											inst->setCellStackPosition(attribute.cellStack);
+										}
 
-															inst->actRepeat("default", target);
-														}
-													}
-													else
-													{
-														std::ostringstream oss;
-														oss << " Failed to create instance of object "
-															<< *objectId
-															<< " : " << __FILE__
-															<< " [" << __LINE__ << "]"
-															<< std::endl;
-														FL_ERR(_log, oss.str());
-													}
-												}
+										if (attribute.costId) {
+											double cost = 0;
+											int costRetVal = attribute.element->QueryValueAttribute("cost", &cost);
+											if (costRetVal == TIXML_SUCCESS) {
+												inst->setCost(*attribute.costId, cost);
 											}
+										}
+
+										if (object->getAction("default")) {
+											Location target(layer);
 
-											// increment % done counter
-											m_percentDoneListener.incrementCount();
+											inst->actRepeat("default", target);
 										}
+
+										// increment % done counter
+										m_percentDoneListener.incrementCount();
 									}
 								}
 							}
@@ -725,6 +760,136 @@ namespace FIFE {
 		return map;
 	}
 
+	void MapLoader::collectImport(const std::string& directory, const std::string& file, std::vector<std::string>& files) {
+		if (!directory.empty() && file.empty()) {
+			bfs::path fullPath(m_mapDirectory);
+			fullPath /= directory;
+			collectImportDirectory(fullPath.string(), files);
+		}
+		else if (!file.empty()) {
+			bfs::path fullFilePath(file);
+			bfs::path fullDirPath(directory);
+			if (!directory.empty()) {
+				fullDirPath = bfs::path(m_mapDirectory);
+				fullDirPath /= directory;
+			}
+			else {
+				fullFilePath = bfs::path(m_mapDirectory);
+				fullFilePath /= file;
+			}
+			bfs::path importFilePath(fullDirPath);
+			importFilePath /= fullFilePath;
+			files.push_back(importFilePath.string());
+		}
+	}
+
+	void MapLoader::collectImportDirectory(const std::string& directory, std::vector<std::string>& files) {
+		if (!directory.empty()) {
+			bfs::path importDirectory(directory);
+			std::string importDirectoryString = importDirectory.string();
+
+			std::set<std::string> directoryFiles = m_vfs->listFiles(importDirectoryString);
+
+			// load all xml files in the directory
+			std::set<std::string>::iterator iter;
+			for (iter = directoryFiles.begin(); iter != directoryFiles.end(); ++iter) {
+				// TODO - vtchill - may need a way to allow clients to load things other
+				// than .xml and .zip files
+				std::string ext = bfs::extension(*iter);
+				if (ext == ".xml" || ext == ".zip") {
+					bfs::path importFilePath(importDirectoryString);
+					importFilePath /= *iter;
+					files.push_back(importFilePath.string());
+				}
+			}
+
+			std::set<std::string> nestedDirectories = m_vfs->listDirectories(importDirectoryString);
+			for (iter  = nestedDirectories.begin(); iter != nestedDirectories.end(); ++iter) {
+				// do not attempt to load anything from a .svn directory
+				if ((*iter).find(".svn") == std::string::npos) {
+					collectImportDirectory(importDirectoryString + "/" + *iter, files);
+				}
+			}
+		}
+	}
+
+	void MapLoader::loadImportFiles(const std::vector<std::string>& files) {
+		if (files.empty() || !m_objectLoader) {
+			return;
+		}
+
+		// the native loaders can work on the parsed files, all others
+		// are handed the filenames and read the files themselves
+		AtlasLoaderPtr atlasLoaderPtr = m_objectLoader->getAtlasLoader();
+		AnimationLoaderPtr animationLoaderPtr = m_objectLoader->getAnimationLoader();
+		AtlasLoader* atlasLoader = dynamic_cast<AtlasLoader*>(atlasLoaderPtr.get());
+		AnimationLoader* animationLoader = dynamic_cast<AnimationLoader*>(animationLoaderPtr.get());
+		ObjectLoader* objectLoader = dynamic_cast<ObjectLoader*>(m_objectLoader.get());
+
+		std::vector<ParsedImport> imports(files.size());
+		if (atlasLoader || animationLoader || objectLoader) {
+			parseImportFiles(m_vfs, files, imports);
+		}
+
+		// the parsed files are registered in import order so the resulting
+		// objects, animations and atlases do not depend on the thread timing
+		for (size_t i = 0; i < files.size(); ++i) {
+			const std::string& file = files[i];
+			TiXmlElement* root = imports[i].parsed ? imports[i].document.RootElement() : NULL;
+
+			// files that could not be parsed go through the file based
+			// functions so the errors are reported as before
+			if (atlasLoaderPtr) {
+				if (atlasLoader && imports[i].parsed) {
+					if (atlasLoader->isLoadable(root)) {
+						atlasLoader->loadMultiple(file, root);
+					}
+				} else if (atlasLoaderPtr->isLoadable(file)) {
+					atlasLoaderPtr->loadMultiple(file);
+				}
+			}
+			if (animationLoaderPtr) {
+				if (animationLoader && imports[i].parsed) {
+					if (animationLoader->isLoadable(root)) {
+						animationLoader->loadMultiple(file, root);
+					}
+				} else if (animationLoaderPtr->isLoadable(file)) {
+					animationLoaderPtr->loadMultiple(file);
+				}
+			}
+			if (objectLoader && imports[i].parsed) {
+				if (objectLoader->isLoadable(root)) {
+					objectLoader->load(file, root);
+				}
+			} else if (m_objectLoader->isLoadable(file)) {
+				m_objectLoader->load(file);
+			}
+		}
+	}
+
+	void MapLoader::linkMultiObjects() {
+		// converts multiobject part id to object pointer
+		std::list<std::string> namespaces = m_model->getNamespaces();
+		std::list<std::string>::iterator name_it = namespaces.begin();
+		for (; name_it != namespaces.end(); ++name_it) {
+			std::list<Object*> objects = m_model->getObjects(*name_it);
+			std::list<Object*>::iterator object_it = objects.begin();
+			for (; object_it != objects.end(); ++object_it) {
+				if ((*object_it)->isMultiObject()) {
+					const std::list<std::string>& multiParts = (*object_it)->getMultiPartIds();
+					std::list<std::string>::const_iterator multi_it = multiParts.begin();
+					for (; multi_it != multiParts.end(); ++multi_it) {
+						Object* partObj = m_model->getObject(*multi_it, *name_it);
+						if (partObj) {
+							partObj->setMultiPart(true);
+							(*object_it)->addMultiPart(partObj);
+						}
+					}
+				}
+			}
+		}
+	}
+
 	void MapLoader::setObjectLoader(const FIFE::ObjectLoaderPtr& objectLoader) {
 		assert(objectLoader);
 
@@ -773,7 +938,7 @@ namespace FIFE {
 
 			if (data) {
 				if (data->getDataLength() != 0) {
-					mapFile.Parse(data->readString(data->getDataLength()).c_str());
+					mapFile.Parse(data->getDataAsText());
 
 					if (mapFile.Error()) {
 						return false;
@@ -813,45 +978,14 @@ namespace FIFE {
 			bfs::path importFilePath(directory);
 			importFilePath /= file;
 
-			std::string importFileString = importFilePath.string();
-			if (m_objectLoader && m_objectLoader->getAtlasLoader() && m_objectLoader->getAtlasLoader()->isLoadable(importFileString)) {
-				m_objectLoader->getAtlasLoader()->loadMultiple(importFileString);
-			}
-			if (m_objectLoader && m_objectLoader->getAnimationLoader() && m_objectLoader->getAnimationLoader()->isLoadable(importFileString)) {
-				m_objectLoader->getAnimationLoader()->loadMultiple(importFileString);
-			}
-			if (m_objectLoader && m_objectLoader->isLoadable(importFileString)) {
-				m_objectLoader->load(importFileString);
-			}
+			loadImportFiles(std::vector<std::string>(1, importFilePath.string()));
 		}
 	}
 
 	void MapLoader::loadImportDirectory(const std::string& directory) {
-		if (!directory.empty()) {
-			bfs::path importDirectory(directory);
-			std::string importDirectoryString = importDirectory.string();
-
-			std::set<std::string> files = m_vfs->listFiles(importDirectoryString);
-
-			// load all xml files in the directory
-			std::set<std::string>::iterator iter;
-			for (iter = files.begin(); iter != files.end(); ++iter) {
-				// TODO - vtchill - may need a way to allow clients to load things other
-				// than .xml and .zip files
-				std::string ext = bfs::extension(*iter);
-				if (ext == ".xml" || ext == ".zip") {
-					loadImportFile(*iter, importDirectoryString);
-				}
-			}
-
-			std::set<std::string> nestedDirectories = m_vfs->listDirectories(importDirectoryString);
-			for (iter  = nestedDirectories.begin(); iter != nestedDirectories.end(); ++iter) {
-				// do not attempt to load anything from a .svn directory
-				if ((*iter).find(".svn") == std::string::npos) {
-					loadImportDirectory(importDirectoryString + "/" + *iter);
-				}
-			}
-		}
+		std::vector<std::string> files;
+		collectImportDirectory(directory, files);
+		loadImportFiles(files);
 	}
 
 	void MapLoader::addPercentDoneListener(PercentDoneListener* listener) {
@@ -118,7 +118,28 @@ namespace FIFE {
 		*/
 		const std::string& getLoaderName() const;
 
-	private:
+	protected:
+		/** adds the files of an import of the map to files, in the
+		* order they are loaded, directory and file are relative to the
+		* location of the map file, an empty file imports the whole directory
+		*/
+		void collectImport(const std::string& directory, const std::string& file, std::vector<std::string>& files);
+
+		/** adds the object files of a directory and its nested
+		* directories to files
+		*/
+		void collectImportDirectory(const std::string& directory, std::vector<std::string>& files);
+
+		/** loads object, animation and atlas files, the files are
+		* parsed in parallel and their contents registered in order
+		*/
+		void loadImportFiles(const std::vector<std::string>& files);
+
+		/** converts the multi part ids of the loaded objects to object pointers,
+		* called once all imports are loaded
+		*/
+		void linkMultiObjects();
+
 		Model* m_model;
 		VFS* m_vfs;
 		ImageManager* m_imageManager;
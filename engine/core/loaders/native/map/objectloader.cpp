@@ -103,7 +103,7 @@ namespace FIFE {
 
 			if (data) {
 				if (data->getDataLength() != 0) {
-					objectFile.Parse(data->readString(data->getDataLength()).c_str());
+					objectFile.Parse(data->getDataAsText());
 
 					if (objectFile.Error()) {
 						 std::ostringstream oss;
@@ -162,14 +162,16 @@ namespace FIFE {
 		}
 
 		// if we get here then loading the file went well
-		TiXmlElement* root = objectFile.RootElement();
+		return isLoadable(objectFile.RootElement());
+	}
 
+	bool ObjectLoader::isLoadable(const TiXmlElement* root) const {
 		if (root && root->ValueStr() == "assets") {
 			if (root->FirstChildElement("object")) {
 				return true;
 			}
 		}
-			
+
 		return false;
 	}
 
@@ -183,7 +185,7 @@ namespace FIFE {
 
 			if (data) {
 				if (data->getDataLength() != 0) {
-					objectFile.Parse(data->readString(data->getDataLength()).c_str());
+					objectFile.Parse(data->getDataAsText());
 
 					if (objectFile.Error()) {
 						return;
@@ -210,13 +212,19 @@ namespace FIFE {
 
 			return;
 		}
+
+		// if we get here then loading the file went well
+		load(filename, objectFile.RootElement());
+	}
+
+	void ObjectLoader::load(const std::string& filename, TiXmlElement* root) {
+		bfs::path objectPath(filename);
+
 		std::string objectDirectory = "";
 		if (HasParentPath(objectPath)) {
 			objectDirectory = GetParentPath(objectPath).string();
 		}
 
-		// if we get here then loading the file went well
-		TiXmlElement* root = objectFile.RootElement();
 		if (root) {
 			for (const TiXmlElement *importElement = root->FirstChildElement("import"); importElement; importElement = importElement->NextSiblingElement("import")) {
 				const std::string* importDir = importElement->Attribute(std::string("dir"));
@@ -37,6 +37,8 @@
 #include "ianimationloader.h"
 #include "iatlasloader.h"
 
+class TiXmlElement;
+
 namespace FIFE {
 
 	class Model;
@@ -80,6 +82,15 @@ namespace FIFE {
 		*/
 		virtual void load(const std::string& filename);
 
+		/** checks if the root element of an already parsed file contains objects
+		*/
+		bool isLoadable(const TiXmlElement* root) const;
+
+		/** loads the objects of an already parsed file, filename is only
+		* used to resolve the paths inside of the file
+		*/
+		void load(const std::string& filename, TiXmlElement* root);
+
 		/** used to load an object, atlas or animation file
 		* if directory is provided then file is assumed relative to directory
 		*/
@@ -0,0 +1,140 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <exception>
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/base/exception.h"
+
+#include "asyncimagedecoder.h"
+#include "imageloader.h"
+
+namespace FIFE {
+	AsyncImageDecoder::AsyncImageDecoder(uint32_t workers):
+		m_busy(0),
+		m_stop(false) {
+		if (workers == 0) {
+			workers = 1;
+		}
+		for (uint32_t i = 0; i < workers; ++i) {
+			m_workers.push_back(std::thread(&AsyncImageDecoder::run, this));
+		}
+	}
+
+	AsyncImageDecoder::~AsyncImageDecoder() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+			m_requests.clear();
+		}
+		m_condition.notify_all();
+		for (std::vector<std::thread>::iterator it = m_workers.begin(); it != m_workers.end(); ++it) {
+			it->join();
+		}
+		for (std::deque<Result>::iterator it = m_results.begin(); it != m_results.end(); ++it) {
+			if (it->surface) {
+				SDL_FreeSurface(it->surface);
+			}
+		}
+	}
+
+	void AsyncImageDecoder::enqueue(const Request& request) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_requests.push_back(request);
+		}
+		m_condition.notify_one();
+	}
+
+	bool AsyncImageDecoder::popResult(Result& result) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_results.empty()) {
+			return false;
+		}
+		result = m_results.front();
+		m_results.pop_front();
+		return true;
+	}
+
+	void AsyncImageDecoder::clear() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_requests.clear();
+		for (std::deque<Result>::iterator it = m_results.begin(); it != m_results.end(); ++it) {
+			if (it->surface) {
+				SDL_FreeSurface(it->surface);
+			}
+		}
+		m_results.clear();
+	}
+
+	uint32_t AsyncImageDecoder::getPendingCount() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_requests.size() + m_busy;
+	}
+
+	uint32_t AsyncImageDecoder::getWorkerCount() const {
+		return m_workers.size();
+	}
+
+	void AsyncImageDecoder::run() {
+		for (;;) {
+			Request request;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				while (!m_stop && m_requests.empty()) {
+					m_condition.wait(lock);
+				}
+				if (m_stop) {
+					return;
+				}
+				request = m_requests.front();
+				m_requests.pop_front();
+				++m_busy;
+			}
+
+			Result result;
+			result.handle = request.handle;
+			result.filename = request.filename;
+			result.surface = NULL;
+			try {
+				result.surface = ImageLoader::loadSurface(request.filename, request.convert ? &request.format : NULL);
+			} catch (const std::exception& e) {
+				result.error = e.what();
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_busy;
+			if (m_stop) {
+				if (result.surface) {
+					SDL_FreeSurface(result.surface);
+				}
+				return;
+			}
+			m_results.push_back(result);
+		}
+	}
+}
@@ -0,0 +1,115 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef FIFE_VIDEO_LOADERS_ASYNC_IMAGE_DECODER_H
+#define FIFE_VIDEO_LOADERS_ASYNC_IMAGE_DECODER_H
+
+// Standard C++ library includes
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 3rd party library includes
+#include <SDL.h>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/base/fife_stdint.h"
+#include "util/resource/resource.h"
+
+namespace FIFE {
+	/** Reads and decodes image files on worker threads.
+	 *
+	 * The workers only open the files through the VFS and create SDL surfaces,
+	 * no image or render backend state is touched. The results are fetched
+	 * on the main thread, which creates the textures.
+	 */
+	class AsyncImageDecoder {
+	public:
+		struct Request {
+			// Handle of the image that waits for the surface
+			ResourceHandle handle;
+			// File to decode
+			std::string filename;
+			// Convert the surface into the format below
+			bool convert;
+			SDL_PixelFormat format;
+		};
+
+		struct Result {
+			ResourceHandle handle;
+			std::string filename;
+			// Decoded surface, NULL if decoding failed
+			SDL_Surface* surface;
+			// Error message if decoding failed
+			std::string error;
+		};
+
+		/** Constructor, starts the worker threads.
+		 * @param workers The number of worker threads, at least one is started.
+		 */
+		AsyncImageDecoder(uint32_t workers);
+
+		/** Destructor, stops the worker threads and frees the undelivered surfaces.
+		 */
+		~AsyncImageDecoder();
+
+		/** Queues a decoding request.
+		 */
+		void enqueue(const Request& request);
+
+		/** Fetches one finished request.
+		 * @return True if a result was written, false if none is ready.
+		 */
+		bool popResult(Result& result);
+
+		/** Drops all queued requests and undelivered results.
+		 * Requests that are already decoded by a worker are still delivered.
+		 */
+		void clear();
+
+		/** Returns the number of requests that are queued or in progress.
+		 */
+		uint32_t getPendingCount() const;
+
+		/** Returns the number of worker threads.
+		 */
+		uint32_t getWorkerCount() const;
+
+	private:
+		void run();
+
+		std::vector<std::thread> m_workers;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_condition;
+		std::deque<Request> m_requests;
+		std::deque<Result> m_results;
+		// requests in progress
+		uint32_t m_busy;
+		bool m_stop;
+	};
+}
+#endif
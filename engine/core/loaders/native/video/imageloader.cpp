@@ -37,13 +37,13 @@
 #include "vfs/vfs.h"
 #include "video/renderbackend.h"
 #include "video/image.h"
+#include "video/imagemanager.h"
 
 #include "imageloader.h"
+#include "texturecache.h"
 
 namespace FIFE {
 	void ImageLoader::load(IResource* res) {
-		VFS* vfs = VFS::instance();
-
 		Image* img = dynamic_cast<Image*>(res);
 
 		//Have to save the images x and y shift or it gets lost when it's
@@ -53,50 +53,83 @@ namespace FIFE {
 
 		if(!img->isSharedImage()) {
 			const std::string& filename = img->getName();
-			std::unique_ptr<RawData> data(vfs->open(filename));
-			size_t datalen = data->getDataLength();
-			std::unique_ptr<uint8_t[]> darray(new uint8_t[datalen]);
-			data->readInto(darray.get(), datalen);
-			SDL_RWops* rwops = SDL_RWFromConstMem(darray.get(), static_cast<int>(datalen));
-
-			SDL_Surface* surface = IMG_Load_RW(rwops, false);
-
-			if (!surface) {
-				throw SDLException(std::string("Fatal Error when loading image into a SDL_Surface: ") + SDL_GetError());
-			}
-
 			RenderBackend* rb = RenderBackend::instance();
 			// in case of SDL we don't need to convert the surface
 			if (rb->getName() == "SDL") {
-				img->setSurface(surface);
+				img->setSurface(loadSurface(filename, NULL));
 			// in case of OpenGL we need a 32bit surface
 			} else {
-				SDL_PixelFormat dst_format = rb->getPixelFormat();
-				SDL_PixelFormat src_format = *surface->format;
-				uint8_t dstbits = dst_format.BitsPerPixel;
-				uint8_t srcbits = src_format.BitsPerPixel;
-
-				if (srcbits != 32 || dst_format.Rmask != src_format.Rmask || dst_format.Gmask != src_format.Gmask ||
-					dst_format.Bmask != src_format.Bmask || dst_format.Amask != src_format.Amask) {
-					dst_format.BitsPerPixel = 32;
-					SDL_Surface* conv = SDL_ConvertSurface(surface, &dst_format, 0);
-					dst_format.BitsPerPixel = dstbits;
-
-					if (!conv) {
-						throw SDLException(std::string("Fatal Error when converting surface to the screen format: ") + SDL_GetError());
-					}
-
-					img->setSurface(conv);
-					SDL_FreeSurface(surface);
-				} else {
-					img->setSurface(surface);
-				}
+				img->setSurface(loadSurface(filename, &rb->getPixelFormat()));
 			}
-
-			SDL_FreeRW(rwops);
 		}
 		//restore saved x and y shifts
 		img->setXShift(xShiftSave);
 		img->setYShift(yShiftSave);
 	}
+
+	SDL_Surface* ImageLoader::loadSurface(const std::string& filename, const SDL_PixelFormat* format) {
+		std::unique_ptr<RawData> data(VFS::instance()->open(filename));
+		TextureCache* cache = ImageManager::instance()->getTextureCache();
+		if (!cache) {
+			return decode(data.get(), format);
+		}
+
+		size_t datalen = data->getDataLength();
+		const uint8_t* darray = 0;
+		TextureCache::SourceStamp stamp;
+		// files outside of archives are identified by their modification time,
+		// so a cache hit doesn't need to read the file content. The host path
+		// includes the root of the directory source, the filename may not.
+		if (!TextureCache::getFileStamp(data->getHostPath(), datalen, stamp)) {
+			darray = data->getDataView();
+			stamp = TextureCache::getContentStamp(darray, datalen);
+		}
+
+		SDL_Surface* surface = cache->read(filename, stamp, format);
+		if (surface) {
+			return surface;
+		}
+
+		if (!darray) {
+			darray = data->getDataView();
+		}
+		surface = decode(darray, datalen, format);
+		cache->write(filename, stamp, surface);
+		return surface;
+	}
+
+	SDL_Surface* ImageLoader::decode(RawData* data, const SDL_PixelFormat* format) {
+		return decode(data->getDataView(), data->getDataLength(), format);
+	}
+
+	SDL_Surface* ImageLoader::decode(const uint8_t* data, size_t length, const SDL_PixelFormat* format) {
+		SDL_RWops* rwops = SDL_RWFromConstMem(data, static_cast<int>(length));
+
+		SDL_Surface* surface = IMG_Load_RW(rwops, false);
+		SDL_FreeRW(rwops);
+
+		if (!surface) {
+			throw SDLException(std::string("Fatal Error when loading image into a SDL_Surface: ") + SDL_GetError());
+		}
+		if (!format) {
+			return surface;
+		}
+
+		SDL_PixelFormat dst_format = *format;
+		SDL_PixelFormat src_format = *surface->format;
+		uint8_t srcbits = src_format.BitsPerPixel;
+
+		if (srcbits != 32 || dst_format.Rmask != src_format.Rmask || dst_format.Gmask != src_format.Gmask ||
+			dst_format.Bmask != src_format.Bmask || dst_format.Amask != src_format.Amask) {
+			dst_format.BitsPerPixel = 32;
+			SDL_Surface* conv = SDL_ConvertSurface(surface, &dst_format, 0);
+			SDL_FreeSurface(surface);
+
+			if (!conv) {
+				throw SDLException(std::string("Fatal Error when converting surface to the screen format: ") + SDL_GetError());
+			}
+			return conv;
+		}
+		return surface;
+	}
 }  //FIFE
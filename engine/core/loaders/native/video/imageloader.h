@@ -23,8 +23,10 @@
 #define FIFE_VIDEO_LOADERS_IMAGE_PROVIDER_H
 
 // Standard C++ library includes
+#include <string>
 
 // 3rd party library includes
+#include <SDL.h>
 
 // FIFE includes
 // These includes are split up in two parts, separated by one empty line
@@ -33,12 +35,40 @@
 #include "util/resource/resource.h"
 
 namespace FIFE {
+	class RawData;
+
 	/** ImageLoader for some basic formats like jpeg, png etc.
 	 */
 	class ImageLoader : public IResourceLoader {
 	public:
 		ImageLoader() {}
 		virtual void load(IResource* res);
+
+		/** Decodes the image data and converts it into a 32bit surface of the given format.
+		 *
+		 * Does not use the render backend, so it can be called from worker threads.
+		 * @param data The raw image file.
+		 * @param format The target format or NULL to keep the decoded format.
+		 * @return The new surface, the caller takes the ownership.
+		 * @throws SDLException if decoding or converting failed.
+		 */
+		static SDL_Surface* decode(RawData* data, const SDL_PixelFormat* format);
+
+		/** Decodes image data from memory, see decode(RawData*, const SDL_PixelFormat*).
+		 */
+		static SDL_Surface* decode(const uint8_t* data, size_t length, const SDL_PixelFormat* format);
+
+		/** Opens the file through the VFS and returns the decoded surface.
+		 *
+		 * Uses the texture cache of the ImageManager if it is enabled, so the
+		 * file is only decoded if the cache has no valid entry for it.
+		 * Can be called from worker threads.
+		 * @param filename The image file.
+		 * @param format The target format or NULL to keep the decoded format.
+		 * @return The new surface, the caller takes the ownership.
+		 * @throws SDLException if decoding or converting failed.
+		 */
+		static SDL_Surface* loadSurface(const std::string& filename, const SDL_PixelFormat* format);
 	};
 }
 #endif
@@ -0,0 +1,277 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/log/logger.h"
+#include "util/structures/openhashmap.h"
+#include "vfs/fife_boost_filesystem.h"
+
+#include "texturecache.h"
+
+namespace FIFE {
+	/** Logger to use for this source file.
+	 *  @relates Logger
+	 */
+	static Logger _log(LM_NATIVE_LOADERS);
+
+	namespace {
+		const char CACHE_MAGIC[4] = { 'F', 'T', 'C', 'F' };
+		// detects cache files written on a machine with other byte order
+		const uint32_t CACHE_BYTE_ORDER = 0x01020304;
+		// increase if the layout changes
+		const uint32_t CACHE_VERSION = 1;
+		const char* CACHE_EXTENSION = ".ftc";
+
+		struct CacheHeader {
+			char magic[4];
+			uint32_t byteOrder;
+			uint32_t version;
+			uint32_t nameLength;
+			uint64_t sourceSize;
+			uint64_t sourceStamp;
+			uint32_t width;
+			uint32_t height;
+			uint32_t pitch;
+			uint32_t bitsPerPixel;
+			uint32_t rmask;
+			uint32_t gmask;
+			uint32_t bmask;
+			uint32_t amask;
+		};
+	}
+
+	TextureCache::TextureCache(const std::string& directory):
+		m_directory(directory),
+		m_hits(0),
+		m_misses(0),
+		m_writes(0) {
+
+		boost::system::error_code error;
+		bfs::create_directories(bfs::path(m_directory), error);
+		if (error) {
+			FL_WARN(_log, LMsg("TextureCache::TextureCache() - ") << "Could not create the directory " << m_directory << ": " << error.message());
+		}
+	}
+
+	TextureCache::~TextureCache() {
+	}
+
+	const std::string& TextureCache::getDirectory() const {
+		return m_directory;
+	}
+
+	bool TextureCache::getFileStamp(const std::string& hostPath, uint64_t size, SourceStamp& stamp) {
+		if (hostPath.empty()) {
+			return false;
+		}
+		boost::system::error_code error;
+		bfs::path path(hostPath);
+		if (!bfs::is_regular_file(path, error) || error) {
+			return false;
+		}
+		if (bfs::file_size(path, error) != size || error) {
+			return false;
+		}
+		std::time_t time = bfs::last_write_time(path, error);
+		// the time has a resolution of one second, a file written in the current
+		// second could still change without getting a new time
+		if (error || std::time(0) - time <= 1) {
+			return false;
+		}
+		stamp.size = size;
+		// the lowest bit marks file stamps, so they never equal a content stamp
+		stamp.stamp = (static_cast<uint64_t>(time) << 1) | 1;
+		return true;
+	}
+
+	TextureCache::SourceStamp TextureCache::getContentStamp(const uint8_t* data, uint64_t size) {
+		uint64_t hash = 14695981039346656037ULL;
+		for (uint64_t i = 0; i < size; ++i) {
+			hash ^= data[i];
+			hash *= 1099511628211ULL;
+		}
+		SourceStamp stamp;
+		stamp.size = size;
+		stamp.stamp = hash & ~static_cast<uint64_t>(1);
+		return stamp;
+	}
+
+	SDL_Surface* TextureCache::read(const std::string& filename, const SourceStamp& stamp, const SDL_PixelFormat* format) {
+		FILE* file = std::fopen(getCachePath(filename).c_str(), "rb");
+		if (!file) {
+			++m_misses;
+			return NULL;
+		}
+
+		CacheHeader header;
+		bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+			std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+			header.byteOrder == CACHE_BYTE_ORDER &&
+			header.version == CACHE_VERSION &&
+			header.nameLength == filename.size() &&
+			header.sourceSize == stamp.size &&
+			header.sourceStamp == stamp.stamp &&
+			header.bitsPerPixel == 32 &&
+			header.pitch >= header.width * 4;
+		if (valid && format) {
+			valid = header.rmask == format->Rmask && header.gmask == format->Gmask &&
+				header.bmask == format->Bmask && header.amask == format->Amask;
+		}
+		if (valid) {
+			// different names can share a cache file if their hashes collide
+			std::vector<char> name(header.nameLength);
+			valid = header.nameLength == 0 || (std::fread(&name[0], header.nameLength, 1, file) == 1 &&
+				filename.compare(0, std::string::npos, &name[0], name.size()) == 0);
+		}
+
+		SDL_Surface* surface = NULL;
+		if (valid) {
+			surface = SDL_CreateRGBSurface(0, header.width, header.height, 32,
+				header.rmask, header.gmask, header.bmask, header.amask);
+		}
+		if (surface) {
+			uint8_t* pixels = static_cast<uint8_t*>(surface->pixels);
+			if (static_cast<uint32_t>(surface->pitch) == header.pitch) {
+				valid = header.height == 0 || std::fread(pixels, header.pitch * header.height, 1, file) == 1;
+			} else {
+				std::vector<uint8_t> row(header.pitch);
+				const uint32_t rowBytes = header.width * 4;
+				for (uint32_t y = 0; valid && y < header.height; ++y) {
+					valid = std::fread(&row[0], header.pitch, 1, file) == 1;
+					std::memcpy(pixels + y * surface->pitch, &row[0], rowBytes);
+				}
+			}
+			if (!valid) {
+				SDL_FreeSurface(surface);
+				surface = NULL;
+			}
+		}
+		std::fclose(file);
+
+		if (surface) {
+			++m_hits;
+		} else {
+			++m_misses;
+		}
+		return surface;
+	}
+
+	bool TextureCache::write(const std::string& filename, const SourceStamp& stamp, SDL_Surface* surface) {
+		Uint32 colorkey;
+		if (!surface || surface->format->BitsPerPixel != 32 || SDL_GetColorKey(surface, &colorkey) == 0) {
+			return false;
+		}
+
+		CacheHeader header;
+		std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+		header.byteOrder = CACHE_BYTE_ORDER;
+		header.version = CACHE_VERSION;
+		header.nameLength = filename.size();
+		header.sourceSize = stamp.size;
+		header.sourceStamp = stamp.stamp;
+		header.width = surface->w;
+		header.height = surface->h;
+		header.pitch = surface->pitch;
+		header.bitsPerPixel = 32;
+		header.rmask = surface->format->Rmask;
+		header.gmask = surface->format->Gmask;
+		header.bmask = surface->format->Bmask;
+		header.amask = surface->format->Amask;
+
+		// write into a temporary file, so other threads and processes never see half written entries
+		const std::string path = getCachePath(filename);
+		std::ostringstream tmp;
+		tmp << path << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+		FILE* file = std::fopen(tmp.str().c_str(), "wb");
+		if (!file) {
+			return false;
+		}
+
+		bool mustLock = SDL_MUSTLOCK(surface);
+		if (mustLock) {
+			SDL_LockSurface(surface);
+		}
+		bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+			(filename.empty() || std::fwrite(filename.data(), filename.size(), 1, file) == 1) &&
+			(header.height == 0 || std::fwrite(surface->pixels, header.pitch * header.height, 1, file) == 1);
+		if (mustLock) {
+			SDL_UnlockSurface(surface);
+		}
+		written = std::fclose(file) == 0 && written;
+
+		boost::system::error_code error;
+		if (written) {
+			bfs::rename(bfs::path(tmp.str()), bfs::path(path), error);
+			written = !error;
+		}
+		if (!written) {
+			bfs::remove(bfs::path(tmp.str()), error);
+			FL_WARN(_log, LMsg("TextureCache::write() - ") << "Could not write the cache entry for " << filename);
+			return false;
+		}
+		++m_writes;
+		return true;
+	}
+
+	void TextureCache::clear() {
+		boost::system::error_code error;
+		bfs::directory_iterator it(bfs::path(m_directory), error);
+		bfs::directory_iterator end;
+		for (; !error && it != end; it.increment(error)) {
+			if (HasExtension(it->path()) && GetExtension(it->path()) == CACHE_EXTENSION) {
+				boost::system::error_code removeError;
+				bfs::remove(it->path(), removeError);
+			}
+		}
+	}
+
+	uint32_t TextureCache::getHitCount() const {
+		return m_hits;
+	}
+
+	uint32_t TextureCache::getMissCount() const {
+		return m_misses;
+	}
+
+	uint32_t TextureCache::getWriteCount() const {
+		return m_writes;
+	}
+
+	std::string TextureCache::getCachePath(const std::string& filename) const {
+		std::ostringstream path;
+		path << m_directory << "/" << std::hex << static_cast<uint64_t>(StringHash()(filename)) << CACHE_EXTENSION;
+		return path.str();
+	}
+}
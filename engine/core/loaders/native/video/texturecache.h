@@ -0,0 +1,135 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef FIFE_VIDEO_LOADERS_TEXTURE_CACHE_H
+#define FIFE_VIDEO_LOADERS_TEXTURE_CACHE_H
+
+// Standard C++ library includes
+#include <atomic>
+#include <string>
+
+// 3rd party library includes
+#include <SDL.h>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/base/fife_stdint.h"
+
+namespace FIFE {
+	/** On-disk cache of decoded image data.
+	 *
+	 * Each image file gets one cache file with a small header and the raw
+	 * pixels of the decoded and converted surface, so a warm start only has to
+	 * read the pixels instead of decoding the PNG again.
+	 * A cache entry is only used if the size and the stamp of the source file
+	 * and the pixel format still match. The stamp is the modification time,
+	 * if the file exists in the real filesystem and was not changed in the last
+	 * second, otherwise a hash of the file content (e.g. files in archives).
+	 *
+	 * Only 32bit surfaces without colorkey are cached.
+	 * The methods can be called from several threads at the same time.
+	 */
+	class TextureCache {
+	public:
+		/** Identifies a version of an image file.
+		 */
+		struct SourceStamp {
+			SourceStamp() : size(0), stamp(0) {}
+			uint64_t size;
+			uint64_t stamp;
+		};
+
+		/** Constructor, creates the directory if it doesn't exist.
+		 * @param directory The directory of the cache files.
+		 */
+		TextureCache(const std::string& directory);
+
+		/** Destructor
+		 */
+		~TextureCache();
+
+		/** Returns the cache directory.
+		 */
+		const std::string& getDirectory() const;
+
+		/** Returns a stamp from the modification time of the file.
+		 * @param hostPath The path of the image file in the real filesystem, see RawData::getHostPath.
+		 * @param size The size of the image file in bytes.
+		 * @param stamp Filled with the stamp if the file exists outside of archives.
+		 * @return True if the stamp could be created, otherwise a content stamp is needed,
+		 * also for files that were modified in the last second.
+		 */
+		static bool getFileStamp(const std::string& hostPath, uint64_t size, SourceStamp& stamp);
+
+		/** Returns a stamp from the file content.
+		 * @param data The content of the image file.
+		 * @param size The size of the image file in bytes.
+		 */
+		static SourceStamp getContentStamp(const uint8_t* data, uint64_t size);
+
+		/** Reads a cached surface.
+		 * @param filename The path of the image file.
+		 * @param stamp The stamp of the current image file.
+		 * @param format The expected pixel format or NULL to accept any 32bit format.
+		 * @return The surface or NULL if there is no valid cache entry, the caller takes the ownership.
+		 */
+		SDL_Surface* read(const std::string& filename, const SourceStamp& stamp, const SDL_PixelFormat* format);
+
+		/** Writes a decoded surface into the cache.
+		 * @param filename The path of the image file.
+		 * @param stamp The stamp of the image file.
+		 * @param surface The decoded surface, it is not modified.
+		 * @return True if the surface was written.
+		 */
+		bool write(const std::string& filename, const SourceStamp& stamp, SDL_Surface* surface);
+
+		/** Removes all cache files from the directory.
+		 */
+		void clear();
+
+		/** Returns the number of images read from the cache.
+		 */
+		uint32_t getHitCount() const;
+
+		/** Returns the number of images that had no valid cache entry.
+		 */
+		uint32_t getMissCount() const;
+
+		/** Returns the number of images written to the cache.
+		 */
+		uint32_t getWriteCount() const;
+
+	private:
+		/** Returns the path of the cache file for the image file.
+		 */
+		std::string getCachePath(const std::string& filename) const;
+
+		// cache directory
+		std::string m_directory;
+		// statistics
+		std::atomic<uint32_t> m_hits;
+		std::atomic<uint32_t> m_misses;
+		std::atomic<uint32_t> m_writes;
+	};
+}
+#endif
@@ -46,7 +46,8 @@ namespace FIFE {
 		m_zone(NULL),
 		m_transition(NULL),
 		m_inserted(false),
-		m_protect(false) {
+		m_protect(false),
+		m_type(CTYPE_NO_BLOCKER) {
 	}
 
 	Cell::~Cell() {
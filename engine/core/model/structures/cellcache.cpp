@@ -29,6 +29,7 @@
 // Second block: files included from the same folder
 #include "model/metamodel/grids/cellgrid.h"
 #include "util/log/logger.h"
+#include "util/structures/openhashmap.h"
 #include "util/structures/purge.h"
 
 #include "cellcache.h"
@@ -42,6 +43,14 @@ namespace FIFE {
 
 	static Logger _log(LM_STRUCTURES);
 
+	/** Instances of a layer grouped by their layer coordinates, see coordinateKey
+	 */
+	typedef OpenHashMap<uint64_t, std::vector<Instance*>, IntegerHash> CoordinateInstanceMap;
+
+	static uint64_t coordinateKey(const ModelCoordinate& mc) {
+		return (static_cast<uint64_t>(static_cast<uint32_t>(mc.x)) << 32) | static_cast<uint32_t>(mc.y);
+	}
+
 	class CellCacheChangeListener : public LayerChangeListener {
 	public:
 		CellCacheChangeListener(Layer* layer)	{
@@ -218,6 +227,27 @@ namespace FIFE {
 			}
 		}
 
+		virtual void onInstancesCreate(Layer* layer, const std::vector<Instance*>& instances) {
+			// the cache is resized once, resize() takes all instances of the layers into account
+			CellCache* cache = m_layer->getCellCache();
+			Location loc(m_layer);
+			for (std::vector<Instance*>::const_iterator it = instances.begin(); it != instances.end(); ++it) {
+				if (m_layer == layer) {
+					loc.setLayerCoordinates((*it)->getLocationRef().getLayerCoordinates());
+				} else {
+					loc.setLayerCoordinates(m_layer->getCellGrid()->toLayerCoordinates(
+						layer->getCellGrid()->toMapCoordinates((*it)->getLocationRef().getExactLayerCoordinatesRef())));
+				}
+				if (!cache->isInCellCache(loc)) {
+					cache->resize();
+					break;
+				}
+			}
+			for (std::vector<Instance*>::const_iterator it = instances.begin(); it != instances.end(); ++it) {
+				onInstanceCreate(layer, *it);
+			}
+		}
+
 		virtual void onInstanceDelete(Layer* layer, Instance* instance)	{
 			ModelCoordinate mc;
 			if (m_layer == layer) {
@@ -582,7 +612,43 @@ namespace FIFE {
 	}
 
 	void CellCache::createCells() {
+		// the instances are sorted into the cells straight from the instance
+		// arrays of the layers, instead of searching the instance trees per cell
+		const std::vector<Instance*>& instances = m_layer->getInstances();
+		std::vector<int32_t> instanceCells(instances.size(), -1);
+		std::vector<uint32_t> cellOffsets(m_width * m_height + 1, 0);
+		for (uint32_t i = 0; i < instances.size(); ++i) {
+			ModelCoordinate mc = instances[i]->getLocationRef().getLayerCoordinates();
+			int32_t x = mc.x - m_size.x;
+			int32_t y = mc.y - m_size.y;
+			if (x < 0 || x >= static_cast<int32_t>(m_width) || y < 0 || y >= static_cast<int32_t>(m_height)) {
+				continue;
+			}
+			instanceCells[i] = x + y * static_cast<int32_t>(m_width);
+			++cellOffsets[instanceCells[i] + 1];
+		}
+		for (uint32_t i = 1; i < cellOffsets.size(); ++i) {
+			cellOffsets[i] += cellOffsets[i - 1];
+		}
+		std::vector<Instance*> cellInstances(cellOffsets.back());
+		std::vector<uint32_t> cellFill(cellOffsets.begin(), cellOffsets.end() - 1);
+		for (uint32_t i = 0; i < instances.size(); ++i) {
+			if (instanceCells[i] != -1) {
+				cellInstances[cellFill[instanceCells[i]]++] = instances[i];
+			}
+		}
+
+		// the cells of interact layers are found by converting the coordinates,
+		// so their instances are grouped by coordinates
 		const std::vector<Layer*>& interacts = m_layer->getInteractLayers();
+		std::vector<CoordinateInstanceMap> interactInstances(interacts.size());
+		for (uint32_t i = 0; i < interacts.size(); ++i) {
+			const std::vector<Instance*>& layerInstances = interacts[i]->getInstances();
+			for (std::vector<Instance*>::const_iterator it = layerInstances.begin(); it != layerInstances.end(); ++it) {
+				interactInstances[i][coordinateKey((*it)->getLocationRef().getLayerCoordinates())].push_back(*it);
+			}
+		}
+
 		for(uint32_t y = 0; y < m_height; ++y) {
 			for(uint32_t x = 0; x < m_width; ++x) {
 				ModelCoordinate mc(m_size.x+x, m_size.y+y);
@@ -592,22 +658,19 @@ namespace FIFE {
 					m_cells[x][y] = cell;
 				}
 				// fill Instances into Cell
-				std::list<Instance*> cell_instances;
-				m_layer->getInstanceTree()->findInstances(mc, 0, 0, cell_instances);
-				if (!interacts.empty()) {
-					// fill interact Instances into Cell
-					std::vector<Layer*>::const_iterator it = interacts.begin();
-					std::list<Instance*> interact_instances;
-					for(; it != interacts.end(); ++it) {
-						// convert coordinates
-						ExactModelCoordinate emc(FIFE::intPt2doublePt(mc));
-						ModelCoordinate inter_mc = (*it)->getCellGrid()->toLayerCoordinates(m_layer->getCellGrid()->toMapCoordinates(emc));
-						// check interact layer for instances
-						(*it)->getInstanceTree()->findInstances(inter_mc, 0, 0, interact_instances);
-						if (!interact_instances.empty()) {
-							cell_instances.insert(cell_instances.end(), interact_instances.begin(), interact_instances.end());
-							interact_instances.clear();
-						}
+				uint32_t index = x + y * m_width;
+				std::list<Instance*> cell_instances(cellInstances.begin() + cellOffsets[index], cellInstances.begin() + cellOffsets[index + 1]);
+				for (uint32_t i = 0; i < interacts.size(); ++i) {
+					if (interactInstances[i].empty()) {
+						continue;
+					}
+					// convert coordinates
+					ExactModelCoordinate emc(FIFE::intPt2doublePt(mc));
+					ModelCoordinate inter_mc = interacts[i]->getCellGrid()->toLayerCoordinates(m_layer->getCellGrid()->toMapCoordinates(emc));
+					// check interact layer for instances
+					CoordinateInstanceMap::const_iterator found = interactInstances[i].find(coordinateKey(inter_mc));
+					if (found != interactInstances[i].end()) {
+						cell_instances.insert(cell_instances.end(), found->second.begin(), found->second.end());
 					}
 				}
 				if (!cell_instances.empty()) {
@@ -20,6 +20,7 @@
  ***************************************************************************/
 
 // Standard C++ library includes
+#include <algorithm>
 
 // 3rd party library includes
 
@@ -39,7 +40,8 @@
 namespace FIFE {
 	static Logger _log(LM_STRUCTURES);
 
-	InstanceTree::InstanceTree(): FifeClass() {
+	InstanceTree::InstanceTree(bool loose): FifeClass(),
+		m_loose(loose) {
 	}
 
 	InstanceTree::~InstanceTree() {
@@ -47,6 +49,16 @@ namespace FIFE {
 
 	void InstanceTree::addInstance(Instance* instance) {
 		ModelCoordinate coords = instance->getLocationRef().getLayerCoordinates();
+		if (m_loose) {
+			if (m_looseReverse.find(instance) != m_looseReverse.end()) {
+				FL_WARN(_log, "InstanceTree::addInstance() - Duplicate Instance.  Ignoring.");
+				return;
+			}
+			int32_t index = m_looseTree.find_container(coords.x, coords.y, 0, 0);
+			m_looseTree.data(index).push_back(instance);
+			m_looseReverse[instance] = index;
+			return;
+		}
 		InstanceTreeNode * node = m_tree.find_container(coords.x,coords.y,0,0);
 		InstanceList& list = node->data();
 		list.push_back(instance);
@@ -57,7 +69,48 @@ namespace FIFE {
 		m_reverse[instance] = node;
 	}
 
+	void InstanceTree::addInstances(const std::vector<Instance*>& instances) {
+		if (instances.empty()) {
+			return;
+		}
+		// grow the root once instead of step by step while inserting
+		ModelCoordinate min = instances.front()->getLocationRef().getLayerCoordinates();
+		ModelCoordinate max = min;
+		for (std::vector<Instance*>::const_iterator it = instances.begin(); it != instances.end(); ++it) {
+			ModelCoordinate coords = (*it)->getLocationRef().getLayerCoordinates();
+			min.x = std::min(min.x, coords.x);
+			min.y = std::min(min.y, coords.y);
+			max.x = std::max(max.x, coords.x);
+			max.y = std::max(max.y, coords.y);
+		}
+		if (m_loose) {
+			m_looseTree.find_container(min.x, min.y, max.x - min.x, max.y - min.y);
+		} else {
+			m_tree.find_container(min.x, min.y, max.x - min.x, max.y - min.y);
+		}
+
+		for (std::vector<Instance*>::const_iterator it = instances.begin(); it != instances.end(); ++it) {
+			addInstance(*it);
+		}
+	}
+
 	void InstanceTree::removeInstance(Instance* instance) {
+		if (m_loose) {
+			std::map<Instance*,int32_t>::iterator it = m_looseReverse.find(instance);
+			if (it == m_looseReverse.end()) {
+				FL_WARN(_log, "InstanceTree::removeInstance() - Instance not part of tree.");
+				return;
+			}
+			std::vector<Instance*>& instances = m_looseTree.data(it->second);
+			m_looseReverse.erase(it);
+			std::vector<Instance*>::iterator found = std::find(instances.begin(), instances.end(), instance);
+			if (found != instances.end()) {
+				instances.erase(found);
+				return;
+			}
+			FL_WARN(_log, "InstanceTree::removeInstance() - Instance part of tree but not found in the expected tree node.");
+			return;
+		}
 		InstanceTreeNode * node = m_reverse[instance];
 		if( !node ) {
 			FL_WARN(_log, "InstanceTree::removeInstance() - Instance not part of tree.");
@@ -95,8 +148,34 @@ namespace FIFE {
 		return true;
 	}
 
+	class LooseInstanceListCollector {
+		public:
+			InstanceTree::InstanceList& instanceList;
+			Rect searchRect;
+			LooseInstanceListCollector(InstanceTree::InstanceList& a_instanceList, const Rect& rect)
+			: instanceList(a_instanceList), searchRect(rect) {
+			}
+			bool visit(InstanceTree::InstanceLooseTreeNode* node, int32_t d);
+	};
+
+	bool LooseInstanceListCollector::visit(InstanceTree::InstanceLooseTreeNode* node, int32_t d) {
+		const std::vector<Instance*>& instances = node->data();
+		for (std::vector<Instance*>::const_iterator it = instances.begin(); it != instances.end(); ++it) {
+			ModelCoordinate coords = (*it)->getLocationRef().getLayerCoordinates();
+			if( searchRect.contains(Point(coords.x,coords.y)) ) {
+				instanceList.push_back(*it);
+			}
+		}
+		return true;
+	}
+
 	void InstanceTree::findInstances(const ModelCoordinate& point, int32_t w, int32_t h, InstanceTree::InstanceList& list) {
 		list.clear();
+		if (m_loose) {
+			LooseInstanceListCollector collector(list, Rect(point.x, point.y, w, h));
+			m_looseTree.apply_visitor(collector.searchRect, collector);
+			return;
+		}
 		InstanceTreeNode * node = m_tree.find_container(point.x, point.y, w, h);
 		Rect rect(point.x, point.y, w, h);
 		InstanceListCollector collector(list,rect);
@@ -24,6 +24,8 @@
 
 // Standard C++ library includes
 #include <list>
+#include <map>
+#include <vector>
 
 // 3rd party library includes
 
@@ -33,6 +35,7 @@
 #include "util/base/fifeclass.h"
 
 #include "util/structures/quadtree.h"
+#include "util/structures/loosequadtree.h"
 #include "model/metamodel/modelcoords.h"
 
 namespace FIFE {
@@ -46,11 +49,15 @@ namespace FIFE {
 		typedef std::list<Instance*> InstanceList;
 		typedef QuadTree< InstanceList, MIN_TREE_SIZE > InstanceQuadTree;
 		typedef InstanceQuadTree::Node InstanceTreeNode;
+		typedef LooseQuadTree< std::vector<Instance*>, MIN_TREE_SIZE > InstanceLooseQuadTree;
+		typedef InstanceLooseQuadTree::Node InstanceLooseTreeNode;
 
 		/** Constructor
 		 *
+		 * @param loose If true the instances are stored in a LooseQuadTree
+		 * instead of the QuadTree. Queries return the same instances.
 		 */
-		InstanceTree();
+		InstanceTree(bool loose = false);
 
 		/** Destructor
 		 *
@@ -67,6 +74,15 @@ namespace FIFE {
 		 */
 		void addInstance(Instance* instance);
 
+		/** Adds several instances to the quad tree.
+		 *
+		 * The tree is grown once to the bounding box of all instances,
+		 * then the instances are sorted into their nodes.
+		 *
+		 * @param instances The instances to add.
+		 */
+		void addInstances(const std::vector<Instance*>& instances);
+
 		/** Removes an instance from the quad tree.
 		 *
 		 * Locates an instance in the quad tree then removes it.
@@ -88,16 +104,28 @@ namespace FIFE {
 		 */
 		void findInstances(const ModelCoordinate& point, int32_t w, int32_t h, InstanceList& list);
 
-		/** See QuadNode::apply_visitor
+		/** Returns true if the instances are stored in a LooseQuadTree.
+		 */
+		bool isLoose() const { return m_loose; }
+
+		/** See QuadNode::apply_visitor and LooseQuadTree::apply_visitor.
+		 * The visitor has to accept the node type of the used tree.
 		 */
 		template<typename Visitor> void applyVisitor(Visitor& visitor) {
-			m_tree.apply_visitor(visitor);
+			if (m_loose) {
+				m_looseTree.apply_visitor(visitor);
+			} else {
+				m_tree.apply_visitor(visitor);
+			}
 		}
 
 
 	private:
+		bool m_loose;
 		InstanceQuadTree m_tree;
 		std::map<Instance*,InstanceTreeNode*> m_reverse;
+		InstanceLooseQuadTree m_looseTree;
+		std::map<Instance*,int32_t> m_looseReverse;
 	};
 
 }
@@ -54,6 +54,7 @@ namespace FIFE {
 		m_grid(grid),
 		m_pathingStrategy(CELL_EDGES_ONLY),
 		m_sortingStrategy(SORTING_CAMERA),
+		m_spatialIndexStrategy(SPATIAL_INDEX_QUADTREE),
 		m_walkable(false),
 		m_interact(false),
 		m_walkableId(""),
@@ -131,6 +132,39 @@ namespace FIFE {
 		return instance;
 	}
 
+	std::vector<Instance*> Layer::createInstances(const std::vector<InstanceDescriptor>& descriptors) {
+		std::vector<Instance*> instances;
+		instances.reserve(descriptors.size());
+		m_instances.reserve(m_instances.size() + descriptors.size());
+
+		for (std::vector<InstanceDescriptor>::const_iterator it = descriptors.begin(); it != descriptors.end(); ++it) {
+			if (!it->object) {
+				continue;
+			}
+			Location location(this);
+			location.setExactLayerCoordinates(it->position);
+
+			Instance* instance = new Instance(it->object, location, it->id);
+			if(instance->isActive()) {
+				setInstanceActivityStatus(instance, instance->isActive());
+			}
+			m_instances.push_back(instance);
+			instances.push_back(instance);
+		}
+		if (instances.empty()) {
+			return instances;
+		}
+		m_instanceTree->addInstances(instances);
+
+		std::vector<LayerChangeListener*>::iterator i = m_changeListeners.begin();
+		while (i != m_changeListeners.end()) {
+			(*i)->onInstancesCreate(this, instances);
+			++i;
+		}
+		m_changed = true;
+		return instances;
+	}
+
 	bool Layer::addInstance(Instance* instance, const ExactModelCoordinate& p){
         if( !instance ){
             FL_ERR(_log, "Tried to add an instance to layer, but given instance is invalid");
@@ -520,6 +554,23 @@ namespace FIFE {
 		return m_sortingStrategy;
 	}
 
+	void Layer::setSpatialIndexStrategy(SpatialIndexStrategy strategy) {
+		if (m_spatialIndexStrategy == strategy) {
+			return;
+		}
+		m_spatialIndexStrategy = strategy;
+		delete m_instanceTree;
+		m_instanceTree = new InstanceTree(strategy == SPATIAL_INDEX_LOOSE_QUADTREE);
+		std::vector<Instance*>::iterator it = m_instances.begin();
+		for (; it != m_instances.end(); ++it) {
+			m_instanceTree->addInstance(*it);
+		}
+	}
+
+	SpatialIndexStrategy Layer::getSpatialIndexStrategy() const {
+		return m_spatialIndexStrategy;
+	}
+
 	void Layer::setWalkable(bool walkable) {
 		m_walkable = walkable;
 	}
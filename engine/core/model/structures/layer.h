@@ -66,6 +66,17 @@ namespace FIFE {
 		SORTING_CAMERA_AND_LOCATION
 	};
 
+	/** Defines which spatial index is used for the instances of a layer and their render cache
+	 *
+	 * SPATIAL_INDEX_QUADTREE uses the QuadTree, every node is allocated separately
+	 * SPATIAL_INDEX_LOOSE_QUADTREE uses the LooseQuadTree, all nodes are stored in one array.
+	 * This is faster for layers with many moving instances.
+	 */
+	enum SpatialIndexStrategy {
+		SPATIAL_INDEX_QUADTREE,
+		SPATIAL_INDEX_LOOSE_QUADTREE
+	};
+
 	/** Listener interface for changes happening on a layer
 	 */
 	class LayerChangeListener {
@@ -85,6 +96,17 @@ namespace FIFE {
 		 */
 		virtual void onInstanceCreate(Layer* layer, Instance* instance) = 0;
 
+		/** Called once when several instances get created on layer by Layer::createInstances
+		 * The default implementation calls onInstanceCreate for each instance.
+		 * @param layer where change occurred
+		 * @param instances which got created
+		 */
+		virtual void onInstancesCreate(Layer* layer, const std::vector<Instance*>& instances) {
+			for (std::vector<Instance*>::const_iterator it = instances.begin(); it != instances.end(); ++it) {
+				onInstanceCreate(layer, *it);
+			}
+		}
+
 		/** Called when some instance gets deleted on layer
 		 * @param layer where change occurred
 		 * @param instance which will be deleted
@@ -94,6 +116,19 @@ namespace FIFE {
 	};
 
 
+	/** Describes an instance for Layer::createInstances
+	 */
+	struct InstanceDescriptor {
+		InstanceDescriptor()
+			: object(NULL) {}
+		InstanceDescriptor(Object* obj, const ExactModelCoordinate& pos, const std::string& identifier="")
+			: object(obj), position(pos), id(identifier) {}
+
+		Object* object;
+		ExactModelCoordinate position;
+		std::string id;
+	};
+
 	/** A basic layer on a map
 	 */
 	class Layer : public FifeClass {
@@ -147,6 +182,14 @@ namespace FIFE {
 			 */
 			Instance* createInstance(Object* object, const ExactModelCoordinate& p, const std::string& id="");
 
+			/** Add instances of objects at specific positions
+			 * The instances are added to the instance tree in one pass and the
+			 * LayerChangeListeners get a single onInstancesCreate call. Used by the map loaders.
+			 * @param descriptors the instances to create, descriptors without object are skipped
+			 * @return the created instances in the order of the descriptors
+			 */
+			std::vector<Instance*> createInstances(const std::vector<InstanceDescriptor>& descriptors);
+
 			/** Add a valid instance at a specific position. This is temporary. It will be moved to a higher level
 			later so that we can ensure that each Instance only lives in one layer.
 			 */
@@ -284,6 +327,17 @@ namespace FIFE {
 			 */
 			SortingStrategy getSortingStrategy() const;
 
+			/** Sets the spatial index strategy for the layer.
+			 * The instance tree is rebuilt, cameras rebuild their layer cache on the next update.
+			 * @see SpatialIndexStrategy
+			 */
+			void setSpatialIndexStrategy(SpatialIndexStrategy strategy);
+
+			/** Gets the spatial index strategy for the layer
+			 * @see SpatialIndexStrategy
+			 */
+			SpatialIndexStrategy getSpatialIndexStrategy() const;
+
 			/** Sets walkable for the layer. Only a walkable layer, can create a CellCache and
 			 *  only on a walkable, instances can move. Also interact layer can only be added to walkables.
 			 * @param walkable A boolean that mark a layer as walkable.
@@ -398,6 +452,8 @@ namespace FIFE {
 			PathingStrategy m_pathingStrategy;
 			//! sorting strategy for rendering
 			SortingStrategy m_sortingStrategy;
+			//! spatial index strategy for instances
+			SpatialIndexStrategy m_spatialIndexStrategy;
 			//! is walkable true/false
 			bool m_walkable;
 			//! is interact true/false
@@ -48,6 +48,11 @@ namespace FIFE {
 		SORTING_CAMERA_AND_LOCATION
 	};
 
+	enum SpatialIndexStrategy {
+		SPATIAL_INDEX_QUADTREE,
+		SPATIAL_INDEX_LOOSE_QUADTREE
+	};
+
 	%feature("director") LayerChangeListener;
 	class LayerChangeListener {
 	public:
@@ -101,6 +106,9 @@ namespace FIFE {
 			void setSortingStrategy(SortingStrategy strategy);
 			SortingStrategy getSortingStrategy() const;
 
+			void setSpatialIndexStrategy(SpatialIndexStrategy strategy);
+			SpatialIndexStrategy getSpatialIndexStrategy() const;
+
 			void setWalkable(bool walkable);
 			bool isWalkable();
 			
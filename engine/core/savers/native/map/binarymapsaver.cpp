@@ -0,0 +1,424 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "loaders/native/map/binarymapformat.h"
+#include "model/structures/map.h"
+#include "model/structures/layer.h"
+#include "model/structures/instance.h"
+#include "model/structures/cell.h"
+#include "model/structures/cellcache.h"
+#include "model/structures/trigger.h"
+#include "model/structures/triggercontroller.h"
+#include "model/metamodel/object.h"
+#include "model/metamodel/grids/cellgrid.h"
+#include "util/base/exception.h"
+#include "util/log/logger.h"
+#include "util/math/fife_math.h"
+#include "util/structures/openhashmap.h"
+#include "util/structures/point.h"
+#include "util/structures/rect.h"
+#include "view/visual.h"
+#include "view/camera.h"
+
+#include "binarymapsaver.h"
+
+namespace FIFE {
+	static Logger _log(LM_NATIVE_SAVERS);
+
+	namespace {
+		/** Collects the body of the file and the string table.
+		 * The string table is written in front of the body, once all names are known.
+		 */
+		class BinaryWriter {
+		public:
+			BinaryWriter() {
+				// index 0 is the empty string
+				index(std::string());
+			}
+
+			template <typename T> void write(const T& value) {
+				const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+				m_body.insert(m_body.end(), bytes, bytes + sizeof(T));
+			}
+
+			void writeString(const std::string& str) {
+				write<uint32_t>(index(str));
+			}
+
+			uint32_t index(const std::string& str) {
+				StringTable::iterator it = m_indices.find(str);
+				if (it != m_indices.end()) {
+					return it->second;
+				}
+				uint32_t idx = static_cast<uint32_t>(m_strings.size());
+				m_indices.insert(std::make_pair(str, idx));
+				m_strings.push_back(str);
+				return idx;
+			}
+
+			std::vector<uint8_t>& body() {
+				return m_body;
+			}
+
+			bool save(FILE* fp, const BinaryMap::Header& header) const {
+				bool written = std::fwrite(&header, sizeof(header), 1, fp) == 1;
+				uint32_t count = static_cast<uint32_t>(m_strings.size());
+				written = written && std::fwrite(&count, sizeof(count), 1, fp) == 1;
+				for (std::vector<std::string>::const_iterator it = m_strings.begin(); written && it != m_strings.end(); ++it) {
+					uint32_t length = static_cast<uint32_t>(it->size());
+					written = std::fwrite(&length, sizeof(length), 1, fp) == 1 &&
+						(length == 0 || std::fwrite(it->data(), length, 1, fp) == 1);
+				}
+				return written && (m_body.empty() || std::fwrite(&m_body[0], m_body.size(), 1, fp) == 1);
+			}
+
+		private:
+			typedef OpenHashMap<std::string, uint32_t, StringHash> StringTable;
+			StringTable m_indices;
+			std::vector<std::string> m_strings;
+			std::vector<uint8_t> m_body;
+		};
+
+		uint8_t getCellFlags(CellCache* cache, Cell* cell, bool saveNarrows, std::vector<std::string>& cellAreaIds) {
+			uint8_t flags = 0;
+			if (!cell->defaultCost()) {
+				flags |= BinaryMap::CELL_COST_MULTIPLIER;
+			}
+			if (!cell->defaultSpeed()) {
+				flags |= BinaryMap::CELL_SPEED_MULTIPLIER;
+			}
+			CellTypeInfo cti = cell->getCellType();
+			if (cti == CTYPE_CELL_NO_BLOCKER) {
+				flags |= BinaryMap::CELL_NO_BLOCKER;
+			} else if (cti == CTYPE_CELL_BLOCKER) {
+				flags |= BinaryMap::CELL_BLOCKER;
+			}
+			if (saveNarrows && cache->getNarrowCells().count(cell) != 0) {
+				flags |= BinaryMap::CELL_NARROW;
+			}
+			if (!cache->getCellCosts(cell).empty()) {
+				flags |= BinaryMap::CELL_COSTS;
+			}
+			if (cell->getTransition()) {
+				flags |= BinaryMap::CELL_TRANSITION;
+			}
+
+			// areas of the objects on the cell are added again when the instances are created
+			std::vector<std::string> areaIds = cache->getCellAreas(cell);
+			const std::set<Instance*>& cellInstances = cell->getInstances();
+			for (std::vector<std::string>::iterator area_it = areaIds.begin(); area_it != areaIds.end(); ++area_it) {
+				bool objectArea = false;
+				std::set<Instance*>::const_iterator instance_it = cellInstances.begin();
+				for (; instance_it != cellInstances.end(); ++instance_it) {
+					if ((*instance_it)->getObject()->getArea() == *area_it) {
+						objectArea = true;
+						break;
+					}
+				}
+				if (!objectArea) {
+					cellAreaIds.push_back(*area_it);
+				}
+			}
+			if (!cellAreaIds.empty()) {
+				flags |= BinaryMap::CELL_AREAS;
+			}
+			return flags;
+		}
+	}
+
+	BinaryMapSaver::BinaryMapSaver() {
+	}
+
+	BinaryMapSaver::~BinaryMapSaver() {
+	}
+
+	void BinaryMapSaver::setObjectSaver(const FIFE::ObjectSaverPtr& objectSaver) {
+		m_objectSaver = objectSaver;
+	}
+
+	void BinaryMapSaver::setAnimationSaver(const FIFE::AnimationSaverPtr& animationSaver) {
+		m_animationSaver = animationSaver;
+	}
+
+	void BinaryMapSaver::setAtlasSaver(const FIFE::AtlasSaverPtr& atlasSaver) {
+		m_atlasSaver = atlasSaver;
+	}
+
+	void BinaryMapSaver::save(const Map& map, const std::string& filename, const std::vector<std::string>& importFiles) {
+		BinaryWriter writer;
+		uint32_t elements = 0;
+
+		writer.writeString(map.getId());
+
+		// the object table, instances refer to their object by index
+		typedef std::list<Layer*> LayerList;
+		const LayerList& layers = map.getLayers();
+		std::map<Object*, uint32_t> objectIndices;
+		std::vector<Object*> objects;
+		for (LayerList::const_iterator iter = layers.begin(); iter != layers.end(); ++iter) {
+			const std::vector<Instance*>& instances = (*iter)->getInstances();
+			for (std::vector<Instance*>::const_iterator it = instances.begin(); it != instances.end(); ++it) {
+				Object* obj = (*it)->getObject();
+				if (objectIndices.insert(std::make_pair(obj, static_cast<uint32_t>(objects.size()))).second) {
+					objects.push_back(obj);
+				}
+			}
+		}
+		writer.write<uint32_t>(objects.size());
+		for (std::vector<Object*>::iterator it = objects.begin(); it != objects.end(); ++it) {
+			writer.writeString((*it)->getNamespace());
+			writer.writeString((*it)->getId());
+		}
+
+		// imports are files, relative to the map, like the ones of MapSaver
+		writer.write<uint32_t>(importFiles.size());
+		for (std::vector<std::string>::const_iterator iter = importFiles.begin(); iter != importFiles.end(); ++iter) {
+			writer.writeString(std::string());
+			writer.writeString(*iter);
+		}
+
+		writer.write<uint32_t>(layers.size());
+		for (LayerList::const_iterator iter = layers.begin(); iter != layers.end(); ++iter) {
+			Layer* layer = *iter;
+			CellGrid* grid = layer->getCellGrid();
+			writer.writeString(layer->getId());
+			writer.writeString(grid->getType());
+			writer.write<double>(grid->getXShift());
+			writer.write<double>(grid->getYShift());
+			writer.write<double>(grid->getZShift());
+			writer.write<double>(grid->getXScale());
+			writer.write<double>(grid->getYScale());
+			writer.write<double>(grid->getZScale());
+			writer.write<double>(grid->getRotation());
+			writer.write<uint8_t>(layer->getPathingStrategy());
+			writer.write<uint8_t>(layer->getSortingStrategy());
+			writer.write<uint8_t>(layer->getSpatialIndexStrategy());
+			writer.write<uint8_t>(layer->getLayerTransparency());
+			if (layer->isWalkable()) {
+				writer.write<uint8_t>(BinaryMap::LAYER_WALKABLE);
+				writer.writeString(std::string());
+			} else if (layer->isInteract()) {
+				writer.write<uint8_t>(BinaryMap::LAYER_INTERACT);
+				writer.writeString(layer->getWalkableId());
+			} else {
+				writer.write<uint8_t>(BinaryMap::LAYER_DEFAULT);
+				writer.writeString(std::string());
+			}
+
+			// the instance count is patched, once the part instances are skipped
+			const size_t countPosition = writer.body().size();
+			writer.write<uint32_t>(0);
+			uint32_t count = 0;
+			const std::vector<Instance*>& instances = layer->getInstances();
+			for (std::vector<Instance*>::const_iterator it = instances.begin(); it != instances.end(); ++it) {
+				Instance* instance = *it;
+				Object* obj = instance->getObject();
+				// don't save part instances
+				if (obj->isMultiPart()) {
+					continue;
+				}
+
+				BinaryMap::PackedInstance packed;
+				std::memset(&packed, 0, sizeof(packed));
+				ExactModelCoordinate position = instance->getLocationRef().getExactLayerCoordinates();
+				packed.x = position.x;
+				packed.y = position.y;
+				packed.z = position.z;
+				packed.object = objectIndices[obj];
+				packed.id = writer.index(instance->getId());
+				packed.rotation = instance->getRotation();
+				packed.stackPosition = instance->getVisual<InstanceVisual>()->getStackPosition();
+				packed.cellStack = instance->getCellStackPosition();
+				if (instance->isBlocking()) {
+					packed.flags |= BinaryMap::INSTANCE_BLOCKING;
+				}
+				if (instance->getCellStackPosition() != obj->getCellStackPosition()) {
+					packed.flags |= BinaryMap::INSTANCE_CELLSTACK;
+				}
+				if (instance->isSpecialCost() && (!obj->isSpecialCost() ||
+					instance->getCostId() != obj->getCostId() || !Mathd::Equal(instance->getCost(), obj->getCost()))) {
+					packed.flags |= BinaryMap::INSTANCE_COST;
+					packed.costId = writer.index(instance->getCostId());
+					packed.cost = instance->getCost();
+				}
+				writer.write(packed);
+				++count;
+			}
+			std::memcpy(&writer.body()[countPosition], &count, sizeof(count));
+			elements += count + 1;
+		}
+
+		// cell caches, only cells with non default values are saved
+		std::vector<CellCache*> caches;
+		for (LayerList::const_iterator iter = layers.begin(); iter != layers.end(); ++iter) {
+			if ((*iter)->getCellCache()) {
+				caches.push_back((*iter)->getCellCache());
+			}
+		}
+		writer.write<uint32_t>(caches.size());
+		for (std::vector<CellCache*>::iterator iter = caches.begin(); iter != caches.end(); ++iter) {
+			CellCache* cache = *iter;
+			writer.writeString(cache->getLayer()->getId());
+			writer.write<double>(cache->getDefaultCostMultiplier());
+			writer.write<double>(cache->getDefaultSpeedMultiplier());
+			writer.write<uint8_t>(cache->isSearchNarrowCells());
+			const bool saveNarrows = !cache->isSearchNarrowCells() && !cache->getNarrowCells().empty();
+
+			const size_t countPosition = writer.body().size();
+			writer.write<uint32_t>(0);
+			uint32_t count = 0;
+			const std::vector<std::vector<Cell*> >& cells = cache->getCells();
+			for (std::vector<std::vector<Cell*> >::const_iterator it = cells.begin(); it != cells.end(); ++it) {
+				for (std::vector<Cell*>::const_iterator cit = it->begin(); cit != it->end(); ++cit) {
+					Cell* cell = *cit;
+					std::vector<std::string> cellAreaIds;
+					uint8_t flags = getCellFlags(cache, cell, saveNarrows, cellAreaIds);
+					if (flags == 0) {
+						continue;
+					}
+					ModelCoordinate cellCoord = cell->getLayerCoordinates();
+					writer.write<int32_t>(cellCoord.x);
+					writer.write<int32_t>(cellCoord.y);
+					writer.write<uint8_t>(flags);
+					if (flags & BinaryMap::CELL_COST_MULTIPLIER) {
+						writer.write<double>(cell->getCostMultiplier());
+					}
+					if (flags & BinaryMap::CELL_SPEED_MULTIPLIER) {
+						writer.write<double>(cell->getSpeedMultiplier());
+					}
+					if (flags & BinaryMap::CELL_COSTS) {
+						std::vector<std::string> costIds = cache->getCellCosts(cell);
+						writer.write<uint32_t>(costIds.size());
+						for (std::vector<std::string>::iterator cost_it = costIds.begin(); cost_it != costIds.end(); ++cost_it) {
+							writer.writeString(*cost_it);
+							writer.write<double>(cache->getCost(*cost_it));
+						}
+					}
+					if (flags & BinaryMap::CELL_AREAS) {
+						writer.write<uint32_t>(cellAreaIds.size());
+						for (std::vector<std::string>::iterator area_it = cellAreaIds.begin(); area_it != cellAreaIds.end(); ++area_it) {
+							writer.writeString(*area_it);
+						}
+					}
+					if (flags & BinaryMap::CELL_TRANSITION) {
+						TransitionInfo* transition = cell->getTransition();
+						writer.writeString(transition->m_layer->getId());
+						writer.write<int32_t>(transition->m_mc.x);
+						writer.write<int32_t>(transition->m_mc.y);
+						writer.write<int32_t>(transition->m_mc.z);
+						writer.write<uint8_t>(transition->m_immediate);
+					}
+					++count;
+				}
+			}
+			std::memcpy(&writer.body()[countPosition], &count, sizeof(count));
+		}
+
+		std::vector<Trigger*> triggers = map.getTriggerController()->getAllTriggers();
+		writer.write<uint32_t>(triggers.size());
+		for (std::vector<Trigger*>::iterator iter = triggers.begin(); iter != triggers.end(); ++iter) {
+			Trigger* trigger = *iter;
+			writer.writeString(trigger->getName());
+			writer.write<uint8_t>(trigger->isTriggered());
+			writer.write<uint8_t>(trigger->isEnabledForAllInstances());
+			Instance* attached = trigger->getAttached();
+			writer.writeString(attached ? attached->getId() : std::string());
+			writer.writeString(attached ? attached->getLocationRef().getLayer()->getId() : std::string());
+
+			const std::vector<Cell*>& cells = trigger->getAssignedCells();
+			writer.write<uint32_t>(cells.size());
+			for (std::vector<Cell*>::const_iterator it = cells.begin(); it != cells.end(); ++it) {
+				writer.writeString((*it)->getLayer()->getId());
+				writer.write<int32_t>((*it)->getLayerCoordinates().x);
+				writer.write<int32_t>((*it)->getLayerCoordinates().y);
+			}
+			const std::vector<Instance*>& instances = trigger->getEnabledInstances();
+			writer.write<uint32_t>(instances.size());
+			for (std::vector<Instance*>::const_iterator it = instances.begin(); it != instances.end(); ++it) {
+				writer.writeString((*it)->getLocationRef().getLayer()->getId());
+				writer.writeString((*it)->getId());
+			}
+			const std::vector<TriggerCondition>& conditions = trigger->getTriggerConditions();
+			writer.write<uint32_t>(conditions.size());
+			for (std::vector<TriggerCondition>::const_iterator it = conditions.begin(); it != conditions.end(); ++it) {
+				writer.write<int32_t>(*it);
+			}
+		}
+
+		const std::vector<Camera*>& cameras = map.getCameras();
+		writer.write<uint32_t>(cameras.size());
+		for (std::vector<Camera*>::const_iterator iter = cameras.begin(); iter != cameras.end(); ++iter) {
+			Camera* camera = *iter;
+			writer.writeString(camera->getId());
+			writer.write<double>(camera->getZoom());
+			writer.write<double>(camera->getTilt());
+			writer.write<double>(camera->getRotation());
+			writer.write<uint8_t>(camera->isZToYEnabled());
+			writer.write<double>(camera->getZToY());
+			const Rect& viewport = camera->getViewPort();
+			writer.write<int32_t>(viewport.x);
+			writer.write<int32_t>(viewport.y);
+			writer.write<int32_t>(viewport.w);
+			writer.write<int32_t>(viewport.h);
+			Point dimensions = camera->getCellImageDimensions();
+			writer.write<int32_t>(dimensions.x);
+			writer.write<int32_t>(dimensions.y);
+			std::vector<float> lightingColor = camera->getLightingColor();
+			lightingColor.resize(3, 1.0f);
+			for (uint32_t i = 0; i < 3; ++i) {
+				writer.write<float>(lightingColor[i]);
+			}
+			++elements;
+		}
+
+		BinaryMap::Header header;
+		std::memcpy(header.magic, BinaryMap::MAGIC, sizeof(BinaryMap::MAGIC));
+		header.byteOrder = BinaryMap::BYTE_ORDER_MARK;
+		header.version = BinaryMap::VERSION;
+		header.elements = elements;
+
+		FILE* fp = 0;
+		#if defined(_MSC_VER) && (_MSC_VER >= 1400 )
+			fp = _fsopen( filename.c_str(), "wb", _SH_DENYNO );
+		#else
+			fp = fopen( filename.c_str(), "wb" );
+		#endif
+		if (!fp) {
+			throw CannotOpenFile(filename);
+		}
+		bool written = writer.save(fp, header);
+		written = std::fclose(fp) == 0 && written;
+		if (!written) {
+			FL_ERR(_log, LMsg("BinaryMapSaver::save() - ") << "Could not write the map file " << filename);
+		}
+	}
+}
@@ -156,6 +156,10 @@ namespace FIFE {
             }
             layerElement->SetAttribute("sorting", sortingStrategy);
 
+			if ((*iter)->getSpatialIndexStrategy() == SPATIAL_INDEX_LOOSE_QUADTREE) {
+				layerElement->SetAttribute("spatial_index", "loose_quadtree");
+			}
+
 			if ((*iter)->isWalkable()) {
 				layerElement->SetAttribute("layer_type", "walkable");
 			} else if ((*iter)->isInteract()) {
@@ -32,6 +32,7 @@
 // First block: files included from the FIFE root src directory
 // Second block: files included from the same folder
 #include "util/base/sharedptr.h"
+#include "util/structures/openhashmap.h"
 
 namespace FIFE {
 
@@ -57,6 +58,7 @@ namespace FIFE {
 
 		IResource(const std::string& name, IResourceLoader* loader = 0)
 		: m_name(name),
+		  m_nameHash(StringHash()(name)),
 		  m_loader(loader),
 		  m_state(RES_NOT_LOADED),
 		  m_handle(m_curhandle++) { }
@@ -65,8 +67,14 @@ namespace FIFE {
 
 		virtual const std::string& getName() { return m_name; }
 
+		/** Returns the hash of the name, calculated once on creation.
+		 */
+		size_t getNameHash() const { return m_nameHash; }
+
 		ResourceHandle getHandle() { return m_handle; }
 
+		IResourceLoader* getLoader() { return m_loader; }
+
 		virtual ResourceState getState() { return m_state; }
 		virtual void setState(const ResourceState& state) { m_state = state; }
 
@@ -77,6 +85,7 @@ namespace FIFE {
 
 	protected:
 		std::string m_name;
+		size_t m_nameHash;
 		IResourceLoader* m_loader;
 		ResourceState m_state;
 
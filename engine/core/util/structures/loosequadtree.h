@@ -0,0 +1,296 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef FIFE_UTIL_LOOSEQUADTREE_H
+#define FIFE_UTIL_LOOSEQUADTREE_H
+
+// Standard C++ library includes
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/base/fife_stdint.h"
+
+#include "rect.h"
+
+namespace FIFE {
+
+template<typename DataType, int32_t MinimumSize> class LooseQuadTree;
+
+/** LooseQuadTree Node
+ *  Nodes are stored by value in one array of the tree
+ *  and reference each other by their index in that array.
+ */
+template<typename DataType, int32_t MinimumSize = 128>
+class LooseQuadNode {
+	public:
+		/** Create a new LooseQuadNode
+		 *  @param parent The index of the parent node or -1.
+		 *  @param x The X position of this node.
+		 *  @param y The Y position of this node.
+		 *  @param size The width and height of this node.
+		 */
+		LooseQuadNode(int32_t parent, int32_t x, int32_t y, int32_t size)
+			: m_parent(parent),m_x(x),m_y(y),m_size(size),m_data() {
+			m_nodes[0] = m_nodes[1] = m_nodes[2] = m_nodes[3] = -1;
+		}
+
+		/** Return the X position of the node.
+		 */
+		int32_t x() const { return m_x; };
+
+		/** Return the Y position of the node.
+		 */
+		int32_t y() const { return m_y; };
+
+		/** Return the size (width and height) of the node.
+		 */
+		int32_t size() const { return m_size; };
+
+		/** Return the index of the parent node or -1 for the root.
+		 */
+		int32_t parent() const { return m_parent; };
+
+		/** Return a reference to the data of the node.
+		 */
+		DataType& data() { return m_data; };
+
+		/** Check whether the loose bounds of the node intersect a rectangle.
+		 *  The loose bounds extend the node by half its size on every side,
+		 *  so they are twice as wide and high as the node itself.
+		 *  Edges that touch count as intersection.
+		 */
+		bool intersectsLoose(int32_t x, int32_t y, int32_t w, int32_t h) const {
+			const int32_t half = m_size / 2;
+			return x <= m_x + m_size + half && x + w >= m_x - half &&
+				y <= m_y + m_size + half && y + h >= m_y - half;
+		}
+
+		/** Check whether a point lies in the node.
+		 *  The top and left borders are inclusive, the right and bottom borders are exclusive.
+		 */
+		bool containsPoint(int32_t x, int32_t y) const {
+			return x >= m_x && x < m_x + m_size && y >= m_y && y < m_y + m_size;
+		}
+
+	private:
+		friend class LooseQuadTree<DataType,MinimumSize>;
+
+		int32_t m_parent;
+		int32_t m_nodes[4];
+		int32_t m_x,m_y,m_size;
+		DataType m_data;
+};
+
+/** Loose QuadTree with a flat node pool
+ *  Alternative to QuadTree that keeps all nodes in one contiguous array
+ *  instead of allocating every node separately.
+ *  An object is stored in the deepest node that contains the center of its
+ *  bounding box and is at least as large as the box. Because every node
+ *  is queried with its loose bounds, see LooseQuadNode::intersectsLoose, the
+ *  objects do not move up to large nodes when they straddle a node border.
+ *  Like QuadTree it extends itself automatically to any object size and position.
+ *  @note Node indices stay valid until clear() is called, references and pointers
+ *  to nodes do not survive the creation of new nodes.
+ */
+template<typename DataType, int32_t MinimumSize = 128>
+class LooseQuadTree {
+	public:
+		typedef LooseQuadNode<DataType,MinimumSize> Node;
+
+		/** Create a new LooseQuadTree
+		 *  @param x The X position of the starting node.
+		 *  @param y The Y position of the starting node.
+		 *  @param starting_size The width and height of the starting node.
+		 */
+		LooseQuadTree(int32_t x = 0, int32_t y = 0, int32_t starting_size = MinimumSize)
+			: m_x(x), m_y(y), m_startingSize(starting_size) {
+			assert(starting_size>1 && starting_size % 2 == 0);
+			clear();
+		}
+
+		/** Find the node an object with the given bounding box belongs to.
+		 *  The tree is extended as needed, so this always returns a valid node index.
+		 *  @return The index of the node.
+		 */
+		int32_t find_container(int32_t x, int32_t y, int32_t w, int32_t h);
+		int32_t find_container(const Rect& rect) {
+			return find_container(rect.x,rect.y,rect.w,rect.h);
+		}
+
+		/** Return the node with the given index.
+		 */
+		Node& node(int32_t index) {
+			assert(index >= 0 && index < static_cast<int32_t>(m_nodes.size()));
+			return m_nodes[index];
+		}
+
+		/** Return the data of the node with the given index.
+		 */
+		DataType& data(int32_t index) {
+			return node(index).data();
+		}
+
+		/** Apply a visitor to all nodes whose loose bounds intersect the rectangle.
+		 *  The visitor needs a @c visit method which takes a pointer to a @c LooseQuadNode
+		 *  and the depth of the node as integer. Nodes that can hold objects which intersect
+		 *  with the rectangle are visited in Z order, if the method returns @c false
+		 *  the subnodes of the node are skipped.
+		 */
+		template<typename Visitor>
+		Visitor& apply_visitor(const Rect& rect, Visitor& visitor) {
+			return traverse(visitor, true, rect);
+		}
+
+		/** Apply a visitor to all nodes of the tree.
+		 *  @see apply_visitor(const Rect&, Visitor&)
+		 */
+		template<typename Visitor>
+		Visitor& apply_visitor(Visitor& visitor) {
+			return traverse(visitor, false, Rect());
+		}
+
+		/** Return the number of nodes in the pool.
+		 */
+		uint32_t getNodeCount() const { return m_nodes.size(); }
+
+		/** Remove all nodes and data, only the starting node is recreated.
+		 */
+		void clear() {
+			m_nodes.clear();
+			m_nodes.push_back(Node(-1, m_x, m_y, m_startingSize));
+			m_root = 0;
+		}
+
+	protected:
+		template<typename Visitor>
+		Visitor& traverse(Visitor& visitor, bool clip, const Rect& rect);
+
+		/** Create a new root node twice as large as the current one,
+		 *  extending the tree towards the given point.
+		 */
+		void grow(int32_t x, int32_t y);
+
+		std::vector<Node> m_nodes;
+		std::vector<std::pair<int32_t, int32_t> > m_stack;
+		int32_t m_root;
+		int32_t m_x, m_y, m_startingSize;
+};
+
+
+template<typename DataType, int32_t MinimumSize>
+void LooseQuadTree<DataType,MinimumSize>::grow(int32_t x, int32_t y) {
+	const int32_t oldRoot = m_root;
+	const Node& root = m_nodes[oldRoot];
+	const int32_t size = root.size();
+	int32_t newX = root.x();
+	int32_t newY = root.y();
+	int32_t quadrant = 0;
+	if (x < root.x()) {
+		newX -= size;
+		quadrant += 1;
+	}
+	if (y < root.y()) {
+		newY -= size;
+		quadrant += 2;
+	}
+	m_root = m_nodes.size();
+	m_nodes.push_back(Node(-1, newX, newY, size * 2));
+	m_nodes[m_root].m_nodes[quadrant] = oldRoot;
+	m_nodes[oldRoot].m_parent = m_root;
+}
+
+template<typename DataType, int32_t MinimumSize>
+int32_t LooseQuadTree<DataType,MinimumSize>::find_container(int32_t x, int32_t y, int32_t w, int32_t h) {
+	w = std::max(w, 0);
+	h = std::max(h, 0);
+	const int32_t cx = x + w / 2;
+	const int32_t cy = y + h / 2;
+	const int32_t extent = std::max(w, h);
+
+	while (!m_nodes[m_root].containsPoint(cx, cy) || m_nodes[m_root].size() < extent) {
+		grow(cx, cy);
+	}
+
+	int32_t index = m_root;
+	while (true) {
+		const Node& current = m_nodes[index];
+		const int32_t half = current.size() / 2;
+		if (current.size() <= MinimumSize || half < extent) {
+			return index;
+		}
+		int32_t quadrant = 0;
+		int32_t nx = current.x();
+		int32_t ny = current.y();
+		if (cx >= nx + half) {
+			quadrant += 1;
+			nx += half;
+		}
+		if (cy >= ny + half) {
+			quadrant += 2;
+			ny += half;
+		}
+		int32_t child = current.m_nodes[quadrant];
+		if (child == -1) {
+			// push_back can invalidate current, so the child is linked by index
+			child = m_nodes.size();
+			m_nodes.push_back(Node(index, nx, ny, half));
+			m_nodes[index].m_nodes[quadrant] = child;
+		}
+		index = child;
+	}
+}
+
+template<typename DataType, int32_t MinimumSize>
+template<typename Visitor>
+Visitor& LooseQuadTree<DataType,MinimumSize>::traverse(Visitor& visitor, bool clip, const Rect& rect) {
+	// explicit stack of (node, depth) instead of recursion
+	m_stack.clear();
+	m_stack.push_back(std::make_pair(m_root, 0));
+	while (!m_stack.empty()) {
+		const std::pair<int32_t, int32_t> current = m_stack.back();
+		m_stack.pop_back();
+		Node& n = m_nodes[current.first];
+		// the loose bounds of the subnodes lie within the loose bounds of their parent
+		if (clip && !n.intersectsLoose(rect.x, rect.y, rect.w, rect.h)) {
+			continue;
+		}
+		if (!visitor.visit(&n, current.second)) {
+			continue;
+		}
+		for (int32_t i = 3; i >= 0; --i) {
+			if (n.m_nodes[i] != -1) {
+				m_stack.push_back(std::make_pair(n.m_nodes[i], current.second + 1));
+			}
+		}
+	}
+	return visitor;
+}
+
+}
+
+#endif // FIFE_UTIL_LOOSEQUADTREE_H
@@ -0,0 +1,298 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef FIFE_UTIL_OPENHASHMAP_H
+#define FIFE_UTIL_OPENHASHMAP_H
+
+// Standard C++ library includes
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/base/fife_stdint.h"
+
+namespace FIFE {
+
+/** FNV-1a hash of a string, used for resource names.
+ */
+struct StringHash {
+	size_t operator()(const std::string& str) const {
+		uint64_t hash = 14695981039346656037ULL;
+		for (std::string::const_iterator it = str.begin(); it != str.end(); ++it) {
+			hash ^= static_cast<uint8_t>(*it);
+			hash *= 1099511628211ULL;
+		}
+		return static_cast<size_t>(hash);
+	}
+};
+
+/** Hash for integer keys like resource handles.
+ *  Consecutive keys are spread over the whole table.
+ */
+struct IntegerHash {
+	size_t operator()(uint64_t key) const {
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdULL;
+		key ^= key >> 33;
+		return static_cast<size_t>(key);
+	}
+};
+
+/** Hash map with open addressing and linear probing
+ *  All entries are stored in one array, together with their hash value,
+ *  so lookups touch few cache lines and strings are only compared if
+ *  the hashes are equal. The interface follows std::map where it is used
+ *  by the resource managers. The hash of a key can be passed in, if it
+ *  is already known, e.g. the name hash of an IResource.
+ *  @note Iteration order is unspecified. Erasing marks the slot as deleted, so
+ *  iterators to other entries stay valid. Inserting can rehash the table
+ *  and invalidates all iterators.
+ */
+template<typename Key, typename Value, typename Hash>
+class OpenHashMap {
+	private:
+		enum SlotState {
+			SLOT_EMPTY = 0,
+			SLOT_USED,
+			SLOT_DELETED
+		};
+
+		struct Slot {
+			Slot() : hash(0), state(SLOT_EMPTY), data() {}
+			size_t hash;
+			uint8_t state;
+			std::pair<Key, Value> data;
+		};
+
+	public:
+		typedef Key key_type;
+		typedef Value mapped_type;
+		typedef std::pair<Key, Value> value_type;
+
+		template<typename SlotType, typename ValueType>
+		class Iterator {
+			public:
+				Iterator() : m_slot(0), m_end(0) {}
+				Iterator(SlotType* slot, SlotType* end) : m_slot(slot), m_end(end) { skip(); }
+				// allows the conversion of iterator to const_iterator
+				template<typename OtherSlot, typename OtherValue>
+				Iterator(const Iterator<OtherSlot, OtherValue>& other) : m_slot(other.m_slot), m_end(other.m_end) {}
+
+				ValueType& operator*() const { return m_slot->data; }
+				ValueType* operator->() const { return &m_slot->data; }
+				Iterator& operator++() { ++m_slot; skip(); return *this; }
+				Iterator operator++(int) { Iterator tmp(*this); ++(*this); return tmp; }
+				bool operator==(const Iterator& other) const { return m_slot == other.m_slot; }
+				bool operator!=(const Iterator& other) const { return m_slot != other.m_slot; }
+
+			private:
+				friend class OpenHashMap;
+				template<typename, typename> friend class Iterator;
+
+				void skip() {
+					while (m_slot != m_end && m_slot->state != SLOT_USED) {
+						++m_slot;
+					}
+				}
+
+				SlotType* m_slot;
+				SlotType* m_end;
+		};
+
+		typedef Iterator<Slot, value_type> iterator;
+		typedef Iterator<const Slot, const value_type> const_iterator;
+
+		OpenHashMap() : m_size(0), m_deleted(0) {}
+
+		iterator begin() { return m_slots.empty() ? iterator() : iterator(&m_slots[0], slotsEnd()); }
+		iterator end() { return m_slots.empty() ? iterator() : iterator(slotsEnd(), slotsEnd()); }
+		const_iterator begin() const { return m_slots.empty() ? const_iterator() : const_iterator(&m_slots[0], slotsEnd()); }
+		const_iterator end() const { return m_slots.empty() ? const_iterator() : const_iterator(slotsEnd(), slotsEnd()); }
+
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+
+		/** Removes all entries and frees the table.
+		 */
+		void clear() {
+			std::vector<Slot>().swap(m_slots);
+			m_size = 0;
+			m_deleted = 0;
+		}
+
+		/** Reserves space for the given number of entries without rehashing.
+		 */
+		void reserve(size_t count) {
+			size_t capacity = 8;
+			while (capacity * 7 / 10 < count) {
+				capacity *= 2;
+			}
+			if (capacity > m_slots.size()) {
+				rehash(capacity);
+			}
+		}
+
+		iterator find(const Key& key) {
+			return find(key, m_hasher(key));
+		}
+
+		iterator find(const Key& key, size_t hash) {
+			size_t index = lookup(key, hash);
+			return index == NOT_FOUND ? end() : iterator(&m_slots[index], slotsEnd());
+		}
+
+		const_iterator find(const Key& key) const {
+			return find(key, m_hasher(key));
+		}
+
+		const_iterator find(const Key& key, size_t hash) const {
+			size_t index = lookup(key, hash);
+			return index == NOT_FOUND ? end() : const_iterator(&m_slots[index], slotsEnd());
+		}
+
+		size_t count(const Key& key) const {
+			return lookup(key, m_hasher(key)) == NOT_FOUND ? 0 : 1;
+		}
+
+		std::pair<iterator, bool> insert(const value_type& value) {
+			return insert(value, m_hasher(value.first));
+		}
+
+		/** Inserts the value if the key does not exist yet.
+		 *  @param value The key and the value.
+		 *  @param hash The hash of the key.
+		 *  @return The iterator to the entry with the key and true if the value was inserted.
+		 */
+		std::pair<iterator, bool> insert(const value_type& value, size_t hash) {
+			size_t index = lookup(value.first, hash);
+			if (index != NOT_FOUND) {
+				return std::make_pair(iterator(&m_slots[index], slotsEnd()), false);
+			}
+			if ((m_size + m_deleted + 1) * 10 > m_slots.size() * 7) {
+				// grows only if the table is filled with entries, not with deleted slots
+				rehash((m_size + 1) * 10 > m_slots.size() * 5 ? std::max<size_t>(8, m_slots.size() * 2) : m_slots.size());
+			}
+			const size_t mask = m_slots.size() - 1;
+			index = hash & mask;
+			while (m_slots[index].state == SLOT_USED) {
+				index = (index + 1) & mask;
+			}
+			Slot& slot = m_slots[index];
+			if (slot.state == SLOT_DELETED) {
+				--m_deleted;
+			}
+			slot.hash = hash;
+			slot.state = SLOT_USED;
+			slot.data = value;
+			++m_size;
+			return std::make_pair(iterator(&slot, slotsEnd()), true);
+		}
+
+		Value& operator[](const Key& key) {
+			size_t hash = m_hasher(key);
+			iterator it = find(key, hash);
+			if (it == end()) {
+				it = insert(value_type(key, Value()), hash).first;
+			}
+			return it->second;
+		}
+
+		void erase(iterator it) {
+			assert(it.m_slot && it.m_slot->state == SLOT_USED);
+			Slot& slot = *it.m_slot;
+			slot.state = SLOT_DELETED;
+			// releases the key and the value
+			slot.data = value_type();
+			--m_size;
+			++m_deleted;
+		}
+
+		size_t erase(const Key& key) {
+			iterator it = find(key);
+			if (it == end()) {
+				return 0;
+			}
+			erase(it);
+			return 1;
+		}
+
+	private:
+		static const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+		Slot* slotsEnd() { return &m_slots[0] + m_slots.size(); }
+		const Slot* slotsEnd() const { return &m_slots[0] + m_slots.size(); }
+
+		size_t lookup(const Key& key, size_t hash) const {
+			if (m_slots.empty()) {
+				return NOT_FOUND;
+			}
+			const size_t mask = m_slots.size() - 1;
+			size_t index = hash & mask;
+			// the table always has empty slots, so the loop ends
+			while (m_slots[index].state != SLOT_EMPTY) {
+				const Slot& slot = m_slots[index];
+				if (slot.state == SLOT_USED && slot.hash == hash && slot.data.first == key) {
+					return index;
+				}
+				index = (index + 1) & mask;
+			}
+			return NOT_FOUND;
+		}
+
+		void rehash(size_t capacity) {
+			std::vector<Slot> old;
+			old.swap(m_slots);
+			m_slots.resize(capacity);
+			m_deleted = 0;
+			const size_t mask = capacity - 1;
+			for (typename std::vector<Slot>::iterator it = old.begin(); it != old.end(); ++it) {
+				if (it->state != SLOT_USED) {
+					continue;
+				}
+				size_t index = it->hash & mask;
+				while (m_slots[index].state == SLOT_USED) {
+					index = (index + 1) & mask;
+				}
+				Slot& slot = m_slots[index];
+				slot.hash = it->hash;
+				slot.state = SLOT_USED;
+				std::swap(slot.data, it->data);
+			}
+		}
+
+		std::vector<Slot> m_slots;
+		size_t m_size;
+		size_t m_deleted;
+		Hash m_hasher;
+};
+
+}
+
+#endif
@@ -104,6 +104,17 @@ namespace FIFE {
 		return i->second;
 	}
 
+	bool DAT1::isStatic() const {
+		return true;
+	}
+
+	void DAT1::listAll(std::vector<std::string>& files, std::vector<std::string>&) const {
+		type_filelist::const_iterator end = m_filelist.end();
+		for (type_filelist::const_iterator i = m_filelist.begin(); i != end; ++i) {
+			files.push_back(i->first);
+		}
+	}
+
 	std::set<std::string> DAT1::listFiles(const std::string& pathstr) const {
 		return list(pathstr, false);
 	}
@@ -25,6 +25,7 @@
 // Standard C++ library includes
 #include <map>
 #include <memory>
+#include <vector>
 
 // 3rd party library includes
 
@@ -40,6 +41,9 @@
 namespace FIFE {
 
 	/** VFSource for the Fallout1 DAT file format.
+	 *
+	 * The file list doesn't change after construction and every opened file
+	 * reads from its own handle of the archive, so it can be used from several threads.
 	 */
 	class DAT1 : public VFSSource {
 		public:
@@ -67,6 +71,9 @@ namespace FIFE {
 			std::set<std::string> listFiles(const std::string& pathstr) const;
 			std::set<std::string> listDirectories(const std::string& pathstr) const;
 
+			bool isStatic() const;
+			void listAll(std::vector<std::string>& files, std::vector<std::string>& directories) const;
+
 		private:
 			std::string m_datpath;
 			std::unique_ptr<RawData> m_data;
@@ -20,6 +20,8 @@
  ***************************************************************************/
 
 // Standard C++ library includes
+#include <algorithm>
+#include <functional>
 
 // 3rd party library includes
 
@@ -39,6 +41,11 @@ namespace FIFE {
 	 */
 	static Logger _log(LM_FO_LOADERS);
 
+	static inline uint32_t get32Little(const uint8_t* data) {
+		return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+			(static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+	}
+
 	DAT2::DAT2(VFS* vfs, const std::string& file)
 		: VFSSource(vfs), m_datpath(file), m_data(vfs->open(file)), m_filelist() {
 
@@ -57,52 +64,67 @@ namespace FIFE {
 		if (archiveSize != m_data->getDataLength())
 			throw InvalidFormat("size mismatch");
 
-		m_data->setIndex( archiveSize - fileListLength - 8);
-		m_filecount = m_data->read32Little();
-		m_currentIndex = m_data->getCurrentIndex();
-
-		FL_LOG(_log, LMsg("MFFalloutDAT2 FileCount: ") << m_filecount);
-
-		// Do not read the complete file list at startup.
-		// Instead read a chunk each frame.
-		m_timer.setInterval(0);
-		m_timer.setCallback(std::bind( &DAT2::readFileEntry, this) );
-		m_timer.start();
-	}
-
-	void DAT2::readFileEntry() const {
-		assert( m_filecount != 0);
+		if (fileListLength < 4 || fileListLength > archiveSize - 8)
+			throw InvalidFormat("file list larger than filesize");
 
-		// Load more items per call,
-		// otherwise it takes _ages_ until everything is in.
-		uint32_t load_per_cycle = 50;
-		if( load_per_cycle > m_filecount )
-			load_per_cycle = m_filecount;
-		m_filecount -= load_per_cycle;
-
-		// Save the old index in an exception save way.
-		IndexSaver isaver(m_data.get());
+		m_data->setIndex( archiveSize - fileListLength - 8);
+		const uint32_t filecount = m_data->read32Little();
+
+		FL_LOG(_log, LMsg("MFFalloutDAT2 FileCount: ") << filecount);
+
+		// Read the complete file list at once, it ends in front of the two size fields.
+		const uint32_t listStart = m_data->getCurrentIndex();
+		const uint32_t listLength = archiveSize - 8 - listStart;
+		std::vector<uint8_t> buffer;
+		const uint8_t* list = m_data->getData();
+		if (list) {
+			list += listStart;
+		} else {
+			buffer.resize(std::max<uint32_t>(listLength, 1));
+			m_data->readInto(&buffer[0], listLength);
+			list = &buffer[0];
+		}
 
-		// Move index to file list and read the entries.
-		m_data->setIndex(m_currentIndex);
-		RawDataDAT2::s_info info;
-		while( load_per_cycle-- ) {
-			uint32_t namelen = m_data->read32Little();
-			info.name = fixPath(m_data->readString(namelen));
+		// Each entry is the name length, the name and 13 bytes of type, lengths and offset.
+		std::vector<uint32_t> positions;
+		positions.reserve(std::min(filecount, listLength / 17));
+		uint32_t pos = 0;
+		for (uint32_t i = 0; i < filecount; ++i) {
+			if (listLength - pos < 17 || listLength - pos - 17 < get32Little(list + pos)) {
+				throw InvalidFormat("file list larger than filesize");
+			}
+			positions.push_back(pos);
+			pos += 17 + get32Little(list + pos);
+		}
 
-			info.type = m_data->read8();
-			info.unpackedLength = m_data->read32Little();
-			info.packedLength = m_data->read32Little();
-			info.offset = m_data->read32Little();
+		// The entries are independent, parse them on several threads.
+		std::vector<RawDataDAT2::s_info> entries(positions.size());
+		parseIndexParallel(positions.size(), std::bind(&DAT2::parseFileEntries, this, list, std::cref(positions),
+			std::ref(entries), std::placeholders::_1, std::placeholders::_2));
 
-			m_filelist.insert(std::make_pair(info.name, info));
+		std::vector<RawDataDAT2::s_info>::const_iterator end = entries.end();
+		for (std::vector<RawDataDAT2::s_info>::const_iterator it = entries.begin(); it != end; ++it) {
+			m_filelist.insert(std::make_pair(it->name, *it));
 		}
-		m_currentIndex = m_data->getCurrentIndex();
 
-		// Finally log on completion and stop the timer.
-		if( m_filecount == 0 ) {
-			FL_LOG(_log, LMsg("MFFalloutDAT2, All file entries in '") << m_datpath << "' loaded.");
-			m_timer.stop();
+		FL_LOG(_log, LMsg("MFFalloutDAT2, All file entries in '") << m_datpath << "' loaded.");
+	}
+
+	void DAT2::parseFileEntries(const uint8_t* list, const std::vector<uint32_t>& positions,
+		std::vector<RawDataDAT2::s_info>& entries, size_t begin, size_t end) const {
+		for (size_t i = begin; i < end; ++i) {
+			const uint8_t* entry = list + positions[i];
+			const uint32_t namelen = get32Little(entry);
+			entry += 4;
+
+			RawDataDAT2::s_info& info = entries[i];
+			info.name = fixPath(std::string(reinterpret_cast<const char*>(entry), namelen));
+			entry += namelen;
+
+			info.type = entry[0];
+			info.unpackedLength = get32Little(entry + 1);
+			info.packedLength = get32Little(entry + 5);
+			info.offset = get32Little(entry + 9);
 		}
 	}
 
@@ -136,22 +158,20 @@ namespace FIFE {
 			name.erase(0, 2);
 		}
 
-		type_filelist::const_iterator i = m_filelist.find(name);
-
-		// We might have another chance to find the file
-		// if the number of file entries not zero.
-		if ( m_filecount && i == m_filelist.end()) {
-			FL_LOG(_log, LMsg("MFFalloutDAT2")
-				<< "Missing '" << name
-				<< "' in partially(" << m_filecount <<") loaded "<< m_datpath);
-			while( m_filecount && i == m_filelist.end()) {
-				readFileEntry();
-				i = m_filelist.find(name);
-			}
-		}
-		return i;
+		return m_filelist.find(name);
+	}
+
+
+	bool DAT2::isStatic() const {
+		return true;
 	}
 
+	void DAT2::listAll(std::vector<std::string>& files, std::vector<std::string>&) const {
+		type_filelist::const_iterator end = m_filelist.end();
+		for (type_filelist::const_iterator i = m_filelist.begin(); i != end; ++i) {
+			files.push_back(i->first);
+		}
+	}
 
 	std::set<std::string> DAT2::listFiles(const std::string& pathstr) const {
 		return list(pathstr, false);
@@ -165,13 +185,6 @@ namespace FIFE {
 		std::set<std::string> list;
 		std::string path = pathstr;
 
-		// Force loading the complete file entries
-		// This is a costly operation... right after startup.
-		// Later this should do nothing.
-		while( m_filecount ) {
-			readFileEntry();
-		}
-
 		// Normalize the path
 		if (path.find("./") == 0) {
 			path.erase(0, 2);
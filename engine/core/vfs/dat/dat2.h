@@ -26,6 +26,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 // Platform specific includes
 #include "util/base/fife_stdint.h"
@@ -36,7 +37,6 @@
 // These includes are split up in two parts, separated by one empty line
 // First block: files included from the FIFE root src directory
 // Second block: files included from the same folder
-#include "util/time/timer.h"
 #include "vfs/vfs.h"
 #include "vfs/vfssource.h"
 
@@ -47,11 +47,10 @@ namespace FIFE {
 
 	/** VFSource for the Fallout2 DAT file format
 	 *
-	 *  Implements a kind of lazy initializing, by reading the file list
-	 *  in chunks. Behaviour is the same as if it wouldn't do this,
-	 *  but startup is very fast. But a open/fileExists call with a
-	 *  filename that doesn't exist, does trigger completely loading
-	 *  the file entries.
+	 *  The file list is read at once when the source is created
+	 *  and parsed on several threads for big archives. It doesn't
+	 *  change afterwards and every opened file reads from its own
+	 *  handle of the archive, so it can be used from several threads.
 	 *
 	 * @see MFFalloutDAT1
 	 * @todo @b maybe merge common DAT1/DAT2 code in a common base class
@@ -78,21 +77,18 @@ namespace FIFE {
 			std::set<std::string> listFiles(const std::string& pathstr) const;
 			std::set<std::string> listDirectories(const std::string& pathstr) const;
 
+			bool isStatic() const;
+			void listAll(std::vector<std::string>& files, std::vector<std::string>& directories) const;
+
 		private:
 			std::string m_datpath;
 			mutable std::unique_ptr<RawData> m_data;
 			typedef std::map<std::string, RawDataDAT2::s_info> type_filelist;
-			mutable type_filelist m_filelist;
-
-			/// number of file entries to read
-			mutable uint32_t m_filecount;
-			/// current index in file
-			mutable uint32_t m_currentIndex;
-			/// lazy loading timer
-			mutable Timer m_timer;
+			type_filelist m_filelist;
 
-			/// read a bunch of file entries
-			void readFileEntry() const;
+			/// parse the file entries [begin, end) of the file list
+			void parseFileEntries(const uint8_t* list, const std::vector<uint32_t>& positions,
+				std::vector<RawDataDAT2::s_info>& entries, size_t begin, size_t end) const;
 
 			/// find a file entry
 			type_filelist::const_iterator findFileEntry(const std::string& name) const;
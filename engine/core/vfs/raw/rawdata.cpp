@@ -21,6 +21,8 @@
 
 // Standard C++ library includes
 #include <algorithm>
+#include <cstring>
+#include <limits>
 #include <vector>
 #include <string>
 
@@ -38,7 +40,7 @@
 namespace FIFE {
 	static Logger _log(LM_VFS);
 	
-	RawData::RawData(RawDataSource* datasource) : m_datasource(datasource), m_index_current(0) {
+	RawData::RawData(RawDataSource* datasource) : m_datasource(datasource), m_data(datasource->getData()), m_datalength(datasource->getSize()), m_terminated(m_data && datasource->hasNullTerminator()), m_index_current(0) {
 
 	}
 
@@ -48,7 +50,7 @@ namespace FIFE {
 
 	std::vector<uint8_t> RawData::getDataInBytes() {
         // get the total file size
-		uint32_t size = getDataLength();
+		size_t size = static_cast<size_t>(getDataLength());
 
         // create output vector
         std::vector<uint8_t> target;
@@ -65,6 +67,9 @@ namespace FIFE {
 	std::vector<std::string> RawData::getDataInLines() {
 		std::vector<std::string> target;
 
+		// lets getLine scan the data in memory
+		getDataView();
+
 		std::string line;
 		while (getLine(line)) {
 			target.push_back(line);
@@ -72,35 +77,93 @@ namespace FIFE {
 		return target;
 	}
 
-	uint32_t RawData::getDataLength() const {
-		return m_datasource->getSize();
+	const uint8_t* RawData::getData() const {
+		return m_data;
+	}
+
+	const uint8_t* RawData::getDataView() {
+		if (!m_data) {
+			fillBuffer();
+		}
+		return m_data;
+	}
+
+	const char* RawData::getDataAsText() {
+		if (!m_terminated) {
+			fillBuffer();
+		}
+		return reinterpret_cast<const char*>(m_data);
+	}
+
+	void RawData::fillBuffer() {
+		if (m_datalength >= std::numeric_limits<size_t>::max()) {
+			throw OutOfMemory("data too big for the address space");
+		}
+		m_buffer.resize(static_cast<size_t>(m_datalength) + 1);
+		if (m_data) {
+			memcpy(&m_buffer[0], m_data, static_cast<size_t>(m_datalength));
+		} else if (m_datalength > 0) {
+			m_datasource->readInto(&m_buffer[0], 0, static_cast<size_t>(m_datalength));
+		}
+		m_buffer[static_cast<size_t>(m_datalength)] = 0;
+		m_data = &m_buffer[0];
+		m_terminated = true;
+	}
+
+	uint64_t RawData::getDataLength() const {
+		return m_datalength;
+	}
+
+	std::string RawData::getHostPath() const {
+		return m_datasource->getHostPath();
 	}
 
-	uint32_t RawData::getCurrentIndex() const {
+	uint64_t RawData::getCurrentIndex() const {
 		return m_index_current;
 	}
 
-	void RawData::setIndex(uint32_t index) {
+	void RawData::setIndex(uint64_t index) {
 		if (index > getDataLength())
 			throw IndexOverflow(__FUNCTION__);
 
 		m_index_current = index;
 	}
 
-	void RawData::moveIndex(int32_t offset) {
+	void RawData::moveIndex(int64_t offset) {
+		if (offset < 0 && static_cast<uint64_t>(-offset) > getCurrentIndex())
+			throw IndexOverflow(__FUNCTION__);
+
 		setIndex(getCurrentIndex() + offset);
 	}
 
 	void RawData::readInto(uint8_t* buffer, size_t len) {
-		if (m_index_current + len > getDataLength()) {
+		if (m_index_current > getDataLength() || len > getDataLength() - m_index_current) {
 			FL_LOG(_log, LMsg("RawData") << m_index_current << " : " << len << " : " << getDataLength());
 			throw IndexOverflow(__FUNCTION__);
 		}
 
-		m_datasource->readInto(buffer, m_index_current, len);
+		// bypass the source if the data is directly accessible
+		if (m_data) {
+			memcpy(buffer, m_data + m_index_current, len);
+		} else {
+			m_datasource->readInto(buffer, m_index_current, len);
+		}
 		m_index_current += len;
 	}
 
+	void RawData::readAt(uint64_t index, uint8_t* buffer, size_t len) const {
+		if (index > getDataLength() || len > getDataLength() - index) {
+			FL_LOG(_log, LMsg("RawData") << index << " : " << len << " : " << getDataLength());
+			throw IndexOverflow(__FUNCTION__);
+		}
+
+		if (m_data) {
+			memcpy(buffer, m_data + index, len);
+		} else {
+			m_datasource->readInto(buffer, index, len);
+		}
+	}
+
 	uint8_t RawData::read8() {
 		return readSingle<uint8_t>();
 	}
@@ -126,18 +189,16 @@ namespace FIFE {
 	}
 
 	std::string RawData::readString(size_t len) {
-        std::vector<uint8_t> strVector;
-        strVector.resize(len);
-        readInto(&strVector[0], len);
-
-        std::string ret(strVector.begin(), strVector.end());
-
-        return ret;
+		std::string ret(len, '\0');
+		if (len > 0) {
+			readInto(reinterpret_cast<uint8_t*>(&ret[0]), len);
+		}
+		return ret;
 	}
 
 	void RawData::read(std::string& outbuffer, int32_t size) {
-		if ((size < 0) || ((size + m_index_current) > getDataLength())) {
-			size = getDataLength() - m_index_current;
+		if ((size < 0) || (static_cast<uint64_t>(size) > getDataLength() - m_index_current)) {
+			size = static_cast<int32_t>(std::min<uint64_t>(getDataLength() - m_index_current, std::numeric_limits<int32_t>::max()));
 		}
 		if (size == 0) {
 			outbuffer = "";
@@ -155,6 +216,20 @@ namespace FIFE {
 		if (getCurrentIndex() >= getDataLength())
 			return false;
 
+		if (m_data) {
+			const char* begin = reinterpret_cast<const char*>(m_data) + m_index_current;
+			const size_t rest = static_cast<size_t>(m_datalength - m_index_current);
+			const char* end = static_cast<const char*>(memchr(begin, '\n', rest));
+			if (end) {
+				buffer.assign(begin, end);
+				m_index_current += end - begin + 1;
+			} else {
+				buffer.assign(begin, rest);
+				m_index_current = m_datalength;
+			}
+			return true;
+		}
+
 		buffer = "";
 		char c;
 		while (getCurrentIndex() < getDataLength() && (c = read8()) != '\n')
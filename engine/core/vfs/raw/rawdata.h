@@ -24,6 +24,7 @@
 
 // Standard C++ library includes
 #include <memory>
+#include <string>
 #include <vector>
 
 // Platform specific includes
@@ -44,6 +45,9 @@ namespace FIFE {
 	 *
 	 * RawData uses RawDataSource to get the real data - that way the user doesn't have to know where the data comes
 	 * from (real files, files inside archives etc.)
+	 *
+	 * Every RawData has its own read position, so one instance must only be used by one thread at a time.
+	 * The only exception is readAt, which can be called from several threads at once.
 	 */
 	class RawData {
 		public:
@@ -60,31 +64,65 @@ namespace FIFE {
 			std::vector<std::string> getDataInLines();
 
 
+			/** get direct read-only access to the data
+			 *
+			 * Only available if the RawDataSource keeps the data contiguous in memory,
+			 * e.g. for memory mapped files. The pointer stays valid as long as this RawData exists.
+			 * @return pointer to getDataLength() bytes or NULL
+			 * @see getDataView
+			 */
+			const uint8_t* getData() const;
+
+			/** get a read-only view of the complete data
+			 *
+			 * Sources that keep their data in memory (mapped files, zip and dat entries) are not copied,
+			 * the data of all other sources is read once into a buffer owned by this RawData.
+			 * The view stays valid as long as this RawData exists, the current index is not changed.
+			 * @return pointer to getDataLength() bytes
+			 */
+			const uint8_t* getDataView();
+
+			/** get the complete data as null terminated text, e.g. for xml parsers
+			 *
+			 * Same as getDataView, but the data is guaranteed to be followed by a null character.
+			 * The data is only copied if the source can not guarantee that.
+			 * @return pointer to getDataLength() characters plus the null terminator
+			 */
+			const char* getDataAsText();
+
 			/** get the complete datalength
 			 *
+			 * Lengths and indices are 64 bit, so files bigger than 4 GB can be addressed.
 			 * @return the complete datalength
 			 */
-			uint32_t getDataLength() const;
+			uint64_t getDataLength() const;
+
+			/** get the path of the host file the data is read from
+			 *
+			 * Unlike the name given to VFS::open, the path includes the root of the source.
+			 * @return the path or an empty string if the data is not a host file, e.g. an archive entry
+			 */
+			std::string getHostPath() const;
 
 			/** get the current index
 			 *
 			 * @return the current index
 			 */
-			uint32_t getCurrentIndex() const;
+			uint64_t getCurrentIndex() const;
 
 			/** set the current index
 			 *
 			 * @param index the new index
 			 * @throws IndexOverflow if index is >= getDataLength()
 			 */
-			void setIndex(uint32_t index);
+			void setIndex(uint64_t index);
 
 			/** move the current index
 			 *
 			 * @param offset the offset
 			 * @throws IndexOverflow if we move outside the datalength
 			 */
-			void moveIndex(int32_t offset);
+			void moveIndex(int64_t offset);
 
 			/** helper-function
 			 *
@@ -105,6 +143,17 @@ namespace FIFE {
 			 */
 			void readInto(uint8_t* buffer, size_t len);
 
+			/** read len bytes at the given position into buffer, without moving the current index
+			 *
+			 * Can be called from several threads at the same time if the data source allows it,
+			 * which files on the host system and data in memory do.
+			 * @param index the position to read from
+			 * @param buffer the data will be written into it
+			 * @param len len bytes will be written
+			 * @throws IndexOverflow if index + len > getDataLength()
+			 */
+			void readAt(uint64_t index, uint8_t* buffer, size_t len) const;
+
 			/** reads 1 byte */
 			uint8_t read8();
 
@@ -155,7 +204,15 @@ namespace FIFE {
 
 		private:
 			RawDataSource* m_datasource;
-			size_t m_index_current;
+			// direct access to the data of the source, NULL if not available
+			const uint8_t* m_data;
+			// size of the source, it does not change
+			uint64_t m_datalength;
+			// is m_data followed by a null byte
+			bool m_terminated;
+			// owned copy of the data, used if the source data can not be viewed directly
+			std::vector<uint8_t> m_buffer;
+			uint64_t m_index_current;
 
 			template <typename T> T littleToHost(T value) const {
 				if (littleEndian())
@@ -182,6 +239,10 @@ namespace FIFE {
 			RawData(const RawData&);
 			RawData& operator=(const RawData&) { return *this; };
 
+			/** Copies the data into m_buffer, followed by a null byte, and uses it as m_data.
+			 */
+			void fillBuffer();
+
 			static bool littleEndian();
 	};
 	typedef std::shared_ptr<RawData> RawDataPtr;
@@ -196,7 +257,7 @@ namespace FIFE {
 
 		private:
 			RawData* m_rd;
-			uint32_t m_index;
+			uint64_t m_index;
 
 			IndexSaver(const IndexSaver&);
 			IndexSaver& operator=(const IndexSaver&) { return *this; }
@@ -38,10 +38,10 @@ namespace FIFE {
 			std::vector<uint8_t> getDataInBytes();
 			std::vector<std::string> getDataInLines();
 
-			uint32_t getDataLength() const;
-			uint32_t getCurrentIndex() const;
-			void setIndex(uint32_t index);
-			void moveIndex(int32_t offset);
+			uint64_t getDataLength() const;
+			uint64_t getCurrentIndex() const;
+			void setIndex(uint64_t index);
+			void moveIndex(int64_t offset);
 
 			void readInto(uint8_t* buffer, size_t len);
 			uint8_t read8();
@@ -20,6 +20,14 @@
  ***************************************************************************/
 
 // Standard C++ library includes
+#include <cerrno>
+
+// Platform specific includes
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // 3rd party library includes
 
@@ -33,12 +41,13 @@
 
 namespace FIFE {
 
+#if defined(_WIN32)
 	RawDataFile::RawDataFile(const std::string& file) : m_file(file), m_stream(m_file.c_str(), std::ios::binary), m_filesize(0) {
 		if (!m_stream)
 			throw CannotOpenFile(m_file);
 
 		m_stream.seekg(0, std::ios::end);
-		m_filesize = m_stream.tellg();
+		m_filesize = static_cast<uint64_t>(m_stream.tellg());
 		m_stream.seekg(0, std::ios::beg);
 	}
 
@@ -46,15 +55,54 @@ namespace FIFE {
 	RawDataFile::~RawDataFile() {
 	}
 
+	void RawDataFile::readInto(uint8_t* buffer, uint64_t start, size_t length) {
+		std::lock_guard<std::mutex> lock(m_streamMutex);
+		m_stream.seekg(static_cast<std::streamoff>(start));
+		m_stream.read(reinterpret_cast<char*>(buffer), length);
+	}
+#else
+	RawDataFile::RawDataFile(const std::string& file) : m_file(file), m_fd(-1), m_filesize(0) {
+		m_fd = ::open(m_file.c_str(), O_RDONLY);
+		if (m_fd < 0)
+			throw CannotOpenFile(m_file);
+
+		struct stat st;
+		if (fstat(m_fd, &st) != 0) {
+			::close(m_fd);
+			throw CannotOpenFile(m_file);
+		}
+		m_filesize = static_cast<uint64_t>(st.st_size);
+	}
+
+
+	RawDataFile::~RawDataFile() {
+		::close(m_fd);
+	}
+
+	void RawDataFile::readInto(uint8_t* buffer, uint64_t start, size_t length) {
+		// pread doesn't move a shared file position
+		while (length > 0) {
+			ssize_t count = ::pread(m_fd, buffer, length, static_cast<off_t>(start));
+			if (count < 0 && errno == EINTR) {
+				continue;
+			}
+			if (count <= 0) {
+				throw CannotOpenFile(m_file);
+			}
+			buffer += count;
+			start += static_cast<uint64_t>(count);
+			length -= static_cast<size_t>(count);
+		}
+	}
+#endif
+
 
-	uint32_t RawDataFile::getSize( ) const {
+	uint64_t RawDataFile::getSize() const {
 		return m_filesize;
 	}
 
-	void RawDataFile::readInto(uint8_t* buffer, uint32_t start, uint32_t length) {
-		m_stream.seekg(start);
-		m_stream.read(reinterpret_cast<char*>(buffer), length);
+	std::string RawDataFile::getHostPath() const {
+		return m_file;
 	}
 
 }
-
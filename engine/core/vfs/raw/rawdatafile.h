@@ -24,6 +24,7 @@
 
 // Standard C++ library includes
 #include <fstream>
+#include <mutex>
 #include <string>
 
 // 3rd party library includes
@@ -37,6 +38,8 @@
 namespace FIFE {
 
 	/** A RawDataSource for a file on the host system
+	 *
+	 * Reads are positional (pread on POSIX systems), so readInto can be called from several threads.
 	 * @see VFSHostSystem
 	 * @see RawDataSource
 	 */
@@ -51,14 +54,24 @@ namespace FIFE {
 			RawDataFile(const std::string& file);
 			virtual ~RawDataFile();
 
-			virtual uint32_t getSize() const;
-			virtual void readInto(uint8_t* buffer, uint32_t start, uint32_t length);
+			virtual uint64_t getSize() const;
+			virtual void readInto(uint8_t* buffer, uint64_t start, size_t length);
+			virtual std::string getHostPath() const;
 
 		private:
 			std::string m_file;
+#if defined(_WIN32)
 			std::ifstream m_stream;
+			// seeking and reading have to happen together
+			std::mutex m_streamMutex;
+#else
+			int m_fd;
+#endif
+
+			uint64_t m_filesize;
 
-			uint32_t m_filesize;
+			RawDataFile(const RawDataFile&);
+			RawDataFile& operator=(const RawDataFile&) { return *this; }
 
 	};
 
@@ -0,0 +1,181 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <cstring>
+#include <limits>
+
+// Platform specific includes
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FIFE_VFS_POSIX_MMAP
+#endif
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/base/exception.h"
+
+#include "rawdatamappedfile.h"
+
+namespace FIFE {
+
+#if defined(_WIN32)
+	RawDataMappedFile::RawDataMappedFile(const std::string& file) : m_file(file), m_data(0), m_filesize(0), m_terminated(false), m_mapping(0) {
+		HANDLE handle = CreateFileA(m_file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (handle == INVALID_HANDLE_VALUE) {
+			throw CannotOpenFile(m_file);
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(handle, &size)) {
+			CloseHandle(handle);
+			throw CannotOpenFile(m_file);
+		}
+		m_filesize = static_cast<uint64_t>(size.QuadPart);
+
+		// the file has to fit into the address space, 32 bit processes read big files with RawDataFile
+		if (m_filesize >= std::numeric_limits<size_t>::max()) {
+			CloseHandle(handle);
+			throw CannotOpenFile(m_file);
+		}
+
+		// empty files can not be mapped, they have no data anyway
+		if (m_filesize > 0) {
+			m_mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (m_mapping) {
+				m_data = static_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+			}
+		}
+		// the mapping keeps the file open
+		CloseHandle(handle);
+
+		if (m_filesize > 0 && !m_data) {
+			if (m_mapping) {
+				CloseHandle(m_mapping);
+			}
+			throw CannotOpenFile(m_file);
+		}
+
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		m_terminated = m_data && (m_filesize % info.dwPageSize) != 0;
+	}
+
+	RawDataMappedFile::~RawDataMappedFile() {
+		if (m_data) {
+			UnmapViewOfFile(m_data);
+		}
+		if (m_mapping) {
+			CloseHandle(m_mapping);
+		}
+	}
+
+	bool RawDataMappedFile::isSupported() {
+		return true;
+	}
+#elif defined(FIFE_VFS_POSIX_MMAP)
+	RawDataMappedFile::RawDataMappedFile(const std::string& file) : m_file(file), m_data(0), m_filesize(0), m_terminated(false) {
+		int fd = ::open(m_file.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw CannotOpenFile(m_file);
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+			::close(fd);
+			throw CannotOpenFile(m_file);
+		}
+		m_filesize = static_cast<uint64_t>(st.st_size);
+
+		// the file has to fit into the address space, 32 bit processes read big files with RawDataFile
+		if (m_filesize >= std::numeric_limits<size_t>::max()) {
+			::close(fd);
+			throw CannotOpenFile(m_file);
+		}
+
+		// empty files can not be mapped, they have no data anyway
+		if (m_filesize > 0) {
+			void* data = mmap(NULL, static_cast<size_t>(m_filesize), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data == MAP_FAILED) {
+				::close(fd);
+				throw CannotOpenFile(m_file);
+			}
+			m_data = static_cast<uint8_t*>(data);
+			m_terminated = (m_filesize % static_cast<uint64_t>(sysconf(_SC_PAGESIZE))) != 0;
+		}
+		// the mapping keeps the file open
+		::close(fd);
+	}
+
+	RawDataMappedFile::~RawDataMappedFile() {
+		if (m_data) {
+			munmap(m_data, static_cast<size_t>(m_filesize));
+		}
+	}
+
+	bool RawDataMappedFile::isSupported() {
+		return true;
+	}
+#else
+	RawDataMappedFile::RawDataMappedFile(const std::string& file) : m_file(file), m_data(0), m_filesize(0), m_terminated(false) {
+		throw CannotOpenFile(m_file);
+	}
+
+	RawDataMappedFile::~RawDataMappedFile() {
+	}
+
+	bool RawDataMappedFile::isSupported() {
+		return false;
+	}
+#endif
+
+	uint64_t RawDataMappedFile::getSize() const {
+		return m_filesize;
+	}
+
+	void RawDataMappedFile::readInto(uint8_t* buffer, uint64_t start, size_t length) {
+		if (length > 0) {
+			memcpy(buffer, m_data + start, length);
+		}
+	}
+
+	const uint8_t* RawDataMappedFile::getData() const {
+		return m_data;
+	}
+
+	bool RawDataMappedFile::hasNullTerminator() const {
+		return m_terminated;
+	}
+
+	std::string RawDataMappedFile::getHostPath() const {
+		return m_file;
+	}
+
+}
@@ -0,0 +1,82 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef FIFE_VFS_RAW_RAWDATAMAPPEDFILE_H
+#define FIFE_VFS_RAW_RAWDATAMAPPEDFILE_H
+
+// Standard C++ library includes
+#include <string>
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "rawdatasource.h"
+
+namespace FIFE {
+
+	/** A RawDataSource for a file on the host system that is mapped into memory
+	 *
+	 * Reads are plain memory copies and getData() gives direct access to the mapped
+	 * file, so no read syscall is needed after the file was opened.
+	 * @see RawDataFile
+	 * @see RawDataSource
+	 */
+	class RawDataMappedFile : public RawDataSource {
+
+		public:
+			/** Constructor
+			 * Maps the whole file read-only into memory.
+			 * @param file The path to the file to map.
+			 * @throw CannotOpenFile if the file can not be opened or mapped.
+			 */
+			RawDataMappedFile(const std::string& file);
+			virtual ~RawDataMappedFile();
+
+			/** Returns true if memory mapping is supported on this platform.
+			 */
+			static bool isSupported();
+
+			virtual uint64_t getSize() const;
+			virtual void readInto(uint8_t* buffer, uint64_t start, size_t length);
+			virtual const uint8_t* getData() const;
+			virtual bool hasNullTerminator() const;
+			virtual std::string getHostPath() const;
+
+		private:
+			std::string m_file;
+			uint8_t* m_data;
+			uint64_t m_filesize;
+			// the rest of the last mapped page is filled with zeros
+			bool m_terminated;
+#if defined(_WIN32)
+			void* m_mapping;
+#endif
+
+			RawDataMappedFile(const RawDataMappedFile&);
+			RawDataMappedFile& operator=(const RawDataMappedFile&) { return *this; }
+	};
+
+}
+
+#endif
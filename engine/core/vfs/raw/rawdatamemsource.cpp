@@ -32,21 +32,30 @@
 
 namespace FIFE {
 
-	RawDataMemSource::RawDataMemSource(uint32_t len) : m_data(new uint8_t[len]), m_datalen(len) {
+	RawDataMemSource::RawDataMemSource(uint32_t len) : m_data(new uint8_t[len + 1]), m_datalen(len) {
+		m_data[len] = 0;
 	}
 
 	RawDataMemSource::~RawDataMemSource() {
 		delete[] m_data;
 	}
 
-	uint32_t RawDataMemSource::getSize() const {
+	uint64_t RawDataMemSource::getSize() const {
 		return m_datalen;
 	}
 
-	void RawDataMemSource::readInto(uint8_t* buffer, uint32_t start, uint32_t length) {
+	void RawDataMemSource::readInto(uint8_t* buffer, uint64_t start, size_t length) {
 		std::copy(m_data + start, m_data + start + length, buffer);
 	}
 
+	const uint8_t* RawDataMemSource::getData() const {
+		return m_data;
+	}
+
+	bool RawDataMemSource::hasNullTerminator() const {
+		return true;
+	}
+
 	uint8_t* RawDataMemSource::getRawData() const {
 		return m_data;
 	}
@@ -49,6 +49,7 @@ namespace FIFE {
 		public:
 			/**
 			 *	Create a new RawDataMemSource that allocates datalen bytes.
+			 * One more byte is allocated and set to 0, so the data can be used as text.
 			 * @param datalen the datalen to allocate
 			 */
 			RawDataMemSource(uint32_t datalen);
@@ -59,8 +60,10 @@ namespace FIFE {
 			 */
 			uint8_t* getRawData() const;
 
-			virtual uint32_t getSize() const;
-			virtual void readInto(uint8_t* buffer, uint32_t start, uint32_t length);
+			virtual uint64_t getSize() const;
+			virtual void readInto(uint8_t* buffer, uint64_t start, size_t length);
+			virtual const uint8_t* getData() const;
+			virtual bool hasNullTerminator() const;
 
 		private:
 			uint8_t* m_data;
@@ -34,4 +34,16 @@ namespace FIFE {
 	RawDataSource::RawDataSource() {}
 
 	RawDataSource::~RawDataSource() {}
+
+	const uint8_t* RawDataSource::getData() const {
+		return 0;
+	}
+
+	bool RawDataSource::hasNullTerminator() const {
+		return false;
+	}
+
+	std::string RawDataSource::getHostPath() const {
+		return std::string();
+	}
 }
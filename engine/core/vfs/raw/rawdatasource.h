@@ -23,6 +23,8 @@
 #define FIFE_VFS_RAW_RAWDATASOURCE_H
 
 // Standard C++ library includes
+#include <cstddef>
+#include <string>
 
 // Platform specific includes
 #include "util/base/fife_stdint.h"
@@ -48,15 +50,37 @@ namespace FIFE {
 			virtual ~RawDataSource();
 
 			/** get the complete datasize */
-			virtual uint32_t getSize() const = 0;
+			virtual uint64_t getSize() const = 0;
 
 			/** read data from the source
 			 *
+			 * Sources for host files and memory allow concurrent calls, sources
+			 * that decode data on the fly (e.g. ZipStreamSource) do not.
 			 * @param buffer the data will be written into buffer
 			 * @param start the startindex inside the source
 			 * @param length length bytes will be written into buffer
 			 */
-			virtual void readInto(uint8_t* buffer, uint32_t start, uint32_t length) = 0;
+			virtual void readInto(uint8_t* buffer, uint64_t start, size_t length) = 0;
+
+			/** get direct read-only access to the data
+			 *
+			 * Sources that keep all of their data contiguous in memory (e.g. mapped files)
+			 * return a pointer to it, all others return NULL and must be read with readInto.
+			 * @return pointer to getSize() bytes or NULL
+			 */
+			virtual const uint8_t* getData() const;
+
+			/** check if the data returned by getData() is followed by a null byte
+			 *
+			 * Such data can be handed to text parsers without copying it.
+			 */
+			virtual bool hasNullTerminator() const;
+
+			/** get the path of the host file the data is read from
+			 *
+			 * @return the path including the root of the source, empty for archive entries and memory
+			 */
+			virtual std::string getHostPath() const;
 
 	};
 
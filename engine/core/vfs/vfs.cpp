@@ -24,7 +24,6 @@
 #include <regex>
 
 // 3rd party library includes
-#include <boost/functional.hpp>
 #include <boost/algorithm/string.hpp>
 
 // FIFE includes
@@ -51,7 +50,15 @@ namespace FIFE {
 	}
 
 	void VFS::cleanup() {
-		type_sources sources = m_sources;
+		// take the sources first, so their destructors don't update the index
+		type_sources sources;
+		{
+			std::lock_guard<std::mutex> lock(m_sourceMutex);
+			sources.swap(m_sources);
+			m_fileIndex.clear();
+			m_directoryIndex.clear();
+		}
+
 		type_sources::const_iterator end = sources.end();
 		for (type_sources::iterator i = sources.begin(); i != end; ++i)
 			delete *i;
@@ -108,13 +115,18 @@ namespace FIFE {
 	}
 
 	void VFS::addSource(VFSSource* source) {
+		std::lock_guard<std::mutex> lock(m_sourceMutex);
 		m_sources.push_back(source);
+		indexSource(m_sources.size() - 1);
 	}
 
 	void VFS::removeSource(VFSSource* source) {
+		std::lock_guard<std::mutex> lock(m_sourceMutex);
 		type_sources::iterator i = std::find(m_sources.begin(), m_sources.end(), source);
-		if (i != m_sources.end())
+		if (i != m_sources.end()) {
 			m_sources.erase(i);
+			rebuildIndex();
+		}
 	}
 
 	void VFS::removeSource(const std::string& path) {
@@ -122,25 +134,121 @@ namespace FIFE {
 		for (type_providers::iterator i = m_providers.begin(); i != end; ++i) {
 			VFSSourceProvider* provider = *i;
 			if (provider->hasSource(path)) {
-				VFSSource* source = provider->getSource(path);
-				type_sources::iterator i = std::find(m_sources.begin(), m_sources.end(), source);
-				if (i == m_sources.end()) {
-					removeSource(*i);
-					return;
+				removeSource(provider->getSource(path));
+				return;
+			}
+		}
+	}
+
+	void VFS::indexSource(size_t position) {
+		VFSSource* source = m_sources[position];
+		if (!source->isStatic()) {
+			return;
+		}
+
+		std::vector<std::string> files;
+		std::vector<std::string> directories;
+		source->listAll(files, directories);
+
+		std::vector<std::string>::const_iterator end = directories.end();
+		for (std::vector<std::string>::const_iterator i = directories.begin(); i != end; ++i) {
+			indexDirectory(normalizePath(*i));
+		}
+
+		end = files.end();
+		for (std::vector<std::string>::const_iterator i = files.begin(); i != end; ++i) {
+			std::string path = normalizePath(*i);
+			if (path.empty()) {
+				continue;
+			}
+			// sources added earlier take precedence
+			m_fileIndex.insert(std::make_pair(path, position));
+
+			size_t slash = path.rfind('/');
+			if (slash == std::string::npos) {
+				indexDirectory("").files.insert(path);
+			} else {
+				indexDirectory(path.substr(0, slash)).files.insert(path.substr(slash + 1));
+			}
+		}
+	}
+
+	VFS::IndexedDirectory& VFS::indexDirectory(const std::string& path) {
+		type_directoryindex::iterator it = m_directoryIndex.find(path);
+		if (it != m_directoryIndex.end()) {
+			return it->second;
+		}
+
+		// references to the elements stay valid while the parents are added
+		IndexedDirectory& directory = m_directoryIndex[path];
+		if (!path.empty()) {
+			size_t slash = path.rfind('/');
+			if (slash == std::string::npos) {
+				indexDirectory("").directories.insert(path);
+			} else {
+				indexDirectory(path.substr(0, slash)).directories.insert(path.substr(slash + 1));
+			}
+		}
+		return directory;
+	}
+
+	void VFS::rebuildIndex() {
+		m_fileIndex.clear();
+		m_directoryIndex.clear();
+		for (size_t i = 0; i < m_sources.size(); ++i) {
+			indexSource(i);
+		}
+	}
+
+	std::string VFS::normalizePath(const std::string& path) {
+		std::string result;
+		result.reserve(path.size());
+
+		size_t pos = 0;
+		while (pos <= path.size()) {
+			size_t end = path.find_first_of("/\\", pos);
+			if (end == std::string::npos) {
+				end = path.size();
+			}
+			size_t length = end - pos;
+			if (length == 0 || (length == 1 && path[pos] == '.')) {
+				// skip empty and current directory components
+			} else if (length == 2 && path[pos] == '.' && path[pos + 1] == '.') {
+				size_t slash = result.rfind('/');
+				result.erase(slash == std::string::npos ? 0 : slash);
+			} else {
+				if (!result.empty()) {
+					result += '/';
 				}
+				result.append(path, pos, length);
 			}
+			pos = end + 1;
 		}
+		return result;
 	}
 
 	VFSSource* VFS::getSourceForFile(const std::string& file) const {
-		type_sources::const_iterator i = std::find_if(m_sources.begin(), m_sources.end(),
-										 boost::bind2nd(boost::mem_fun(&VFSSource::fileExists), file));
-		if (i == m_sources.end()) {
+		std::lock_guard<std::mutex> lock(m_sourceMutex);
+
+		// the first static source with the file, all sources before it have to be asked
+		size_t indexed = m_sources.size();
+		type_fileindex::const_iterator it = m_fileIndex.find(normalizePath(file));
+		if (it != m_fileIndex.end()) {
+			indexed = it->second;
+		}
+
+		for (size_t i = 0; i < indexed; ++i) {
+			VFSSource* source = m_sources[i];
+			if (!source->isStatic() && source->fileExists(file)) {
+				return source;
+			}
+		}
+
+		if (indexed == m_sources.size()) {
 			FL_WARN(_log, LMsg("no source for ") << file << " found");
 			return 0;
 		}
-
-		return *i;
+		return m_sources[indexed];
 	}
 
 	bool VFS::exists(const std::string& file) const {
@@ -148,6 +256,13 @@ namespace FIFE {
 	}
 
 	bool VFS::isDirectory(const std::string& path) const {
+		{
+			std::lock_guard<std::mutex> lock(m_sourceMutex);
+			if (m_directoryIndex.find(normalizePath(path)) != m_directoryIndex.end()) {
+				return true;
+			}
+		}
+
 		std::vector<std::string> tokens;
 		// Add a slash in case there isn't one in the string
 		const std::string newpath = path + "/";
@@ -181,12 +296,20 @@ namespace FIFE {
 
 	std::set<std::string> VFS::listFiles(const std::string& pathstr) const {
 		std::set<std::string> list;
+		std::lock_guard<std::mutex> lock(m_sourceMutex);
 		type_sources::const_iterator end = m_sources.end();
 		for (type_sources::const_iterator i = m_sources.begin(); i != end; ++i) {
+			if ((*i)->isStatic()) {
+				continue;
+			}
 			std::set<std::string> sourcelist = (*i)->listFiles(pathstr);
 			list.insert(sourcelist.begin(), sourcelist.end());
 		}
 
+		type_directoryindex::const_iterator directory = m_directoryIndex.find(normalizePath(pathstr));
+		if (directory != m_directoryIndex.end()) {
+			list.insert(directory->second.files.begin(), directory->second.files.end());
+		}
 		return list;
 	}
 
@@ -197,12 +320,20 @@ namespace FIFE {
 
 	std::set<std::string> VFS::listDirectories(const std::string& pathstr) const {
 		std::set<std::string> list;
+		std::lock_guard<std::mutex> lock(m_sourceMutex);
 		type_sources::const_iterator end = m_sources.end();
 		for (type_sources::const_iterator i = m_sources.begin(); i != end; ++i) {
+			if ((*i)->isStatic()) {
+				continue;
+			}
 			std::set<std::string> sourcelist = (*i)->listDirectories(pathstr);
 			list.insert(sourcelist.begin(), sourcelist.end());
 		}
 
+		type_directoryindex::const_iterator directory = m_directoryIndex.find(normalizePath(pathstr));
+		if (directory != m_directoryIndex.end()) {
+			list.insert(directory->second.directories.begin(), directory->second.directories.end());
+		}
 		return list;
 	}
 
@@ -231,6 +362,7 @@ namespace FIFE {
 			const VFSSourceProvider* provider = *i;
 			if (provider->hasSource(path)) {
 				const VFSSource* source = provider->getSource(path);
+				std::lock_guard<std::mutex> lock(m_sourceMutex);
 				type_sources::const_iterator i = std::find(m_sources.begin(), m_sources.end(), source);
 				if (i == m_sources.end())
 					return false;
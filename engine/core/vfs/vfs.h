@@ -23,7 +23,9 @@
 #define FIFE_VFS_VFS_H
 
 // Standard C++ library includes
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <set>
 
@@ -54,6 +56,15 @@ namespace FIFE {
 	 * @note All filenames have to be @b lowercase. The VFS will convert them to lowercase
 	 * and emit a warning. This is done to avoid problems with filesystems which are not
 	 * case sensitive.
+	 *
+	 * @note The files and directories of static sources (archives) are kept in a hash index
+	 * that is built when the source is added. Lookups only ask the non static sources
+	 * (directories on the host system) that were added before the indexed source.
+	 *
+	 * @note open, exists, isDirectory and the list functions can be called from several threads.
+	 * The sources and the index are only locked for the lookup, the file is read without the lock.
+	 * Providers have to be added before other threads use the VFS, and a source must not be
+	 * removed while files are opened from it.
 	 */
 	class VFS : public DynamicSingleton<VFS>{
 		public:
@@ -115,6 +126,9 @@ namespace FIFE {
 			 * @param path the file to open
 			 * @return the opened file; delete this when done.
 			 * @throws NotFound if the file cannot be found
+			 * @note Files can be opened from worker threads as long as the sources are
+			 * not changed at the same time. Only the source lookup is locked, the source
+			 * opens the file unlocked, so archive sources can open their archive again.
 			 */
 			RawData* open(const std::string& path);
 
@@ -158,6 +172,15 @@ namespace FIFE {
 			 */
 			bool hasSource(const std::string& path) const;
 
+			/** Normalizes a path for lookups in the index
+			 *
+			 * Backslashes become slashes, empty and "." components are removed and ".." removes
+			 * the previous component. The result has no leading or trailing slash.
+			 * @param path the path to normalize
+			 * @return the normalized path
+			 */
+			static std::string normalizePath(const std::string& path);
+
 
 		private:
 			typedef std::vector<VFSSourceProvider*> type_providers;
@@ -166,6 +189,38 @@ namespace FIFE {
 			typedef std::vector<VFSSource*> type_sources;
 			type_sources m_sources;
 
+			// guards the sources and the index, not held while a source opens a file,
+			// archive sources open the archive again while opening an entry.
+			mutable std::mutex m_sourceMutex;
+
+			/** Files and subdirectories of an indexed directory
+			 */
+			struct IndexedDirectory {
+				std::set<std::string> files;
+				std::set<std::string> directories;
+			};
+
+			// normalized file path -> position of the first static source with that file
+			typedef std::unordered_map<std::string, size_t> type_fileindex;
+			type_fileindex m_fileIndex;
+
+			// normalized directory path -> content of all static sources
+			typedef std::unordered_map<std::string, IndexedDirectory> type_directoryindex;
+			type_directoryindex m_directoryIndex;
+
+			/** Adds the files of the source at the given position to the index, if it is static.
+			 */
+			void indexSource(size_t position);
+
+			/** Adds a directory and all of its parents to the directory index.
+			 * @return the index entry of the directory
+			 */
+			IndexedDirectory& indexDirectory(const std::string& path);
+
+			/** Rebuilds the index after a source was removed.
+			 */
+			void rebuildIndex();
+
 			std::set<std::string> filterList(const std::set<std::string>& list, const std::string& fregex) const;
 			VFSSource* getSourceForFile(const std::string& file) const;
 	};
@@ -29,6 +29,7 @@
 // Second block: files included from the same folder
 #include "vfs/raw/rawdata.h"
 #include "vfs/raw/rawdatafile.h"
+#include "vfs/raw/rawdatamappedfile.h"
 #include "util/log/logger.h"
 #include "util/base/exception.h"
 
@@ -55,17 +56,42 @@ namespace FIFE {
 	bool VFSDirectory::fileExists(const std::string& name) const {
 		std::string fullFilename = m_root + name;
 
-        bfs::path fullPath(fullFilename);
-		std::ifstream file(fullPath.string().c_str());
+		bfs::path fullPath(fullFilename);
+		std::string directory = fullPath.parent_path().string();
+		if (directory.empty()) {
+			directory = ".";
+		}
+
+		try {
+			std::lock_guard<std::mutex> lock(m_listingMutex);
+			const Listing* listing = getListing(directory);
+			if (listing && listing->files.count(GetFilenameFromPath(fullPath)) > 0) {
+				return true;
+			}
+		} catch (const Exception&) {
+			return false;
+		}
 
+#if defined(_WIN32) || defined(__APPLE__)
+		// the file system is usually case insensitive, the listing is not
+		std::ifstream file(fullPath.string().c_str());
 		if (file)
 			return true;
-
+#endif
 		return false;
 	}
 
 	RawData* VFSDirectory::open(const std::string& file) const {
-		return new RawData(new RawDataFile(m_root + file));
+		std::string fullFilename = m_root + file;
+		if (RawDataMappedFile::isSupported()) {
+			try {
+				return new RawData(new RawDataMappedFile(fullFilename));
+			} catch (const CannotOpenFile&) {
+				// not mappable, e.g. a special file, use the stream based source
+				FL_DBG(_log, LMsg("could not map file ") << fullFilename);
+			}
+		}
+		return new RawData(new RawDataFile(fullFilename));
 	}
 
 	std::set<std::string> VFSDirectory::listFiles(const std::string& path) const {
@@ -88,27 +114,51 @@ namespace FIFE {
 			dir.append(path);
 		}
 
+		std::lock_guard<std::mutex> lock(m_listingMutex);
+		const Listing* listing = getListing(dir);
+		if (listing) {
+			list = directorys ? listing->directories : listing->files;
+		}
+		return list;
+	}
+
+	const VFSDirectory::Listing* VFSDirectory::getListing(const std::string& directory) const {
 		try {
-			bfs::path boost_path(dir);
-			if (!bfs::exists(boost_path) || !bfs::is_directory(boost_path))
-				return list;
+			bfs::path boost_path(directory);
+			if (!bfs::exists(boost_path) || !bfs::is_directory(boost_path)) {
+				m_listings.erase(directory);
+				return 0;
+			}
+
+			std::time_t timestamp = bfs::last_write_time(boost_path);
+			type_listings::iterator it = m_listings.find(directory);
+			if (it != m_listings.end() && !it->second.recent && it->second.timestamp == timestamp) {
+				return &it->second;
+			}
+
+			Listing& listing = m_listings[directory];
+			listing.timestamp = timestamp;
+			listing.recent = std::time(0) - timestamp <= 1;
+			listing.files.clear();
+			listing.directories.clear();
 
 			bfs::directory_iterator end;
 			for	(bfs::directory_iterator i(boost_path); i != end; ++i) {
-				if (bfs::is_directory(*i) != directorys)
+				std::string filename = GetFilenameFromDirectoryIterator(i);
+				if (filename.empty()) {
 					continue;
-
-                std::string filename = GetFilenameFromDirectoryIterator(i);
-                if (!filename.empty())
-                {
-                    list.insert(filename);
-                }
+				}
+				if (bfs::is_directory(*i)) {
+					listing.directories.insert(filename);
+				} else {
+					listing.files.insert(filename);
+				}
 			}
+			return &listing;
 		}
 		catch (const bfs::filesystem_error& ex) {
+			m_listings.erase(directory);
 			throw Exception(ex.what());
 		}
-
-		return list;
 	}
 }
@@ -23,6 +23,11 @@
 #define FIFE_VFS_VFSHOSTSYSTEM_H
 
 // Standard C++ library includes
+#include <ctime>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
 
 // 3rd party library includes
 
@@ -40,6 +45,11 @@ namespace FIFE {
 	 * Uses boost_filesystem to achieve Plattform independancy.
 	 * This also means you have to use slashes as directory
 	 * separators.
+	 *
+	 * The content of directories is cached for fileExists and the listings.
+	 * A cached directory is read again when its modification time changes.
+	 * The cache is locked, every opened file gets its own handle, so the
+	 * source can be used from several threads.
 	 */
 	class VFSDirectory : public VFSSource {
 		public:
@@ -77,10 +87,33 @@ namespace FIFE {
 			std::set<std::string> listDirectories(const std::string& path) const;
 
 		private:
+			/** Cached content of a directory
+			 */
+			struct Listing {
+				std::time_t timestamp;
+				// read in the second the directory was changed, so later changes in
+				// the same second would not be noticed
+				bool recent;
+				std::set<std::string> files;
+				std::set<std::string> directories;
+			};
+
 			std::string m_root;
 
+			typedef std::unordered_map<std::string, Listing> type_listings;
+			mutable type_listings m_listings;
+			mutable std::mutex m_listingMutex;
+
 			std::set<std::string> list(const std::string& path, bool directorys) const;
 
+			/** Returns the content of the directory, reads it if it is not cached or outdated.
+			 * Has to be called with m_listingMutex locked.
+			 * @param directory The directory, including the root.
+			 * @return The listing or NULL if the directory does not exist.
+			 * @throw Exception if the directory can not be read.
+			 */
+			const Listing* getListing(const std::string& directory) const;
+
 	};
 
 }
@@ -21,6 +21,7 @@
 
 // Standard C++ library includes
 #include <algorithm>
+#include <thread>
 
 // 3rd party library includes
 
@@ -40,6 +41,35 @@ namespace FIFE {
 		m_vfs->removeSource(this);
 	}
 
+	bool VFSSource::isStatic() const {
+		return false;
+	}
+
+	void VFSSource::listAll(std::vector<std::string>&, std::vector<std::string>&) const {
+	}
+
+	void VFSSource::parseIndexParallel(size_t count, const std::function<void(size_t, size_t)>& parse) {
+		// below that starting threads costs more than it saves
+		const size_t minEntriesPerThread = 8192;
+
+		size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), 8);
+		threads = std::max<size_t>(1, std::min(threads, count / minEntriesPerThread));
+
+		const size_t chunk = (count + threads - 1) / threads;
+		std::vector<std::thread> workers;
+		for (size_t t = 1; t < threads; ++t) {
+			size_t begin = t * chunk;
+			size_t end = std::min(count, begin + chunk);
+			workers.push_back(std::thread(parse, begin, end));
+		}
+		// the first chunk is parsed by the calling thread
+		parse(0, std::min(count, chunk));
+
+		for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it) {
+			it->join();
+		}
+	}
+
 }
 
 std::string FIFE::VFSSource::fixPath(std::string path) const
@@ -23,7 +23,9 @@
 #define FIFE_VFS_VFSSOURCE_H
 
 // Standard C++ library includes
+#include <functional>
 #include <string>
+#include <vector>
 
 // 3rd party library includes
 
@@ -81,9 +83,37 @@ namespace FIFE {
 			 */
 			virtual std::set<std::string> listDirectories(const std::string& path) const = 0;
 
+			/** check if the content of this source is fixed
+			 *
+			 * The VFS keeps a hash index of the files of fixed sources, so they are only asked
+			 * when a file is opened. Archives are fixed, directories on the host system are not.
+			 * @return true if the content never changes, false otherwise
+			 * @see listAll
+			 */
+			virtual bool isStatic() const;
+
+			/** list all files and directories of this source, with their full path
+			 *
+			 * Only used for static sources, to build the index of the VFS.
+			 * Parent directories of files do not have to be listed.
+			 * @param files the files are appended to this list
+			 * @param directories the directories are appended to this list
+			 */
+			virtual void listAll(std::vector<std::string>& files, std::vector<std::string>& directories) const;
+
 		protected:
 			std::string fixPath(std::string path) const;
 
+			/** parse the entries [0, count) of an archive index
+			 *
+			 * The range is split into chunks that are handed to parse(begin, end), on several
+			 * threads if there are enough entries. parse must not throw and must only write
+			 * to the results of its own chunk.
+			 * @param count the number of entries
+			 * @param parse called for each chunk
+			 */
+			static void parseIndexParallel(size_t count, const std::function<void(size_t, size_t)>& parse);
+
 		private:
 			VFS* m_vfs;
 	};
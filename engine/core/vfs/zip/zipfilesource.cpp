@@ -33,18 +33,34 @@
 
 namespace FIFE {
 
+	std::atomic<uint32_t> ZipFileSource::s_inflatedBytes(0);
+
 	ZipFileSource::ZipFileSource(uint8_t* data, uint32_t datalen) : m_data(data), m_datalen(datalen) {
+		s_inflatedBytes += m_datalen;
 	}
 
 	ZipFileSource::~ZipFileSource() {
+		s_inflatedBytes -= m_datalen;
 		delete[] m_data;
 	}
 
-	uint32_t ZipFileSource::getSize() const {
+	uint32_t ZipFileSource::getInflatedBytes() {
+		return s_inflatedBytes;
+	}
+
+	uint64_t ZipFileSource::getSize() const {
 		return m_datalen;
 	}
 
-	void ZipFileSource::readInto(uint8_t* target, uint32_t start, uint32_t len) {
+	const uint8_t* ZipFileSource::getData() const {
+		return m_data;
+	}
+
+	bool ZipFileSource::hasNullTerminator() const {
+		return true;
+	}
+
+	void ZipFileSource::readInto(uint8_t* target, uint64_t start, size_t len) {
 		assert(start + len <= m_datalen);
 		memcpy(target, m_data + start, len);
 	}
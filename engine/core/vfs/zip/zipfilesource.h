@@ -21,6 +21,9 @@
 #ifndef FIFE_VFS_ZIP_ZIPFILESOURCE_H
 #define FIFE_VFS_ZIP_ZIPFILESOURCE_H
 
+// Standard C++ library includes
+#include <atomic>
+
 #include "vfs/raw/rawdatasource.h"
 
 namespace FIFE {
@@ -28,13 +31,26 @@ namespace FIFE {
 	class VFS;
 	class ZipFileSource : public RawDataSource {
 		public:
+			/** Constructor
+			 * Takes ownership of data, which has to be allocated with new[] and
+			 * hold datalen + 1 bytes, the last one being a null terminator.
+			 */
 			ZipFileSource(uint8_t* data, uint32_t datalen);
 			virtual ~ZipFileSource();
 
-			virtual uint32_t getSize() const;
-			virtual void readInto(uint8_t* target, uint32_t start, uint32_t len);
+			virtual uint64_t getSize() const;
+			virtual void readInto(uint8_t* target, uint64_t start, size_t len);
+			virtual const uint8_t* getData() const;
+			virtual bool hasNullTerminator() const;
+
+			/** Returns the number of bytes held by all ZipFileSources
+			 */
+			static uint32_t getInflatedBytes();
 
 		private:
+			// entries are inflated on several threads
+			static std::atomic<uint32_t> s_inflatedBytes;
+
 			uint8_t* m_data;
 			uint32_t m_datalen;
 
@@ -62,7 +62,7 @@ namespace {
 
 namespace FIFE {
     ZipEntryData::ZipEntryData() 
-    : comp(0), crc32(0), size_comp(0), size_real(0), offset(0) { 
+    : comp(0), crc32(0), size_comp(0), size_real(0), offset(0), header_offset(0) { 
     }
 
     ZipNode::ZipNode(const std::string& name, ZipNode* parent/*=0*/)
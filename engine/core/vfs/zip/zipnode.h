@@ -52,9 +52,13 @@ namespace FIFE {
 
         uint16_t comp;
         uint32_t crc32;
-        uint32_t size_comp;
-        uint32_t size_real;
-        uint32_t offset;
+        // sizes and offsets are 64 bit for Zip64 archives
+        uint64_t size_comp;
+        uint64_t size_real;
+        // offset of the data, 0 if only the local header offset is known yet
+        uint64_t offset;
+        // offset of the local file header
+        uint64_t header_offset;
     };
 
     // convenience typedef
@@ -21,8 +21,12 @@
 
 // Standard C++ library includes
 #include <algorithm>
+#include <functional>
+#include <limits>
 #include <list>
 #include <memory>
+#include <string>
+#include <vector>
 
 // 3rd party library includes
 #include "zlib.h"
@@ -39,16 +43,100 @@
 #include "zipsource.h"
 #include "zipfilesource.h"
 #include "zipnode.h"
+#include "zipstreamsource.h"
 
 namespace FIFE {
 
 	static const uint32_t LF_HEADER = 0x04034b50;
 	static const uint32_t DE_HEADER = 0x08064b50;
 	static const uint32_t CF_HEADER = 0x02014b50;
+	static const uint32_t EOCD_HEADER = 0x06054b50;
+	static const uint32_t ZIP64_EOCD_HEADER = 0x06064b50;
+	static const uint32_t ZIP64_LOCATOR_HEADER = 0x07064b50;
+	static const uint16_t ZIP64_EXTRA_ID = 0x0001;
+
+	// sizes of the fixed parts of the records
+	static const uint32_t LF_SIZE = 30;
+	static const uint32_t CF_SIZE = 46;
+	static const uint32_t EOCD_SIZE = 22;
+	static const uint32_t ZIP64_EOCD_SIZE = 56;
+	static const uint32_t ZIP64_LOCATOR_SIZE = 20;
+
+	// highest "version needed to extract" that is supported, 4.5 added Zip64
+	static const uint16_t MAX_VERSION = 45;
 
 	static Logger _log(LM_LOADERS);
 
-	ZipSource::ZipSource(VFS* vfs, const std::string& zip_file) : VFSSource(vfs), m_zipfile(vfs->open(zip_file)) {
+	static inline uint16_t get16Little(const uint8_t* data) {
+		return static_cast<uint16_t>(data[0] | (data[1] << 8));
+	}
+
+	static inline uint32_t get32Little(const uint8_t* data) {
+		return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+			(static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+	}
+
+	static inline uint64_t get64Little(const uint8_t* data) {
+		return static_cast<uint64_t>(get32Little(data)) | (static_cast<uint64_t>(get32Little(data + 4)) << 32);
+	}
+
+	/** One parsed record of the central directory.
+	 */
+	struct CentralRecord {
+		std::string name;
+		// normalized path, only for files
+		std::string path;
+		uint16_t vneeded;
+		ZipEntryData data;
+	};
+
+	/** Parses the central directory records [begin, end), called from parseIndexParallel.
+	 */
+	static void parseCentralRecords(const uint8_t* directory, const std::vector<size_t>& positions,
+		std::vector<CentralRecord>& records, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			const uint8_t* record = directory + positions[i];
+			CentralRecord& result = records[i];
+			result.vneeded = get16Little(record + 6);
+			result.data.comp = get16Little(record + 10);
+			result.data.crc32 = get32Little(record + 16);
+			result.data.size_comp = get32Little(record + 20);
+			result.data.size_real = get32Little(record + 24);
+			result.data.header_offset = get32Little(record + 42);
+			const uint16_t namelen = get16Little(record + 28);
+			result.name.assign(reinterpret_cast<const char*>(record + CF_SIZE), namelen);
+
+			// Zip64 stores the fields that don't fit into 32 bit in an extra field, in this order
+			const uint8_t* extra = record + CF_SIZE + namelen;
+			const uint8_t* extraEnd = extra + get16Little(record + 30);
+			while (extra + 4 <= extraEnd) {
+				const uint16_t id = get16Little(extra);
+				const uint8_t* field = extra + 4;
+				const uint8_t* fieldEnd = std::min(extraEnd, field + get16Little(extra + 2));
+				if (id == ZIP64_EXTRA_ID) {
+					uint64_t* values[] = { &result.data.size_real, &result.data.size_comp, &result.data.header_offset };
+					for (uint32_t v = 0; v < 3; ++v) {
+						if (*values[v] == 0xffffffff && field + 8 <= fieldEnd) {
+							*values[v] = get64Little(field);
+							field += 8;
+						}
+					}
+					break;
+				}
+				extra = fieldEnd;
+			}
+
+			// directories are stored with a trailing slash
+			if (result.name.empty() || result.name[result.name.length() - 1] != '/') {
+				result.path = VFS::normalizePath(result.name);
+			}
+		}
+	}
+
+	std::atomic<uint32_t> ZipSource::s_streamingThreshold(1024 * 1024);
+	std::atomic<uint32_t> ZipSource::s_maxInflatedBytes(64 * 1024 * 1024);
+
+	ZipSource::ZipSource(VFS* vfs, const std::string& zip_file) : VFSSource(vfs), m_zipfile(vfs->open(zip_file)), m_zipPath(zip_file) {
 		readIndex();
 	}
 
@@ -57,34 +145,75 @@ namespace FIFE {
 	}
 
 	bool ZipSource::fileExists(const std::string& file) const {
-		bfs::path path(file);
-		return (m_zipTree.getNode(path.string()) != 0);
+		return m_entries.find(VFS::normalizePath(file)) != m_entries.end();
+	}
+
+	bool ZipSource::isStatic() const {
+		return true;
+	}
+
+	void ZipSource::listAll(std::vector<std::string>& files, std::vector<std::string>& directories) const {
+		files.reserve(files.size() + m_entries.size());
+		for (type_entries::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+			files.push_back(it->first);
+		}
+		directories.insert(directories.end(), m_directories.begin(), m_directories.end());
 	}
 
 	RawData* ZipSource::open(const std::string& path) const {
-		bfs::path filePath(path);
-		ZipNode* node = m_zipTree.getNode(filePath.string());
+		type_entries::const_iterator entry = m_entries.find(VFS::normalizePath(path));
+
+		assert(entry != m_entries.end());
+
+		if (entry != m_entries.end()) {
+			ZipEntryData entryData = entry->second;
 
-		assert(node != 0);
+			if (entryData.comp != 0 && entryData.comp != 8) {
+				FL_ERR(_log, LMsg("unsupported compression"));
+				return 0;
+			}
 
-		if (node) {
-			const ZipEntryData& entryData = node->getZipEntryData();
+			if (entryData.offset == 0 && !readDataOffset(entryData)) {
+				FL_ERR(_log, LMsg("invalid local file header: ") << path);
+				return 0;
+			}
+
+			// big entries are read on demand from their own handle of the archive
+			if (entryData.size_real > s_streamingThreshold ||
+				ZipFileSource::getInflatedBytes() + entryData.size_real > s_maxInflatedBytes) {
+				FL_DBG(_log, LMsg("streaming file ") <<  path << " (" << entryData.size_real << " bytes)");
+				return new RawData(new ZipStreamSource(getVFS()->open(m_zipPath), entryData));
+			}
 
-			m_zipfile->setIndex(entryData.offset);
-			uint8_t* data = new uint8_t[entryData.size_real]; // beware of me - one day i WILL cause memory leaks
+			// one more byte for the null terminator, see ZipFileSource
+			uint8_t* data = new uint8_t[static_cast<size_t>(entryData.size_real) + 1]; // beware of me - one day i WILL cause memory leaks
+			data[entryData.size_real] = 0;
 			if (entryData.comp == 8) { // compressed using deflate
 				FL_DBG(_log, LMsg("trying to uncompress file ") <<  path << " (compressed with method " << entryData.comp << ")");
-				std::unique_ptr<uint8_t[]> compdata(new uint8_t[entryData.size_comp]);
-				m_zipfile->readInto(compdata.get(), entryData.size_comp);
+				// inflate directly from the archive data if it is mapped into memory
+				std::unique_ptr<uint8_t[]> compdata;
+				const uint8_t* input = m_zipfile->getData();
+				if (input) {
+					if (entryData.offset + entryData.size_comp > m_zipfile->getDataLength()) {
+						FL_ERR(_log, LMsg("compressed data exceeds the archive: ") << path);
+						delete[] data;
+						return 0;
+					}
+					input += entryData.offset;
+				} else {
+					compdata.reset(new uint8_t[static_cast<size_t>(entryData.size_comp)]);
+					m_zipfile->readAt(entryData.offset, compdata.get(), static_cast<size_t>(entryData.size_comp));
+					input = compdata.get();
+				}
 
 				z_stream zstream;
-				zstream.next_in = compdata.get();
-				zstream.avail_in = entryData.size_comp;
+				zstream.next_in = const_cast<uint8_t*>(input);
+				zstream.avail_in = static_cast<uInt>(entryData.size_comp);
 				zstream.zalloc = Z_NULL;
 				zstream.zfree = Z_NULL;
 				zstream.opaque = Z_NULL;
 				zstream.next_out = data;
-				zstream.avail_out = entryData.size_real;
+				zstream.avail_out = static_cast<uInt>(entryData.size_real);
 
 				if (inflateInit2(&zstream, -15) != Z_OK) {
 					FL_ERR(_log, LMsg("inflateInit2 failed"));
@@ -106,26 +235,168 @@ namespace FIFE {
 				}
 
 				inflateEnd(&zstream);
-			} else if (entryData.comp == 0) { // uncompressed
-				m_zipfile->readInto(data, entryData.size_real);
-			} else {
-				FL_ERR(_log, LMsg("unsupported compression"));
-				delete[] data;
-				return 0;
+			} else { // uncompressed
+				m_zipfile->readAt(entryData.offset, data, static_cast<size_t>(entryData.size_real));
 			}
 
-			return new RawData(new ZipFileSource(data, entryData.size_real));
+			// entries inflated at once are smaller than the streaming threshold
+			return new RawData(new ZipFileSource(data, static_cast<uint32_t>(entryData.size_real)));
 		}
 
 		return 0;
 	}
 
+	void ZipSource::setStreamingThreshold(uint32_t bytes) {
+		s_streamingThreshold = bytes;
+	}
+
+	uint32_t ZipSource::getStreamingThreshold() {
+		return s_streamingThreshold;
+	}
+
+	void ZipSource::setMaxInflatedBytes(uint32_t bytes) {
+		s_maxInflatedBytes = bytes;
+	}
+
+	uint32_t ZipSource::getMaxInflatedBytes() {
+		return s_maxInflatedBytes;
+	}
+
 	void ZipSource::readIndex() {
-		m_zipfile->setIndex(0);
+		if (readCentralDirectory()) {
+			return;
+		}
 
+		// damaged or unusual archive, walk through the local file headers instead
+		m_zipfile->setIndex(0);
 		while (!readFileToIndex()) {}
 	}
 
+	const uint8_t* ZipSource::readBlock(uint64_t offset, size_t length, std::vector<uint8_t>& buffer) const {
+		const uint8_t* data = m_zipfile->getData();
+		if (data) {
+			return data + offset;
+		}
+
+		buffer.resize(std::max<size_t>(length, 1));
+		m_zipfile->readAt(offset, &buffer[0], length);
+		return &buffer[0];
+	}
+
+	bool ZipSource::readCentralDirectory() {
+		const uint64_t size = m_zipfile->getDataLength();
+		if (size < EOCD_SIZE) {
+			return false;
+		}
+
+		// the end of central directory record is at the end, followed by a comment of up to 64k
+		const uint32_t tailLength = static_cast<uint32_t>(std::min<uint64_t>(size, EOCD_SIZE + 0xffff));
+		std::vector<uint8_t> tailBuffer;
+		const uint8_t* tail = readBlock(size - tailLength, tailLength, tailBuffer);
+		const uint8_t* eocd = 0;
+		uint64_t eocdOffset = 0;
+		for (uint32_t pos = tailLength - EOCD_SIZE + 1; pos-- > 0;) {
+			if (get32Little(tail + pos) == EOCD_HEADER && pos + EOCD_SIZE + get16Little(tail + pos + 20) <= tailLength) {
+				eocd = tail + pos;
+				eocdOffset = size - tailLength + pos;
+				break;
+			}
+		}
+		if (!eocd) {
+			FL_WARN(_log, LMsg("no central directory found in ") << m_zipPath);
+			return false;
+		}
+
+		// the entry count is only a hint, archives with more than 65535 entries overflow it
+		uint64_t countHint = get16Little(eocd + 10);
+		uint64_t directorySize = get32Little(eocd + 12);
+		uint64_t directoryOffset = get32Little(eocd + 16);
+
+		// Zip64 archives have a locator in front of the end record that points to the Zip64 end record
+		if (eocdOffset >= ZIP64_LOCATOR_SIZE) {
+			std::vector<uint8_t> locatorBuffer;
+			const uint8_t* locator = readBlock(eocdOffset - ZIP64_LOCATOR_SIZE, ZIP64_LOCATOR_SIZE, locatorBuffer);
+			if (get32Little(locator) == ZIP64_LOCATOR_HEADER) {
+				const uint64_t zip64Offset = get64Little(locator + 8);
+				if (zip64Offset > size || size - zip64Offset < ZIP64_EOCD_SIZE) {
+					FL_WARN(_log, LMsg("invalid Zip64 end of central directory in ") << m_zipPath);
+					return false;
+				}
+				std::vector<uint8_t> zip64Buffer;
+				const uint8_t* zip64 = readBlock(zip64Offset, ZIP64_EOCD_SIZE, zip64Buffer);
+				if (get32Little(zip64) != ZIP64_EOCD_HEADER) {
+					FL_WARN(_log, LMsg("invalid Zip64 end of central directory in ") << m_zipPath);
+					return false;
+				}
+				countHint = get64Little(zip64 + 32);
+				directorySize = get64Little(zip64 + 40);
+				directoryOffset = get64Little(zip64 + 48);
+			}
+		}
+
+		if (directoryOffset > size || directorySize > size - directoryOffset ||
+			directorySize >= std::numeric_limits<size_t>::max()) {
+			FL_WARN(_log, LMsg("invalid central directory in ") << m_zipPath);
+			return false;
+		}
+
+		// read the whole directory at once and find the start of each record
+		std::vector<uint8_t> directoryBuffer;
+		const size_t length = static_cast<size_t>(directorySize);
+		const uint8_t* directory = readBlock(directoryOffset, length, directoryBuffer);
+		std::vector<size_t> positions;
+		positions.reserve(static_cast<size_t>(std::min<uint64_t>(countHint, length / CF_SIZE)));
+		size_t pos = 0;
+		while (pos + CF_SIZE <= length && get32Little(directory + pos) == CF_HEADER) {
+			positions.push_back(pos);
+			pos += CF_SIZE + get16Little(directory + pos + 28) + get16Little(directory + pos + 30) + get16Little(directory + pos + 32);
+		}
+		if (pos > length || (positions.empty() && length > 0)) {
+			FL_WARN(_log, LMsg("invalid central directory in ") << m_zipPath);
+			return false;
+		}
+
+		// the records are independent, parse them on several threads
+		std::vector<CentralRecord> records(positions.size());
+		parseIndexParallel(positions.size(), std::bind(parseCentralRecords, directory, std::cref(positions),
+			std::ref(records), std::placeholders::_1, std::placeholders::_2));
+
+		m_entries.reserve(records.size());
+		for (std::vector<CentralRecord>::const_iterator it = records.begin(); it != records.end(); ++it) {
+			if ((it->vneeded & 0xff) > MAX_VERSION) {
+				FL_ERR(_log, LMsg("only zip versions up to 4.5 are supported, required: ") << it->vneeded << " by " << it->name);
+				continue;
+			}
+
+			if (it->path.empty()) {
+				m_directories.push_back(it->name);
+			} else {
+				m_entries[it->path] = it->data;
+			}
+		}
+		FL_DBG(_log, LMsg("indexed ") << records.size() << " entries of " << m_zipPath);
+
+		return true;
+	}
+
+	bool ZipSource::readDataOffset(ZipEntryData& entry) const {
+		if (entry.header_offset > m_zipfile->getDataLength() ||
+			m_zipfile->getDataLength() - entry.header_offset < LF_SIZE) {
+			return false;
+		}
+
+		std::vector<uint8_t> buffer;
+		const uint8_t* header = readBlock(entry.header_offset, LF_SIZE, buffer);
+		if (get32Little(header) != LF_HEADER) {
+			return false;
+		}
+
+		// the extra field of the local header may differ from the one in the central directory
+		entry.offset = entry.header_offset + LF_SIZE + get16Little(header + 26) + get16Little(header + 28);
+		return entry.offset <= m_zipfile->getDataLength() &&
+			m_zipfile->getDataLength() - entry.offset >= entry.size_comp;
+	}
+
 	bool ZipSource::readFileToIndex() {
 		uint32_t header   = m_zipfile->read32Little();
 		if (header == DE_HEADER || header == CF_HEADER) { // decryption header or central directory header - we are finished
@@ -156,7 +427,7 @@ namespace FIFE {
 		bfs::path filePath = bfs::path(m_zipfile->readString(fnamelen));
 
 		m_zipfile->moveIndex(extralen);
-		uint32_t offset = m_zipfile->getCurrentIndex();
+		uint64_t offset = m_zipfile->getCurrentIndex();
 		FL_DBG(_log, LMsg("found file: ") << filePath.string() << " (" << compsize << "/" << realsize << ") on offset " << offset);
 
 		m_zipfile->moveIndex(compsize);
@@ -173,14 +444,16 @@ namespace FIFE {
 		data.size_real = realsize;
 		data.size_comp = compsize;
 		data.offset = offset;
+		data.header_offset = offset - LF_SIZE - fnamelen - extralen;
 		data.crc32 = crc;
 
 		std::string filename = filePath.string();
-		ZipNode* node = m_zipTree.addNode(filename);
 
-		if (node) {
-			// store the zip entry information in the node
-			node->setZipEntryData(data);
+		// directories are stored with a trailing slash
+		if (!filename.empty() && filename[filename.length() - 1] == '/') {
+			m_directories.push_back(filename);
+		} else {
+			m_entries[VFS::normalizePath(filename)] = data;
 		}
 
 		return false;
@@ -188,39 +461,46 @@ namespace FIFE {
 
 
 	std::set<std::string> ZipSource::listFiles(const std::string& path) const {
-		std::set<std::string> result;
+		return list(path, false);
+	}
+
+	std::set<std::string> ZipSource::listDirectories(const std::string& path) const {
+		return list(path, true);
+	}
 
-		bfs::path fixedPath(path);
+	std::set<std::string> ZipSource::list(const std::string& pathstr, bool dirs) const {
+		std::set<std::string> result;
+		std::string path = VFS::normalizePath(pathstr);
+		if (!path.empty()) {
+			path += '/';
+		}
 
-		ZipNode* node = m_zipTree.getNode(fixedPath.string());
-		
-		if (node) {
-			ZipNodeContainer files = node->getChildren(ZipContentType::File);
-			ZipNodeContainer::iterator iter;
-			for (iter = files.begin(); iter != files.end(); ++iter) {
-				result.insert((*iter)->getFullName());
+		for (type_entries::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+			addListEntry(it->first, path, dirs, result);
+		}
+		if (dirs) {
+			std::vector<std::string>::const_iterator end = m_directories.end();
+			for (std::vector<std::string>::const_iterator it = m_directories.begin(); it != end; ++it) {
+				addListEntry(VFS::normalizePath(*it), path, dirs, result);
 			}
 		}
 
 		return result;
 	}
 
-	// FIXME: quick&very dirty..
-	std::set<std::string> ZipSource::listDirectories(const std::string& path) const {
-		std::set<std::string> result;
-
-		bfs::path fixedPath(path);
-
-		ZipNode* node = m_zipTree.getNode(fixedPath.string());
+	void ZipSource::addListEntry(const std::string& file, const std::string& path, bool dirs, std::set<std::string>& result) {
+		if (file.size() <= path.size() || file.compare(0, path.size(), path) != 0) {
+			return;
+		}
 
-		if (node) {
-			ZipNodeContainer files = node->getChildren(ZipContentType::Directory);
-			ZipNodeContainer::iterator iter;
-			for (iter = files.begin(); iter != files.end(); ++iter) {
-				result.insert((*iter)->getFullName());
+		// if there is still a slash it's a file in a subdirectory
+		size_t slash = file.find('/', path.size());
+		if (slash == std::string::npos) {
+			if (!dirs) {
+				result.insert(file.substr(path.size()));
 			}
+		} else if (dirs) {
+			result.insert(file.substr(path.size(), slash - path.size()));
 		}
-
-		return result;
 	}
 }
@@ -24,7 +24,11 @@
 
 // Standard C++ library includes
 //
+#include <atomic>
 #include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 // 3rd party library includes
 //
@@ -36,7 +40,7 @@
 #include "util/base/fife_stdint.h"
 #include "vfs/vfssource.h"
 
-#include "ziptree.h"
+#include "zipnode.h"
 
 namespace FIFE {
 	/**  Implements a Zip archive file source.
@@ -48,22 +52,71 @@ namespace FIFE {
         ZipSource(VFS* vfs, const std::string& zip_file);
         ~ZipSource();
 
-        /// WARNING: fileExists, listFiles and listDirectories are not
-        // thread-safe, and will probably break if called from multiple
-        // threads at the same time.
+        /// The index doesn't change after construction and the archive is only read
+        // with positional reads, so all functions can be called from several threads.
         bool fileExists(const std::string& file) const;
         std::set<std::string> listFiles(const std::string& path) const;
         std::set<std::string> listDirectories(const std::string& path) const;
 
+        bool isStatic() const;
+        void listAll(std::vector<std::string>& files, std::vector<std::string>& directories) const;
+
+        /** Opens a file inside the archive.
+         * Entries bigger than the streaming threshold, or that would exceed the limit of
+         * inflated bytes, are read on demand with a ZipStreamSource. All others are inflated at once.
+         */
         virtual RawData* open(const std::string& path) const;
 
+        /** Sets the size above which entries are streamed instead of inflated at once.
+         * The default is 1 MB.
+         */
+        static void setStreamingThreshold(uint32_t bytes);
+        static uint32_t getStreamingThreshold();
+
+        /** Sets how many bytes all entries that are inflated at once may hold together,
+         * further entries are streamed. The default is 64 MB.
+         */
+        static void setMaxInflatedBytes(uint32_t bytes);
+        static uint32_t getMaxInflatedBytes();
+
     private:
+        /** Builds the index, from the central directory if possible and
+         * by walking through the local file headers otherwise.
+         */
         void readIndex();
         bool readFileToIndex();
 
+        /** Reads the central directory in one go and parses it, on several threads for big archives.
+         * @return false if the archive has no usable central directory
+         */
+        bool readCentralDirectory();
+
+        /** Looks up the data offset of an entry that is only known from the central directory.
+         * @return false if the local file header is invalid
+         */
+        bool readDataOffset(ZipEntryData& entry) const;
+
+        /** Returns a block of the archive, either directly from the mapped archive or read into buffer.
+         */
+        const uint8_t* readBlock(uint64_t offset, size_t length, std::vector<uint8_t>& buffer) const;
+
+        /** Lists the files or directories directly inside of path.
+         */
+        std::set<std::string> list(const std::string& pathstr, bool dirs) const;
+        static void addListEntry(const std::string& file, const std::string& path, bool dirs, std::set<std::string>& result);
+
     private:
-        ZipTree m_zipTree;
 		RawData* m_zipfile;
+		std::string m_zipPath;
+
+		// normalized path -> entry, for all files of the archive
+		typedef std::unordered_map<std::string, ZipEntryData> type_entries;
+		type_entries m_entries;
+		// directories that are stored as own entries
+		std::vector<std::string> m_directories;
+
+		static std::atomic<uint32_t> s_streamingThreshold;
+		static std::atomic<uint32_t> s_maxInflatedBytes;
 
 	};
 
@@ -0,0 +1,201 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "vfs/raw/rawdata.h"
+#include "util/base/exception.h"
+
+#include "zipstreamsource.h"
+
+namespace FIFE {
+
+	// size of the compressed input that is read at once if the archive is not mapped
+	static const uint32_t INPUT_SIZE = 16 * 1024;
+
+	ZipStreamSource::ZipStreamSource(RawData* archive, const ZipEntryData& entry) :
+		m_archive(archive),
+		m_entry(entry),
+		m_archiveData(archive->getData()),
+		m_streamInitialized(false),
+		m_totalIn(0),
+		m_totalOut(0),
+		m_windowStart(0),
+		m_windowLength(0) {
+		assert(m_entry.comp == 0 || m_entry.comp == 8);
+		memset(&m_stream, 0, sizeof(m_stream));
+	}
+
+	ZipStreamSource::~ZipStreamSource() {
+		if (m_streamInitialized) {
+			inflateEnd(&m_stream);
+		}
+		for (std::vector<RestartPoint>::iterator it = m_restartPoints.begin(); it != m_restartPoints.end(); ++it) {
+			inflateEnd(it->stream);
+			delete it->stream;
+		}
+		delete m_archive;
+	}
+
+	uint64_t ZipStreamSource::getSize() const {
+		return m_entry.size_real;
+	}
+
+	const uint8_t* ZipStreamSource::getData() const {
+		if (m_entry.comp == 0 && m_archiveData) {
+			return m_archiveData + m_entry.offset;
+		}
+		return 0;
+	}
+
+	void ZipStreamSource::readInto(uint8_t* buffer, uint64_t start, size_t length) {
+		if (m_entry.comp == 0) {
+			if (m_archiveData) {
+				memcpy(buffer, m_archiveData + m_entry.offset + start, length);
+			} else {
+				m_archive->readAt(m_entry.offset + start, buffer, length);
+			}
+			return;
+		}
+
+		while (length > 0) {
+			if (start < m_windowStart || start >= m_windowStart + m_windowLength) {
+				seek(start - start % WINDOW_SIZE);
+				inflateNext();
+			}
+			uint32_t offset = static_cast<uint32_t>(start - m_windowStart);
+			size_t count = std::min<size_t>(length, m_windowLength - offset);
+			memcpy(buffer, &m_window[offset], count);
+			buffer += count;
+			start += count;
+			length -= count;
+		}
+	}
+
+	void ZipStreamSource::seek(uint64_t position) {
+		if (!m_streamInitialized) {
+			m_stream.zalloc = Z_NULL;
+			m_stream.zfree = Z_NULL;
+			m_stream.opaque = Z_NULL;
+			m_stream.next_in = Z_NULL;
+			m_stream.avail_in = 0;
+			if (inflateInit2(&m_stream, -15) != Z_OK) {
+				throw InvalidFormat("inflateInit2 failed");
+			}
+			m_streamInitialized = true;
+			m_window.resize(WINDOW_SIZE);
+		}
+
+		// use the nearest restart point if the current state is behind the position or too far away
+		uint64_t index = position / RESTART_INTERVAL;
+		if (index >= m_restartPoints.size()) {
+			index = m_restartPoints.size() - 1;
+		}
+		if (!m_restartPoints.empty() && (m_totalOut > position || m_totalOut < index * RESTART_INTERVAL)) {
+			inflateEnd(&m_stream);
+			if (inflateCopy(&m_stream, m_restartPoints[index].stream) != Z_OK) {
+				m_streamInitialized = false;
+				throw InvalidFormat("inflateCopy failed");
+			}
+			m_totalIn = m_restartPoints[index].totalIn;
+			m_totalOut = index * RESTART_INTERVAL;
+			// the saved input pointer may be outdated, fillInput continues at m_totalIn
+			m_stream.next_in = Z_NULL;
+			m_stream.avail_in = 0;
+		}
+
+		// skip the windows in between
+		while (m_totalOut < position) {
+			inflateNext();
+		}
+	}
+
+	void ZipStreamSource::inflateNext() {
+		uint64_t position = m_totalOut;
+		if (position % RESTART_INTERVAL == 0 && position / RESTART_INTERVAL == m_restartPoints.size()) {
+			RestartPoint point;
+			point.stream = new z_stream;
+			point.totalIn = m_totalIn - m_stream.avail_in;
+			if (inflateCopy(point.stream, &m_stream) != Z_OK) {
+				delete point.stream;
+				throw InvalidFormat("inflateCopy failed");
+			}
+			m_restartPoints.push_back(point);
+		}
+
+		uint32_t wanted = static_cast<uint32_t>(std::min<uint64_t>(WINDOW_SIZE, m_entry.size_real - position));
+		m_windowStart = position;
+		m_windowLength = 0;
+		m_stream.next_out = &m_window[0];
+		m_stream.avail_out = wanted;
+		while (m_stream.avail_out > 0) {
+			fillInput();
+			int32_t err = inflateStep();
+			if (err == Z_STREAM_END) {
+				break;
+			}
+			if (err != Z_OK) {
+				throw InvalidFormat(std::string("inflate failed: ") + (m_stream.msg ? m_stream.msg : "no message"));
+			}
+		}
+		m_windowLength = wanted - m_stream.avail_out;
+		if (m_windowLength != wanted) {
+			throw InvalidFormat("zip entry is shorter than its size");
+		}
+	}
+
+	int32_t ZipStreamSource::inflateStep() {
+		uInt availOut = m_stream.avail_out;
+		int32_t err = inflate(&m_stream, Z_NO_FLUSH);
+		m_totalOut += availOut - m_stream.avail_out;
+		return err;
+	}
+
+	void ZipStreamSource::fillInput() {
+		if (m_stream.avail_in > 0) {
+			return;
+		}
+		uint64_t remaining = m_entry.size_comp - m_totalIn;
+		if (m_archiveData) {
+			// avail_in is 32 bit, big entries are handed over in parts
+			uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(remaining, 1u << 30));
+			m_stream.next_in = const_cast<uint8_t*>(m_archiveData + m_entry.offset + m_totalIn);
+			m_stream.avail_in = count;
+			m_totalIn += count;
+		} else {
+			uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(remaining, INPUT_SIZE));
+			m_input.resize(INPUT_SIZE);
+			m_archive->readAt(m_entry.offset + m_totalIn, &m_input[0], count);
+			m_stream.next_in = &m_input[0];
+			m_stream.avail_in = count;
+			m_totalIn += count;
+		}
+	}
+}
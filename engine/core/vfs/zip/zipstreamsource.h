@@ -0,0 +1,120 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef FIFE_VFS_ZIP_ZIPSTREAMSOURCE_H
+#define FIFE_VFS_ZIP_ZIPSTREAMSOURCE_H
+
+// Standard C++ library includes
+#include <vector>
+
+// 3rd party library includes
+#include "zlib.h"
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "vfs/raw/rawdatasource.h"
+
+#include "zipnode.h"
+
+namespace FIFE {
+
+	class RawData;
+
+	/** A RawDataSource that reads a zip entry on demand.
+	 *
+	 * Stored entries are read directly from the archive. Deflated entries are inflated into a small
+	 * window while they are read. Every RESTART_INTERVAL bytes the inflate state is saved as a restart point,
+	 * so seeking backwards only inflates from the nearest restart point and not from the start of the entry.
+	 * Used by ZipSource for big entries, so they are never inflated into memory as a whole.
+	 */
+	class ZipStreamSource : public RawDataSource {
+		public:
+			/** Size of the window that holds the inflated data */
+			static const uint32_t WINDOW_SIZE = 64 * 1024;
+			/** Distance between two restart points, a multiple of WINDOW_SIZE */
+			static const uint32_t RESTART_INTERVAL = 16 * WINDOW_SIZE;
+
+			/** Constructor
+			 * @param archive The zip archive, ownership is taken.
+			 * @param entry The entry to read, it has to be stored or deflated.
+			 */
+			ZipStreamSource(RawData* archive, const ZipEntryData& entry);
+			virtual ~ZipStreamSource();
+
+			virtual uint64_t getSize() const;
+			virtual void readInto(uint8_t* buffer, uint64_t start, size_t length);
+
+			/** Stored entries of mapped archives can be accessed directly.
+			 */
+			virtual const uint8_t* getData() const;
+
+		private:
+			/** Moves the inflate state to the given output position, which has to be a multiple of WINDOW_SIZE.
+			 * Restores the nearest restart point if it is closer than the current position.
+			 */
+			void seek(uint64_t position);
+
+			/** Calls inflate and counts the output, total_out of zlib is only 32 bit on some platforms.
+			 */
+			int32_t inflateStep();
+
+			/** Inflates the next window, saves a restart point if the window starts at a RESTART_INTERVAL.
+			 * @throw InvalidFormat if the compressed data is broken.
+			 */
+			void inflateNext();
+
+			/** Provides compressed input for inflate if it ran out of it.
+			 */
+			void fillInput();
+
+			RawData* m_archive;
+			ZipEntryData m_entry;
+			// archive data if it is mapped, NULL otherwise
+			const uint8_t* m_archiveData;
+
+			z_stream m_stream;
+			bool m_streamInitialized;
+			// compressed bytes handed to m_stream and inflated bytes produced by it
+			uint64_t m_totalIn;
+			uint64_t m_totalOut;
+
+			/** Saved inflate state at index * RESTART_INTERVAL, zlib streams can not be moved in memory
+			 */
+			struct RestartPoint {
+				z_stream* stream;
+				uint64_t totalIn;
+			};
+			std::vector<RestartPoint> m_restartPoints;
+			// compressed input, only used if the archive is not mapped
+			std::vector<uint8_t> m_input;
+			// inflated data from m_windowStart to m_windowStart + m_windowLength
+			std::vector<uint8_t> m_window;
+			uint64_t m_windowStart;
+			uint32_t m_windowLength;
+
+			ZipStreamSource(const ZipStreamSource&);
+			ZipStreamSource& operator=(const ZipStreamSource&) { return *this; }
+	};
+}
+
+#endif
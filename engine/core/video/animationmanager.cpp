@@ -139,7 +139,7 @@ namespace FIFE {
 		returnValue = m_animHandleMap.insert ( AnimationHandleMapPair(res->getHandle(), resptr));
 
 		if (returnValue.second) {
-			m_animNameMap.insert ( AnimationNameMapPair(returnValue.first->second->getName(), returnValue.first->second) );
+			m_animNameMap.insert ( AnimationNameMapPair(returnValue.first->second->getName(), returnValue.first->second), res->getNameHash() );
 		}
 		else {
 			FL_WARN(_log, LMsg("AnimationManager::add(IResource*) - ") << "Resource " << res->getName() << " already exists.... ignoring.");
@@ -279,7 +279,7 @@ namespace FIFE {
 
 	void AnimationManager::remove(AnimationPtr& resource) {
 		AnimationHandleMapIterator it = m_animHandleMap.find(resource->getHandle());
-		AnimationNameMapIterator nit = m_animNameMap.find(resource->getName());
+		AnimationNameMapIterator nit = m_animNameMap.find(resource->getName(), resource->getNameHash());
 
 		if (it != m_animHandleMap.end()) {
 			m_animHandleMap.erase(it);
@@ -318,11 +318,13 @@ namespace FIFE {
 
 	void AnimationManager::remove(ResourceHandle handle) {
 		std::string name;
+		size_t nameHash = 0;
 
 		AnimationHandleMapIterator it = m_animHandleMap.find(handle);
 
 		if (it != m_animHandleMap.end()) {
 			name = it->second->getName();
+			nameHash = it->second->getNameHash();
 			m_animHandleMap.erase(it);
 		}
 		else {
@@ -330,7 +332,7 @@ namespace FIFE {
 			return;
 		}
 
-		AnimationNameMapIterator nit = m_animNameMap.find(name);
+		AnimationNameMapIterator nit = m_animNameMap.find(name, nameHash);
 		if ( nit != m_animNameMap.end() ) {
 			m_animNameMap.erase(nit);
 			return;
@@ -36,6 +36,7 @@
 #include "util/base/singleton.h"
 #include "util/resource/resource.h"
 #include "util/resource/resourcemanager.h"
+#include "util/structures/openhashmap.h"
 
 #include "animation.h"
 
@@ -360,14 +361,14 @@ namespace FIFE {
 		virtual void invalidateAll();
 
 	private:
-		typedef std::map< ResourceHandle, AnimationPtr > AnimationHandleMap;
-		typedef std::map< ResourceHandle, AnimationPtr >::iterator AnimationHandleMapIterator;
-		typedef std::map< ResourceHandle, AnimationPtr >::const_iterator AnimationHandleMapConstIterator;
+		typedef OpenHashMap< ResourceHandle, AnimationPtr, IntegerHash > AnimationHandleMap;
+		typedef OpenHashMap< ResourceHandle, AnimationPtr, IntegerHash >::iterator AnimationHandleMapIterator;
+		typedef OpenHashMap< ResourceHandle, AnimationPtr, IntegerHash >::const_iterator AnimationHandleMapConstIterator;
 		typedef std::pair< ResourceHandle, AnimationPtr > AnimationHandleMapPair;
 
-		typedef std::map< std::string, AnimationPtr > AnimationNameMap;
-		typedef std::map< std::string, AnimationPtr >::iterator AnimationNameMapIterator;
-		typedef std::map< std::string, AnimationPtr >::const_iterator AnimationNameMapConstIterator;
+		typedef OpenHashMap< std::string, AnimationPtr, StringHash > AnimationNameMap;
+		typedef OpenHashMap< std::string, AnimationPtr, StringHash >::iterator AnimationNameMapIterator;
+		typedef OpenHashMap< std::string, AnimationPtr, StringHash >::const_iterator AnimationNameMapConstIterator;
 		typedef std::pair< std::string, AnimationPtr > AnimationNameMapPair;
 
 		AnimationHandleMap m_animHandleMap;
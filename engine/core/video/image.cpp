@@ -33,6 +33,7 @@
 // Second block: files included from the same folder
 #include "util/resource/resource.h"
 #include "loaders/native/video/imageloader.h"
+#include "video/renderbackend.h"
 
 #include "image.h"
 
@@ -43,7 +44,11 @@ namespace FIFE {
 		m_surface(NULL),
 		m_xshift(0),
 		m_yshift(0),
-		m_shared(false){
+		m_shared(false),
+		m_lastUse(0),
+		m_atlasUses(0),
+		m_alphaMaskWidth(0),
+		m_alphaMaskHeight(0) {
 	}
 
 	Image::Image(const std::string& name, IResourceLoader* loader):
@@ -51,7 +56,11 @@ namespace FIFE {
 		m_surface(NULL),
 		m_xshift(0),
 		m_yshift(0),
-		m_shared(false){
+		m_shared(false),
+		m_lastUse(0),
+		m_atlasUses(0),
+		m_alphaMaskWidth(0),
+		m_alphaMaskHeight(0) {
 	}
 
 	Image::Image(SDL_Surface* surface):
@@ -59,7 +68,11 @@ namespace FIFE {
 		m_surface(NULL),
 		m_xshift(0),
 		m_yshift(0),
-		m_shared(false){
+		m_shared(false),
+		m_lastUse(0),
+		m_atlasUses(0),
+		m_alphaMaskWidth(0),
+		m_alphaMaskHeight(0) {
 		reset(surface);
 	}
 
@@ -68,7 +81,11 @@ namespace FIFE {
 		m_surface(NULL),
 		m_xshift(0),
 		m_yshift(0),
-		m_shared(false){
+		m_shared(false),
+		m_lastUse(0),
+		m_atlasUses(0),
+		m_alphaMaskWidth(0),
+		m_alphaMaskHeight(0) {
 		reset(surface);
 	}
 
@@ -78,7 +95,11 @@ namespace FIFE {
 		m_surface(NULL),
 		m_xshift(0),
 		m_yshift(0),
-		m_shared(false){
+		m_shared(false),
+		m_lastUse(0),
+		m_atlasUses(0),
+		m_alphaMaskWidth(0),
+		m_alphaMaskHeight(0) {
 		SDL_Surface* surface = SDL_CreateRGBSurface(0, width,height, 32,
 		                                            RMASK, GMASK, BMASK ,AMASK);
 		SDL_LockSurface(surface);
@@ -95,7 +116,11 @@ namespace FIFE {
 		m_surface(NULL),
 		m_xshift(0),
 		m_yshift(0),
-		m_shared(false) {
+		m_shared(false),
+		m_lastUse(0),
+		m_atlasUses(0),
+		m_alphaMaskWidth(0),
+		m_alphaMaskHeight(0) {
 		SDL_Surface* surface = SDL_CreateRGBSurface(0, width,height, 32,
 		                                            RMASK, GMASK, BMASK ,AMASK);
 		SDL_LockSurface(surface);
@@ -115,6 +140,10 @@ namespace FIFE {
 		m_xshift = 0;
 		m_yshift = 0;
 		m_surface = surface;
+		// freeing keeps the mask, a new surface can contain other pixels
+		if (surface) {
+			resetAlphaMask();
+		}
 	}
 
 	Image::~Image() {
@@ -142,6 +171,10 @@ namespace FIFE {
 		m_state = IResource::RES_NOT_LOADED;
 	}
 
+	void Image::touch() {
+		m_lastUse = RenderBackend::instance()->getFrameNumber();
+	}
+
 	SDL_Surface* Image::detachSurface() {
 		SDL_Surface* srf = m_surface;
 		m_surface = NULL;
@@ -224,6 +257,93 @@ namespace FIFE {
 		SDL_GetRGBA(pixel, m_surface->format, r, g, b, a);
 	}
 
+	void Image::loadSurface() {
+		if (m_shared) {
+			forceLoadInternal();
+		} else if (!m_surface) {
+			load();
+		}
+	}
+
+	void Image::resetAlphaMask() {
+		m_alphaMask.clear();
+		m_alphaMaskWidth = 0;
+		m_alphaMaskHeight = 0;
+	}
+
+	void Image::buildAlphaMask() {
+		loadSurface();
+		resetAlphaMask();
+		if (!m_surface) {
+			return;
+		}
+		const uint32_t width = getWidth();
+		const uint32_t height = getHeight();
+		const uint32_t pitch = (width + 7) / 8;
+		m_alphaMask.assign(pitch * height, 0);
+
+		int32_t xoffset = 0;
+		int32_t yoffset = 0;
+		if (m_shared) {
+			xoffset = m_subimagerect.x;
+			yoffset = m_subimagerect.y;
+		}
+		SDL_LockSurface(m_surface);
+		const SDL_PixelFormat* format = m_surface->format;
+		if (format->BytesPerPixel == 4 && format->Amask &&
+			static_cast<int32_t>(xoffset + width) <= m_surface->w &&
+			static_cast<int32_t>(yoffset + height) <= m_surface->h) {
+			// fast path for the usual 32 bit RGBA surfaces
+			for (uint32_t y = 0; y < height; ++y) {
+				const Uint32* row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(m_surface->pixels) +
+					(y + yoffset) * m_surface->pitch) + xoffset;
+				uint8_t* bits = &m_alphaMask[y * pitch];
+				for (uint32_t x = 0; x < width; ++x) {
+					if (row[x] & format->Amask) {
+						bits[x >> 3] |= static_cast<uint8_t>(1 << (x & 7));
+					}
+				}
+			}
+		} else {
+			uint8_t r, g, b, a;
+			for (uint32_t y = 0; y < height; ++y) {
+				uint8_t* bits = &m_alphaMask[y * pitch];
+				for (uint32_t x = 0; x < width; ++x) {
+					a = 0;
+					getPixelRGBA(x, y, &r, &g, &b, &a);
+					if (a != 0) {
+						bits[x >> 3] |= static_cast<uint8_t>(1 << (x & 7));
+					}
+				}
+			}
+		}
+		SDL_UnlockSurface(m_surface);
+		m_alphaMaskWidth = width;
+		m_alphaMaskHeight = height;
+	}
+
+	bool Image::isPixelTransparent(int32_t x, int32_t y, uint8_t alpha) {
+		if (m_alphaMask.empty()) {
+			buildAlphaMask();
+		}
+		if (x < 0 || y < 0 || x >= static_cast<int32_t>(m_alphaMaskWidth) ||
+			y >= static_cast<int32_t>(m_alphaMaskHeight)) {
+			return true;
+		}
+		const uint32_t pitch = (m_alphaMaskWidth + 7) / 8;
+		if ((m_alphaMask[y * pitch + (x >> 3)] & (1 << (x & 7))) == 0) {
+			return true;
+		}
+		if (alpha == 0) {
+			return false;
+		}
+		// the threshold needs the real alpha value
+		loadSurface();
+		uint8_t r, g, b, a = 0;
+		getPixelRGBA(x, y, &r, &g, &b, &a);
+		return a < alpha;
+	}
+
 	void Image::saveImage(const std::string& filename) {
 		saveAsPng(filename, *m_surface);
 	}
@@ -319,6 +439,7 @@ namespace FIFE {
 			m_surface = SDL_CreateRGBSurface(0, srcimg->getWidth(),
 				srcimg->getHeight(), 32, RMASK, GMASK, BMASK ,AMASK);
 		}
+		resetAlphaMask();
 		// disable blending
 		SDL_SetSurfaceBlendMode(srcimg->m_surface, SDL_BLENDMODE_NONE);
 		if(this->isSharedImage()) {
@@ -24,6 +24,7 @@
 
 // Standard C++ library includes
 #include <stack>
+#include <vector>
 
 // 3rd party library includes
 #include <SDL.h>
@@ -131,10 +132,37 @@ namespace FIFE {
 
 		void getPixelRGBA(int32_t x, int32_t y, uint8_t* r, uint8_t* g, uint8_t* b, uint8_t* a);
 
+		/** Checks whether the pixel at the given position is transparent.
+		 * The first call builds a 1-bit alpha mask of the image, after that fully transparent
+		 * pixels are rejected by a bit test. The mask survives free(), so an unloaded image
+		 * does not need to be reloaded for that test.
+		 * @param x The x position inside the image.
+		 * @param y The y position inside the image.
+		 * @param alpha If not 0, pixels with a lower alpha value count as transparent too.
+		 * @return True if the pixel is transparent or the position lies outside of the image.
+		 */
+		bool isPixelTransparent(int32_t x, int32_t y, uint8_t alpha = 0);
+
 		virtual size_t getSize();
 		virtual void load();
 		virtual void free();
 
+		/** Marks the image as used in the current frame, called by the render functions
+		 */
+		void touch();
+
+		/** Returns the number of the frame in which the image was last rendered
+		 */
+		uint32_t getLastUse() const { return m_lastUse; }
+
+		/** Returns the number of uses the ImageManager counted for runtime atlasing
+		 */
+		uint32_t getAtlasUses() const { return m_atlasUses; }
+
+		/** Sets the number of uses counted for runtime atlasing
+		 */
+		void setAtlasUses(uint32_t uses) { m_atlasUses = uses; }
+
 		/** After this call all image data will be taken from the given image and its subregion
 		 */
 		virtual void useSharedImage(const ImagePtr& shared, const Rect& region) = 0;
@@ -171,13 +199,34 @@ namespace FIFE {
 		 */
 		void reset(SDL_Surface* surface);
 
+		/** Makes sure the surface (or the shared surface) is available for pixel access.
+		 */
+		void loadSurface();
+
+		/** Discards the alpha mask, it is rebuilt on the next isPixelTransparent call.
+		 */
+		void resetAlphaMask();
+
 		// Does this image share data with another
 		bool m_shared;
 		// Area which this image occupy in shared image
 		Rect m_subimagerect;
+		// Frame in which the image was last rendered
+		uint32_t m_lastUse;
+		// Uses counted for runtime atlasing
+		uint32_t m_atlasUses;
 
 	private:
 		std::string createUniqueImageName();
+
+		/** Builds the alpha mask, one bit per pixel, set if alpha is not 0.
+		 */
+		void buildAlphaMask();
+
+		// 1-bit alpha mask, rows are padded to full bytes
+		std::vector<uint8_t> m_alphaMask;
+		uint32_t m_alphaMaskWidth;
+		uint32_t m_alphaMaskHeight;
 	};
 }
 
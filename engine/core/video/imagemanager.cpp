@@ -20,7 +20,11 @@
  ***************************************************************************/
 
 // Standard C++ library includes
+#include <algorithm>
+#include <chrono>
 #include <map>
+#include <sstream>
+#include <thread>
 
 // 3rd party library includes
 #include <tinyxml.h>
@@ -29,9 +33,13 @@
 // These includes are split up in two parts, separated by one empty line
 // First block: files included from the FIFE root src directory
 // Second block: files included from the same folder
+#include "loaders/native/video/asyncimagedecoder.h"
+#include "loaders/native/video/texturecache.h"
+#include "util/base/exception.h"
 #include "util/log/logger.h"
 #include "util/resource/resourcemanager.h"
 #include "util/resource/resource.h"
+#include "video/atlasbook.h"
 #include "video/image.h"
 #include "video/renderbackend.h"
 
@@ -43,8 +51,29 @@ namespace FIFE {
 	 */
 	static Logger _log(LM_RESMGR);
 
-	ImageManager::~ImageManager() {
+	ImageManager::ImageManager() :
+		IResourceManager(),
+		m_atlasing(false),
+		m_atlasPageSize(1024),
+		m_atlasThreshold(16),
+		m_atlasedImages(0),
+		m_atlasBook(NULL),
+		m_asyncLoading(false),
+		m_asyncDecoder(NULL),
+		m_asyncWorkers(0),
+		m_asyncUploadBudget(2000),
+		m_memoryBudget(0),
+		m_residentBytes(0),
+		m_evictions(0),
+		m_reloads(0),
+		m_textureCache(NULL) {
+	}
 
+	ImageManager::~ImageManager() {
+		// stop the workers first, they use the texture cache
+		delete m_asyncDecoder;
+		delete m_atlasBook;
+		delete m_textureCache;
 	}
 
 	size_t ImageManager::getMemoryUsed() const {
@@ -111,11 +140,13 @@ namespace FIFE {
 		ImageNameMapIterator nit = m_imgNameMap.find(name);
 
 		if (nit != m_imgNameMap.end()) {
-			if ( nit->second->getState() == IResource::RES_NOT_LOADED ) {
-				nit->second->load();
+			// loading can create images and rehash the map, see reloadAll
+			ImagePtr image = nit->second;
+			if ( image->getState() == IResource::RES_NOT_LOADED ) {
+				image->load();
 			}
 
-			return nit->second;
+			return image;
 		}
 
 		//was not found so create and load resource
@@ -162,7 +193,11 @@ namespace FIFE {
 		returnValue = m_imgHandleMap.insert ( ImageHandleMapPair(res->getHandle(), resptr));
 
 		if (returnValue.second) {
-			m_imgNameMap.insert ( ImageNameMapPair(returnValue.first->second->getName(), returnValue.first->second) );
+			m_imgNameMap.insert ( ImageNameMapPair(returnValue.first->second->getName(), returnValue.first->second), res->getNameHash() );
+			// images that are created from memory can not be reloaded after an eviction
+			if (res->getState() == IResource::RES_LOADED) {
+				m_memoryImages.insert(res->getHandle());
+			}
 		}
 		else {
 			FL_WARN(_log, LMsg("ImageManager::add(IResource*) - ") << "Resource " << res->getName() << " already exists.... ignoring.");
@@ -193,10 +228,11 @@ namespace FIFE {
 		ImageNameMapIterator nit = m_imgNameMap.find(name);
 
 		if (nit != m_imgNameMap.end()) {
-			if ( nit->second->getState() == IResource::RES_LOADED) {
-				nit->second->free();
+			ImagePtr image = nit->second;
+			if ( image->getState() == IResource::RES_LOADED) {
+				image->free();
 			}
-			nit->second->load();
+			image->load();
 			return;
 		}
 
@@ -207,10 +243,11 @@ namespace FIFE {
 		ImageHandleMapIterator it = m_imgHandleMap.find(handle);
 
 		if ( it != m_imgHandleMap.end()) {
-			if ( it->second->getState() == IResource::RES_LOADED) {
-				it->second->free();
+			ImagePtr image = it->second;
+			if ( image->getState() == IResource::RES_LOADED) {
+				image->free();
 			}
-			it->second->load();
+			image->load();
 			return;
 		}
 
@@ -219,28 +256,52 @@ namespace FIFE {
 	}
 
 	void ImageManager::reloadAll() {
+		// loading can create images, e.g. the atlas of a subimage, which can
+		// rehash the map, so the handles are collected first
 		ImageHandleMapIterator it = m_imgHandleMap.begin(),
 			itend = m_imgHandleMap.end();
 
+		std::vector<ResourceHandle> imgHandles;
+		imgHandles.reserve(m_imgHandleMap.size());
 		for ( ; it != itend; ++it) {
-			if ( it->second->getState() == IResource::RES_LOADED) {
-				it->second->free();
+			imgHandles.push_back(it->first);
+		}
+
+		for (std::vector<ResourceHandle>::iterator hit = imgHandles.begin(); hit != imgHandles.end(); ++hit) {
+			it = m_imgHandleMap.find(*hit);
+			if (it == m_imgHandleMap.end()) {
+				continue;
+			}
+			ImagePtr image = it->second;
+			if (image->getState() == IResource::RES_LOADED) {
+				image->free();
 			}
-			it->second->load();
+			image->load();
 		}
 	}
 
 	void ImageManager::loadUnreferenced() {
+		// see reloadAll, loading can change the map
 		ImageHandleMapIterator it = m_imgHandleMap.begin(),
 			itend = m_imgHandleMap.end();
 
-		int32_t count = 0;
+		std::vector<ResourceHandle> imgHandles;
 		for ( ; it != itend; ++it) {
 			if (it->second.useCount() == 2 && it->second->getState() != IResource::RES_LOADED){
-				it->second->load();
-				count++;
+				imgHandles.push_back(it->first);
 			}
 		}
+
+		int32_t count = 0;
+		for (std::vector<ResourceHandle>::iterator hit = imgHandles.begin(); hit != imgHandles.end(); ++hit) {
+			it = m_imgHandleMap.find(*hit);
+			if (it == m_imgHandleMap.end() || it->second->getState() == IResource::RES_LOADED) {
+				continue;
+			}
+			ImagePtr image = it->second;
+			image->load();
+			count++;
+		}
 		FL_DBG(_log, LMsg("ImageManager::loadUnreferenced() - ") << "Loaded " << count << " unreferenced resources.");
 	}
 
@@ -276,6 +337,10 @@ namespace FIFE {
 		int32_t count = 0;
 
 		for ( ; it != itend; ++it) {
+			// runtime atlas pages can not be reloaded from disk
+			if (isAtlasPage(it->first)) {
+				continue;
+			}
 			if ( it->second->getState() == IResource::RES_LOADED) {
 				it->second->free();
 				count++;
@@ -302,10 +367,12 @@ namespace FIFE {
 
 	void ImageManager::remove(ImagePtr& resource) {
 		ImageHandleMapIterator it = m_imgHandleMap.find(resource->getHandle());
-		ImageNameMapIterator nit = m_imgNameMap.find(resource->getName());
+		ImageNameMapIterator nit = m_imgNameMap.find(resource->getName(), resource->getNameHash());
 
 		if (it != m_imgHandleMap.end()) {
 			m_imgHandleMap.erase(it);
+			m_memoryImages.erase(resource->getHandle());
+			m_evicted.erase(resource->getHandle());
 
 			if (nit != m_imgNameMap.end()) {
 				m_imgNameMap.erase(nit);
@@ -333,6 +400,8 @@ namespace FIFE {
 		ImageHandleMapIterator it = m_imgHandleMap.find(handle);
 		if ( it != m_imgHandleMap.end()) {
 			m_imgHandleMap.erase(it);
+			m_memoryImages.erase(handle);
+			m_evicted.erase(handle);
 			return;
 		}
 
@@ -341,19 +410,23 @@ namespace FIFE {
 
 	void ImageManager::remove(ResourceHandle handle) {
 		std::string name;
+		size_t nameHash = 0;
 
 		ImageHandleMapIterator it = m_imgHandleMap.find(handle);
 
 		if (it != m_imgHandleMap.end()) {
 			name = it->second->getName();
+			nameHash = it->second->getNameHash();
 			m_imgHandleMap.erase(it);
+			m_memoryImages.erase(handle);
+			m_evicted.erase(handle);
 		}
 		else {
 			FL_WARN(_log, LMsg("ImageManager::remove(ResourceHandle) - ") << "Resource handle " << handle << " was not found.");
 			return;
 		}
 
-		ImageNameMapIterator nit = m_imgNameMap.find(name);
+		ImageNameMapIterator nit = m_imgNameMap.find(name, nameHash);
 		if ( nit != m_imgNameMap.end() ) {
 			m_imgNameMap.erase(nit);
 			return;
@@ -370,6 +443,13 @@ namespace FIFE {
 
 		m_imgHandleMap.clear();
 		m_imgNameMap.clear();
+		resetAtlasing();
+		if (m_asyncDecoder) {
+			m_asyncDecoder->clear();
+		}
+		m_asyncPending.clear();
+		m_memoryImages.clear();
+		m_evicted.clear();
 
 		FL_DBG(_log, LMsg("ImageManager::removeAll() - ") << "Removed all " << count << " resources.");
 	}
@@ -399,11 +479,13 @@ namespace FIFE {
 		ImageNameMapIterator nit = m_imgNameMap.find(name);
 
 		if (nit != m_imgNameMap.end()) {
-			if (nit->second->getState() != IResource::RES_LOADED){
+			// loading can create images and rehash the map, see reloadAll
+			ImagePtr image = nit->second;
+			if (image->getState() != IResource::RES_LOADED){
 				//resource is not loaded so load it
-				nit->second->load();
+				image->load();
 			}
-			return nit->second;
+			return image;
 		}
 
 		//not found so attempt to create and load the resource
@@ -414,11 +496,12 @@ namespace FIFE {
 	ImagePtr ImageManager::get(ResourceHandle handle) {
 		ImageHandleMapConstIterator it = m_imgHandleMap.find(handle);
 		if (it != m_imgHandleMap.end()) {
-			if (it->second->getState() != IResource::RES_LOADED){
+			ImagePtr image = it->second;
+			if (image->getState() != IResource::RES_LOADED){
 				//resource is not loaded so load it
-				it->second->load();
+				image->load();
 			}
-			return it->second;
+			return image;
 		}
 
 		FL_WARN(_log, LMsg("ImageManager::get(ResourceHandle) - ") << "Resource handle " << handle << " is undefined.");
@@ -438,6 +521,14 @@ namespace FIFE {
 		return ImagePtr();
 	}
 
+	ImagePtr ImageManager::find(const std::string& name) {
+		ImageNameMapIterator nit = m_imgNameMap.find(name);
+		if (nit != m_imgNameMap.end()) {
+			return nit->second;
+		}
+		return ImagePtr();
+	}
+
 	ImagePtr ImageManager::getPtr(ResourceHandle handle) {
 		ImageHandleMapConstIterator it = m_imgHandleMap.find(handle);
 		if (it != m_imgHandleMap.end()) {
@@ -490,4 +581,435 @@ namespace FIFE {
 
 	}
 
+	void ImageManager::setAtlasingEnabled(bool enabled) {
+		if (enabled && RenderBackend::instance()->getName() != "OpenGL") {
+			FL_WARN(_log, LMsg("ImageManager::setAtlasingEnabled(bool) - ") << "Runtime atlasing is not supported by the " << RenderBackend::instance()->getName() << " backend.");
+			return;
+		}
+		m_atlasing = enabled;
+		if (!m_atlasing) {
+			// counting starts again once atlasing is enabled
+			ImageHandleMapIterator it = m_imgHandleMap.begin();
+			for (; it != m_imgHandleMap.end(); ++it) {
+				it->second->setAtlasUses(0);
+			}
+			m_atlasQueue.clear();
+		}
+	}
+
+	bool ImageManager::isAtlasingEnabled() const {
+		return m_atlasing;
+	}
+
+	void ImageManager::setAtlasPageSize(uint32_t size) {
+		if (!m_atlasPages.empty()) {
+			FL_WARN(_log, LMsg("ImageManager::setAtlasPageSize(uint32_t) - ") << "Atlas pages already exist, page size stays " << m_atlasPageSize << ".");
+			return;
+		}
+		m_atlasPageSize = size;
+		delete m_atlasBook;
+		m_atlasBook = NULL;
+	}
+
+	uint32_t ImageManager::getAtlasPageSize() const {
+		return m_atlasPageSize;
+	}
+
+	void ImageManager::setAtlasingThreshold(uint32_t uses) {
+		m_atlasThreshold = std::max(uses, static_cast<uint32_t>(1));
+	}
+
+	uint32_t ImageManager::getAtlasingThreshold() const {
+		return m_atlasThreshold;
+	}
+
+	void ImageManager::notifyImageUse(const ImagePtr& image) {
+		if (!m_atlasing || image->isSharedImage()) {
+			return;
+		}
+		// images at the threshold are queued or were rejected, the count
+		// lives in the image, so it goes away with the image
+		uint32_t uses = image->getAtlasUses();
+		if (uses < m_atlasThreshold) {
+			image->setAtlasUses(++uses);
+			if (uses == m_atlasThreshold) {
+				m_atlasQueue.push_back(image->getHandle());
+			}
+		}
+	}
+
+	void ImageManager::packAtlasCandidates() {
+		if (m_atlasQueue.empty()) {
+			return;
+		}
+
+		const uint32_t maxSize = m_atlasPageSize / 2;
+		std::vector<ResourceHandle>::iterator it = m_atlasQueue.begin();
+		for (; it != m_atlasQueue.end(); ++it) {
+			ImageHandleMapIterator iit = m_imgHandleMap.find(*it);
+			if (iit == m_imgHandleMap.end()) {
+				continue;
+			}
+			// a new page is added to the map, which can rehash it
+			ImagePtr img = iit->second;
+			if (img->isSharedImage() || img->getState() != IResource::RES_LOADED) {
+				continue;
+			}
+			if (img->getWidth() == 0 || img->getHeight() == 0 ||
+				img->getWidth() > maxSize || img->getHeight() > maxSize) {
+				continue;
+			}
+			packImage(img);
+		}
+		m_atlasQueue.clear();
+	}
+
+	uint32_t ImageManager::getAtlasPageCount() const {
+		return m_atlasPages.size();
+	}
+
+	uint32_t ImageManager::getAtlasedImageCount() const {
+		return m_atlasedImages;
+	}
+
+	ImagePtr ImageManager::loadAsync(const std::string& name) {
+		ImagePtr image;
+		ImageNameMapIterator nit = m_imgNameMap.find(name);
+		if (nit != m_imgNameMap.end()) {
+			image = nit->second;
+			if (image->getState() == IResource::RES_LOADED || m_asyncPending.count(image->getHandle()) > 0) {
+				return image;
+			}
+			// shared images and custom loaders need the main thread
+			if (image->isSharedImage() || image->getLoader()) {
+				image->load();
+				return image;
+			}
+		} else {
+			image = create(name);
+		}
+
+		if (!m_asyncLoading) {
+			try {
+				image->load();
+			} catch (Exception& e) {
+				FL_WARN(_log, LMsg("ImageManager::loadAsync() - ") << "Resource name " << name << " could not be loaded: " << e.what());
+			}
+			std::vector<ImageLoadListener*>::iterator lit = m_loadListeners.begin();
+			for (; lit != m_loadListeners.end(); ++lit) {
+				if (image->getState() == IResource::RES_LOADED) {
+					(*lit)->onImageLoaded(image);
+				} else {
+					(*lit)->onImageLoadFailed(image);
+				}
+			}
+			return image;
+		}
+
+		if (!m_asyncDecoder) {
+			uint32_t workers = m_asyncWorkers;
+			if (workers == 0) {
+				uint32_t cores = std::thread::hardware_concurrency();
+				workers = std::max(1u, std::min(4u, cores > 1 ? cores - 1 : 1u));
+			}
+			m_asyncDecoder = new AsyncImageDecoder(workers);
+			FL_LOG(_log, LMsg("ImageManager::loadAsync() - ") << "Started " << workers << " image decoding threads.");
+		}
+
+		RenderBackend* rb = RenderBackend::instance();
+		AsyncImageDecoder::Request request;
+		request.handle = image->getHandle();
+		request.filename = name;
+		// in case of SDL we don't need to convert the surface
+		request.convert = rb->getName() != "SDL";
+		request.format = rb->getPixelFormat();
+		m_asyncPending.insert(request.handle);
+		m_asyncDecoder->enqueue(request);
+		return image;
+	}
+
+	void ImageManager::prefetch(const std::vector<std::string>& names) {
+		std::vector<std::string>::const_iterator it = names.begin();
+		for (; it != names.end(); ++it) {
+			loadAsync(*it);
+		}
+	}
+
+	bool ImageManager::isLoadPending(ResourceHandle handle) const {
+		return m_asyncPending.find(handle) != m_asyncPending.end();
+	}
+
+	uint32_t ImageManager::getPendingLoadCount() const {
+		return m_asyncPending.size();
+	}
+
+	void ImageManager::processAsyncLoads() {
+		if (!m_asyncDecoder) {
+			return;
+		}
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		AsyncImageDecoder::Result result;
+		while (m_asyncDecoder->popResult(result)) {
+			m_asyncPending.erase(result.handle);
+			ImageHandleMapIterator it = m_imgHandleMap.find(result.handle);
+			// the image was removed or loaded synchronously in the meantime
+			if (it == m_imgHandleMap.end() || it->second->getState() == IResource::RES_LOADED) {
+				if (result.surface) {
+					SDL_FreeSurface(result.surface);
+				}
+				continue;
+			}
+
+			ImagePtr image = it->second;
+			if (!result.surface) {
+				FL_WARN(_log, LMsg("ImageManager::processAsyncLoads() - ") << "Resource name " << result.filename << " could not be loaded: " << result.error);
+				std::vector<ImageLoadListener*>::iterator lit = m_loadListeners.begin();
+				for (; lit != m_loadListeners.end(); ++lit) {
+					(*lit)->onImageLoadFailed(image);
+				}
+				continue;
+			}
+
+			//Have to save the images x and y shift or it gets lost when the surface is set.
+			int32_t xShiftSave = image->getXShift();
+			int32_t yShiftSave = image->getYShift();
+			image->setSurface(result.surface);
+			image->setXShift(xShiftSave);
+			image->setYShift(yShiftSave);
+			image->setState(IResource::RES_LOADED);
+			image->forceLoadInternal();
+
+			std::vector<ImageLoadListener*>::iterator lit = m_loadListeners.begin();
+			for (; lit != m_loadListeners.end(); ++lit) {
+				(*lit)->onImageLoaded(image);
+			}
+
+			std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+			if (std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() >= static_cast<int64_t>(m_asyncUploadBudget)) {
+				break;
+			}
+		}
+	}
+
+	void ImageManager::setAsyncUploadBudget(uint32_t microseconds) {
+		m_asyncUploadBudget = microseconds;
+	}
+
+	uint32_t ImageManager::getAsyncUploadBudget() const {
+		return m_asyncUploadBudget;
+	}
+
+	void ImageManager::setAsyncLoadingEnabled(bool enabled) {
+		m_asyncLoading = enabled;
+	}
+
+	bool ImageManager::isAsyncLoadingEnabled() const {
+		return m_asyncLoading;
+	}
+
+	void ImageManager::setAsyncWorkerCount(uint32_t count) {
+		if (m_asyncDecoder) {
+			FL_WARN(_log, LMsg("ImageManager::setAsyncWorkerCount() - ") << "The worker threads are already running, the count can not be changed.");
+			return;
+		}
+		m_asyncWorkers = count;
+	}
+
+	uint32_t ImageManager::getAsyncWorkerCount() const {
+		if (m_asyncDecoder) {
+			return m_asyncDecoder->getWorkerCount();
+		}
+		return m_asyncWorkers;
+	}
+
+	void ImageManager::setMemoryBudget(size_t bytes) {
+		m_memoryBudget = bytes;
+	}
+
+	size_t ImageManager::getMemoryBudget() const {
+		return m_memoryBudget;
+	}
+
+	void ImageManager::enforceMemoryBudget() {
+		// evicted images that were loaded again
+		std::set<ResourceHandle>::iterator eit = m_evicted.begin();
+		while (eit != m_evicted.end()) {
+			ImageHandleMapConstIterator it = m_imgHandleMap.find(*eit);
+			if (it == m_imgHandleMap.end() || it->second->getState() == IResource::RES_LOADED) {
+				if (it != m_imgHandleMap.end()) {
+					++m_reloads;
+				}
+				m_evicted.erase(eit++);
+			} else {
+				++eit;
+			}
+		}
+
+		if (m_memoryBudget == 0) {
+			return;
+		}
+
+		// images that are still referenced are only evicted with OpenGL, because
+		// SDL subimages of an atlas would lose the shared texture
+		const bool evictReferenced = RenderBackend::instance()->getName() == "OpenGL";
+		const uint32_t frame = RenderBackend::instance()->getFrameNumber();
+		std::vector<EvictionCandidate> candidates;
+		size_t resident = 0;
+		ImageHandleMapIterator it = m_imgHandleMap.begin();
+		for (; it != m_imgHandleMap.end(); ++it) {
+			Image* image = it->second.get();
+			size_t size = image->getSize();
+			resident += size;
+			if (size == 0 || image->getState() != IResource::RES_LOADED ||
+				m_memoryImages.count(it->first) > 0 || isAtlasPage(it->first) || isLoadPending(it->first)) {
+				continue;
+			}
+			// the manager holds two references
+			bool referenced = it->second.useCount() > 2;
+			// images of the last two frames are on screen
+			if (referenced && (!evictReferenced || image->getLastUse() + 1 >= frame)) {
+				continue;
+			}
+			EvictionCandidate candidate;
+			candidate.handle = it->first;
+			candidate.referenced = referenced;
+			candidate.lastUse = image->getLastUse();
+			candidate.size = size;
+			candidates.push_back(candidate);
+		}
+		m_residentBytes = resident;
+		if (resident <= m_memoryBudget) {
+			return;
+		}
+
+		// unreferenced images first, then the least recently rendered
+		std::sort(candidates.begin(), candidates.end());
+		uint32_t count = 0;
+		std::vector<EvictionCandidate>::iterator cit = candidates.begin();
+		for (; cit != candidates.end() && resident > m_memoryBudget; ++cit) {
+			m_imgHandleMap[cit->handle]->free();
+			m_evicted.insert(cit->handle);
+			resident -= cit->size;
+			++count;
+		}
+		m_residentBytes = resident;
+		m_evictions += count;
+
+		if (resident > m_memoryBudget) {
+			FL_DBG(_log, LMsg("ImageManager::enforceMemoryBudget() - ") << "Images on screen need " << resident << " bytes, the budget is " << m_memoryBudget << " bytes.");
+		}
+		FL_DBG(_log, LMsg("ImageManager::enforceMemoryBudget() - ") << "Evicted " << count << " images.");
+	}
+
+	size_t ImageManager::getResidentBytes() const {
+		return m_residentBytes;
+	}
+
+	uint32_t ImageManager::getEvictionCount() const {
+		return m_evictions;
+	}
+
+	uint32_t ImageManager::getReloadCount() const {
+		return m_reloads;
+	}
+
+	void ImageManager::setTextureCacheDirectory(const std::string& directory) {
+		if (getTextureCacheDirectory() == directory) {
+			return;
+		}
+		// the worker threads could still use the old cache
+		while (m_asyncDecoder && m_asyncDecoder->getPendingCount() > 0) {
+			std::this_thread::yield();
+		}
+		delete m_textureCache;
+		m_textureCache = NULL;
+		if (!directory.empty()) {
+			m_textureCache = new TextureCache(directory);
+		}
+	}
+
+	std::string ImageManager::getTextureCacheDirectory() const {
+		return m_textureCache ? m_textureCache->getDirectory() : std::string();
+	}
+
+	TextureCache* ImageManager::getTextureCache() const {
+		return m_textureCache;
+	}
+
+	void ImageManager::clearTextureCache() {
+		if (m_textureCache) {
+			m_textureCache->clear();
+		}
+	}
+
+	uint32_t ImageManager::getTextureCacheHitCount() const {
+		return m_textureCache ? m_textureCache->getHitCount() : 0;
+	}
+
+	uint32_t ImageManager::getTextureCacheMissCount() const {
+		return m_textureCache ? m_textureCache->getMissCount() : 0;
+	}
+
+	void ImageManager::addLoadListener(ImageLoadListener* listener) {
+		m_loadListeners.push_back(listener);
+	}
+
+	void ImageManager::removeLoadListener(ImageLoadListener* listener) {
+		std::vector<ImageLoadListener*>::iterator it = std::find(m_loadListeners.begin(), m_loadListeners.end(), listener);
+		if (it != m_loadListeners.end()) {
+			m_loadListeners.erase(it);
+		}
+	}
+
+	void ImageManager::packImage(ImagePtr image) {
+		if (!m_atlasBook) {
+			m_atlasBook = new AtlasBook(m_atlasPageSize, m_atlasPageSize);
+		}
+		// look for a place for an image of given size
+		AtlasBlock* block = m_atlasBook->getBlock(image->getWidth(), image->getHeight());
+
+		// if it can't fit, we need to add new 'page'
+		if (block->page >= m_atlasPages.size()) {
+			std::ostringstream name;
+			name << "__runtime_atlas_" << block->page << "__";
+			ImagePtr page = loadBlank(name.str(), m_atlasPageSize, m_atlasPageSize);
+
+			// because we update the texture on-the-fly (via TexSubImage)
+			// we cant use a compressed texture
+			RenderBackend* rb = RenderBackend::instance();
+			bool prev = rb->isImageCompressingEnabled();
+			rb->setImageCompressingEnabled(false);
+			page->forceLoadInternal();
+			rb->setImageCompressingEnabled(prev);
+			m_atlasPages.push_back(page);
+		}
+
+		ImagePtr page = m_atlasPages[block->page];
+		page->copySubimage(block->left, block->top, image);
+
+		// release own surface and texture, the offsets are kept
+		image->free();
+		Rect region(block->left, block->top, block->getWidth(), block->getHeight());
+		image->useSharedImage(page, region);
+		++m_atlasedImages;
+	}
+
+	bool ImageManager::isAtlasPage(ResourceHandle handle) const {
+		std::vector<ImagePtr>::const_iterator it = m_atlasPages.begin();
+		for (; it != m_atlasPages.end(); ++it) {
+			if ((*it)->getHandle() == handle) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void ImageManager::resetAtlasing() {
+		delete m_atlasBook;
+		m_atlasBook = NULL;
+		m_atlasPages.clear();
+		m_atlasQueue.clear();
+		m_atlasedImages = 0;
+	}
+
 } //FIFE
@@ -24,6 +24,7 @@
 
 // Standard C++ library includes
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -36,11 +37,34 @@
 #include "util/base/singleton.h"
 #include "util/resource/resource.h"
 #include "util/resource/resourcemanager.h"
+#include "util/structures/openhashmap.h"
 
 #include "image.h"
 
 namespace FIFE {
 
+	class AsyncImageDecoder;
+	class AtlasBook;
+	class TextureCache;
+
+	/** Listener for images that are loaded with ImageManager::loadAsync()
+	 *
+	 * The callbacks are invoked on the main thread from ImageManager::processAsyncLoads(),
+	 * or directly from ImageManager::loadAsync() if background loading is disabled.
+	 */
+	class ImageLoadListener {
+	public:
+		virtual ~ImageLoadListener() {}
+
+		/** Called once the image is decoded and its texture is created.
+		 */
+		virtual void onImageLoaded(ImagePtr image) = 0;
+
+		/** Called if the image file could not be read or decoded.
+		 */
+		virtual void onImageLoadFailed(ImagePtr image) = 0;
+	};
+
 	/** ImageManager
 	 *
 	 * An interface for managing images.
@@ -56,7 +80,7 @@ namespace FIFE {
 
 		/** Default constructor.
 		 */
-		ImageManager() : IResourceManager() { }
+		ImageManager();
 
 		/** Destructor.
 		 */
@@ -362,6 +386,16 @@ namespace FIFE {
 		virtual ImagePtr getPtr(const std::string& name);
 		virtual ImagePtr getPtr(ResourceHandle handle);
 
+		/** Looks up an image by name with one lookup
+		 *
+		 * Unlike get() and getPtr() it neither loads the image nor logs a warning
+		 * if it does not exist.
+		 *
+		 * @param name The name of the image.
+		 * @return An ImagePtr to the image or an empty ImagePtr.
+		 */
+		ImagePtr find(const std::string& name);
+
 		/** Gets an Image handle by name
 		 *
 		 * Returns the Image handle associated with the name
@@ -376,20 +410,308 @@ namespace FIFE {
 		virtual void invalidate(ResourceHandle handle);
 		virtual void invalidateAll();
 
+		/** Enables or disables automatic runtime atlasing
+		 *
+		 * If enabled, images that are reported through notifyImageUse() often
+		 * enough are packed into shared atlas pages.  Consecutive instances
+		 * then use the same texture and the render backend can draw them
+		 * within one batch.
+		 *
+		 * @note Only the OpenGL backend can update atlas pages in place,
+		 * with other backends the request is ignored.
+		 *
+		 * @param enabled True to enable runtime atlasing.
+		 */
+		void setAtlasingEnabled(bool enabled);
+
+		/** Returns true if automatic runtime atlasing is enabled
+		 */
+		bool isAtlasingEnabled() const;
+
+		/** Sets the width and height of the runtime atlas pages
+		 *
+		 * Can only be changed as long as no page was created.
+		 * Images larger than half of the page size are never packed.
+		 *
+		 * @param size The page size in pixels. Default is 1024.
+		 */
+		void setAtlasPageSize(uint32_t size);
+
+		/** Returns the width and height of the runtime atlas pages
+		 */
+		uint32_t getAtlasPageSize() const;
+
+		/** Sets how often an image must be used before it gets packed
+		 *
+		 * @param uses The number of reported uses. Default is 16.
+		 */
+		void setAtlasingThreshold(uint32_t uses);
+
+		/** Returns how often an image must be used before it gets packed
+		 */
+		uint32_t getAtlasingThreshold() const;
+
+		/** Reports that the image was used for rendering
+		 *
+		 * Once the image reaches the atlasing threshold it is queued
+		 * and packed with the next call to packAtlasCandidates().
+		 *
+		 * @param image The rendered image.
+		 */
+		void notifyImageUse(const ImagePtr& image);
+
+		/** Packs all queued images into the runtime atlas pages
+		 *
+		 * @note Must be called outside of rendering, because the
+		 * textures of the packed images are released.
+		 */
+		void packAtlasCandidates();
+
+		/** Returns the number of runtime atlas pages
+		 */
+		uint32_t getAtlasPageCount() const;
+
+		/** Returns the number of images that were packed into runtime atlas pages
+		 */
+		uint32_t getAtlasedImageCount() const;
+
+		/** Loads an image in the background
+		 *
+		 * Reading and decoding of the file is done by worker threads, the texture
+		 * is created on the main thread by processAsyncLoads(). The returned image
+		 * is a placeholder that is filled in once the load is finished, until then
+		 * its state is RES_NOT_LOADED. If it is loaded synchronously in the
+		 * meantime, e.g. by get() or by rendering it, the background result is
+		 * discarded.
+		 *
+		 * Images that are already loaded, shared images and images with their own
+		 * resource loader are returned as they are. If background loading is
+		 * disabled, the image is loaded right away.
+		 *
+		 * @see setAsyncLoadingEnabled()
+		 * @param name The name of the image file.
+		 * @return An ImagePtr to the image.
+		 */
+		ImagePtr loadAsync(const std::string& name);
+
+		/** Loads a list of images in the background
+		 *
+		 * @see loadAsync()
+		 * @param names The names of the image files.
+		 */
+		void prefetch(const std::vector<std::string>& names);
+
+		/** Returns true if the image waits for its background load
+		 */
+		bool isLoadPending(ResourceHandle handle) const;
+
+		/** Returns the number of images that wait for their background load
+		 */
+		uint32_t getPendingLoadCount() const;
+
+		/** Creates the textures of the images that were decoded in the background
+		 *
+		 * Stops after the upload budget is used up, at least one image is processed
+		 * per call. Called by the engine once per frame.
+		 */
+		void processAsyncLoads();
+
+		/** Sets the time per frame that may be spent on creating textures for background loads
+		 *
+		 * @param microseconds The budget in microseconds. Default is 2000.
+		 */
+		void setAsyncUploadBudget(uint32_t microseconds);
+
+		/** Returns the time per frame that may be spent on creating textures for background loads
+		 */
+		uint32_t getAsyncUploadBudget() const;
+
+		/** Enables or disables background loading
+		 *
+		 * The worker threads read the files through the VFS while the main thread
+		 * uses it too, so every VFSSource in use, including custom ones, has to
+		 * allow concurrent reads. Disabled by default.
+		 *
+		 * @param enabled True to decode images with loadAsync() in the background.
+		 */
+		void setAsyncLoadingEnabled(bool enabled);
+
+		/** Returns true if loadAsync() decodes images in the background
+		 */
+		bool isAsyncLoadingEnabled() const;
+
+		/** Sets the number of worker threads for background loads
+		 *
+		 * Can only be changed before the first background load.
+		 *
+		 * @param count The number of threads, 0 uses the number of cores minus one (max 4).
+		 */
+		void setAsyncWorkerCount(uint32_t count);
+
+		/** Returns the number of worker threads for background loads
+		 */
+		uint32_t getAsyncWorkerCount() const;
+
+		/** Sets the memory budget for loaded images
+		 *
+		 * The size of an image includes its surface and its texture, see Image::getSize().
+		 * If the images need more memory, enforceMemoryBudget() frees unreferenced
+		 * images first and then the least recently rendered ones. Freed images are
+		 * reloaded when they are used again. Images that were created from memory,
+		 * e.g. with loadBlank(), and images rendered during the last two frames are
+		 * never evicted.
+		 *
+		 * @param bytes The budget in bytes, 0 disables the eviction. Default is 0.
+		 */
+		void setMemoryBudget(size_t bytes);
+
+		/** Returns the memory budget for loaded images in bytes
+		 */
+		size_t getMemoryBudget() const;
+
+		/** Frees images until the memory budget is met
+		 *
+		 * Called by the engine once per frame, before rendering.
+		 */
+		void enforceMemoryBudget();
+
+		/** Returns the memory used by loaded images after the last enforceMemoryBudget() call
+		 */
+		size_t getResidentBytes() const;
+
+		/** Returns the number of images that were freed to meet the memory budget
+		 */
+		uint32_t getEvictionCount() const;
+
+		/** Returns the number of evicted images that were loaded again
+		 */
+		uint32_t getReloadCount() const;
+
+		/** Enables the on-disk cache of decoded images
+		 *
+		 * Decoded and converted pixel data is stored in the directory, so the next
+		 * start only reads it instead of decoding the image files again. Entries are
+		 * validated against the size and modification time (or content hash for
+		 * archives) of the image file and the pixel format of the render backend.
+		 * Waits for running background loads before the cache is replaced.
+		 *
+		 * @param directory The cache directory, an empty string disables the cache. Default is disabled.
+		 */
+		void setTextureCacheDirectory(const std::string& directory);
+
+		/** Returns the directory of the texture cache, empty if it is disabled
+		 */
+		std::string getTextureCacheDirectory() const;
+
+		/** Returns the texture cache or NULL if it is disabled
+		 */
+		TextureCache* getTextureCache() const;
+
+		/** Removes all entries from the texture cache
+		 */
+		void clearTextureCache();
+
+		/** Returns the number of images that were read from the texture cache
+		 */
+		uint32_t getTextureCacheHitCount() const;
+
+		/** Returns the number of images that had to be decoded, because the texture cache had no valid entry
+		 */
+		uint32_t getTextureCacheMissCount() const;
+
+		/** Adds a listener that is informed about finished background loads
+		 */
+		void addLoadListener(ImageLoadListener* listener);
+
+		/** Removes a listener
+		 */
+		void removeLoadListener(ImageLoadListener* listener);
+
 	private:
-		typedef std::map< ResourceHandle, ImagePtr > ImageHandleMap;
-		typedef std::map< ResourceHandle, ImagePtr >::iterator ImageHandleMapIterator;
-		typedef std::map< ResourceHandle, ImagePtr >::const_iterator ImageHandleMapConstIterator;
+		/** Copies the image into a free block of the runtime atlas
+		 * and turns it into a shared image of that page.
+		 */
+		void packImage(ImagePtr image);
+
+		/** Returns true if the handle belongs to a runtime atlas page
+		 */
+		bool isAtlasPage(ResourceHandle handle) const;
+
+		/** Drops all runtime atlas pages and bookkeeping
+		 */
+		void resetAtlasing();
+
+		struct EvictionCandidate {
+			ResourceHandle handle;
+			bool referenced;
+			uint32_t lastUse;
+			size_t size;
+
+			bool operator<(const EvictionCandidate& rhs) const {
+				if (referenced != rhs.referenced) {
+					return !referenced;
+				}
+				return lastUse < rhs.lastUse;
+			}
+		};
+
+		typedef OpenHashMap< ResourceHandle, ImagePtr, IntegerHash > ImageHandleMap;
+		typedef OpenHashMap< ResourceHandle, ImagePtr, IntegerHash >::iterator ImageHandleMapIterator;
+		typedef OpenHashMap< ResourceHandle, ImagePtr, IntegerHash >::const_iterator ImageHandleMapConstIterator;
 		typedef std::pair< ResourceHandle, ImagePtr > ImageHandleMapPair;
 
-		typedef std::map< std::string, ImagePtr > ImageNameMap;
-		typedef std::map< std::string, ImagePtr >::iterator ImageNameMapIterator;
-		typedef std::map< std::string, ImagePtr >::const_iterator ImageNameMapConstIterator;
+		typedef OpenHashMap< std::string, ImagePtr, StringHash > ImageNameMap;
+		typedef OpenHashMap< std::string, ImagePtr, StringHash >::iterator ImageNameMapIterator;
+		typedef OpenHashMap< std::string, ImagePtr, StringHash >::const_iterator ImageNameMapConstIterator;
 		typedef std::pair< std::string, ImagePtr > ImageNameMapPair;
 
 		ImageHandleMap m_imgHandleMap;
 
 		ImageNameMap m_imgNameMap;
+
+		// runtime atlasing enabled
+		bool m_atlasing;
+		// width and height of the runtime atlas pages
+		uint32_t m_atlasPageSize;
+		// uses before an image is packed
+		uint32_t m_atlasThreshold;
+		// number of packed images
+		uint32_t m_atlasedImages;
+		// block allocator for the runtime atlas pages
+		AtlasBook* m_atlasBook;
+		// runtime atlas pages
+		std::vector<ImagePtr> m_atlasPages;
+		// images that reached the threshold
+		std::vector<ResourceHandle> m_atlasQueue;
+
+		// true if loadAsync uses the worker threads
+		bool m_asyncLoading;
+		// worker threads for background loads, created on first use
+		AsyncImageDecoder* m_asyncDecoder;
+		// requested number of worker threads, 0 means automatic
+		uint32_t m_asyncWorkers;
+		// texture upload budget per frame in microseconds
+		uint32_t m_asyncUploadBudget;
+		// images that wait for their background load
+		std::set<ResourceHandle> m_asyncPending;
+		// listeners for finished background loads
+		std::vector<ImageLoadListener*> m_loadListeners;
+
+		// memory budget in bytes, 0 if disabled
+		size_t m_memoryBudget;
+		// memory used by loaded images, measured by enforceMemoryBudget()
+		size_t m_residentBytes;
+		// number of evicted images
+		uint32_t m_evictions;
+		// number of evicted images that were loaded again
+		uint32_t m_reloads;
+		// images that were created from memory and can not be reloaded
+		std::set<ResourceHandle> m_memoryImages;
+		// evicted images, to count their reloads
+		std::set<ResourceHandle> m_evicted;
+
+		// on-disk cache of decoded images, NULL if disabled
+		TextureCache* m_textureCache;
 	};
 
 } //FIFE
@@ -100,6 +100,17 @@ namespace FIFE {
 		resetGlimage();
 	}
 
+	size_t GLImage::getSize() {
+		size_t size = Image::getSize();
+		// the texture is owned by the shared image
+		if (m_texId && !m_shared) {
+			size_t texSize = static_cast<size_t>(m_chunk_size_w) * m_chunk_size_h * 4;
+			// compressed textures use about one byte per pixel
+			size += m_compressed ? texSize / 4 : texSize;
+		}
+		return size;
+	}
+
 	void GLImage::resetGlimage() {
 		cleanup();
 
@@ -136,6 +147,10 @@ namespace FIFE {
 			rect.bottom() < 0 || rect.y > static_cast<int32_t>(target->h)) {
 			return;
 		}
+		touch();
+		if (m_shared) {
+			m_shared_img->touch();
+		}
 		if (!m_texId) {
 			generateGLTexture();
 		} else if (m_shared) {
@@ -159,6 +174,10 @@ namespace FIFE {
 			rect.bottom() < 0 || rect.y > static_cast<int32_t>(target->h)) {
 			return;
 		}
+		touch();
+		if (m_shared) {
+			m_shared_img->touch();
+		}
 		if (!m_texId) {
 			generateGLTexture();
 		} else if (m_shared) {
@@ -186,6 +205,10 @@ namespace FIFE {
 			rect.bottom() < 0 || rect.y > static_cast<int32_t>(target->h)) {
 			return;
 		}
+		touch();
+		if (m_shared) {
+			m_shared_img->touch();
+		}
 		if (!m_texId) {
 			generateGLTexture();
 		} else if (m_shared) {
@@ -209,6 +232,10 @@ namespace FIFE {
 			rect.bottom() < 0 || rect.y > static_cast<int32_t>(target->h)) {
 			return;
 		}
+		touch();
+		if (m_shared) {
+			m_shared_img->touch();
+		}
 		
 		if (!m_texId) {
 			generateGLTexture();
@@ -223,6 +250,69 @@ namespace FIFE {
 		//rb->addImageToArray(rect, m_texId, m_tex_coords, img->getTexId(), img->getTexCoords(), alpha, rgb);
 	}
 
+	void GLImage::renderOutline(const Rect& rect, uint8_t alpha, uint8_t const* rgb, int32_t width, int32_t threshold) {
+		if (!prepareRender(rect, alpha)) {
+			return;
+		}
+		static_cast<RenderBackendOpenGL*>(RenderBackend::instance())->addOutlineToArray(m_texId, rect, m_tex_coords,
+			getWidth(), getHeight(), alpha, rgb, width, threshold);
+	}
+
+	void GLImage::renderOutlineZ(const Rect& rect, float vertexZ, uint8_t alpha, uint8_t const* rgb, int32_t width, int32_t threshold) {
+		if (!prepareRender(rect, alpha)) {
+			return;
+		}
+		static_cast<RenderBackendOpenGL*>(RenderBackend::instance())->addOutlineToArrayZ(m_texId, rect, vertexZ, m_tex_coords,
+			getWidth(), getHeight(), alpha, rgb, width, threshold);
+	}
+
+	void GLImage::renderColorTable(const Rect& rect, const ImagePtr& overlay, const std::map<Color, Color>& colors, uint8_t alpha, uint8_t const* factor) {
+		if (!prepareRender(rect, alpha)) {
+			return;
+		}
+		GLImage* img = static_cast<GLImage*>(overlay.get());
+		img->forceLoadInternal();
+
+		static_cast<RenderBackendOpenGL*>(RenderBackend::instance())->addColorTableToArray(rect, m_texId, m_tex_coords,
+			img->getTexId(), img->getTexCoords(), alpha, factor, colors);
+	}
+
+	void GLImage::renderColorTableZ(const Rect& rect, float vertexZ, const ImagePtr& overlay, const std::map<Color, Color>& colors, uint8_t alpha, uint8_t const* factor) {
+		if (!prepareRender(rect, alpha)) {
+			return;
+		}
+		GLImage* img = static_cast<GLImage*>(overlay.get());
+		img->forceLoadInternal();
+
+		static_cast<RenderBackendOpenGL*>(RenderBackend::instance())->addColorTableToArrayZ(rect, vertexZ, m_texId, m_tex_coords,
+			img->getTexId(), img->getTexCoords(), alpha, factor, colors);
+	}
+
+	bool GLImage::prepareRender(const Rect& rect, uint8_t alpha) {
+		// completely transparent so dont bother rendering
+		if (0 == alpha) {
+			return false;
+		}
+		SDL_Surface* target = RenderBackend::instance()->getRenderTargetSurface();
+		assert(target != m_surface); // can't draw on the source surface
+
+		// not on the screen.  dont render
+		if (rect.right() < 0 || rect.x > static_cast<int32_t>(target->w) ||
+			rect.bottom() < 0 || rect.y > static_cast<int32_t>(target->h)) {
+			return false;
+		}
+		touch();
+		if (m_shared) {
+			m_shared_img->touch();
+		}
+		if (!m_texId) {
+			generateGLTexture();
+		} else if (m_shared) {
+			validateShared();
+		}
+		return true;
+	}
+
 	void GLImage::generateGLTexture() {
 		if (m_shared) {
 			// First make sure we loaded big image to opengl
@@ -495,6 +585,7 @@ namespace FIFE {
 		m_surface = m_shared_img->m_surface;
 		m_compressed = m_shared_img->m_compressed;
 		m_atlas_name = m_shared_img->getName();
+		resetAlphaMask();
 
 		if(m_texId) {
 			generateGLSharedTexture(img, region);
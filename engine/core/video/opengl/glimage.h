@@ -23,6 +23,7 @@
 #define FIFE_VIDEO_RENDERBACKENDS_OPENGL_GLIMAGE_H
 
 // Standard C++ library includes
+#include <map>
 #include <vector>
 
 // Platform specific includes
@@ -35,6 +36,7 @@
 // These includes are split up in two parts, separated by one empty line
 // First block: files included from the FIFE root src directory
 // Second block: files included from the same folder
+#include "video/color.h"
 #include "video/image.h"
 
 #include "fife_opengl.h"
@@ -70,11 +72,24 @@ namespace FIFE {
 		virtual void renderZ(const Rect& rect, float vertexZ, uint8_t alpha = 255, uint8_t const* rgb = 0);
 		virtual void renderZ(const Rect& rect, float vertexZ, const ImagePtr& overlay, uint8_t alpha = 255, uint8_t const* rgb = 0);
 
+		/** Renders the outline of the image with the outline shader.
+		 * @see RenderBackendOpenGL::addOutlineToArray
+		 */
+		void renderOutline(const Rect& rect, uint8_t alpha, uint8_t const* rgb, int32_t width, int32_t threshold);
+		void renderOutlineZ(const Rect& rect, float vertexZ, uint8_t alpha, uint8_t const* rgb, int32_t width, int32_t threshold);
+
+		/** Renders the image with an overlay that is recolored by the color table shader.
+		 * @see RenderBackendOpenGL::addColorTableToArray
+		 */
+		void renderColorTable(const Rect& rect, const ImagePtr& overlay, const std::map<Color, Color>& colors, uint8_t alpha, uint8_t const* factor);
+		void renderColorTableZ(const Rect& rect, float vertexZ, const ImagePtr& overlay, const std::map<Color, Color>& colors, uint8_t alpha, uint8_t const* factor);
+
 		virtual void useSharedImage(const ImagePtr& shared, const Rect& region);
 		virtual void forceLoadInternal();
 		virtual void copySubimage(uint32_t xoffset, uint32_t yoffset, const ImagePtr& img);
 		virtual void load();
 		virtual void free();
+		virtual size_t getSize();
 
 		GLuint getTexId() const;
 		const GLfloat* getTexCoords() const;
@@ -108,6 +123,11 @@ namespace FIFE {
 		 */
 		void cleanup();
 
+		/** Makes the texture available for rendering into the rectangle.
+		 * Returns false if the rectangle is transparent or outside of the render target.
+		 */
+		bool prepareRender(const Rect& rect, uint8_t alpha);
+
 		/** Resets GLImage variables
 		 */
 		void resetGlimage();
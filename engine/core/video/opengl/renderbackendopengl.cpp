@@ -20,6 +20,10 @@
  ***************************************************************************/
 
 // Standard C++ library includes
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <sstream>
 
 // Platform specific includes
 
@@ -29,6 +33,7 @@
 // FIFE includes
 #include "util/base/exception.h"
 #include "util/log/logger.h"
+#include "util/math/fife_math.h"
 #include "video/devicecaps.h"
 
 #include "glimage.h"
@@ -42,6 +47,108 @@ namespace FIFE {
 	 */
 	static Logger _log(LM_VIDEO);
 
+	// number of segments of the persistently mapped stream buffer
+	static const uint32_t STREAM_SEGMENTS = 3;
+	// minimal size of a stream buffer segment, the orphaned buffer uses the size of all segments
+	static const uint32_t STREAM_SEGMENT_SIZE = 1024 * 1024;
+	// maximal number of submissions per frame that can reuse a retained buffer
+	static const uint32_t MAX_RETAINED_BUFFERS = 64;
+	// alignment of the vertex arrays inside a buffer
+	static const uint32_t VERTEX_ALIGNMENT = 16;
+	// marks a pointer state as unknown, e.g. after the array buffer changed
+	static const GLvoid* const INVALID_POINTER = reinterpret_cast<const GLvoid*>(~static_cast<uintptr_t>(0));
+
+	// fragment shader of OVERLAY_TYPE_OUTLINE, marks the same pixels as markOutline()
+	// without partial leading runs being dropped, MAX_WIDTH is defined in initShaders()
+	static const char* const OUTLINE_SHADER =
+		"uniform sampler2D source;\n"
+		"uniform vec4 bounds;\n"
+		"uniform vec2 texel;\n"
+		"uniform vec4 color;\n"
+		"// x: outline width, y: alpha threshold, z: 0 no edges, 1 threshold edges, 2 transparent edges\n"
+		"uniform ivec3 params;\n"
+		"\n"
+		"// alpha of an image pixel as byte value, pixels left and above of the image are transparent\n"
+		"float alphaAt(vec2 p) {\n"
+		"	if (p.x < 0.0 || p.y < 0.0) {\n"
+		"		return 0.0;\n"
+		"	}\n"
+		"	return floor(texture2D(source, bounds.xy + (p + 0.5) * texel).a * 255.0 + 0.5);\n"
+		"}\n"
+		"\n"
+		"bool isEdge(float a, float prev) {\n"
+		"	if (a == prev) {\n"
+		"		return false;\n"
+		"	}\n"
+		"	if (params.z == 1) {\n"
+		"		return a >= float(params.y) || prev >= float(params.y);\n"
+		"	}\n"
+		"	return params.z == 2 && (a == 0.0 || prev == 0.0);\n"
+		"}\n"
+		"\n"
+		"// edge between p - dir and p, the alpha falls or rises towards p\n"
+		"bool hasEdge(vec2 p, vec2 dir, bool falling) {\n"
+		"	float a = alphaAt(p);\n"
+		"	float prev = alphaAt(p - dir);\n"
+		"	return (falling ? a < prev : a > prev) && isEdge(a, prev);\n"
+		"}\n"
+		"\n"
+		"void main() {\n"
+		"	vec2 size = floor((bounds.zw - bounds.xy) / texel + 0.5);\n"
+		"	vec2 p = clamp(floor((gl_TexCoord[0].st - bounds.xy) / texel), vec2(0.0), size - 1.0);\n"
+		"	bool marked = false;\n"
+		"	// a falling edge marks itself and the next width - 1 pixels, a rising edge the width pixels before it\n"
+		"	for (int k = 0; k <= MAX_WIDTH; ++k) {\n"
+		"		if (k > params.x || marked) {\n"
+		"			break;\n"
+		"		}\n"
+		"		float d = float(k);\n"
+		"		if (k < params.x) {\n"
+		"			marked = (p.x >= d && hasEdge(p - vec2(d, 0.0), vec2(1.0, 0.0), true)) ||\n"
+		"				(p.y >= d && hasEdge(p - vec2(0.0, d), vec2(0.0, 1.0), true));\n"
+		"		}\n"
+		"		if (k > 0 && !marked) {\n"
+		"			marked = (p.x + d < size.x && hasEdge(p + vec2(d, 0.0), vec2(1.0, 0.0), false)) ||\n"
+		"				(p.y + d < size.y && hasEdge(p + vec2(0.0, d), vec2(0.0, 1.0), false));\n"
+		"		}\n"
+		"	}\n"
+		"	gl_FragColor = marked ? vec4(color.rgb, 1.0) * gl_Color : vec4(0.0);\n"
+		"}\n";
+
+	// fragment shader of OVERLAY_TYPE_COLOR_TABLE, recolors the overlay and combines it
+	// like the texture environment of OVERLAY_TYPE_TEXTURES_AND_FACTOR, MAX_ENTRIES is defined in initShaders()
+	static const char* const COLOR_TABLE_SHADER =
+		"uniform sampler2D source;\n"
+		"uniform sampler2D overlay;\n"
+		"uniform vec4 color;\n"
+		"// x: number of entries\n"
+		"uniform ivec3 params;\n"
+		"uniform vec4 from[MAX_ENTRIES];\n"
+		"uniform vec4 to[MAX_ENTRIES];\n"
+		"\n"
+		"void main() {\n"
+		"	vec4 base = texture2D(source, gl_TexCoord[0].st);\n"
+		"	vec4 over = texture2D(overlay, gl_TexCoord[3].st);\n"
+		"	for (int i = 0; i < MAX_ENTRIES; ++i) {\n"
+		"		if (i >= params.x) {\n"
+		"			break;\n"
+		"		}\n"
+		"		if (all(lessThan(abs(over - from[i]), vec4(0.5 / 255.0)))) {\n"
+		"			over = to[i];\n"
+		"			break;\n"
+		"		}\n"
+		"	}\n"
+		"	gl_FragColor = vec4(mix(over.rgb, base.rgb, color.a), over.a * base.a * gl_Color.a);\n"
+		"}\n";
+
+	static inline uint32_t alignVertexBytes(uint32_t bytes) {
+		return (bytes + VERTEX_ALIGNMENT - 1) & ~(VERTEX_ALIGNMENT - 1);
+	}
+
+	static inline const uint8_t* bufferOffset(uint32_t offset) {
+		return reinterpret_cast<const uint8_t*>(static_cast<uintptr_t>(offset));
+	}
+
 	class RenderBackendOpenGL::RenderObject {
 	public:
 		RenderObject(GLenum m, uint16_t s, uint32_t t1=0, uint32_t t2=0):
@@ -57,7 +164,8 @@ namespace FIFE {
 			overlay_type(OVERLAY_TYPE_NONE),
 			stencil_ref(0),
 			stencil_op(0),
-			stencil_func(0) {}
+			stencil_func(0),
+			effect(-1) {}
 
 		GLenum mode;
 		uint16_t size;
@@ -73,10 +181,20 @@ namespace FIFE {
 		GLenum stencil_op;
 		GLenum stencil_func;
 		uint8_t rgba[4];
+		// index of the shader uniforms in m_effects or -1
+		int32_t effect;
 	};
 
 	RenderBackendOpenGL::RenderBackendOpenGL(const SDL_Color& colorkey)
-		: RenderBackend(colorkey), m_maskOverlay(0){
+		: RenderBackend(colorkey), m_maskOverlay(0),
+		m_arrayBuffer(0),
+		m_streamBuffer(0),
+		m_streamSize(0),
+		m_streamOffset(0),
+		m_streamMapping(NULL),
+		m_persistentMapping(true),
+		m_streamSegment(0),
+		m_retainedSlot(0) {
 
 		m_state.tex_enabled[0] = false;
 		m_state.tex_enabled[1] = false;
@@ -115,10 +233,20 @@ namespace FIFE {
 		m_state.scissor_test = true;
 		m_state.depth_enabled = true;
 		m_state.color_enabled = true;
+		m_state.program = 0;
+
+		std::memset(&m_outlineProgram, 0, sizeof(m_outlineProgram));
+		std::memset(&m_colorTableProgram, 0, sizeof(m_colorTableProgram));
+
+		for (uint32_t i = 0; i < STREAM_SEGMENTS; ++i) {
+			m_streamFences[i] = 0;
+		}
 	}
 
 	RenderBackendOpenGL::~RenderBackendOpenGL() {
 		glDeleteTextures(1, &m_maskOverlay);
+		deinitVertexBuffers();
+		deinitShaders();
 		if(GLEW_EXT_framebuffer_object && m_useframebuffer) {
 			glDeleteFramebuffers(1, &m_fbo_id);
 		}
@@ -317,6 +445,9 @@ namespace FIFE {
 		// sync swaping with refresh rate if VSync is enabled
 		SDL_GL_SetSwapInterval(static_cast<uint8_t>(m_vSync));
 
+		initVertexBuffers();
+		initShaders();
+
 		// currently unused, 1000 objects x 400 textures x 4 renderDataZ
 		//m_renderZ_datas.resize(1600000);
 
@@ -343,6 +474,7 @@ namespace FIFE {
 
 	void RenderBackendOpenGL::startFrame() {
 		RenderBackend::startFrame();
+		m_retainedSlot = 0;
 	}
 
 	void RenderBackendOpenGL::endFrame() {
@@ -503,6 +635,7 @@ namespace FIFE {
 			}
 			m_state.texture[texUnit] = texId;
 			glBindTexture(GL_TEXTURE_2D, texId);
+			++m_textureBinds;
 		}
 	}
 
@@ -510,6 +643,7 @@ namespace FIFE {
 		if(m_state.texture[m_state.active_tex] != texId) {
 			m_state.texture[m_state.active_tex] = texId;
 			glBindTexture(GL_TEXTURE_2D, texId);
+			++m_textureBinds;
 		}
 	}
 
@@ -684,6 +818,397 @@ namespace FIFE {
 		}
 	}
 
+	void RenderBackendOpenGL::bindArrayBuffer(GLuint id) {
+		if (m_arrayBuffer != id) {
+			m_arrayBuffer = id;
+			glBindBuffer(GL_ARRAY_BUFFER, id);
+			// pointers are bound to the buffer that was active when they were set
+			invalidatePointers();
+		}
+	}
+
+	void RenderBackendOpenGL::invalidatePointers() {
+		m_state.vertex_pointer = INVALID_POINTER;
+		m_state.color_pointer = INVALID_POINTER;
+		m_state.tex_pointer[0] = INVALID_POINTER;
+		m_state.tex_pointer[1] = INVALID_POINTER;
+		m_state.tex_pointer[2] = INVALID_POINTER;
+		m_state.tex_pointer[3] = INVALID_POINTER;
+	}
+
+	void RenderBackendOpenGL::initVertexBuffers() {
+		if (!m_usevbo || m_streamBuffer != 0) {
+			return;
+		}
+		if (!GLEW_VERSION_1_5 && !GLEW_ARB_vertex_buffer_object) {
+			FL_LOG(_log, LMsg("RenderBackendOpenGL") << "Vertex buffer objects are not supported, using client side arrays.");
+			m_usevbo = false;
+			return;
+		}
+		createStreamBuffer(0);
+		FL_LOG(_log, LMsg("RenderBackendOpenGL") << "Streaming vertex data through "
+			<< (m_streamMapping ? "a persistently mapped" : "an orphaned") << " vertex buffer of " << m_streamSize << " bytes");
+	}
+
+	void RenderBackendOpenGL::deinitVertexBuffers() {
+		releaseStreamBuffer();
+		std::vector<RetainedBuffer>::iterator it = m_retainedBuffers.begin();
+		for (; it != m_retainedBuffers.end(); ++it) {
+			if (it->id) {
+				glDeleteBuffers(1, &it->id);
+			}
+		}
+		m_retainedBuffers.clear();
+	}
+
+	void RenderBackendOpenGL::initShaders() {
+		if (!m_useshaders || m_outlineProgram.program != 0) {
+			return;
+		}
+		if (!GLEW_VERSION_2_0) {
+			FL_LOG(_log, LMsg("RenderBackendOpenGL") << "Shaders are not supported, outlines and color overlays use images.");
+			return;
+		}
+		if (m_compressimages) {
+			// the shaders compare exact alpha values and colors
+			FL_LOG(_log, LMsg("RenderBackendOpenGL") << "Shaders are not used together with compressed images.");
+			return;
+		}
+		if (m_isMipmapping) {
+			// the shaders read single texels, minified textures would be sampled from the averaged levels
+			FL_LOG(_log, LMsg("RenderBackendOpenGL") << "Shaders are not used together with mipmapping.");
+			return;
+		}
+
+		std::ostringstream outline;
+		outline << "#version 110\n#define MAX_WIDTH " << MAX_SHADER_OUTLINE_WIDTH << "\n" << OUTLINE_SHADER;
+		std::ostringstream colorTable;
+		colorTable << "#version 110\n#define MAX_ENTRIES " << MAX_SHADER_COLOR_ENTRIES << "\n" << COLOR_TABLE_SHADER;
+		if (!createEffectProgram(outline.str(), m_outlineProgram) ||
+			!createEffectProgram(colorTable.str(), m_colorTableProgram)) {
+			FL_WARN(_log, LMsg("RenderBackendOpenGL") << "Shaders could not be created, outlines and color overlays use images.");
+			deinitShaders();
+			return;
+		}
+		FL_LOG(_log, LMsg("RenderBackendOpenGL") << "Rendering outlines and color overlays with shaders");
+	}
+
+	void RenderBackendOpenGL::deinitShaders() {
+		useProgram(0);
+		if (m_outlineProgram.program != 0) {
+			glDeleteProgram(m_outlineProgram.program);
+		}
+		if (m_colorTableProgram.program != 0) {
+			glDeleteProgram(m_colorTableProgram.program);
+		}
+		std::memset(&m_outlineProgram, 0, sizeof(m_outlineProgram));
+		std::memset(&m_colorTableProgram, 0, sizeof(m_colorTableProgram));
+	}
+
+	bool RenderBackendOpenGL::createEffectProgram(const std::string& source, EffectProgram& program) {
+		const GLchar* text = source.c_str();
+		GLuint shader = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(shader, 1, &text, NULL);
+		glCompileShader(shader);
+
+		GLint status = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (status != GL_TRUE) {
+			GLchar log[1024];
+			glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+			FL_WARN(_log, LMsg("RenderBackendOpenGL") << "Compiling shader failed: " << log);
+			glDeleteShader(shader);
+			return false;
+		}
+
+		program.program = glCreateProgram();
+		glAttachShader(program.program, shader);
+		glLinkProgram(program.program);
+		// the program keeps the shader alive
+		glDeleteShader(shader);
+		glGetProgramiv(program.program, GL_LINK_STATUS, &status);
+		if (status != GL_TRUE) {
+			GLchar log[1024];
+			glGetProgramInfoLog(program.program, sizeof(log), NULL, log);
+			FL_WARN(_log, LMsg("RenderBackendOpenGL") << "Linking shader failed: " << log);
+			return false;
+		}
+
+		program.source = glGetUniformLocation(program.program, "source");
+		program.overlay = glGetUniformLocation(program.program, "overlay");
+		program.bounds = glGetUniformLocation(program.program, "bounds");
+		program.texel = glGetUniformLocation(program.program, "texel");
+		program.color = glGetUniformLocation(program.program, "color");
+		program.params = glGetUniformLocation(program.program, "params");
+		program.from = glGetUniformLocation(program.program, "from");
+		program.to = glGetUniformLocation(program.program, "to");
+
+		// the samplers never change, image on unit 0 and overlay on unit 3
+		useProgram(program.program);
+		glUniform1i(program.source, 0);
+		glUniform1i(program.overlay, 3);
+		useProgram(0);
+		return true;
+	}
+
+	void RenderBackendOpenGL::useProgram(GLuint program) {
+		if (m_state.program != program) {
+			m_state.program = program;
+			glUseProgram(program);
+		}
+	}
+
+	void RenderBackendOpenGL::useEffect(OverlayType type, int32_t effect) {
+		const EffectProgram& program = type == OVERLAY_TYPE_OUTLINE ? m_outlineProgram : m_colorTableProgram;
+		const EffectData& data = m_effects[effect];
+		useProgram(program.program);
+		// unused uniforms have location -1 and are ignored
+		glUniform4fv(program.bounds, 1, data.bounds);
+		glUniform2fv(program.texel, 1, data.texel);
+		glUniform4fv(program.color, 1, data.color);
+		glUniform3iv(program.params, 1, data.params);
+		if (type == OVERLAY_TYPE_COLOR_TABLE && data.params[0] > 0) {
+			glUniform4fv(program.from, data.params[0], data.from);
+			glUniform4fv(program.to, data.params[0], data.to);
+		}
+	}
+
+	int32_t RenderBackendOpenGL::addEffect(const EffectData& data) {
+		// consecutive draws with the same uniforms are batched
+		if (!m_effects.empty() && std::memcmp(&m_effects.back(), &data, sizeof(EffectData)) == 0) {
+			return static_cast<int32_t>(m_effects.size()) - 1;
+		}
+		m_effects.push_back(data);
+		return static_cast<int32_t>(m_effects.size()) - 1;
+	}
+
+	int32_t RenderBackendOpenGL::addOutlineEffect(float const* st, uint32_t width, uint32_t height, uint8_t const* rgb, int32_t outlineWidth, int32_t threshold) {
+		EffectData data;
+		std::memset(&data, 0, sizeof(EffectData));
+		for (uint32_t i = 0; i < 4; ++i) {
+			data.bounds[i] = st[i];
+		}
+		data.texel[0] = (st[2] - st[0]) / static_cast<float>(std::max(width, 1U));
+		data.texel[1] = (st[3] - st[1]) / static_cast<float>(std::max(height, 1U));
+		data.color[0] = rgb[0] / 255.0f;
+		data.color[1] = rgb[1] / 255.0f;
+		data.color[2] = rgb[2] / 255.0f;
+		data.color[3] = 1.0f;
+		data.params[0] = outlineWidth;
+		data.params[1] = threshold;
+		// same edge modes as markOutline()
+		if (threshold > 255 || width == 0 || height == 0) {
+			data.params[2] = 0;
+		} else if (threshold > 1) {
+			data.params[2] = 1;
+		} else {
+			data.params[2] = 2;
+		}
+		return addEffect(data);
+	}
+
+	int32_t RenderBackendOpenGL::addColorTableEffect(uint8_t const* factor, const std::map<Color, Color>& colors) {
+		EffectData data;
+		std::memset(&data, 0, sizeof(EffectData));
+		data.color[3] = factor[3] / 255.0f;
+		uint32_t entries = 0;
+		std::map<Color, Color>::const_iterator it = colors.begin();
+		for (; it != colors.end() && entries < MAX_SHADER_COLOR_ENTRIES; ++it, ++entries) {
+			GLfloat* from = &data.from[entries * 4];
+			from[0] = it->first.getR() / 255.0f;
+			from[1] = it->first.getG() / 255.0f;
+			from[2] = it->first.getB() / 255.0f;
+			from[3] = it->first.getAlpha() / 255.0f;
+			GLfloat* to = &data.to[entries * 4];
+			to[0] = it->second.getR() / 255.0f;
+			to[1] = it->second.getG() / 255.0f;
+			to[2] = it->second.getB() / 255.0f;
+			to[3] = it->second.getAlpha() / 255.0f;
+		}
+		data.params[0] = static_cast<GLint>(entries);
+		return addEffect(data);
+	}
+
+	void RenderBackendOpenGL::releaseStreamBuffer() {
+		bindArrayBuffer(0);
+		for (uint32_t i = 0; i < STREAM_SEGMENTS; ++i) {
+			if (m_streamFences[i]) {
+				glDeleteSync(m_streamFences[i]);
+				m_streamFences[i] = 0;
+			}
+		}
+		if (m_streamBuffer) {
+			if (m_streamMapping) {
+				glBindBuffer(GL_ARRAY_BUFFER, m_streamBuffer);
+				glUnmapBuffer(GL_ARRAY_BUFFER);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				m_streamMapping = NULL;
+			}
+			glDeleteBuffers(1, &m_streamBuffer);
+			m_streamBuffer = 0;
+		}
+	}
+
+	void RenderBackendOpenGL::createStreamBuffer(uint32_t bytes) {
+		const bool persistent = m_persistentMapping && GLEW_ARB_buffer_storage && GLEW_ARB_sync;
+		// with segments a single submission has to fit into one segment
+		uint32_t segment = nextPow2(std::max(bytes, STREAM_SEGMENT_SIZE));
+
+		// release the old buffer, pending draws keep its storage alive
+		releaseStreamBuffer();
+		glGenBuffers(1, &m_streamBuffer);
+		bindArrayBuffer(m_streamBuffer);
+		m_streamOffset = 0;
+		m_streamSegment = 0;
+		m_streamSize = segment * STREAM_SEGMENTS;
+		if (persistent) {
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_ARRAY_BUFFER, m_streamSize, NULL, flags);
+			m_streamMapping = static_cast<uint8_t*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, m_streamSize, flags));
+		}
+		if (!m_streamMapping) {
+			if (persistent) {
+				// mapping failed, start over with a mutable buffer
+				bindArrayBuffer(0);
+				glDeleteBuffers(1, &m_streamBuffer);
+				glGenBuffers(1, &m_streamBuffer);
+				bindArrayBuffer(m_streamBuffer);
+			}
+			glBufferData(GL_ARRAY_BUFFER, m_streamSize, NULL, GL_STREAM_DRAW);
+		}
+	}
+
+	void RenderBackendOpenGL::reserveStreamRegion(uint32_t bytes) {
+		if (m_streamMapping) {
+			const uint32_t segment = m_streamSize / STREAM_SEGMENTS;
+			if (bytes > segment) {
+				createStreamBuffer(bytes);
+				return;
+			}
+			if (m_streamOffset + bytes > (m_streamSegment + 1) * segment) {
+				// leave the current segment and wait until the gpu is done with the next one
+				m_streamFences[m_streamSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+				m_streamSegment = (m_streamSegment + 1) % STREAM_SEGMENTS;
+				GLsync& fence = m_streamFences[m_streamSegment];
+				if (fence) {
+					while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+					}
+					glDeleteSync(fence);
+					fence = 0;
+				}
+				m_streamOffset = m_streamSegment * segment;
+			}
+		} else {
+			if (bytes > m_streamSize) {
+				createStreamBuffer(bytes);
+				return;
+			}
+			if (m_streamOffset + bytes > m_streamSize) {
+				// orphan the storage, the driver keeps the old one alive for pending draws
+				bindArrayBuffer(m_streamBuffer);
+				glBufferData(GL_ARRAY_BUFFER, m_streamSize, NULL, GL_STREAM_DRAW);
+				m_streamOffset = 0;
+			}
+		}
+	}
+
+	void RenderBackendOpenGL::uploadStreamData(const VertexSource* sources, uint32_t count, uint32_t total, const uint8_t** bases) {
+		reserveStreamRegion(total);
+		bindArrayBuffer(m_streamBuffer);
+		uint32_t offset = m_streamOffset;
+		for (uint32_t i = 0; i < count; ++i) {
+			bases[i] = bufferOffset(offset);
+			if (sources[i].bytes > 0) {
+				if (m_streamMapping) {
+					memcpy(m_streamMapping + offset, sources[i].data, sources[i].bytes);
+				} else {
+					glBufferSubData(GL_ARRAY_BUFFER, offset, sources[i].bytes, sources[i].data);
+				}
+			}
+			offset += alignVertexBytes(sources[i].bytes);
+		}
+		m_streamOffset = offset;
+		m_uploadedBytes += total;
+	}
+
+	void RenderBackendOpenGL::submitVertexData(const VertexSource* sources, uint32_t count, const uint8_t** bases) {
+		uint32_t total = 0;
+		for (uint32_t i = 0; i < count; ++i) {
+			total += alignVertexBytes(sources[i].bytes);
+		}
+
+		if (!m_usevbo || m_streamBuffer == 0 || total == 0) {
+			bindArrayBuffer(0);
+			for (uint32_t i = 0; i < count; ++i) {
+				bases[i] = static_cast<const uint8_t*>(sources[i].data);
+				m_uploadedBytes += sources[i].bytes;
+			}
+			return;
+		}
+
+		// render target passes, e.g. of static layer tiles, are only redrawn if their
+		// content changed, so they are streamed and don't shift the screen submissions
+		if (m_target == m_screen && m_retainedSlot < MAX_RETAINED_BUFFERS) {
+			while (m_retainedSlot >= m_retainedBuffers.size()) {
+				RetainedBuffer retained;
+				retained.id = 0;
+				retained.uploaded = false;
+				retained.changed = false;
+				m_retainedBuffers.push_back(retained);
+			}
+			RetainedBuffer& retained = m_retainedBuffers[m_retainedSlot++];
+
+			// same data as in the previous frame?
+			bool same = retained.shadow.size() == total;
+			uint32_t offset = 0;
+			for (uint32_t i = 0; same && i < count; ++i) {
+				same = sources[i].bytes == 0 || memcmp(&retained.shadow[offset], sources[i].data, sources[i].bytes) == 0;
+				offset += alignVertexBytes(sources[i].bytes);
+			}
+
+			if (!same) {
+				// remember the data for the comparison in the next frame
+				retained.shadow.assign(total, 0);
+				offset = 0;
+				for (uint32_t i = 0; i < count; ++i) {
+					if (sources[i].bytes > 0) {
+						memcpy(&retained.shadow[offset], sources[i].data, sources[i].bytes);
+					}
+					offset += alignVertexBytes(sources[i].bytes);
+				}
+				retained.uploaded = false;
+				if (retained.changed) {
+					// changed in consecutive frames, streamed until it stays the same
+					uploadStreamData(sources, count, total, bases);
+					return;
+				}
+				// first change after stable data, retained right away
+				retained.changed = true;
+			} else {
+				retained.changed = false;
+			}
+
+			if (!retained.uploaded) {
+				if (!retained.id) {
+					glGenBuffers(1, &retained.id);
+				}
+				bindArrayBuffer(retained.id);
+				glBufferData(GL_ARRAY_BUFFER, total, &retained.shadow[0], GL_STATIC_DRAW);
+				retained.uploaded = true;
+				m_uploadedBytes += total;
+			}
+			bindArrayBuffer(retained.id);
+			offset = 0;
+			for (uint32_t i = 0; i < count; ++i) {
+				bases[i] = bufferOffset(offset);
+				offset += alignVertexBytes(sources[i].bytes);
+			}
+			return;
+		}
+
+		uploadStreamData(sources, count, total, bases);
+	}
+
 	void RenderBackendOpenGL::enableScissorTest() {
 		if(m_state.scissor_test == false) {
 			m_state.scissor_test = true;
@@ -812,6 +1337,8 @@ namespace FIFE {
 		OverlayType overlay_type = OVERLAY_TYPE_NONE;
 		// overlay color
 		uint8_t rgba[4] = {0};
+		// shader uniforms
+		int32_t effect = -1;
 
 		// array indices
 		int32_t indexP = 0;
@@ -836,6 +1363,20 @@ namespace FIFE {
 		const uint32_t strideTC = sizeof(renderDataTC);
 		const uint32_t stride2TC = sizeof(renderData2TC);
 
+		// make the vertex data available, as client arrays or in a vertex buffer
+		const VertexSource sources[] = {
+			{ m_renderPrimitiveDatas.data(), static_cast<uint32_t>(m_renderPrimitiveDatas.size() * strideP) },
+			{ m_renderTextureDatas.data(), static_cast<uint32_t>(m_renderTextureDatas.size() * strideT) },
+			{ m_renderTextureColorDatas.data(), static_cast<uint32_t>(m_renderTextureColorDatas.size() * strideTC) },
+			{ m_renderMultitextureDatas.data(), static_cast<uint32_t>(m_renderMultitextureDatas.size() * stride2TC) }
+		};
+		const uint8_t* bases[4];
+		submitVertexData(sources, 4, bases);
+		const uint8_t* baseP = bases[0];
+		const uint8_t* baseT = bases[1];
+		const uint8_t* baseTC = bases[2];
+		const uint8_t* base2TC = bases[3];
+
 		// disable alpha and depth tests
 		disableAlphaTest();
 		disableDepthTest();
@@ -845,8 +1386,8 @@ namespace FIFE {
 			if (!m_renderObjects[0].color) {
 				// set pointer
 				disableColorArray();
-				setVertexPointer(2, strideT, &m_renderTextureDatas[0].vertex);
-				setTexCoordPointer(0, strideT, &m_renderTextureDatas[0].texel);
+				setVertexPointer(2, strideT, baseT + offsetof(renderDataT, vertex));
+				setTexCoordPointer(0, strideT, baseT + offsetof(renderDataT, texel));
 				indexBuffer = &m_tIndices[0];
 				currentIndex = &indexT;
 				currentElements = &elementsT;
@@ -854,9 +1395,9 @@ namespace FIFE {
 			} else if (m_renderObjects[0].texture_id != 0){
 				// set pointer
 				enableColorArray();
-				setVertexPointer(2, strideTC, &m_renderTextureColorDatas[0].vertex);
-				setTexCoordPointer(0, strideTC, &m_renderTextureColorDatas[0].texel);
-				setColorPointer(strideTC, &m_renderTextureColorDatas[0].color);
+				setVertexPointer(2, strideTC, baseTC + offsetof(renderDataTC, vertex));
+				setTexCoordPointer(0, strideTC, baseTC + offsetof(renderDataTC, texel));
+				setColorPointer(strideTC, baseTC + offsetof(renderDataTC, color));
 				indexBuffer = &m_tcIndices[0];
 				currentIndex = &indexTC;
 				currentElements = &elementsTC;
@@ -864,8 +1405,8 @@ namespace FIFE {
 			} else {
 				// set pointer
 				enableColorArray();
-				setVertexPointer(2, strideP, &m_renderPrimitiveDatas[0].vertex);
-				setColorPointer(strideP, &m_renderPrimitiveDatas[0].color);
+				setVertexPointer(2, strideP, baseP + offsetof(renderDataP, vertex));
+				setColorPointer(strideP, baseP + offsetof(renderDataP, color));
 				indexBuffer = &m_pIndices[0];
 				currentIndex = &indexP;
 				currentElements = &elementsP;
@@ -873,9 +1414,9 @@ namespace FIFE {
 		// multitexture overlay
 		} else {
 			// set pointer
-			setVertexPointer(2, stride2TC, &m_renderMultitextureDatas[0].vertex);
-			setColorPointer(stride2TC, &m_renderMultitextureDatas[0].color);
-			setTexCoordPointer(0, stride2TC, &m_renderMultitextureDatas[0].texel);
+			setVertexPointer(2, stride2TC, base2TC + offsetof(renderData2TC, vertex));
+			setColorPointer(stride2TC, base2TC + offsetof(renderData2TC, color));
+			setTexCoordPointer(0, stride2TC, base2TC + offsetof(renderData2TC, texel));
 			indexBuffer = &m_tc2Indices[0];
 			currentIndex = &index2TC;
 			currentElements = &elements2TC;
@@ -900,7 +1441,7 @@ namespace FIFE {
 				color = true;
 				render = true;
 			}
-			if (ro.overlay_type != overlay_type || 
+			if (ro.overlay_type != overlay_type || ro.effect != effect ||
 				(ro.overlay_type != OVERLAY_TYPE_NONE && (memcmp(rgba, ro.rgba, sizeof(uint8_t) * 4) || ro.overlay_id != texture_id2))) {
 				mt = true;
 				render = true;
@@ -932,6 +1473,7 @@ namespace FIFE {
 				if (*currentElements > 0) {
 					//render
 					glDrawElements(mode, *currentElements, GL_UNSIGNED_INT, indexBuffer + *currentIndex);
+					++m_drawCalls;
 					*currentIndex += *currentElements;
 				}
 				// switch mode
@@ -945,15 +1487,15 @@ namespace FIFE {
 						enableColorArray();
 						if (ro.overlay_type == OVERLAY_TYPE_NONE) {
 							if (ro.texture_id != 0) {
-								setVertexPointer(2, strideTC, &m_renderTextureColorDatas[0].vertex);
-								setTexCoordPointer(0, strideTC, &m_renderTextureColorDatas[0].texel);
-								setColorPointer(strideTC, &m_renderTextureColorDatas[0].color);
+								setVertexPointer(2, strideTC, baseTC + offsetof(renderDataTC, vertex));
+								setTexCoordPointer(0, strideTC, baseTC + offsetof(renderDataTC, texel));
+								setColorPointer(strideTC, baseTC + offsetof(renderDataTC, color));
 								indexBuffer = &m_tcIndices[0];
 								currentElements = &elementsTC;
 								currentIndex = &indexTC;
 							} else {
-								setVertexPointer(2, strideP, &m_renderPrimitiveDatas[0].vertex);
-								setColorPointer(strideP, &m_renderPrimitiveDatas[0].color);
+								setVertexPointer(2, strideP, baseP + offsetof(renderDataP, vertex));
+								setColorPointer(strideP, baseP + offsetof(renderDataP, color));
 								indexBuffer = &m_pIndices[0];
 								currentElements = &elementsP;
 								currentIndex = &indexP;
@@ -962,8 +1504,8 @@ namespace FIFE {
 					} else if (!ro.color && m_state.color_enabled) {
 						disableColorArray();
 						if (ro.overlay_type == OVERLAY_TYPE_NONE) {
-							setVertexPointer(2, strideT, &m_renderTextureDatas[0].vertex);
-							setTexCoordPointer(0, strideT, &m_renderTextureDatas[0].texel);
+							setVertexPointer(2, strideT, baseT + offsetof(renderDataT, vertex));
+							setTexCoordPointer(0, strideT, baseT + offsetof(renderDataT, texel));
 							indexBuffer = &m_tIndices[0];
 							currentElements = &elementsT;
 							currentIndex = &indexT;
@@ -973,6 +1515,10 @@ namespace FIFE {
 				}
 				// multitexturing
 				if (mt) {
+					// outlines and color tables use a shader, the rest the texture environment
+					if (ro.effect == -1) {
+						useProgram(0);
+					}
 					switch (ro.overlay_type) {
 					case OVERLAY_TYPE_NONE:
 						disableTextures(3);
@@ -982,22 +1528,22 @@ namespace FIFE {
 						if (ro.texture_id != 0) {
 							enableTextures(0);
 							if (m_state.color_enabled) {
-								setVertexPointer(2, strideTC, &m_renderTextureColorDatas[0].vertex);
-								setTexCoordPointer(0, strideTC, &m_renderTextureColorDatas[0].texel);
-								setColorPointer(strideTC, &m_renderTextureColorDatas[0].color);
+								setVertexPointer(2, strideTC, baseTC + offsetof(renderDataTC, vertex));
+								setTexCoordPointer(0, strideTC, baseTC + offsetof(renderDataTC, texel));
+								setColorPointer(strideTC, baseTC + offsetof(renderDataTC, color));
 								indexBuffer = &m_tcIndices[0];
 								currentElements = &elementsTC;
 								currentIndex = &indexTC;
 							} else {
-								setVertexPointer(2, strideT, &m_renderTextureDatas[0].vertex);
-								setTexCoordPointer(0, strideT, &m_renderTextureDatas[0].texel);
+								setVertexPointer(2, strideT, baseT + offsetof(renderDataT, vertex));
+								setTexCoordPointer(0, strideT, baseT + offsetof(renderDataT, texel));
 								indexBuffer = &m_tIndices[0];
 								currentIndex = &indexT;
 								currentElements = &elementsT;
 							}
 						} else {
-							setVertexPointer(2, strideP, &m_renderPrimitiveDatas[0].vertex);
-							setColorPointer(strideP, &m_renderPrimitiveDatas[0].color);
+							setVertexPointer(2, strideP, baseP + offsetof(renderDataP, vertex));
+							setColorPointer(strideP, baseP + offsetof(renderDataP, color));
 							indexBuffer = &m_pIndices[0];
 							currentElements = &elementsP;
 							currentIndex = &indexP;
@@ -1012,10 +1558,10 @@ namespace FIFE {
 						enableTextures(0);
 
 						// set pointer
-						setVertexPointer(2, stride2TC, &m_renderMultitextureDatas[0].vertex);
-						setColorPointer(stride2TC, &m_renderMultitextureDatas[0].color);
-						setTexCoordPointer(1, stride2TC, &m_renderMultitextureDatas[0].texel2);
-						setTexCoordPointer(0, stride2TC, &m_renderMultitextureDatas[0].texel);
+						setVertexPointer(2, stride2TC, base2TC + offsetof(renderData2TC, vertex));
+						setColorPointer(stride2TC, base2TC + offsetof(renderData2TC, color));
+						setTexCoordPointer(1, stride2TC, base2TC + offsetof(renderData2TC, texel2));
+						setTexCoordPointer(0, stride2TC, base2TC + offsetof(renderData2TC, texel));
 						indexBuffer = &m_tc2Indices[0];
 
 						texture_id2 = m_maskOverlay;
@@ -1030,10 +1576,10 @@ namespace FIFE {
 						enableTextures(0);
 
 						// set pointer
-						setVertexPointer(2, stride2TC, &m_renderMultitextureDatas[0].vertex);
-						setColorPointer(stride2TC, &m_renderMultitextureDatas[0].color);
-						setTexCoordPointer(2, stride2TC, &m_renderMultitextureDatas[0].texel2);
-						setTexCoordPointer(0, stride2TC, &m_renderMultitextureDatas[0].texel);
+						setVertexPointer(2, stride2TC, base2TC + offsetof(renderData2TC, vertex));
+						setColorPointer(stride2TC, base2TC + offsetof(renderData2TC, color));
+						setTexCoordPointer(2, stride2TC, base2TC + offsetof(renderData2TC, texel2));
+						setTexCoordPointer(0, stride2TC, base2TC + offsetof(renderData2TC, texel));
 						indexBuffer = &m_tc2Indices[0];
 
 						texture_id2 = ro.overlay_id;
@@ -1048,10 +1594,45 @@ namespace FIFE {
 						enableTextures(0);
 
 						// set pointer
-						setVertexPointer(2, stride2TC, &m_renderMultitextureDatas[0].vertex);
-						setColorPointer(stride2TC, &m_renderMultitextureDatas[0].color);
-						setTexCoordPointer(3, stride2TC, &m_renderMultitextureDatas[0].texel2);
-						setTexCoordPointer(0, stride2TC, &m_renderMultitextureDatas[0].texel);
+						setVertexPointer(2, stride2TC, base2TC + offsetof(renderData2TC, vertex));
+						setColorPointer(stride2TC, base2TC + offsetof(renderData2TC, color));
+						setTexCoordPointer(3, stride2TC, base2TC + offsetof(renderData2TC, texel2));
+						setTexCoordPointer(0, stride2TC, base2TC + offsetof(renderData2TC, texel));
+						indexBuffer = &m_tc2Indices[0];
+
+						texture_id2 = ro.overlay_id;
+						currentElements = &elements2TC;
+						currentIndex = &index2TC;
+						break;
+					case OVERLAY_TYPE_OUTLINE:
+						disableTextures(3);
+						disableTextures(2);
+						disableTextures(1);
+						enableTextures(0);
+						useEffect(ro.overlay_type, ro.effect);
+
+						// set pointer
+						setVertexPointer(2, stride2TC, base2TC + offsetof(renderData2TC, vertex));
+						setColorPointer(stride2TC, base2TC + offsetof(renderData2TC, color));
+						setTexCoordPointer(0, stride2TC, base2TC + offsetof(renderData2TC, texel));
+						indexBuffer = &m_tc2Indices[0];
+
+						texture_id2 = 0;
+						currentElements = &elements2TC;
+						currentIndex = &index2TC;
+						break;
+					case OVERLAY_TYPE_COLOR_TABLE:
+						disableTextures(2);
+						disableTextures(1);
+						bindTexture(3, ro.overlay_id);
+						enableTextures(0);
+						useEffect(ro.overlay_type, ro.effect);
+
+						// set pointer
+						setVertexPointer(2, stride2TC, base2TC + offsetof(renderData2TC, vertex));
+						setColorPointer(stride2TC, base2TC + offsetof(renderData2TC, color));
+						setTexCoordPointer(3, stride2TC, base2TC + offsetof(renderData2TC, texel2));
+						setTexCoordPointer(0, stride2TC, base2TC + offsetof(renderData2TC, texel));
 						indexBuffer = &m_tc2Indices[0];
 
 						texture_id2 = ro.overlay_id;
@@ -1061,6 +1642,7 @@ namespace FIFE {
 					}
 					memcpy(rgba, ro.rgba, sizeof(uint8_t) * 4);
 					overlay_type = ro.overlay_type;
+					effect = ro.effect;
 					mt = false;
 				}
 				// switch texturing
@@ -1070,15 +1652,15 @@ namespace FIFE {
 						texture_id = ro.texture_id;
 						if (ro.overlay_type == OVERLAY_TYPE_NONE) {
 							if (m_state.color_enabled) {
-								setVertexPointer(2, strideTC, &m_renderTextureColorDatas[0].vertex);
-								setTexCoordPointer(0, strideTC, &m_renderTextureColorDatas[0].texel);
-								setColorPointer(strideTC, &m_renderTextureColorDatas[0].color);
+								setVertexPointer(2, strideTC, baseTC + offsetof(renderDataTC, vertex));
+								setTexCoordPointer(0, strideTC, baseTC + offsetof(renderDataTC, texel));
+								setColorPointer(strideTC, baseTC + offsetof(renderDataTC, color));
 								indexBuffer = &m_tcIndices[0];
 								currentElements = &elementsTC;
 								currentIndex = &indexTC;
 							} else {
-								setVertexPointer(2, strideT, &m_renderTextureDatas[0].vertex);
-								setTexCoordPointer(0, strideT, &m_renderTextureDatas[0].texel);
+								setVertexPointer(2, strideT, baseT + offsetof(renderDataT, vertex));
+								setTexCoordPointer(0, strideT, baseT + offsetof(renderDataT, texel));
 								indexBuffer = &m_tIndices[0];
 								currentElements = &elementsT;
 								currentIndex = &indexT;
@@ -1088,8 +1670,8 @@ namespace FIFE {
 						disableTextures(0);
 						texture_id = 0;
 						if (ro.overlay_type == OVERLAY_TYPE_NONE) {
-							setVertexPointer(2, strideP, &m_renderPrimitiveDatas[0].vertex);
-							setColorPointer(strideP, &m_renderPrimitiveDatas[0].color);
+							setVertexPointer(2, strideP, baseP + offsetof(renderDataP, vertex));
+							setColorPointer(strideP, baseP + offsetof(renderDataP, color));
 							indexBuffer = &m_pIndices[0];
 							currentElements = &elementsP;
 							currentIndex = &indexP;
@@ -1140,6 +1722,7 @@ namespace FIFE {
 		}
 		// render
 		glDrawElements(mode, *currentElements, GL_UNSIGNED_INT, indexBuffer + *currentIndex);
+		++m_drawCalls;
 
 		// reset all states
 		if (overlay_type != OVERLAY_TYPE_NONE) {
@@ -1149,6 +1732,7 @@ namespace FIFE {
 		}
 		disableTextures(0);
 		enableColorArray();
+		useProgram(0);
 
 		if (m_state.lightmodel != 0) {
 			changeBlending(4, 5);
@@ -1173,9 +1757,14 @@ namespace FIFE {
 		// stride
 		const uint32_t stride = sizeof(renderDataZ);
 
+		// make the vertex data available, as client arrays or in a vertex buffer
+		const VertexSource source = { m_renderTextureDatasZ.data(), static_cast<uint32_t>(m_renderTextureDatasZ.size() * stride) };
+		const uint8_t* base;
+		submitVertexData(&source, 1, &base);
+
 		// set pointer
-		setVertexPointer(3, stride, &m_renderTextureDatasZ[0].vertex);
-		setTexCoordPointer(0, stride, &m_renderTextureDatasZ[0].texel);
+		setVertexPointer(3, stride, base + offsetof(renderDataZ, vertex));
+		setTexCoordPointer(0, stride, base + offsetof(renderDataZ, texel));
 
 		// array index
 		int32_t index = 0;
@@ -1200,6 +1789,7 @@ namespace FIFE {
 				if (*currentElements > 0) {
 					//render
 					glDrawElements(GL_TRIANGLES, *currentElements, GL_UNSIGNED_INT, &m_indices[*currentIndex]);
+					++m_drawCalls;
 					*currentIndex += *currentElements;
 				}
 
@@ -1221,6 +1811,7 @@ namespace FIFE {
 
 		// render
 		glDrawElements(GL_TRIANGLES, *currentElements, GL_UNSIGNED_INT, &m_indices[*currentIndex]);
+		++m_drawCalls;
 
 		//reset all states
 		disableLighting();
@@ -1237,9 +1828,14 @@ namespace FIFE {
 		// stride
 		const uint32_t stride = sizeof(renderDataZ);
 
+		// make the vertex data available, as client arrays or in a vertex buffer
+		const VertexSource source = { m_renderZ_datas.data(), static_cast<uint32_t>(m_renderZ_datas.size() * stride) };
+		const uint8_t* base;
+		submitVertexData(&source, 1, &base);
+
 		// set pointer
-		setVertexPointer(3, stride, &m_renderZ_datas[0].vertex);
-		setTexCoordPointer(0, stride, &m_renderZ_datas[0].texel);
+		setVertexPointer(3, stride, base + offsetof(renderDataZ, vertex));
+		setTexCoordPointer(0, stride, base + offsetof(renderDataZ, texel));
 
 		enableAlphaTest();
 		enableDepthTest();
@@ -1251,6 +1847,7 @@ namespace FIFE {
 		for ( ; iter != m_renderZ_objects.end(); ++iter) {
 			bindTexture(iter->texture_id);
 			glDrawArrays(GL_QUADS, iter->index, iter->elements);
+			++m_drawCalls;
 		}
 		m_renderZ_objects.clear();
 
@@ -1266,10 +1863,15 @@ namespace FIFE {
 		// stride
 		const uint32_t stride = sizeof(renderDataColorZ);
 
+		// make the vertex data available, as client arrays or in a vertex buffer
+		const VertexSource source = { m_renderTextureColorDatasZ.data(), static_cast<uint32_t>(m_renderTextureColorDatasZ.size() * stride) };
+		const uint8_t* base;
+		submitVertexData(&source, 1, &base);
+
 		// set pointer
-		setVertexPointer(3, stride, &m_renderTextureColorDatasZ[0].vertex);
-		setTexCoordPointer(0, stride, &m_renderTextureColorDatasZ[0].texel);
-		setColorPointer(stride, &m_renderTextureColorDatasZ[0].color);
+		setVertexPointer(3, stride, base + offsetof(renderDataColorZ, vertex));
+		setTexCoordPointer(0, stride, base + offsetof(renderDataColorZ, texel));
+		setColorPointer(stride, base + offsetof(renderDataColorZ, color));
 
 		// array index
 		int32_t index = 0;
@@ -1294,6 +1896,7 @@ namespace FIFE {
 				if (*currentElements > 0) {
 					//render
 					glDrawElements(GL_TRIANGLES, *currentElements, GL_UNSIGNED_INT, &m_indices[*currentIndex]);
+					++m_drawCalls;
 					*currentIndex += *currentElements;
 				}
 
@@ -1315,6 +1918,7 @@ namespace FIFE {
 
 		// render
 		glDrawElements(GL_TRIANGLES, *currentElements, GL_UNSIGNED_INT, &m_indices[*currentIndex]);
+		++m_drawCalls;
 
 		//reset all states
 		disableLighting();
@@ -1336,13 +1940,18 @@ namespace FIFE {
 		// stride
 		const uint32_t stride = sizeof(renderData2TCZ);
 
+		// make the vertex data available, as client arrays or in a vertex buffer
+		const VertexSource source = { m_renderMultitextureDatasZ.data(), static_cast<uint32_t>(m_renderMultitextureDatasZ.size() * stride) };
+		const uint8_t* base;
+		submitVertexData(&source, 1, &base);
+
 		// set pointer
-		setVertexPointer(3, stride, &m_renderMultitextureDatasZ[0].vertex);
-		setTexCoordPointer(0, stride, &m_renderMultitextureDatasZ[0].texel);
-		setTexCoordPointer(1, stride, &m_renderMultitextureDatasZ[0].texel2);
-		setTexCoordPointer(2, stride, &m_renderMultitextureDatasZ[0].texel2);
-		setTexCoordPointer(3, stride, &m_renderMultitextureDatasZ[0].texel2);
-		setColorPointer(stride, &m_renderMultitextureDatasZ[0].color);
+		setVertexPointer(3, stride, base + offsetof(renderData2TCZ, vertex));
+		setTexCoordPointer(0, stride, base + offsetof(renderData2TCZ, texel));
+		setTexCoordPointer(1, stride, base + offsetof(renderData2TCZ, texel2));
+		setTexCoordPointer(2, stride, base + offsetof(renderData2TCZ, texel2));
+		setTexCoordPointer(3, stride, base + offsetof(renderData2TCZ, texel2));
+		setColorPointer(stride, base + offsetof(renderData2TCZ, color));
 
 		// array index
 		int32_t index = 0;
@@ -1355,6 +1964,8 @@ namespace FIFE {
 		OverlayType overlay_type = OVERLAY_TYPE_NONE;
 		// overlay color
 		uint8_t color[4] = {0};
+		// shader uniforms
+		int32_t effect = -1;
 
 		int32_t* currentIndex = &index;
 		uint32_t* currentElements = &elements;
@@ -1372,7 +1983,7 @@ namespace FIFE {
 				texture = true;
 				render = true;
 			}
-			if (ro.overlay_type != overlay_type || 
+			if (ro.overlay_type != overlay_type || ro.effect != effect ||
 				(ro.overlay_type != OVERLAY_TYPE_NONE && (memcmp(color, ro.rgba, sizeof(uint8_t) * 4) || ro.overlay_id != texture_id2))) {
 				mt = true;
 				render = true;
@@ -1383,10 +1994,15 @@ namespace FIFE {
 				if (*currentElements > 0) {
 					//render
 					glDrawElements(GL_TRIANGLES, *currentElements, GL_UNSIGNED_INT, &m_indices[*currentIndex]);
+					++m_drawCalls;
 					*currentIndex += *currentElements;
 				}
 				// multitexturing
 				if(mt) {
+					// outlines and color tables use a shader, the rest the texture environment
+					if (ro.effect == -1) {
+						useProgram(0);
+					}
 					switch (ro.overlay_type) {
 					case OVERLAY_TYPE_NONE:
 						disableTextures(3);
@@ -1421,11 +2037,30 @@ namespace FIFE {
 						setEnvironmentalColor(3, ro.rgba);
 						enableTextures(0);
 
+						texture_id2 = ro.overlay_id;
+						break;
+					case OVERLAY_TYPE_OUTLINE:
+						disableTextures(3);
+						disableTextures(2);
+						disableTextures(1);
+						enableTextures(0);
+						useEffect(ro.overlay_type, ro.effect);
+
+						texture_id2 = 0;
+						break;
+					case OVERLAY_TYPE_COLOR_TABLE:
+						disableTextures(2);
+						disableTextures(1);
+						bindTexture(3, ro.overlay_id);
+						enableTextures(0);
+						useEffect(ro.overlay_type, ro.effect);
+
 						texture_id2 = ro.overlay_id;
 						break;
 					}
 					memcpy(color, ro.rgba, sizeof(uint8_t) * 4);
 					overlay_type = ro.overlay_type;
+					effect = ro.effect;
 					mt = false;
 				}
 
@@ -1451,6 +2086,7 @@ namespace FIFE {
 		}
 		// render
 		glDrawElements(GL_TRIANGLES, *currentElements, GL_UNSIGNED_INT, &m_indices[*currentIndex]);
+		++m_drawCalls;
 
 		//reset all states
 		if (overlay_type != OVERLAY_TYPE_NONE) {
@@ -1462,6 +2098,7 @@ namespace FIFE {
 		disableLighting();
 		disableAlphaTest();
 		disableDepthTest();
+		useProgram(0);
 
 		m_renderMultitextureDatasZ.clear();
 		m_renderMultitextureObjectsZ.clear();
@@ -1486,6 +2123,7 @@ namespace FIFE {
 		if (!m_renderObjects.empty()) {
 			renderWithoutZ();
 		}
+		m_effects.clear();
 	}
 
 	bool RenderBackendOpenGL::putPixel(int32_t x, int32_t y, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
@@ -2103,6 +2741,97 @@ namespace FIFE {
 		}
 	}
 
+	void RenderBackendOpenGL::addOutlineToArray(uint32_t id, const Rect& rect, float const* st, uint32_t width, uint32_t height,
+		uint8_t alpha, uint8_t const* rgb, int32_t outlineWidth, int32_t threshold) {
+
+		renderData2TC rd;
+		rd.vertex[0] = static_cast<float>(rect.x);
+		rd.vertex[1] = static_cast<float>(rect.y);
+		rd.texel[0] = st[0];
+		rd.texel[1] = st[1];
+		rd.texel2[0] = st[0];
+		rd.texel2[1] = st[1];
+		rd.color[0] = 255;
+		rd.color[1] = 255;
+		rd.color[2] = 255;
+		rd.color[3] = alpha;
+		m_renderMultitextureDatas.push_back(rd);
+
+		rd.vertex[0] = static_cast<float>(rect.x);
+		rd.vertex[1] = static_cast<float>(rect.y+rect.h);
+		rd.texel[1] = st[3];
+		rd.texel2[1] = st[3];
+		m_renderMultitextureDatas.push_back(rd);
+
+		rd.vertex[0] = static_cast<float>(rect.x+rect.w);
+		rd.vertex[1] = static_cast<float>(rect.y+rect.h);
+		rd.texel[0] = st[2];
+		rd.texel2[0] = st[2];
+		m_renderMultitextureDatas.push_back(rd);
+
+		rd.vertex[0] = static_cast<float>(rect.x+rect.w);
+		rd.vertex[1] = static_cast<float>(rect.y);
+		rd.texel[1] = st[1];
+		rd.texel2[1] = st[1];
+		m_renderMultitextureDatas.push_back(rd);
+
+		uint32_t index = m_tc2Indices.empty() ? 0 : m_tc2Indices.back() + 1;
+		uint32_t indices[] = { index, index + 1, index + 2, index, index + 2, index + 3 };
+		m_tc2Indices.insert(m_tc2Indices.end(), indices, indices + 6);
+
+		// always added, changeRenderInfos() is called for the outline and has to keep OVERLAY_TYPE_OUTLINE
+		RenderObject ro(GL_TRIANGLES, 6, id);
+		ro.overlay_type = OVERLAY_TYPE_OUTLINE;
+		std::memset(ro.rgba, 0, sizeof(ro.rgba));
+		ro.effect = addOutlineEffect(st, width, height, rgb, outlineWidth, threshold);
+		m_renderObjects.push_back(ro);
+	}
+
+	void RenderBackendOpenGL::addColorTableToArray(const Rect& rect, uint32_t id1, float const* st1, uint32_t id2, float const* st2,
+		uint8_t alpha, uint8_t const* factor, const std::map<Color, Color>& colors) {
+
+		renderData2TC rd;
+		rd.vertex[0] = static_cast<float>(rect.x);
+		rd.vertex[1] = static_cast<float>(rect.y);
+		rd.texel[0] = st1[0];
+		rd.texel[1] = st1[1];
+		rd.texel2[0] = st2[0];
+		rd.texel2[1] = st2[1];
+		rd.color[0] = 255;
+		rd.color[1] = 255;
+		rd.color[2] = 255;
+		rd.color[3] = alpha;
+		m_renderMultitextureDatas.push_back(rd);
+
+		rd.vertex[0] = static_cast<float>(rect.x);
+		rd.vertex[1] = static_cast<float>(rect.y+rect.h);
+		rd.texel[1] = st1[3];
+		rd.texel2[1] = st2[3];
+		m_renderMultitextureDatas.push_back(rd);
+
+		rd.vertex[0] = static_cast<float>(rect.x+rect.w);
+		rd.vertex[1] = static_cast<float>(rect.y+rect.h);
+		rd.texel[0] = st1[2];
+		rd.texel2[0] = st2[2];
+		m_renderMultitextureDatas.push_back(rd);
+
+		rd.vertex[0] = static_cast<float>(rect.x+rect.w);
+		rd.vertex[1] = static_cast<float>(rect.y);
+		rd.texel[1] = st1[1];
+		rd.texel2[1] = st2[1];
+		m_renderMultitextureDatas.push_back(rd);
+
+		uint32_t index = m_tc2Indices.empty() ? 0 : m_tc2Indices.back() + 1;
+		uint32_t indices[] = { index, index + 1, index + 2, index, index + 2, index + 3 };
+		m_tc2Indices.insert(m_tc2Indices.end(), indices, indices + 6);
+
+		RenderObject ro(GL_TRIANGLES, 6, id1, id2);
+		ro.overlay_type = OVERLAY_TYPE_COLOR_TABLE;
+		std::memset(ro.rgba, 0, sizeof(ro.rgba));
+		ro.effect = addColorTableEffect(factor, colors);
+		m_renderObjects.push_back(ro);
+	}
+
 	RenderBackendOpenGL::RenderZObjectTest* RenderBackendOpenGL::getRenderBufferObject(GLuint texture_id) {
 		for (std::vector<RenderZObjectTest>::iterator it = m_renderZ_objects.begin(); it != m_renderZ_objects.end(); ++it) {
 			if (it->texture_id == texture_id) {
@@ -2312,6 +3041,90 @@ namespace FIFE {
 		}
 	}
 
+	void RenderBackendOpenGL::addOutlineToArrayZ(uint32_t id, const Rect& rect, float vertexZ, float const* st, uint32_t width, uint32_t height,
+		uint8_t alpha, uint8_t const* rgb, int32_t outlineWidth, int32_t threshold) {
+
+		renderData2TCZ rd;
+		rd.vertex[0] = static_cast<float>(rect.x);
+		rd.vertex[1] = static_cast<float>(rect.y);
+		rd.vertex[2] = vertexZ;
+		rd.texel[0] = st[0];
+		rd.texel[1] = st[1];
+		rd.texel2[0] = st[0];
+		rd.texel2[1] = st[1];
+		rd.color[0] = 255;
+		rd.color[1] = 255;
+		rd.color[2] = 255;
+		rd.color[3] = alpha;
+		m_renderMultitextureDatasZ.push_back(rd);
+
+		rd.vertex[0] = static_cast<float>(rect.x);
+		rd.vertex[1] = static_cast<float>(rect.y+rect.h);
+		rd.texel[1] = st[3];
+		rd.texel2[1] = st[3];
+		m_renderMultitextureDatasZ.push_back(rd);
+
+		rd.vertex[0] = static_cast<float>(rect.x+rect.w);
+		rd.vertex[1] = static_cast<float>(rect.y+rect.h);
+		rd.texel[0] = st[2];
+		rd.texel2[0] = st[2];
+		m_renderMultitextureDatasZ.push_back(rd);
+
+		rd.vertex[0] = static_cast<float>(rect.x+rect.w);
+		rd.vertex[1] = static_cast<float>(rect.y);
+		rd.texel[1] = st[1];
+		rd.texel2[1] = st[1];
+		m_renderMultitextureDatasZ.push_back(rd);
+
+		RenderObject ro(GL_TRIANGLES, 6, id);
+		ro.overlay_type = OVERLAY_TYPE_OUTLINE;
+		std::memset(ro.rgba, 0, sizeof(ro.rgba));
+		ro.effect = addOutlineEffect(st, width, height, rgb, outlineWidth, threshold);
+		m_renderMultitextureObjectsZ.push_back(ro);
+	}
+
+	void RenderBackendOpenGL::addColorTableToArrayZ(const Rect& rect, float vertexZ, uint32_t id1, float const* st1, uint32_t id2, float const* st2,
+		uint8_t alpha, uint8_t const* factor, const std::map<Color, Color>& colors) {
+
+		renderData2TCZ rd;
+		rd.vertex[0] = static_cast<float>(rect.x);
+		rd.vertex[1] = static_cast<float>(rect.y);
+		rd.vertex[2] = vertexZ;
+		rd.texel[0] = st1[0];
+		rd.texel[1] = st1[1];
+		rd.texel2[0] = st2[0];
+		rd.texel2[1] = st2[1];
+		rd.color[0] = 255;
+		rd.color[1] = 255;
+		rd.color[2] = 255;
+		rd.color[3] = alpha;
+		m_renderMultitextureDatasZ.push_back(rd);
+
+		rd.vertex[0] = static_cast<float>(rect.x);
+		rd.vertex[1] = static_cast<float>(rect.y+rect.h);
+		rd.texel[1] = st1[3];
+		rd.texel2[1] = st2[3];
+		m_renderMultitextureDatasZ.push_back(rd);
+
+		rd.vertex[0] = static_cast<float>(rect.x+rect.w);
+		rd.vertex[1] = static_cast<float>(rect.y+rect.h);
+		rd.texel[0] = st1[2];
+		rd.texel2[0] = st2[2];
+		m_renderMultitextureDatasZ.push_back(rd);
+
+		rd.vertex[0] = static_cast<float>(rect.x+rect.w);
+		rd.vertex[1] = static_cast<float>(rect.y);
+		rd.texel[1] = st1[1];
+		rd.texel2[1] = st2[1];
+		m_renderMultitextureDatasZ.push_back(rd);
+
+		RenderObject ro(GL_TRIANGLES, 6, id1, id2);
+		ro.overlay_type = OVERLAY_TYPE_COLOR_TABLE;
+		std::memset(ro.rgba, 0, sizeof(ro.rgba));
+		ro.effect = addColorTableEffect(factor, colors);
+		m_renderMultitextureObjectsZ.push_back(ro);
+	}
+
 	void RenderBackendOpenGL::prepareForOverlays() {
 		glActiveTexture(GL_TEXTURE1);
 		glEnable(GL_TEXTURE_2D);
@@ -2322,6 +3135,7 @@ namespace FIFE {
 
 			uint8_t dummydata[3] = {127, 127, 127};
 			glBindTexture(GL_TEXTURE_2D, m_maskOverlay);
+			++m_textureBinds;
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -2330,6 +3144,7 @@ namespace FIFE {
 				GL_RGB, GL_UNSIGNED_BYTE, dummydata);
 		} else {
 			glBindTexture(GL_TEXTURE_2D, m_maskOverlay);
+			++m_textureBinds;
 		}
 
 		m_state.texture[1] = m_maskOverlay;
@@ -2674,6 +3489,10 @@ namespace FIFE {
 	
 		glPushMatrix();
 		glTranslatef(translation.x, translation.y, 0);
+
+		// gui geometry is drawn from client side arrays and bypasses the pointer state
+		bindArrayBuffer(0);
+		invalidatePointers();
 		
 		glVertexPointer(2, GL_DOUBLE, sizeof(GuiVertex), &vertices[0].position);
 		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(GuiVertex), &vertices[0].color);
@@ -2692,11 +3511,13 @@ namespace FIFE {
 		} else {
 			glEnable(GL_TEXTURE_2D);
 			glBindTexture(GL_TEXTURE_2D, texId);
+			++m_textureBinds;
 			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 			glTexCoordPointer(2, GL_DOUBLE, sizeof(GuiVertex), &vertices[0].texCoords);
 		}
 		
 		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, &indices[0]);
+		++m_drawCalls;
 		
 		glPopMatrix();
 	}
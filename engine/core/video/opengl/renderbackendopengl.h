@@ -23,6 +23,7 @@
 #define FIFE_VIDEO_RENDERBACKENSD_OPENGL_RENDERBACKENDOPENGL_H
 
 // Standard C++ library includes
+#include <map>
 
 // 3rd party library includes
 
@@ -30,6 +31,7 @@
 // These includes are split up in two parts, separated by one empty line
 // First block: files included from the FIFE root src directory
 // Second block: files included from the same folder
+#include "video/color.h"
 #include "video/renderbackend.h"
 
 #include "fife_opengl.h"
@@ -107,6 +109,58 @@ namespace FIFE {
 		void bindTexture(uint32_t texUnit, GLuint texId);
 		void bindTexture(GLuint textId);
 
+		//! maximal outline width of the outline shader
+		static const int32_t MAX_SHADER_OUTLINE_WIDTH = 16;
+		//! maximal number of colors of the color table shader
+		static const uint32_t MAX_SHADER_COLOR_ENTRIES = 16;
+
+		/** Returns true if outlines and color tables are rendered by shaders.
+		 * @see RenderBackend::setShadersEnabled
+		 */
+		bool hasEffectShaders() const { return m_outlineProgram.program != 0 && m_colorTableProgram.program != 0; }
+
+		/** Adds the outline of an image. The outline is generated at draw time by a shader
+		 * and matches the outline image that markOutline() and fillOutline() create.
+		 * @param id The texture of the image.
+		 * @param rect The screen rectangle.
+		 * @param st The texture coordinates of the image.
+		 * @param width The width of the image in pixels.
+		 * @param height The height of the image in pixels.
+		 * @param alpha The transparency.
+		 * @param rgb The outline color.
+		 * @param outlineWidth The outline width in pixels, at most MAX_SHADER_OUTLINE_WIDTH.
+		 * @param threshold The alpha threshold, see markOutline().
+		 */
+		void addOutlineToArray(uint32_t id, const Rect& rect, float const* st, uint32_t width, uint32_t height,
+			uint8_t alpha, uint8_t const* rgb, int32_t outlineWidth, int32_t threshold);
+		void addOutlineToArrayZ(uint32_t id, const Rect& rect, float vertexZ, float const* st, uint32_t width, uint32_t height,
+			uint8_t alpha, uint8_t const* rgb, int32_t outlineWidth, int32_t threshold);
+
+		/** Adds an image with a color overlay. The overlay colors are replaced at draw time by a shader,
+		 * the result matches an overlay image that was recolored with the same table.
+		 * @param colors Maps overlay colors to their replacement, at most MAX_SHADER_COLOR_ENTRIES entries.
+		 * @param factor The alpha value is the interpolation factor between image and overlay.
+		 * @see addImageToArray
+		 */
+		void addColorTableToArray(const Rect& rect, uint32_t id1, float const* st1, uint32_t id2, float const* st2,
+			uint8_t alpha, uint8_t const* factor, const std::map<Color, Color>& colors);
+		void addColorTableToArrayZ(const Rect& rect, float vertexZ, uint32_t id1, float const* st1, uint32_t id2, float const* st2,
+			uint8_t alpha, uint8_t const* factor, const std::map<Color, Color>& colors);
+
+		/** Allows or forbids a persistently mapped stream buffer. Without it the stream
+		 * buffer is orphaned, e.g. for drivers with slow or broken persistent mappings.
+		 * Must be set before the main screen is created.
+		 */
+		void setPersistentMappingEnabled(bool enabled) { m_persistentMapping = enabled; }
+
+		/** @see setPersistentMappingEnabled
+		 */
+		bool isPersistentMappingEnabled() const { return m_persistentMapping; }
+
+		/** Returns true if vertex data is streamed through a persistently mapped buffer.
+		 */
+		bool isStreamBufferMapped() const { return m_streamMapping != NULL; }
+
 	protected:
 		virtual void setClipArea(const Rect& cliparea, bool clear);
 
@@ -127,10 +181,76 @@ namespace FIFE {
 		void setVertexPointer(GLint size, GLsizei stride, const GLvoid* ptr);
 		void setColorPointer(GLsizei stride, const GLvoid* ptr);
 		void setTexCoordPointer(uint32_t texUnit, GLsizei stride, const GLvoid* ptr);
+
+		/** Client side vertex array that is handed to submitVertexData().
+		 */
+		struct VertexSource {
+			const void* data;
+			uint32_t bytes;
+		};
+
+		/** Makes the given vertex arrays available for drawing.
+		 * With vertex buffers enabled each screen submission is kept in a retained buffer
+		 * for its position in the frame, which is reused while the same data is submitted
+		 * there. Data that changes in consecutive frames and render target passes are
+		 * uploaded into one region of the stream buffer instead. The returned bases replace the client
+		 * pointers in the set*Pointer calls. Without vertex buffers the client
+		 * pointers are returned.
+		 */
+		void submitVertexData(const VertexSource* sources, uint32_t count, const uint8_t** bases);
+		void uploadStreamData(const VertexSource* sources, uint32_t count, uint32_t total, const uint8_t** bases);
+		void reserveStreamRegion(uint32_t bytes);
+		void createStreamBuffer(uint32_t size);
+		void initVertexBuffers();
+		void deinitVertexBuffers();
+		void releaseStreamBuffer();
+		void bindArrayBuffer(GLuint id);
+		void invalidatePointers();
 		
 		GLuint m_maskOverlay;
 		void prepareForOverlays();
 
+		// fragment program for outlines or color tables and its uniforms, unused uniforms are -1
+		struct EffectProgram {
+			GLuint program;
+			GLint source;
+			GLint overlay;
+			GLint bounds;
+			GLint texel;
+			GLint color;
+			GLint params;
+			GLint from;
+			GLint to;
+		};
+
+		// uniform values of an outline or color table draw, referenced by RenderObject::effect
+		struct EffectData {
+			// outline: image bounds in texture coordinates and size of one pixel
+			GLfloat bounds[4];
+			GLfloat texel[2];
+			// outline: color, color table: the alpha value is the interpolation factor
+			GLfloat color[4];
+			// outline: width, threshold and edge mode, color table: number of entries
+			GLint params[3];
+			// color table: overlay colors and their replacement
+			GLfloat from[MAX_SHADER_COLOR_ENTRIES * 4];
+			GLfloat to[MAX_SHADER_COLOR_ENTRIES * 4];
+		};
+
+		void initShaders();
+		void deinitShaders();
+		bool createEffectProgram(const std::string& source, EffectProgram& program);
+		void useProgram(GLuint program);
+		void useEffect(OverlayType type, int32_t effect);
+		int32_t addEffect(const EffectData& data);
+		int32_t addOutlineEffect(float const* st, uint32_t width, uint32_t height, uint8_t const* rgb, int32_t outlineWidth, int32_t threshold);
+		int32_t addColorTableEffect(uint8_t const* factor, const std::map<Color, Color>& colors);
+
+		EffectProgram m_outlineProgram;
+		EffectProgram m_colorTableProgram;
+		// effect uniforms of the current frame
+		std::vector<EffectData> m_effects;
+
 		void renderWithoutZ();
 
 		void renderWithZ();
@@ -270,8 +390,39 @@ namespace FIFE {
 			bool scissor_test;
 			bool depth_enabled;
 			bool color_enabled;
+			GLuint program;
 		} m_state;
 
+		// retained copy of a submission, reused while the same data is submitted
+		struct RetainedBuffer {
+			GLuint id;
+			bool uploaded;
+			// the data changed in the last submission at this position
+			bool changed;
+			std::vector<uint8_t> shadow;
+		};
+
+		// currently bound GL_ARRAY_BUFFER
+		GLuint m_arrayBuffer;
+		// ring buffer for streamed vertex data
+		GLuint m_streamBuffer;
+		// size of the stream buffer in bytes
+		uint32_t m_streamSize;
+		// write position in the stream buffer
+		uint32_t m_streamOffset;
+		// persistent mapping of the stream buffer, NULL if orphaning is used
+		uint8_t* m_streamMapping;
+		// persistent mapping is allowed
+		bool m_persistentMapping;
+		// fences guarding the segments of the persistently mapped stream buffer
+		GLsync m_streamFences[3];
+		// retained buffers in submission order
+		std::vector<RetainedBuffer> m_retainedBuffers;
+		// segment of the persistently mapped stream buffer that is written
+		uint32_t m_streamSegment;
+		// next retained buffer of the current frame
+		uint32_t m_retainedSlot;
+
 		GLuint m_fbo_id;
 		GLuint m_indicebufferId;
 		//! static indices for vertex data with z
@@ -0,0 +1,366 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <algorithm>
+#include <cstring>
+
+// Platform specific includes
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FIFE_OUTLINE_AVX2
+#define FIFE_OUTLINE_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FIFE_OUTLINE_SSE2
+#endif
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+
+#include "outlinekernel.h"
+
+namespace FIFE {
+
+	namespace {
+		/** Decides if two neighboring alpha values form an outline edge.
+		 */
+		struct EdgeTest {
+			enum Mode {
+				// threshold > 255, no edges at all
+				EDGE_NONE,
+				// threshold > 1, one side at least threshold
+				EDGE_THRESHOLD,
+				// threshold <= 1, one side transparent
+				EDGE_TRANSPARENT
+			};
+
+			EdgeTest(int32_t threshold) {
+				if (threshold > 255) {
+					mode = EDGE_NONE;
+				} else if (threshold > 1) {
+					mode = EDGE_THRESHOLD;
+				} else {
+					mode = EDGE_TRANSPARENT;
+				}
+				value = static_cast<uint8_t>(std::max(0, std::min(threshold, 255)));
+			}
+
+			bool operator()(uint8_t a, uint8_t prev) const {
+				if (a == prev) {
+					return false;
+				}
+				if (mode == EDGE_THRESHOLD) {
+					return a >= value || prev >= value;
+				}
+				return mode == EDGE_TRANSPARENT && (a == 0 || prev == 0);
+			}
+
+			Mode mode;
+			uint8_t value;
+		};
+
+		/** Compares two rows of alpha values. down is set where the alpha falls,
+		 * up where it rises. Returns false if there is no edge at all.
+		 */
+		bool findEdges(const uint8_t* cur, const uint8_t* prev, int32_t count, const EdgeTest& test, uint8_t* down, uint8_t* up) {
+			if (test.mode == EdgeTest::EDGE_NONE) {
+				return false;
+			}
+			int32_t x = 0;
+			uint8_t any = 0;
+#if defined(FIFE_OUTLINE_AVX2)
+			{
+				const __m256i zero = _mm256_setzero_si256();
+				const __m256i value = _mm256_set1_epi8(static_cast<char>(test.value));
+				const bool threshold = test.mode == EdgeTest::EDGE_THRESHOLD;
+				__m256i found = zero;
+				for (; x + 32 <= count; x += 32) {
+					const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cur + x));
+					const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + x));
+					__m256i side;
+					if (threshold) {
+						side = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(a, value), a),
+							_mm256_cmpeq_epi8(_mm256_max_epu8(p, value), p));
+					} else {
+						side = _mm256_or_si256(_mm256_cmpeq_epi8(a, zero), _mm256_cmpeq_epi8(p, zero));
+					}
+					const __m256i edge = _mm256_andnot_si256(_mm256_cmpeq_epi8(a, p), side);
+					const __m256i rises = _mm256_cmpeq_epi8(_mm256_max_epu8(a, p), a);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(up + x), _mm256_and_si256(edge, rises));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(down + x), _mm256_andnot_si256(rises, edge));
+					found = _mm256_or_si256(found, edge);
+				}
+				any |= _mm256_movemask_epi8(found) != 0;
+			}
+#endif
+#if defined(FIFE_OUTLINE_SSE2)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i value = _mm_set1_epi8(static_cast<char>(test.value));
+				const bool threshold = test.mode == EdgeTest::EDGE_THRESHOLD;
+				__m128i found = zero;
+				for (; x + 16 <= count; x += 16) {
+					const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + x));
+					const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + x));
+					__m128i side;
+					if (threshold) {
+						side = _mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(a, value), a),
+							_mm_cmpeq_epi8(_mm_max_epu8(p, value), p));
+					} else {
+						side = _mm_or_si128(_mm_cmpeq_epi8(a, zero), _mm_cmpeq_epi8(p, zero));
+					}
+					const __m128i edge = _mm_andnot_si128(_mm_cmpeq_epi8(a, p), side);
+					const __m128i rises = _mm_cmpeq_epi8(_mm_max_epu8(a, p), a);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(up + x), _mm_and_si128(edge, rises));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(down + x), _mm_andnot_si128(rises, edge));
+					found = _mm_or_si128(found, edge);
+				}
+				any |= _mm_movemask_epi8(found) != 0;
+			}
+#endif
+			for (; x < count; ++x) {
+				const uint8_t a = cur[x];
+				const uint8_t p = prev[x];
+				const uint8_t edge = test(a, p) ? 0xFF : 0;
+				up[x] = a > p ? edge : 0;
+				down[x] = a < p ? edge : 0;
+				any |= edge;
+			}
+			return any != 0;
+		}
+
+		/** dst[i] |= src[i] for count bytes.
+		 */
+		void orBytes(uint8_t* dst, const uint8_t* src, int32_t count) {
+			int32_t x = 0;
+#if defined(FIFE_OUTLINE_AVX2)
+			for (; x + 32 <= count; x += 32) {
+				__m256i* d = reinterpret_cast<__m256i*>(dst + x);
+				const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x));
+				_mm256_storeu_si256(d, _mm256_or_si256(_mm256_loadu_si256(d), s));
+			}
+#endif
+#if defined(FIFE_OUTLINE_SSE2)
+			for (; x + 16 <= count; x += 16) {
+				__m128i* d = reinterpret_cast<__m128i*>(dst + x);
+				const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+				_mm_storeu_si128(d, _mm_or_si128(_mm_loadu_si128(d), s));
+			}
+#endif
+			for (; x < count; ++x) {
+				dst[x] |= src[x];
+			}
+		}
+
+		/** ORs the flags of plane columns [0, count) into a mask row, shifted by shift columns.
+		 * Columns outside of [0, maskWidth) are dropped.
+		 */
+		void orShifted(uint8_t* maskRow, int32_t maskWidth, const uint8_t* flags, int32_t count, int32_t shift) {
+			const int32_t first = std::max(0, -shift);
+			const int32_t last = std::min(count, maskWidth - shift);
+			if (first < last) {
+				orBytes(maskRow + first + shift, flags + first, last - first);
+			}
+		}
+	}
+
+	AlphaPlane::AlphaPlane() :
+		m_width(0),
+		m_height(0),
+		m_stride(1) {
+	}
+
+	void AlphaPlane::extract(const SDL_Surface* surface, const Rect& rect) {
+		m_width = std::max(0, rect.w);
+		m_height = std::max(0, rect.h);
+		m_stride = m_width + 1;
+		m_data.assign(static_cast<size_t>(m_height + 1) * m_stride, 0);
+
+		// the part of the rect that is inside of the surface, the rest stays transparent
+		const int32_t x0 = std::max(0, -rect.x);
+		const int32_t y0 = std::max(0, -rect.y);
+		const int32_t x1 = std::min(m_width, surface->w - rect.x);
+		const int32_t y1 = std::min(m_height, surface->h - rect.y);
+		if (x0 >= x1 || y0 >= y1) {
+			return;
+		}
+
+		const SDL_PixelFormat* format = surface->format;
+		const int32_t bpp = format->BytesPerPixel;
+		const int32_t count = x1 - x0;
+		if (bpp == 4 && format->Amask == 0) {
+			// SDL_GetRGBA returns opaque pixels without alpha channel
+			for (int32_t y = y0; y < y1; ++y) {
+				std::memset(getRow(y) + x0, 0xFF, count);
+			}
+			return;
+		}
+
+		if (bpp == 4 && (format->Amask >> format->Ashift) == 0xFF) {
+			const uint32_t shift = format->Ashift;
+			for (int32_t y = y0; y < y1; ++y) {
+				const uint32_t* src = reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(surface->pixels) +
+					(y + rect.y) * surface->pitch) + rect.x + x0;
+				uint8_t* dst = getRow(y) + x0;
+				int32_t x = 0;
+#if defined(FIFE_OUTLINE_SSE2)
+				const __m128i byteMask = _mm_set1_epi32(0xFF);
+				const __m128i count128 = _mm_cvtsi32_si128(static_cast<int>(shift));
+				for (; x + 16 <= count; x += 16) {
+					const __m128i* s = reinterpret_cast<const __m128i*>(src + x);
+					const __m128i p0 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(s), count128), byteMask);
+					const __m128i p1 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(s + 1), count128), byteMask);
+					const __m128i p2 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(s + 2), count128), byteMask);
+					const __m128i p3 = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(s + 3), count128), byteMask);
+					const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), packed);
+				}
+#endif
+				for (; x < count; ++x) {
+					dst[x] = static_cast<uint8_t>(src[x] >> shift);
+				}
+			}
+			return;
+		}
+
+		// other formats, same conversion as Image::getPixelRGBA
+		for (int32_t y = y0; y < y1; ++y) {
+			const uint8_t* src = static_cast<const uint8_t*>(surface->pixels) + (y + rect.y) * surface->pitch;
+			uint8_t* dst = getRow(y);
+			for (int32_t x = x0; x < x1; ++x) {
+				const uint8_t* p = src + (x + rect.x) * bpp;
+				uint32_t pixel = 0;
+				switch (bpp) {
+				case 1:
+					pixel = *p;
+					break;
+				case 2:
+					pixel = *reinterpret_cast<const uint16_t*>(p);
+					break;
+				case 3:
+					if (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+						pixel = p[0] << 16 | p[1] << 8 | p[2];
+					} else {
+						pixel = p[0] | p[1] << 8 | p[2] << 16;
+					}
+					break;
+				case 4:
+					pixel = *reinterpret_cast<const uint32_t*>(p);
+					break;
+				}
+				uint8_t r, g, b, a;
+				SDL_GetRGBA(pixel, format, &r, &g, &b, &a);
+				dst[x] = a;
+			}
+		}
+	}
+
+	void markOutline(const AlphaPlane& alpha, int32_t threshold, int32_t width, bool dropPartialLeadingRuns,
+		uint8_t* mask, int32_t maskWidth, int32_t maskHeight, int32_t offsetX, int32_t offsetY) {
+
+		const int32_t w = alpha.getWidth();
+		const int32_t h = alpha.getHeight();
+		const EdgeTest test(threshold);
+		if (width <= 0 || w == 0 || h == 0 || test.mode == EdgeTest::EDGE_NONE) {
+			return;
+		}
+
+		std::vector<uint8_t> down(w);
+		std::vector<uint8_t> up(w);
+		for (int32_t y = 0; y < h; ++y) {
+			const uint8_t* row = alpha.getRow(y);
+
+			// vertical: compare with the row above, mark width rows below or above the edge
+			if (findEdges(row, alpha.getRow(y - 1), w, test, &down[0], &up[0])) {
+				for (int32_t yy = y; yy < y + width; ++yy) {
+					const int32_t my = yy + offsetY;
+					if (my >= 0 && my < maskHeight) {
+						orShifted(mask + my * maskWidth, maskWidth, &down[0], w, offsetX);
+					}
+				}
+				if (!dropPartialLeadingRuns || y >= width) {
+					for (int32_t yy = y - width; yy < y; ++yy) {
+						const int32_t my = yy + offsetY;
+						if (my >= 0 && my < maskHeight) {
+							orShifted(mask + my * maskWidth, maskWidth, &up[0], w, offsetX);
+						}
+					}
+				}
+			}
+
+			// horizontal: compare with the pixel on the left, mark width pixels right or left of the edge
+			const int32_t my = y + offsetY;
+			if (my < 0 || my >= maskHeight) {
+				continue;
+			}
+			if (findEdges(row, row - 1, w, test, &down[0], &up[0])) {
+				uint8_t* maskRow = mask + my * maskWidth;
+				for (int32_t k = 0; k < width; ++k) {
+					orShifted(maskRow, maskWidth, &down[0], w, offsetX + k);
+				}
+				if (dropPartialLeadingRuns) {
+					std::fill(up.begin(), up.begin() + std::min(width, w), 0);
+				}
+				for (int32_t k = 1; k <= width; ++k) {
+					orShifted(maskRow, maskWidth, &up[0], w, offsetX - k);
+				}
+			}
+		}
+	}
+
+	void fillOutline(const uint8_t* mask, SDL_Surface* surface, uint32_t color) {
+		const int32_t w = surface->w;
+		for (int32_t y = 0; y < surface->h; ++y) {
+			const uint8_t* src = mask + y * w;
+			uint32_t* dst = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(surface->pixels) + y * surface->pitch);
+			int32_t x = 0;
+#if defined(FIFE_OUTLINE_AVX2)
+			const __m256i color256 = _mm256_set1_epi32(static_cast<int>(color));
+			for (; x + 8 <= w; x += 8) {
+				// sign extension turns 0xFF into 0xFFFFFFFF
+				const __m256i m = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + x)));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_and_si256(m, color256));
+			}
+#elif defined(FIFE_OUTLINE_SSE2)
+			const __m128i color128 = _mm_set1_epi32(static_cast<int>(color));
+			for (; x + 16 <= w; x += 16) {
+				const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+				const __m128i lo = _mm_unpacklo_epi8(m, m);
+				const __m128i hi = _mm_unpackhi_epi8(m, m);
+				__m128i* d = reinterpret_cast<__m128i*>(dst + x);
+				_mm_storeu_si128(d, _mm_and_si128(_mm_unpacklo_epi16(lo, lo), color128));
+				_mm_storeu_si128(d + 1, _mm_and_si128(_mm_unpackhi_epi16(lo, lo), color128));
+				_mm_storeu_si128(d + 2, _mm_and_si128(_mm_unpacklo_epi16(hi, hi), color128));
+				_mm_storeu_si128(d + 3, _mm_and_si128(_mm_unpackhi_epi16(hi, hi), color128));
+			}
+#endif
+			for (; x < w; ++x) {
+				dst[x] = src[x] ? color : 0;
+			}
+		}
+	}
+
+} //FIFE
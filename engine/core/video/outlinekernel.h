@@ -0,0 +1,104 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef FIFE_VIDEO_OUTLINEKERNEL_H
+#define FIFE_VIDEO_OUTLINEKERNEL_H
+
+// Standard C++ library includes
+#include <vector>
+
+// 3rd party library includes
+#include <SDL.h>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/base/fife_stdint.h"
+#include "util/structures/rect.h"
+
+namespace FIFE {
+
+	/** Alpha channel of an image, prepared for markOutline().
+	 *
+	 * The plane has one zero row above and one zero column left of the image,
+	 * so the first pixels of a row or column are compared against alpha 0.
+	 */
+	class AlphaPlane {
+	public:
+		AlphaPlane();
+
+		/** Reads the alpha values of a rectangle of the surface.
+		 * Pixels outside of the surface get alpha 0.
+		 * @param surface The source surface, 32bit surfaces with 8bit alpha use a fast path.
+		 * @param rect The rectangle in surface coordinates, e.g. the subimage rect of a shared image.
+		 */
+		void extract(const SDL_Surface* surface, const Rect& rect);
+
+		int32_t getWidth() const { return m_width; }
+		int32_t getHeight() const { return m_height; }
+
+		/** Returns the alpha values of a row, index -1 is the zero column.
+		 * Row -1 is the zero row.
+		 */
+		const uint8_t* getRow(int32_t y) const { return &m_data[(y + 1) * m_stride + 1]; }
+
+	private:
+		uint8_t* getRow(int32_t y) { return &m_data[(y + 1) * m_stride + 1]; }
+
+		std::vector<uint8_t> m_data;
+		int32_t m_width;
+		int32_t m_height;
+		int32_t m_stride;
+	};
+
+	/** Marks the outline of an alpha plane in a byte mask.
+	 *
+	 * Every row and every column is scanned for alpha transitions (see threshold).
+	 * At a transition to a lower alpha the next width pixels are marked, at a
+	 * transition to a higher alpha the previous width pixels. Marked pixels are
+	 * set to 0xFF, the mask is not cleared, so several planes can be combined.
+	 *
+	 * @param alpha The alpha plane.
+	 * @param threshold If greater than 1, a transition needs a different alpha on both
+	 *        sides and one of them at least threshold. Otherwise one side must be 0.
+	 * @param width The outline width in pixels.
+	 * @param dropPartialLeadingRuns If true, pixels before a transition are only marked
+	 *        if the run fits into the plane. Used by multi outlines.
+	 * @param mask The mask, one byte per pixel.
+	 * @param maskWidth The width and pitch of the mask.
+	 * @param maskHeight The height of the mask, marks outside of the mask are dropped.
+	 * @param offsetX The position of the plane in the mask.
+	 * @param offsetY The position of the plane in the mask.
+	 */
+	void markOutline(const AlphaPlane& alpha, int32_t threshold, int32_t width, bool dropPartialLeadingRuns,
+		uint8_t* mask, int32_t maskWidth, int32_t maskHeight, int32_t offsetX, int32_t offsetY);
+
+	/** Writes the color to all marked pixels and 0 to the others.
+	 * @param mask The mask from markOutline(), with the size of the surface.
+	 * @param surface A 32bit surface.
+	 * @param color The pixel value, already mapped to the surface format.
+	 */
+	void fillOutline(const uint8_t* mask, SDL_Surface* surface, uint32_t color);
+
+} //FIFE
+
+#endif
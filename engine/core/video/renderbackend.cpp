@@ -38,6 +38,8 @@ namespace FIFE {
 		m_compressimages(false),
 		m_useframebuffer(false),
 		m_usenpot(false),
+		m_usevbo(false),
+		m_useshaders(false),
 		m_isalphaoptimized(false),
 		m_iscolorkeyenabled(false),
 		m_colorkey(colorkey),
@@ -48,9 +50,16 @@ namespace FIFE {
 		m_isDepthBuffer(false),
 		m_alphaValue(0.3),
 		m_vSync(false),
+		m_drawCalls(0),
+		m_textureBinds(0),
+		m_uploadedBytes(0),
 		m_isframelimit(false),
 		m_frame_start(0),
-		m_framelimit(60) {
+		m_framelimit(60),
+		m_lastDrawCalls(0),
+		m_lastTextureBinds(0),
+		m_lastUploadedBytes(0),
+		m_frameNumber(0) {
 
 		m_isbackgroundcolor = false;
 		m_backgroundcolor.r = 0;
@@ -67,6 +76,13 @@ namespace FIFE {
 	}
 
 	void RenderBackend::startFrame() {
+		m_lastDrawCalls = m_drawCalls;
+		m_lastTextureBinds = m_textureBinds;
+		m_lastUploadedBytes = m_uploadedBytes;
+		m_drawCalls = 0;
+		m_textureBinds = 0;
+		m_uploadedBytes = 0;
+		++m_frameNumber;
 		if (m_isframelimit) {
 			m_frame_start = SDL_GetTicks();
 		}
@@ -233,6 +249,22 @@ namespace FIFE {
 		return m_framelimit;
 	}
 
+	uint32_t RenderBackend::getDrawCallCount() const {
+		return m_lastDrawCalls;
+	}
+
+	uint32_t RenderBackend::getTextureBindCount() const {
+		return m_lastTextureBinds;
+	}
+
+	uint32_t RenderBackend::getUploadedBytes() const {
+		return m_lastUploadedBytes;
+	}
+
+	uint32_t RenderBackend::getFrameNumber() const {
+		return m_frameNumber;
+	}
+
 	SDL_Surface* RenderBackend::getScreenSurface() {
 		return m_screen;
 	}
@@ -93,7 +93,9 @@ namespace FIFE {
 		OVERLAY_TYPE_NONE = 0,
 		OVERLAY_TYPE_COLOR = 1,
 		OVERLAY_TYPE_COLOR_AND_TEXTURE = 2,
-		OVERLAY_TYPE_TEXTURES_AND_FACTOR = 3
+		OVERLAY_TYPE_TEXTURES_AND_FACTOR = 3,
+		OVERLAY_TYPE_OUTLINE = 4,
+		OVERLAY_TYPE_COLOR_TABLE = 5
 	};
 
 	enum TextureFiltering {
@@ -365,6 +367,26 @@ namespace FIFE {
 		 */
 		bool isNPOTEnabled() const { return m_usenpot; }
 
+		/** Enables or disables the submission of vertex data through vertex buffer objects.
+		 * Must be set before the main screen is created.
+		 */
+		void setVertexBufferEnabled(bool enabled) { m_usevbo = enabled; }
+
+		/** @see setVertexBufferEnabled
+		 */
+		bool isVertexBufferEnabled() const { return m_usevbo; }
+
+		/** Enables or disables shaders for instance outlines and color overlays.
+		 * If available, they are rendered at draw time instead of creating an image per variant.
+		 * Not used together with compressed images or mipmapping.
+		 * Must be set before the main screen is created. Only used by the OpenGL backend.
+		 */
+		void setShadersEnabled(bool enabled) { m_useshaders = enabled; }
+
+		/** @see setShadersEnabled
+		 */
+		bool isShadersEnabled() const { return m_useshaders; }
+
 		/** Sets the texture filtering method.
 		 * Supports none, bilinear, trilinear and anisotropic filtering.
 		 * Note! Works only for OpenGL backends.
@@ -469,6 +491,22 @@ namespace FIFE {
 		 */
 		uint16_t getFrameLimit() const;
 
+		/** Returns the number of draw calls issued during the last frame
+		 */
+		uint32_t getDrawCallCount() const;
+
+		/** Returns the number of texture binds issued during the last frame
+		 */
+		uint32_t getTextureBindCount() const;
+
+		/** Returns the number of vertex bytes uploaded during the last frame
+		 */
+		uint32_t getUploadedBytes() const;
+
+		/** Returns the number of the current frame, incremented by startFrame()
+		 */
+		uint32_t getFrameNumber() const;
+
 		/** Returns screen render surface
 		 */
 		 SDL_Surface* getScreenSurface();
@@ -510,6 +548,8 @@ namespace FIFE {
 		bool m_compressimages;
 		bool m_useframebuffer;
 		bool m_usenpot;
+		bool m_usevbo;
+		bool m_useshaders;
 		bool m_isalphaoptimized;
 		bool m_iscolorkeyenabled;
 		SDL_Color m_colorkey;
@@ -533,6 +573,12 @@ namespace FIFE {
 		float m_alphaValue;
 		// vsync value
 		bool m_vSync;
+		// draw calls of the current frame
+		uint32_t m_drawCalls;
+		// texture binds of the current frame
+		uint32_t m_textureBinds;
+		// uploaded vertex bytes of the current frame
+		uint32_t m_uploadedBytes;
 
 		/** Clears any possible clip areas
 		 *  @see pushClipArea
@@ -551,6 +597,14 @@ namespace FIFE {
 		bool m_isframelimit;
 		uint32_t m_frame_start;
 		uint16_t m_framelimit;
+		// draw calls of the last frame
+		uint32_t m_lastDrawCalls;
+		// texture binds of the last frame
+		uint32_t m_lastTextureBinds;
+		// uploaded vertex bytes of the last frame
+		uint32_t m_lastUploadedBytes;
+		// number of the current frame
+		uint32_t m_frameNumber;
 		
 	};
 }
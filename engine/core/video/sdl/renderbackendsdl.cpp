@@ -45,7 +45,10 @@ namespace FIFE {
 
 	RenderBackendSDL::RenderBackendSDL(const SDL_Color& colorkey) :
 		RenderBackend(colorkey),
-		m_renderer(NULL) {
+		m_renderer(NULL),
+		m_lastTexture(NULL),
+		m_batchTexture(NULL),
+		m_renderGeometry(false) {
 	}
 
 	RenderBackendSDL::~RenderBackendSDL() {
@@ -71,6 +74,7 @@ namespace FIFE {
 	}
 
 	void RenderBackendSDL::clearBackBuffer() {
+		flushBatch();
 		SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 255);
 		SDL_RenderClear(m_renderer);
 	}
@@ -96,6 +100,9 @@ namespace FIFE {
 		uint32_t flags = mode.getSDLFlags();
 		// in case of recreating
 		if (m_window) {
+			// the batched textures belong to the old renderer
+			m_batchQuads.clear();
+			m_batchTexture = NULL;
 			SDL_DestroyRenderer(m_renderer);
 			SDL_DestroyWindow(m_window);
 			m_screen = NULL;
@@ -141,6 +148,17 @@ namespace FIFE {
 		// enable alpha blending
 		SDL_SetRenderDrawBlendMode(m_renderer, SDL_BLENDMODE_BLEND);
 
+		// the headers can be newer than the linked library
+		m_renderGeometry = false;
+#ifdef FIFE_SDL_RENDER_GEOMETRY
+		SDL_version linked;
+		SDL_GetVersion(&linked);
+		m_renderGeometry = SDL_VERSIONNUM(linked.major, linked.minor, linked.patch) >= SDL_VERSIONNUM(2, 0, 18);
+#endif
+		if (!m_renderGeometry) {
+			FL_LOG(_log, "SDL_RenderGeometry is not available, images are drawn one by one");
+		}
+
 		// set the window surface as main surface, not really needed anymore
 		m_screen = SDL_GetWindowSurface(m_window);
 		m_target = m_screen;
@@ -173,13 +191,148 @@ namespace FIFE {
 
 	void RenderBackendSDL::startFrame() {
 		RenderBackend::startFrame();
+		m_lastTexture = NULL;
 	}
 
 	void RenderBackendSDL::endFrame() {
+		flushBatch();
 		SDL_RenderPresent(m_renderer);
 		RenderBackend::endFrame();
 	}
 
+	void RenderBackendSDL::notifyTextureDraw(SDL_Texture* texture) {
+		++m_drawCalls;
+		if (texture != m_lastTexture) {
+			m_lastTexture = texture;
+			++m_textureBinds;
+		}
+	}
+
+	void RenderBackendSDL::addQuadToBatch(SDL_Texture* texture, const SDL_Rect& src, const SDL_Rect& dst, const SDL_Color& color) {
+		if (texture != m_batchTexture) {
+			flushBatch();
+			m_batchTexture = texture;
+		}
+		BatchQuad quad;
+		quad.src = src;
+		quad.dst = dst;
+		quad.color = color;
+		m_batchQuads.push_back(quad);
+	}
+
+	void RenderBackendSDL::flushBatch() {
+		if (m_batchQuads.empty()) {
+			return;
+		}
+		if (!m_renderGeometry || !renderBatchGeometry()) {
+			renderBatchQuads();
+		}
+		m_batchQuads.clear();
+	}
+
+	bool RenderBackendSDL::renderBatchGeometry() {
+#ifdef FIFE_SDL_RENDER_GEOMETRY
+		float invWidth = 0.0f;
+		float invHeight = 0.0f;
+		if (m_batchTexture) {
+			int32_t width = 0;
+			int32_t height = 0;
+			SDL_QueryTexture(m_batchTexture, NULL, NULL, &width, &height);
+			invWidth = 1.0f / static_cast<float>(width);
+			invHeight = 1.0f / static_cast<float>(height);
+			// the quads carry the modulation as vertex color
+			SDL_SetTextureColorMod(m_batchTexture, 255, 255, 255);
+			SDL_SetTextureAlphaMod(m_batchTexture, 255);
+		}
+
+		const uint32_t quads = m_batchQuads.size();
+		m_batchVertices.resize(quads * 4);
+		// the index pattern is always the same, only new quads need indices
+		for (uint32_t i = m_batchIndices.size() / 6; i < quads; ++i) {
+			const int32_t base = i * 4;
+			m_batchIndices.push_back(base);
+			m_batchIndices.push_back(base + 1);
+			m_batchIndices.push_back(base + 2);
+			m_batchIndices.push_back(base);
+			m_batchIndices.push_back(base + 2);
+			m_batchIndices.push_back(base + 3);
+		}
+
+		SDL_Vertex* vertex = &m_batchVertices[0];
+		std::vector<BatchQuad>::const_iterator it = m_batchQuads.begin();
+		for (; it != m_batchQuads.end(); ++it, vertex += 4) {
+			const float left = static_cast<float>(it->dst.x);
+			const float top = static_cast<float>(it->dst.y);
+			const float right = static_cast<float>(it->dst.x + it->dst.w);
+			const float bottom = static_cast<float>(it->dst.y + it->dst.h);
+			const float s0 = static_cast<float>(it->src.x) * invWidth;
+			const float t0 = static_cast<float>(it->src.y) * invHeight;
+			const float s1 = static_cast<float>(it->src.x + it->src.w) * invWidth;
+			const float t1 = static_cast<float>(it->src.y + it->src.h) * invHeight;
+
+			vertex[0].position.x = left;
+			vertex[0].position.y = top;
+			vertex[0].tex_coord.x = s0;
+			vertex[0].tex_coord.y = t0;
+			vertex[1].position.x = right;
+			vertex[1].position.y = top;
+			vertex[1].tex_coord.x = s1;
+			vertex[1].tex_coord.y = t0;
+			vertex[2].position.x = right;
+			vertex[2].position.y = bottom;
+			vertex[2].tex_coord.x = s1;
+			vertex[2].tex_coord.y = t1;
+			vertex[3].position.x = left;
+			vertex[3].position.y = bottom;
+			vertex[3].tex_coord.x = s0;
+			vertex[3].tex_coord.y = t1;
+			vertex[0].color = vertex[1].color = vertex[2].color = vertex[3].color = it->color;
+		}
+
+		if (SDL_RenderGeometry(m_renderer, m_batchTexture, &m_batchVertices[0], quads * 4, &m_batchIndices[0], quads * 6) != 0) {
+			FL_WARN(_log, LMsg("SDL_RenderGeometry failed, images are drawn one by one: ") << SDL_GetError());
+			m_renderGeometry = false;
+			return false;
+		}
+		notifyTextureDraw(m_batchTexture);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void RenderBackendSDL::renderBatchQuads() {
+		SDL_Color last = m_batchQuads.front().color;
+		if (m_batchTexture) {
+			SDL_SetTextureColorMod(m_batchTexture, last.r, last.g, last.b);
+			SDL_SetTextureAlphaMod(m_batchTexture, last.a);
+		} else {
+			SDL_SetRenderDrawColor(m_renderer, last.r, last.g, last.b, last.a);
+		}
+		std::vector<BatchQuad>::const_iterator it = m_batchQuads.begin();
+		for (; it != m_batchQuads.end(); ++it) {
+			const SDL_Color& color = it->color;
+			// only change the modulation if needed
+			if (color.r != last.r || color.g != last.g || color.b != last.b || color.a != last.a) {
+				if (m_batchTexture) {
+					SDL_SetTextureColorMod(m_batchTexture, color.r, color.g, color.b);
+					SDL_SetTextureAlphaMod(m_batchTexture, color.a);
+				} else {
+					SDL_SetRenderDrawColor(m_renderer, color.r, color.g, color.b, color.a);
+				}
+				last = color;
+			}
+			if (m_batchTexture) {
+				if (SDL_RenderCopy(m_renderer, m_batchTexture, &it->src, &it->dst) != 0) {
+					throw SDLException(SDL_GetError());
+				}
+				notifyTextureDraw(m_batchTexture);
+			} else {
+				SDL_RenderFillRect(m_renderer, &it->dst);
+			}
+		}
+	}
+
 	Image* RenderBackendSDL::createImage(IResourceLoader* loader) {
 		return new SDLImage(loader);
 	}
@@ -225,6 +378,7 @@ namespace FIFE {
 	}
 
 	void RenderBackendSDL::renderVertexArrays() {
+		flushBatch();
 	}
 
 	void RenderBackendSDL::addImageToArray(uint32_t id, const Rect& rec, float const* st, uint8_t alpha, uint8_t const* rgba) {
@@ -234,6 +388,7 @@ namespace FIFE {
 	}
 
 	bool RenderBackendSDL::putPixel(int32_t x, int32_t y, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+		flushBatch();
 		SDL_SetRenderDrawColor(m_renderer, r, g, b, a);
 		if (SDL_RenderDrawPoint(m_renderer, x, y) == 0) {
 			return true;
@@ -242,6 +397,7 @@ namespace FIFE {
 	}
 
 	void RenderBackendSDL::drawLine(const Point& p1, const Point& p2, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+		flushBatch();
 		SDL_SetRenderDrawColor(m_renderer, r, g, b, a);
 		SDL_RenderDrawLine(m_renderer, p1.x, p1.y, p2.x, p2.y);
 	}
@@ -302,10 +458,9 @@ namespace FIFE {
 			for (int32_t i = 0; i < xs.size(); i += 2) {
 				int32_t x1 = xs[i];
 				int32_t x2 = xs[i+1];
-				// vertical line
-				while (x1 <= x2) {
-					putPixel(x1, y, r, g, b, a);
-					++x1;
+				// horizontal span
+				if (x1 <= x2) {
+					fillRectangle(Point(x1, y), static_cast<uint16_t>(x2 - x1 + 1), 1, r, g, b, a);
 				}
 			}
 		}
@@ -367,6 +522,7 @@ namespace FIFE {
 	}
 
 	void RenderBackendSDL::drawTriangle(const Point& p1, const Point& p2, const Point& p3, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+		flushBatch();
 		SDL_SetRenderDrawColor(m_renderer, r, g, b, a);
 		SDL_RenderDrawLine(m_renderer, p1.x, p1.y, p2.x, p2.y);
 		SDL_RenderDrawLine(m_renderer, p2.x, p2.y, p3.x, p3.y);
@@ -379,6 +535,7 @@ namespace FIFE {
 		rect.y = p.y;
 		rect.w = w;
 		rect.h = h;
+		flushBatch();
 		SDL_SetRenderDrawColor(m_renderer, r, g, b, a);
 		SDL_RenderDrawRect(m_renderer, &rect);
 	}
@@ -389,8 +546,8 @@ namespace FIFE {
 		rect.y = p.y;
 		rect.w = w;
 		rect.h = h;
-		SDL_SetRenderDrawColor(m_renderer, r, g, b, a);
-		SDL_RenderFillRect(m_renderer, &rect);
+		SDL_Color color = { r, g, b, a };
+		addQuadToBatch(NULL, rect, rect, color);
 	}
 
 	void RenderBackendSDL::drawQuad(const Point& p1, const Point& p2, const Point& p3, const Point& p4, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
@@ -403,6 +560,7 @@ namespace FIFE {
 		Point p3 = Point(p.x+size, p.y-size);
 		Point p4 = Point(p.x-size, p.y-size);
 
+		flushBatch();
 		SDL_SetRenderDrawColor(m_renderer, r, g, b, a);
 		SDL_RenderDrawLine(m_renderer, p1.x, p1.y, p2.x, p2.y);
 		SDL_RenderDrawLine(m_renderer, p2.x, p2.y, p3.x, p3.y);
@@ -440,10 +598,9 @@ namespace FIFE {
 		for (float dy = 1; dy <= r; dy += 1.0) {
 			float dx = Mathf::Floor(Mathf::Sqrt((2.0 * rad * dy) - (dy * dy)));
 			int32_t x = p.x - dx;
-			for (; x <= p.x + dx; x++) {
-				putPixel(x, p.y + rad - dy, r, g, b, a);
-				putPixel(x, p.y - rad + dy, r, g, b, a);
-			}
+			uint16_t w = static_cast<uint16_t>(p.x + dx - x + 1);
+			fillRectangle(Point(x, p.y + rad - dy), w, 1, r, g, b, a);
+			fillRectangle(Point(x, p.y - rad + dy), w, 1, r, g, b, a);
 		}
 	}
 
@@ -515,10 +672,9 @@ namespace FIFE {
 			for (int32_t i = 0; i < xs.size(); i += 2) {
 				int32_t x1 = xs[i];
 				int32_t x2 = xs[i+1];
-				// vertical line
-				while (x1 <= x2) {
-					putPixel(x1, y, r, g, b, a);
-					++x1;
+				// horizontal span
+				if (x1 <= x2) {
+					fillRectangle(Point(x1, y), static_cast<uint16_t>(x2 - x1 + 1), 1, r, g, b, a);
 				}
 			}
 		}
@@ -650,6 +806,7 @@ namespace FIFE {
 	}
 
 	void RenderBackendSDL::setClipArea(const Rect& cliparea, bool clear) {
+		flushBatch();
 		SDL_Rect rect;
 		rect.x = cliparea.x;
 		rect.y = cliparea.y;
@@ -667,18 +824,27 @@ namespace FIFE {
 	}
 
 	void RenderBackendSDL::attachRenderTarget(ImagePtr& img, bool discard) {
+		flushBatch();
 		SDLImage* image = static_cast<SDLImage*>(img.get());
 		m_target = img->getSurface();
 		SDL_Texture* texture = image->getTexture();
 		if (!texture) {
 			texture = SDL_CreateTexture(m_renderer, m_rgba_format.format, SDL_TEXTUREACCESS_TARGET, m_target->w, m_target->h);
+			// the target is drawn with alpha blending, e.g. the tiles of a static layer
+			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
 			image->setTexture(texture);
 		}
 		SDL_SetRenderTarget(m_renderer, texture);
-		setClipArea(img->getArea(), discard);
+		setClipArea(img->getArea(), false);
+		if (discard) {
+			// clears to transparent like the OpenGL backend, so that the layers below stay visible
+			SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 0);
+			SDL_RenderClear(m_renderer);
+		}
 	}
 
 	void RenderBackendSDL::detachRenderTarget(){
+		flushBatch();
 		SDL_RenderPresent(m_renderer);
 		m_target = m_screen;
 		SDL_SetRenderTarget(m_renderer, NULL);
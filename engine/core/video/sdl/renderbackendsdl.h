@@ -23,8 +23,10 @@
 #define FIFE_VIDEO_RENDERBACKENDS_SDL_RENDERBACKENDSDL_H
 
 // Standard C++ library includes
+#include <vector>
 
 // 3rd party library includes
+#include <SDL.h>
 
 // FIFE includes
 // These includes are split up in two parts, separated by one empty line
@@ -32,6 +34,11 @@
 // Second block: files included from the same folder
 #include "video/renderbackend.h"
 
+// SDL_RenderGeometry is available since SDL 2.0.18
+#if SDL_VERSION_ATLEAST(2,0,18)
+#define FIFE_SDL_RENDER_GEOMETRY
+#endif
+
 namespace FIFE {
 
 	class ScreenMode;
@@ -97,11 +104,61 @@ namespace FIFE {
 		virtual void renderGuiGeometry(const std::vector<GuiVertex>& vertices, const std::vector<int>& indices, const DoublePoint& translation, ImagePtr texture);
 
 		SDL_Renderer* getRenderer() { return m_renderer; }
-		
+
+		/** Counts a texture copy for the frame statistics
+		 */
+		void notifyTextureDraw(SDL_Texture* texture);
+
+		/** Adds a quad to the batch of the current texture.
+		 * The batch is drawn with one SDL_RenderGeometry call once the texture changes,
+		 * a primitive that is not batched is drawn, the render state changes or
+		 * renderVertexArrays is called. Without SDL_RenderGeometry every quad is drawn
+		 * with SDL_RenderCopy or SDL_RenderFillRect.
+		 * @param texture The texture or NULL for a quad filled with the color.
+		 * @param src The source rectangle in texture pixels, ignored without texture.
+		 * @param dst The target rectangle.
+		 * @param color The color and alpha the texture is modulated with.
+		 */
+		void addQuadToBatch(SDL_Texture* texture, const SDL_Rect& src, const SDL_Rect& dst, const SDL_Color& color);
+
+		/** Draws and clears the quads of the batch.
+		 */
+		void flushBatch();
+
+		/** Returns true if the batch is drawn with SDL_RenderGeometry.
+		 */
+		bool isRenderGeometryEnabled() const { return m_renderGeometry; }
+
 	protected:
 		virtual void setClipArea(const Rect& cliparea, bool clear);
 
+		/** Draws the batch with one SDL_RenderGeometry call.
+		 * @return False if SDL can not draw the geometry.
+		 */
+		bool renderBatchGeometry();
+
+		/** Draws the batch quad by quad.
+		 */
+		void renderBatchQuads();
+
 		SDL_Renderer* m_renderer;
+		// last drawn texture
+		SDL_Texture* m_lastTexture;
+
+		struct BatchQuad {
+			SDL_Rect src;
+			SDL_Rect dst;
+			SDL_Color color;
+		};
+		// quads waiting to be drawn with m_batchTexture
+		std::vector<BatchQuad> m_batchQuads;
+		SDL_Texture* m_batchTexture;
+		// true if SDL_RenderGeometry is used for the batch
+		bool m_renderGeometry;
+#ifdef FIFE_SDL_RENDER_GEOMETRY
+		std::vector<SDL_Vertex> m_batchVertices;
+		std::vector<int> m_batchIndices;
+#endif
 	};
 
 }
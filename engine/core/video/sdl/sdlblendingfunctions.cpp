@@ -21,6 +21,23 @@
 
 // Standard C++ library includes
 
+// Platform specific includes
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FIFE_BLEND_SSE2
+// the AVX2 versions are compiled with a target attribute and used after a CPU check
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FIFE_BLEND_AVX2
+#define FIFE_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#define FIFE_BLEND_AVX2
+#define FIFE_TARGET_AVX2
+#endif
+#endif
+
 // 3rd party library includes
 
 // FIFE includes
@@ -39,89 +56,523 @@ namespace FIFE {
 		uint8_t r, g, b, a;
 	};
 
-	void SDL_BlendRow_RGBA8_to_RGBA8( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
-		const ColorRGBA8* srcColor = reinterpret_cast< const ColorRGBA8* >( src );
-		ColorRGBA8* dstColor = reinterpret_cast< ColorRGBA8* >( dst );
-
-		for( int32_t i = n; 0 < i; --i ) {
-			uint32_t aMulA = alpha * srcColor->a;
-
-			if( aMulA ) {
-				uint32_t OneMin_aMulA = 65535 - aMulA;
-				dstColor->r = ( aMulA * srcColor->r + OneMin_aMulA * dstColor->r ) >> 16;
-				dstColor->g = ( aMulA * srcColor->g + OneMin_aMulA * dstColor->g ) >> 16;
-				dstColor->b = ( aMulA * srcColor->b + OneMin_aMulA * dstColor->b ) >> 16;
-				dstColor->a = 255;
+	namespace {
+		typedef void (*BlendRowFunction)( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n );
+
+		/** One implementation of all blending functions.
+		 */
+		struct BlendFunctions {
+			BlendRowFunction rgba8ToRgba8;
+			BlendRowFunction rgba8ToRgb8;
+			BlendRowFunction rgba8ToRgb565;
+			BlendRowFunction rgba4ToRgb565;
+		};
+
+		void blendRow_RGBA8_to_RGBA8_Scalar( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+			const ColorRGBA8* srcColor = reinterpret_cast< const ColorRGBA8* >( src );
+			ColorRGBA8* dstColor = reinterpret_cast< ColorRGBA8* >( dst );
+
+			for( int32_t i = n; 0 < i; --i ) {
+				uint32_t aMulA = alpha * srcColor->a;
+
+				if( aMulA ) {
+					uint32_t OneMin_aMulA = 65535 - aMulA;
+					dstColor->r = ( aMulA * srcColor->r + OneMin_aMulA * dstColor->r ) >> 16;
+					dstColor->g = ( aMulA * srcColor->g + OneMin_aMulA * dstColor->g ) >> 16;
+					dstColor->b = ( aMulA * srcColor->b + OneMin_aMulA * dstColor->b ) >> 16;
+					dstColor->a = 255;
+				}
+				++dstColor;
+				++srcColor;
 			}
-			++dstColor;
-			++srcColor;
 		}
-	}
 
-	void SDL_BlendRow_RGBA8_to_RGB8( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
-		const ColorRGBA8* srcColor = reinterpret_cast< const ColorRGBA8* >( src );
-		ColorRGB8* dstColor = reinterpret_cast< ColorRGB8* >( dst );
-
-		for( int32_t i = n; 0 < i; --i ) {
-			uint32_t aMulA = alpha * srcColor->a;
-			if( aMulA ) {
-				uint32_t OneMin_aMulA = 65535 - aMulA;
-				dstColor->r = ( aMulA * srcColor->r + OneMin_aMulA * dstColor->r ) >> 16;
-				dstColor->g = ( aMulA * srcColor->g + OneMin_aMulA * dstColor->g ) >> 16;
-				dstColor->b = ( aMulA * srcColor->b + OneMin_aMulA * dstColor->b ) >> 16;
+		void blendRow_RGBA8_to_RGB8_Scalar( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+			const ColorRGBA8* srcColor = reinterpret_cast< const ColorRGBA8* >( src );
+			ColorRGB8* dstColor = reinterpret_cast< ColorRGB8* >( dst );
+
+			for( int32_t i = n; 0 < i; --i ) {
+				uint32_t aMulA = alpha * srcColor->a;
+				if( aMulA ) {
+					uint32_t OneMin_aMulA = 65535 - aMulA;
+					dstColor->r = ( aMulA * srcColor->r + OneMin_aMulA * dstColor->r ) >> 16;
+					dstColor->g = ( aMulA * srcColor->g + OneMin_aMulA * dstColor->g ) >> 16;
+					dstColor->b = ( aMulA * srcColor->b + OneMin_aMulA * dstColor->b ) >> 16;
+				}
+
+				++dstColor;
+				++srcColor;
+			}
+		}
+
+		void blendRow_RGBA8_to_RGB565_Scalar( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+			const ColorRGBA8* srcColor = reinterpret_cast< const ColorRGBA8* >( src );
+			uint16_t* dstColor = reinterpret_cast< uint16_t* >( dst );
+
+			for( int32_t i = n; 0 < i; --i ) {
+				uint32_t aMulA = ( alpha * srcColor->a ) >> 8;
+				if( aMulA ) {
+					uint32_t OneMin_aMulA = 255 - aMulA;
+					uint32_t c = *dstColor;
+					*dstColor = ( ( ( srcColor->b * aMulA ) +
+						( ( ( c & 0xF800 ) >> 8 ) * OneMin_aMulA ) ) & 0xF800 ) |
+						( ( ( ( srcColor->g * aMulA ) +
+						( ( ( c & 0x07E0 ) >> 3 ) * OneMin_aMulA ) ) >> 5 ) & 0x07E0 ) |
+						( ( ( ( srcColor->r * aMulA ) +
+						( ( ( c & 0x001F ) << 3 ) * OneMin_aMulA ) ) >> 11 ) & 0x001F );
+				}
+
+				++dstColor;
+				++srcColor;
+			}
+		}
+
+		void blendRow_RGBA4_to_RGB565_Scalar( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+			const uint16_t* srcColor = reinterpret_cast< const uint16_t* >( src );
+			uint16_t* dstColor = reinterpret_cast< uint16_t* >( dst );
+
+			for( int32_t i = n; 0 < i; --i ) {
+				uint32_t c1 = *dstColor;
+				uint32_t c2 = *srcColor;
+
+				uint32_t aMulA = c2 & 0xF;
+				aMulA = ( alpha * aMulA ) / 15;	///< upgrade to range 0-255
+				if( aMulA ) {
+					uint32_t OneMin_aMulA = 255 - aMulA;
+					uint32_t result;
+					result = ( ( ( ( c2 & 0xF000 ) | 0x0800 ) * aMulA ) + ( ( c1 & 0xF800 ) * OneMin_aMulA ) ) & 0xF80000;
+					result |= ( ( ( ( ( c2 & 0x0F00 ) >> 1 ) | 0x0040 ) * aMulA ) + ( ( c1 & 0x07E0 ) * OneMin_aMulA ) ) & 0x07E000;
+					result |= ( ( ( ( ( c2 & 0x00F0 ) >> 3 ) | 0x0001 ) * aMulA ) + ( ( c1 & 0x001F ) * OneMin_aMulA ) ) & 0x001F00;
+					/// multiplying by alpha resulted in shift.
+					*dstColor = static_cast< uint16_t >( result >> 8 );
+				}
+
+				++dstColor;
+				++srcColor;
 			}
+		}
 
-			++dstColor;
-			++srcColor;
+#if defined(FIFE_BLEND_SSE2)
+		/** Computes (a * b + c * d) >> 16 for unsigned 16 bit lanes.
+		 * The sum of both products has to fit into 32 bits.
+		 */
+		inline __m128i mulAddHi_SSE2( __m128i a, __m128i b, __m128i c, __m128i d ) {
+			const __m128i sign = _mm_set1_epi16( static_cast<short>( 0x8000 ) );
+			const __m128i lo1 = _mm_mullo_epi16( a, b );
+			const __m128i lo = _mm_add_epi16( lo1, _mm_mullo_epi16( c, d ) );
+			const __m128i hi = _mm_add_epi16( _mm_mulhi_epu16( a, b ), _mm_mulhi_epu16( c, d ) );
+			// the low halves overflowed if the sum is smaller than a summand, unsigned compare
+			const __m128i carry = _mm_cmpgt_epi16( _mm_xor_si128( lo1, sign ), _mm_xor_si128( lo, sign ) );
+			return _mm_sub_epi16( hi, carry );
 		}
-	}
 
-	void SDL_BlendRow_RGBA8_to_RGB565( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
-		const ColorRGBA8* srcColor = reinterpret_cast< const ColorRGBA8* >( src );
-		uint16_t* dstColor = reinterpret_cast< uint16_t* >( dst );
-
-		for( int32_t i = n; 0 < i; --i ) {
-			uint32_t aMulA = ( alpha * srcColor->a ) >> 8;
-			if( aMulA ) {
-				uint32_t OneMin_aMulA = 255 - aMulA;
-				uint32_t c = *dstColor;
-				*dstColor = ( ( ( srcColor->b * aMulA ) +
-					( ( ( c & 0xF800 ) >> 8 ) * OneMin_aMulA ) ) & 0xF800 ) |
-					( ( ( ( srcColor->g * aMulA ) +
-					( ( ( c & 0x07E0 ) >> 3 ) * OneMin_aMulA ) ) >> 5 ) & 0x07E0 ) |
-					( ( ( ( srcColor->r * aMulA ) +
-					( ( ( c & 0x001F ) << 3 ) * OneMin_aMulA ) ) >> 11 ) & 0x001F );
+		/** Blends two RGBA8 pixels unpacked to 16 bit lanes, see blendRow_RGBA8_to_RGBA8_Scalar.
+		 * @param zero Set to all ones for the lanes of pixels that stay unchanged.
+		 */
+		inline __m128i blendRGBA16_SSE2( __m128i src, __m128i dst, __m128i alpha, __m128i& zero ) {
+			__m128i srcAlpha = _mm_shufflelo_epi16( src, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+			srcAlpha = _mm_shufflehi_epi16( srcAlpha, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+			// alpha * srcAlpha fits into 16 bits, 65535 - aMulA is its complement
+			const __m128i aMulA = _mm_mullo_epi16( alpha, srcAlpha );
+			const __m128i oneMinAMulA = _mm_xor_si128( aMulA, _mm_set1_epi16( -1 ) );
+			zero = _mm_cmpeq_epi16( aMulA, _mm_setzero_si128() );
+			return mulAddHi_SSE2( aMulA, src, oneMinAMulA, dst );
+		}
+
+		/** Blends four RGBA8 pixels, the alpha of blended pixels is set to the bits of opaque.
+		 */
+		inline __m128i blendRGBA8_SSE2( __m128i src, __m128i dst, __m128i alpha, __m128i opaque ) {
+			const __m128i zero = _mm_setzero_si128();
+			__m128i keepLo, keepHi;
+			const __m128i lo = blendRGBA16_SSE2( _mm_unpacklo_epi8( src, zero ), _mm_unpacklo_epi8( dst, zero ), alpha, keepLo );
+			const __m128i hi = blendRGBA16_SSE2( _mm_unpackhi_epi8( src, zero ), _mm_unpackhi_epi8( dst, zero ), alpha, keepHi );
+			const __m128i blended = _mm_or_si128( _mm_packus_epi16( lo, hi ), opaque );
+			const __m128i keep = _mm_packs_epi16( keepLo, keepHi );
+			return _mm_or_si128( _mm_and_si128( keep, dst ), _mm_andnot_si128( keep, blended ) );
+		}
+
+		void blendRow_RGBA8_to_RGBA8_SSE2( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+			const __m128i alpha16 = _mm_set1_epi16( static_cast<short>( alpha ) );
+			const __m128i opaque = _mm_set1_epi32( static_cast<int>( 0xFF000000 ) );
+			int32_t i = 0;
+			for( ; i + 4 <= n; i += 4 ) {
+				const __m128i s = _mm_loadu_si128( reinterpret_cast< const __m128i* >( src + i * 4 ) );
+				const __m128i d = _mm_loadu_si128( reinterpret_cast< const __m128i* >( dst + i * 4 ) );
+				_mm_storeu_si128( reinterpret_cast< __m128i* >( dst + i * 4 ), blendRGBA8_SSE2( s, d, alpha16, opaque ) );
+			}
+			blendRow_RGBA8_to_RGBA8_Scalar( src + i * 4, dst + i * 4, alpha, n - i );
+		}
+
+		void blendRow_RGBA8_to_RGB565_SSE2( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+			const __m128i alpha16 = _mm_set1_epi16( static_cast<short>( alpha ) );
+			const __m128i byteMask = _mm_set1_epi32( 0xFF );
+			const __m128i maxValue = _mm_set1_epi16( 255 );
+			const __m128i maskR = _mm_set1_epi16( static_cast<short>( 0xF800 ) );
+			const __m128i maskG = _mm_set1_epi16( 0x07E0 );
+			const __m128i maskB = _mm_set1_epi16( 0x001F );
+			int32_t i = 0;
+			for( ; i + 8 <= n; i += 8 ) {
+				const __m128i s0 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( src + i * 4 ) );
+				const __m128i s1 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( src + i * 4 + 16 ) );
+				const __m128i c = _mm_loadu_si128( reinterpret_cast< const __m128i* >( dst + i * 2 ) );
+				// one 16 bit lane per pixel and channel
+				const __m128i r = _mm_packs_epi32( _mm_and_si128( s0, byteMask ), _mm_and_si128( s1, byteMask ) );
+				const __m128i g = _mm_packs_epi32( _mm_and_si128( _mm_srli_epi32( s0, 8 ), byteMask ),
+					_mm_and_si128( _mm_srli_epi32( s1, 8 ), byteMask ) );
+				const __m128i b = _mm_packs_epi32( _mm_and_si128( _mm_srli_epi32( s0, 16 ), byteMask ),
+					_mm_and_si128( _mm_srli_epi32( s1, 16 ), byteMask ) );
+				const __m128i a = _mm_packs_epi32( _mm_srli_epi32( s0, 24 ), _mm_srli_epi32( s1, 24 ) );
+
+				const __m128i aMulA = _mm_srli_epi16( _mm_mullo_epi16( alpha16, a ), 8 );
+				const __m128i oneMinAMulA = _mm_sub_epi16( maxValue, aMulA );
+				// every sum is a weighted mean of two 8 bit values and fits into 16 bits
+				__m128i sum = _mm_add_epi16( _mm_mullo_epi16( b, aMulA ),
+					_mm_mullo_epi16( _mm_srli_epi16( _mm_and_si128( c, maskR ), 8 ), oneMinAMulA ) );
+				__m128i result = _mm_and_si128( sum, maskR );
+				sum = _mm_add_epi16( _mm_mullo_epi16( g, aMulA ),
+					_mm_mullo_epi16( _mm_srli_epi16( _mm_and_si128( c, maskG ), 3 ), oneMinAMulA ) );
+				result = _mm_or_si128( result, _mm_and_si128( _mm_srli_epi16( sum, 5 ), maskG ) );
+				sum = _mm_add_epi16( _mm_mullo_epi16( r, aMulA ),
+					_mm_mullo_epi16( _mm_slli_epi16( _mm_and_si128( c, maskB ), 3 ), oneMinAMulA ) );
+				result = _mm_or_si128( result, _mm_and_si128( _mm_srli_epi16( sum, 11 ), maskB ) );
+
+				const __m128i keep = _mm_cmpeq_epi16( aMulA, _mm_setzero_si128() );
+				result = _mm_or_si128( _mm_and_si128( keep, c ), _mm_andnot_si128( keep, result ) );
+				_mm_storeu_si128( reinterpret_cast< __m128i* >( dst + i * 2 ), result );
+			}
+			blendRow_RGBA8_to_RGB565_Scalar( src + i * 4, dst + i * 2, alpha, n - i );
+		}
+
+		void blendRow_RGBA4_to_RGB565_SSE2( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+			const __m128i alpha16 = _mm_set1_epi16( static_cast<short>( alpha ) );
+			const __m128i maxValue = _mm_set1_epi16( 255 );
+			const __m128i one = _mm_set1_epi16( 1 );
+			const __m128i nibble = _mm_set1_epi16( 0xF );
+			const __m128i mask5 = _mm_set1_epi16( 0x1F );
+			const __m128i mask6 = _mm_set1_epi16( 0x3F );
+			// x / 15 == (x * 34953) >> 19 for all x <= 255 * 15
+			const __m128i div15 = _mm_set1_epi16( static_cast<short>( 34953 ) );
+			int32_t i = 0;
+			for( ; i + 8 <= n; i += 8 ) {
+				const __m128i c2 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( src + i * 2 ) );
+				const __m128i c1 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( dst + i * 2 ) );
+
+				const __m128i a = _mm_mullo_epi16( alpha16, _mm_and_si128( c2, nibble ) );
+				const __m128i aMulA = _mm_srli_epi16( _mm_mulhi_epu16( a, div15 ), 3 );
+				const __m128i oneMinAMulA = _mm_sub_epi16( maxValue, aMulA );
+
+				// the scalar version works on the shifted channels, the shifts are factored out here
+				__m128i source = _mm_or_si128( _mm_slli_epi16( _mm_srli_epi16( c2, 12 ), 1 ), one );
+				__m128i sum = _mm_add_epi16( _mm_mullo_epi16( source, aMulA ),
+					_mm_mullo_epi16( _mm_srli_epi16( c1, 11 ), oneMinAMulA ) );
+				__m128i result = _mm_slli_epi16( _mm_and_si128( _mm_srli_epi16( sum, 8 ), mask5 ), 11 );
+
+				source = _mm_slli_epi16( _mm_or_si128( _mm_slli_epi16( _mm_and_si128( _mm_srli_epi16( c2, 8 ), nibble ), 1 ), one ), 1 );
+				sum = _mm_add_epi16( _mm_mullo_epi16( source, aMulA ),
+					_mm_mullo_epi16( _mm_and_si128( _mm_srli_epi16( c1, 5 ), mask6 ), oneMinAMulA ) );
+				result = _mm_or_si128( result, _mm_slli_epi16( _mm_and_si128( _mm_srli_epi16( sum, 8 ), mask6 ), 5 ) );
+
+				source = _mm_or_si128( _mm_slli_epi16( _mm_and_si128( _mm_srli_epi16( c2, 4 ), nibble ), 1 ), one );
+				sum = _mm_add_epi16( _mm_mullo_epi16( source, aMulA ),
+					_mm_mullo_epi16( _mm_and_si128( c1, mask5 ), oneMinAMulA ) );
+				result = _mm_or_si128( result, _mm_and_si128( _mm_srli_epi16( sum, 8 ), mask5 ) );
+
+				const __m128i keep = _mm_cmpeq_epi16( aMulA, _mm_setzero_si128() );
+				result = _mm_or_si128( _mm_and_si128( keep, c1 ), _mm_andnot_si128( keep, result ) );
+				_mm_storeu_si128( reinterpret_cast< __m128i* >( dst + i * 2 ), result );
+			}
+			blendRow_RGBA4_to_RGB565_Scalar( src + i * 2, dst + i * 2, alpha, n - i );
+		}
+#endif
+
+#if defined(FIFE_BLEND_AVX2)
+		/** AVX2 version of mulAddHi_SSE2.
+		 */
+		FIFE_TARGET_AVX2 inline __m256i mulAddHi_AVX2( __m256i a, __m256i b, __m256i c, __m256i d ) {
+			const __m256i sign = _mm256_set1_epi16( static_cast<short>( 0x8000 ) );
+			const __m256i lo1 = _mm256_mullo_epi16( a, b );
+			const __m256i lo = _mm256_add_epi16( lo1, _mm256_mullo_epi16( c, d ) );
+			const __m256i hi = _mm256_add_epi16( _mm256_mulhi_epu16( a, b ), _mm256_mulhi_epu16( c, d ) );
+			const __m256i carry = _mm256_cmpgt_epi16( _mm256_xor_si256( lo1, sign ), _mm256_xor_si256( lo, sign ) );
+			return _mm256_sub_epi16( hi, carry );
+		}
+
+		/** AVX2 version of blendRGBA16_SSE2.
+		 */
+		FIFE_TARGET_AVX2 inline __m256i blendRGBA16_AVX2( __m256i src, __m256i dst, __m256i alpha, __m256i& zero ) {
+			__m256i srcAlpha = _mm256_shufflelo_epi16( src, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+			srcAlpha = _mm256_shufflehi_epi16( srcAlpha, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+			const __m256i aMulA = _mm256_mullo_epi16( alpha, srcAlpha );
+			const __m256i oneMinAMulA = _mm256_xor_si256( aMulA, _mm256_set1_epi16( -1 ) );
+			zero = _mm256_cmpeq_epi16( aMulA, _mm256_setzero_si256() );
+			return mulAddHi_AVX2( aMulA, src, oneMinAMulA, dst );
+		}
+
+		/** AVX2 version of blendRGBA8_SSE2, eight pixels.
+		 */
+		FIFE_TARGET_AVX2 inline __m256i blendRGBA8_AVX2( __m256i src, __m256i dst, __m256i alpha, __m256i opaque ) {
+			// unpack and pack work per 128 bit lane, so the pixel order is kept
+			const __m256i zero = _mm256_setzero_si256();
+			__m256i keepLo, keepHi;
+			const __m256i lo = blendRGBA16_AVX2( _mm256_unpacklo_epi8( src, zero ), _mm256_unpacklo_epi8( dst, zero ), alpha, keepLo );
+			const __m256i hi = blendRGBA16_AVX2( _mm256_unpackhi_epi8( src, zero ), _mm256_unpackhi_epi8( dst, zero ), alpha, keepHi );
+			const __m256i blended = _mm256_or_si256( _mm256_packus_epi16( lo, hi ), opaque );
+			const __m256i keep = _mm256_packs_epi16( keepLo, keepHi );
+			return _mm256_blendv_epi8( blended, dst, keep );
+		}
+
+		FIFE_TARGET_AVX2 void blendRow_RGBA8_to_RGBA8_AVX2( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+			const __m256i alpha16 = _mm256_set1_epi16( static_cast<short>( alpha ) );
+			const __m256i opaque = _mm256_set1_epi32( static_cast<int>( 0xFF000000 ) );
+			int32_t i = 0;
+			for( ; i + 8 <= n; i += 8 ) {
+				const __m256i s = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( src + i * 4 ) );
+				const __m256i d = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( dst + i * 4 ) );
+				_mm256_storeu_si256( reinterpret_cast< __m256i* >( dst + i * 4 ), blendRGBA8_AVX2( s, d, alpha16, opaque ) );
+			}
+			blendRow_RGBA8_to_RGBA8_Scalar( src + i * 4, dst + i * 4, alpha, n - i );
+		}
+
+		FIFE_TARGET_AVX2 void blendRow_RGBA8_to_RGB8_AVX2( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+			const __m256i alpha16 = _mm256_set1_epi16( static_cast<short>( alpha ) );
+			// pixels 0-3 from bytes 0-11 and pixels 4-7 from bytes 12-23, loaded at offset 8
+			const __m128i expandLo = _mm_setr_epi8( 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 );
+			const __m128i expandHi = _mm_setr_epi8( 4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15, -1 );
+			// back to 24 bytes, stored as 16 and 8 bytes
+			const __m128i compressLo = _mm_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 );
+			const __m128i compressHi = _mm_setr_epi8( -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, 2, 4 );
+			const __m128i compressTail = _mm_setr_epi8( 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, -1, -1, -1, -1 );
+			int32_t i = 0;
+			for( ; i + 8 <= n; i += 8 ) {
+				// only the 24 bytes of the eight pixels are accessed, wider accesses would
+				// overlap with the next iteration and stall the store forwarding
+				uint8_t* d = dst + i * 3;
+				const __m128i d0 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( d ) );
+				const __m128i d1 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( d + 8 ) );
+				const __m256i dv = _mm256_inserti128_si256( _mm256_castsi128_si256( _mm_shuffle_epi8( d0, expandLo ) ),
+					_mm_shuffle_epi8( d1, expandHi ), 1 );
+				const __m256i s = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( src + i * 4 ) );
+				const __m256i result = blendRGBA8_AVX2( s, dv, alpha16, _mm256_setzero_si256() );
+				const __m128i lo = _mm256_castsi256_si128( result );
+				const __m128i hi = _mm256_extracti128_si256( result, 1 );
+				_mm_storeu_si128( reinterpret_cast< __m128i* >( d ),
+					_mm_or_si128( _mm_shuffle_epi8( lo, compressLo ), _mm_shuffle_epi8( hi, compressHi ) ) );
+				_mm_storel_epi64( reinterpret_cast< __m128i* >( d + 16 ), _mm_shuffle_epi8( hi, compressTail ) );
+			}
+			blendRow_RGBA8_to_RGB8_Scalar( src + i * 4, dst + i * 3, alpha, n - i );
+		}
+
+		FIFE_TARGET_AVX2 void blendRow_RGBA8_to_RGB565_AVX2( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+			const __m256i alpha16 = _mm256_set1_epi16( static_cast<short>( alpha ) );
+			const __m256i byteMask = _mm256_set1_epi32( 0xFF );
+			const __m256i maxValue = _mm256_set1_epi16( 255 );
+			const __m256i maskR = _mm256_set1_epi16( static_cast<short>( 0xF800 ) );
+			const __m256i maskG = _mm256_set1_epi16( 0x07E0 );
+			const __m256i maskB = _mm256_set1_epi16( 0x001F );
+			int32_t i = 0;
+			for( ; i + 16 <= n; i += 16 ) {
+				const __m256i l0 = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( src + i * 4 ) );
+				const __m256i l1 = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( src + i * 4 + 32 ) );
+				// pack works per 128 bit lane, pixels 0-3 and 8-11 go into the first register
+				const __m256i s0 = _mm256_permute2x128_si256( l0, l1, 0x20 );
+				const __m256i s1 = _mm256_permute2x128_si256( l0, l1, 0x31 );
+				const __m256i c = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( dst + i * 2 ) );
+				const __m256i r = _mm256_packs_epi32( _mm256_and_si256( s0, byteMask ), _mm256_and_si256( s1, byteMask ) );
+				const __m256i g = _mm256_packs_epi32( _mm256_and_si256( _mm256_srli_epi32( s0, 8 ), byteMask ),
+					_mm256_and_si256( _mm256_srli_epi32( s1, 8 ), byteMask ) );
+				const __m256i b = _mm256_packs_epi32( _mm256_and_si256( _mm256_srli_epi32( s0, 16 ), byteMask ),
+					_mm256_and_si256( _mm256_srli_epi32( s1, 16 ), byteMask ) );
+				const __m256i a = _mm256_packs_epi32( _mm256_srli_epi32( s0, 24 ), _mm256_srli_epi32( s1, 24 ) );
+
+				const __m256i aMulA = _mm256_srli_epi16( _mm256_mullo_epi16( alpha16, a ), 8 );
+				const __m256i oneMinAMulA = _mm256_sub_epi16( maxValue, aMulA );
+				__m256i sum = _mm256_add_epi16( _mm256_mullo_epi16( b, aMulA ),
+					_mm256_mullo_epi16( _mm256_srli_epi16( _mm256_and_si256( c, maskR ), 8 ), oneMinAMulA ) );
+				__m256i result = _mm256_and_si256( sum, maskR );
+				sum = _mm256_add_epi16( _mm256_mullo_epi16( g, aMulA ),
+					_mm256_mullo_epi16( _mm256_srli_epi16( _mm256_and_si256( c, maskG ), 3 ), oneMinAMulA ) );
+				result = _mm256_or_si256( result, _mm256_and_si256( _mm256_srli_epi16( sum, 5 ), maskG ) );
+				sum = _mm256_add_epi16( _mm256_mullo_epi16( r, aMulA ),
+					_mm256_mullo_epi16( _mm256_slli_epi16( _mm256_and_si256( c, maskB ), 3 ), oneMinAMulA ) );
+				result = _mm256_or_si256( result, _mm256_and_si256( _mm256_srli_epi16( sum, 11 ), maskB ) );
+
+				const __m256i keep = _mm256_cmpeq_epi16( aMulA, _mm256_setzero_si256() );
+				_mm256_storeu_si256( reinterpret_cast< __m256i* >( dst + i * 2 ), _mm256_blendv_epi8( result, c, keep ) );
+			}
+			blendRow_RGBA8_to_RGB565_Scalar( src + i * 4, dst + i * 2, alpha, n - i );
+		}
+
+		FIFE_TARGET_AVX2 void blendRow_RGBA4_to_RGB565_AVX2( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+			const __m256i alpha16 = _mm256_set1_epi16( static_cast<short>( alpha ) );
+			const __m256i maxValue = _mm256_set1_epi16( 255 );
+			const __m256i one = _mm256_set1_epi16( 1 );
+			const __m256i nibble = _mm256_set1_epi16( 0xF );
+			const __m256i mask5 = _mm256_set1_epi16( 0x1F );
+			const __m256i mask6 = _mm256_set1_epi16( 0x3F );
+			const __m256i div15 = _mm256_set1_epi16( static_cast<short>( 34953 ) );
+			int32_t i = 0;
+			for( ; i + 16 <= n; i += 16 ) {
+				const __m256i c2 = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( src + i * 2 ) );
+				const __m256i c1 = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( dst + i * 2 ) );
+
+				const __m256i a = _mm256_mullo_epi16( alpha16, _mm256_and_si256( c2, nibble ) );
+				const __m256i aMulA = _mm256_srli_epi16( _mm256_mulhi_epu16( a, div15 ), 3 );
+				const __m256i oneMinAMulA = _mm256_sub_epi16( maxValue, aMulA );
+
+				__m256i source = _mm256_or_si256( _mm256_slli_epi16( _mm256_srli_epi16( c2, 12 ), 1 ), one );
+				__m256i sum = _mm256_add_epi16( _mm256_mullo_epi16( source, aMulA ),
+					_mm256_mullo_epi16( _mm256_srli_epi16( c1, 11 ), oneMinAMulA ) );
+				__m256i result = _mm256_slli_epi16( _mm256_and_si256( _mm256_srli_epi16( sum, 8 ), mask5 ), 11 );
+
+				source = _mm256_slli_epi16( _mm256_or_si256( _mm256_slli_epi16( _mm256_and_si256( _mm256_srli_epi16( c2, 8 ), nibble ), 1 ), one ), 1 );
+				sum = _mm256_add_epi16( _mm256_mullo_epi16( source, aMulA ),
+					_mm256_mullo_epi16( _mm256_and_si256( _mm256_srli_epi16( c1, 5 ), mask6 ), oneMinAMulA ) );
+				result = _mm256_or_si256( result, _mm256_slli_epi16( _mm256_and_si256( _mm256_srli_epi16( sum, 8 ), mask6 ), 5 ) );
+
+				source = _mm256_or_si256( _mm256_slli_epi16( _mm256_and_si256( _mm256_srli_epi16( c2, 4 ), nibble ), 1 ), one );
+				sum = _mm256_add_epi16( _mm256_mullo_epi16( source, aMulA ),
+					_mm256_mullo_epi16( _mm256_and_si256( c1, mask5 ), oneMinAMulA ) );
+				result = _mm256_or_si256( result, _mm256_and_si256( _mm256_srli_epi16( sum, 8 ), mask5 ) );
+
+				const __m256i keep = _mm256_cmpeq_epi16( aMulA, _mm256_setzero_si256() );
+				_mm256_storeu_si256( reinterpret_cast< __m256i* >( dst + i * 2 ), _mm256_blendv_epi8( result, c1, keep ) );
 			}
+			blendRow_RGBA4_to_RGB565_Scalar( src + i * 2, dst + i * 2, alpha, n - i );
+		}
 
-			++dstColor;
-			++srcColor;
+		/** Checks the CPU and the operating system for AVX2 support.
+		 */
+		bool hasAVX2() {
+#if defined(__GNUC__)
+			__builtin_cpu_init();
+			return __builtin_cpu_supports( "avx2" ) != 0;
+#else
+			int32_t info[4];
+			__cpuid( info, 0 );
+			if( info[0] < 7 ) {
+				return false;
+			}
+			__cpuid( info, 1 );
+			// the OS has to save the AVX registers
+			const bool osxsave = ( info[2] & ( 1 << 27 ) ) != 0;
+			if( !osxsave || ( _xgetbv( 0 ) & 6 ) != 6 ) {
+				return false;
+			}
+			__cpuidex( info, 7, 0 );
+			return ( info[1] & ( 1 << 5 ) ) != 0;
+#endif
+		}
+#endif
+
+		BlendFunctions getBlendFunctions( BlendInstructionSet set ) {
+			BlendFunctions functions = {
+				blendRow_RGBA8_to_RGBA8_Scalar,
+				blendRow_RGBA8_to_RGB8_Scalar,
+				blendRow_RGBA8_to_RGB565_Scalar,
+				blendRow_RGBA4_to_RGB565_Scalar
+			};
+			switch( set ) {
+#if defined(FIFE_BLEND_SSE2)
+				case BLEND_SSE2:
+					functions.rgba8ToRgba8 = blendRow_RGBA8_to_RGBA8_SSE2;
+					// without a byte shuffle the 3 byte pixels cost more than the blending saves,
+					// an SSE2 version measured no faster than the scalar one
+					functions.rgba8ToRgb565 = blendRow_RGBA8_to_RGB565_SSE2;
+					functions.rgba4ToRgb565 = blendRow_RGBA4_to_RGB565_SSE2;
+					break;
+#endif
+#if defined(FIFE_BLEND_AVX2)
+				case BLEND_AVX2:
+					functions.rgba8ToRgba8 = blendRow_RGBA8_to_RGBA8_AVX2;
+					functions.rgba8ToRgb8 = blendRow_RGBA8_to_RGB8_AVX2;
+					functions.rgba8ToRgb565 = blendRow_RGBA8_to_RGB565_AVX2;
+					functions.rgba4ToRgb565 = blendRow_RGBA4_to_RGB565_AVX2;
+					break;
+#endif
+				default:
+					break;
+			}
+			return functions;
+		}
+
+		BlendInstructionSet detectBlendInstructionSet() {
+#if defined(FIFE_BLEND_AVX2)
+			if( hasAVX2() ) {
+				return BLEND_AVX2;
+			}
+#endif
+#if defined(FIFE_BLEND_SSE2)
+			return BLEND_SSE2;
+#else
+			return BLEND_SCALAR;
+#endif
+		}
+
+		// selected once on start up, SDL_SetBlendInstructionSet can change it
+		BlendInstructionSet s_blendSet = detectBlendInstructionSet();
+		BlendFunctions s_blendFunctions = getBlendFunctions( s_blendSet );
+	}
+
+	void SDL_BlendRow_RGBA8_to_RGBA8( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+		// the SIMD versions need alpha * 255 to fit into 16 bits
+		if( alpha > 255 ) {
+			blendRow_RGBA8_to_RGBA8_Scalar( src, dst, alpha, n );
+		} else {
+			s_blendFunctions.rgba8ToRgba8( src, dst, alpha, n );
 		}
 	}
 
+	void SDL_BlendRow_RGBA8_to_RGB8( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+		if( alpha > 255 ) {
+			blendRow_RGBA8_to_RGB8_Scalar( src, dst, alpha, n );
+		} else {
+			s_blendFunctions.rgba8ToRgb8( src, dst, alpha, n );
+		}
+	}
+
+	void SDL_BlendRow_RGBA8_to_RGB565( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
+		if( alpha > 255 ) {
+			blendRow_RGBA8_to_RGB565_Scalar( src, dst, alpha, n );
+		} else {
+			s_blendFunctions.rgba8ToRgb565( src, dst, alpha, n );
+		}
+	}
 
 	void SDL_BlendRow_RGBA4_to_RGB565( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n ) {
-		const uint16_t* srcColor = reinterpret_cast< const uint16_t* >( src );
-		uint16_t* dstColor = reinterpret_cast< uint16_t* >( dst );
-
-		for( int32_t i = n; 0 < i; --i ) {
-			uint32_t c1 = *dstColor;
-			uint32_t c2 = *srcColor;
-
-			uint32_t aMulA = c2 & 0xF;
-			aMulA = ( alpha * aMulA ) / 15;	///< upgrade to range 0-255
-			if( aMulA ) {
-				uint32_t OneMin_aMulA = 255 - aMulA;
-				uint32_t result;
-				result = ( ( ( ( c2 & 0xF000 ) | 0x0800 ) * aMulA ) + ( ( c1 & 0xF800 ) * OneMin_aMulA ) ) & 0xF80000;
-				result |= ( ( ( ( ( c2 & 0x0F00 ) >> 1 ) | 0x0040 ) * aMulA ) + ( ( c1 & 0x07E0 ) * OneMin_aMulA ) ) & 0x07E000;
-				result |= ( ( ( ( ( c2 & 0x00F0 ) >> 3 ) | 0x0001 ) * aMulA ) + ( ( c1 & 0x001F ) * OneMin_aMulA ) ) & 0x001F00;
-				/// multiplying by alpha resulted in shift.
-				*dstColor = static_cast< uint16_t >( result >> 8 );
-			}
+		if( alpha > 255 ) {
+			blendRow_RGBA4_to_RGB565_Scalar( src, dst, alpha, n );
+		} else {
+			s_blendFunctions.rgba4ToRgb565( src, dst, alpha, n );
+		}
+	}
 
-			++dstColor;
-			++srcColor;
+	bool SDL_IsBlendInstructionSetSupported( BlendInstructionSet set ) {
+		switch( set ) {
+			case BLEND_SCALAR:
+				return true;
+#if defined(FIFE_BLEND_SSE2)
+			case BLEND_SSE2:
+				return true;
+#endif
+#if defined(FIFE_BLEND_AVX2)
+			case BLEND_AVX2:
+				return hasAVX2();
+#endif
+			default:
+				return false;
 		}
 	}
 
+	BlendInstructionSet SDL_GetBlendInstructionSet() {
+		return s_blendSet;
+	}
+
+	bool SDL_SetBlendInstructionSet( BlendInstructionSet set ) {
+		if( !SDL_IsBlendInstructionSetSupported( set ) ) {
+			return false;
+		}
+		s_blendSet = set;
+		s_blendFunctions = getBlendFunctions( set );
+		return true;
+	}
 }
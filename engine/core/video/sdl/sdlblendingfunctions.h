@@ -35,6 +35,8 @@
 namespace FIFE {
 
 	/** Blends one row of n pixels from src with n pixels of dst.
+	 * The functions dispatch to SIMD versions if the CPU supports them
+	 * and alpha is not greater than 255, see SDL_SetBlendInstructionSet.
  	 *
  	 * @param src Source.
  	 * @param dst Destiny.
@@ -70,6 +72,33 @@ namespace FIFE {
  	 */
 	void SDL_BlendRow_RGBA4_to_RGB565( const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n );
 
+	/** Instruction sets the blending functions can be implemented with.
+	 * All implementations produce exactly the same pixels.
+	 */
+	enum BlendInstructionSet {
+		BLEND_SCALAR = 0,
+		BLEND_SSE2,
+		BLEND_AVX2,
+		// reserved for an ARM implementation, not supported yet
+		BLEND_NEON
+	};
+
+	/** Checks if the CPU and the build support the instruction set.
+	 */
+	bool SDL_IsBlendInstructionSetSupported( BlendInstructionSet set );
+
+	/** Returns the instruction set the blending functions currently use.
+	 * On start up this is the best one supported by the CPU.
+	 */
+	BlendInstructionSet SDL_GetBlendInstructionSet();
+
+	/** Selects the implementation of the blending functions, e.g. to compare them.
+	 *
+	 * @param set The instruction set to use.
+	 * @return False if the set is not supported, the current one is kept in that case.
+	 */
+	bool SDL_SetBlendInstructionSet( BlendInstructionSet set );
+
 }
 
 #endif
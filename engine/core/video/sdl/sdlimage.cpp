@@ -85,6 +85,8 @@ namespace FIFE {
 
 	void SDLImage::invalidate() {
 		if (m_texture && !m_shared) {
+			// the texture can be part of the pending batch
+			static_cast<RenderBackendSDL*>(RenderBackend::instance())->flushBatch();
 			SDL_DestroyTexture(m_texture);
 		}
 		m_texture = NULL;
@@ -108,6 +110,10 @@ namespace FIFE {
 			rect.bottom() < 0 || rect.y > static_cast<int32_t>(target->h)) {
 			return;
 		}
+		touch();
+		if (m_atlas_img) {
+			m_atlas_img->touch();
+		}
 
 		SDL_Rect tarRect;
 		tarRect.x = rect.x;
@@ -122,7 +128,8 @@ namespace FIFE {
 		srcRect.w = tmpRect.w;
 		srcRect.h = tmpRect.h;
 
-		SDL_Renderer* renderer = static_cast<RenderBackendSDL*>(RenderBackend::instance())->getRenderer();
+		RenderBackendSDL* rb = static_cast<RenderBackendSDL*>(RenderBackend::instance());
+		SDL_Renderer* renderer = rb->getRenderer();
 
 		// create texture
 		if (!m_texture) {
@@ -132,20 +139,15 @@ namespace FIFE {
 			m_texture = SDL_CreateTextureFromSurface(renderer, m_surface);
 		}
 		
-		// set additonal color and alpha mods
+		// additonal color and alpha mods, drawn with the batch of the texture
+		SDL_Color color = { 255, 255, 255, alpha };
 		if (rgb) {
-			SDL_SetTextureColorMod(m_texture, rgb[0], rgb[1], rgb[2]);
-			SDL_SetTextureAlphaMod(m_texture, rgb[3]);
-		} else {
-			SDL_SetTextureColorMod(m_texture, 255, 255, 255);
-			SDL_SetTextureAlphaMod(m_texture, 255);
-		}
-		// set render color
-		SDL_SetRenderDrawColor(renderer, 255, 255, 255, alpha);
-
-		if (SDL_RenderCopy(renderer, m_texture, &srcRect, &tarRect) != 0) {
-			throw SDLException(SDL_GetError());
+			color.r = rgb[0];
+			color.g = rgb[1];
+			color.b = rgb[2];
+			color.a = static_cast<uint8_t>(rgb[3] * alpha / 255);
 		}
+		rb->addQuadToBatch(m_texture, srcRect, tarRect, color);
 	}
 
 	size_t SDLImage::getSize() {
@@ -153,6 +155,10 @@ namespace FIFE {
 		if (m_surface && !m_shared) {
 			size += m_surface->h * m_surface->pitch;
 		}
+		// the texture is owned by the atlas image in case of shared images
+		if (m_texture && !m_shared) {
+			size += getWidth() * getHeight() * 4;
+		}
 
 		return size;
 	}
@@ -230,6 +236,7 @@ namespace FIFE {
 			return;
 		}
 		if (m_texture && !m_shared) {
+			static_cast<RenderBackendSDL*>(RenderBackend::instance())->flushBatch();
 			SDL_DestroyTexture(m_texture);
 		}
 		m_texture = texture;
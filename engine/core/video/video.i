@@ -129,6 +129,35 @@ namespace FIFE {
 		virtual void invalidate(const std::string& name);
 		virtual void invalidate(ResourceHandle handle);
 		virtual void invalidateAll();
+
+		void setAtlasingEnabled(bool enabled);
+		bool isAtlasingEnabled() const;
+		void setAtlasPageSize(uint32_t size);
+		uint32_t getAtlasPageSize() const;
+		void setAtlasingThreshold(uint32_t uses);
+		uint32_t getAtlasingThreshold() const;
+		uint32_t getAtlasPageCount() const;
+		uint32_t getAtlasedImageCount() const;
+		ImagePtr loadAsync(const std::string& name);
+		void prefetch(const std::vector<std::string>& names);
+		bool isLoadPending(ResourceHandle handle) const;
+		uint32_t getPendingLoadCount() const;
+		void setAsyncUploadBudget(uint32_t microseconds);
+		uint32_t getAsyncUploadBudget() const;
+		void setAsyncLoadingEnabled(bool enabled);
+		bool isAsyncLoadingEnabled() const;
+		void setAsyncWorkerCount(uint32_t count);
+		uint32_t getAsyncWorkerCount() const;
+		void setMemoryBudget(size_t bytes);
+		size_t getMemoryBudget() const;
+		size_t getResidentBytes() const;
+		uint32_t getEvictionCount() const;
+		uint32_t getReloadCount() const;
+		void setTextureCacheDirectory(const std::string& directory);
+		std::string getTextureCacheDirectory() const;
+		void clearTextureCache();
+		uint32_t getTextureCacheHitCount() const;
+		uint32_t getTextureCacheMissCount() const;
 	};
 	
 	class Animation: public IResource {
@@ -223,6 +252,10 @@ namespace FIFE {
 		bool isFramebufferEnabled() const;
 		void setNPOTEnabled(bool enabled);
 		bool isNPOTEnabled() const;
+		void setVertexBufferEnabled(bool enabled);
+		bool isVertexBufferEnabled() const;
+		void setShadersEnabled(bool enabled);
+		bool isShadersEnabled() const;
 		void setTextureFiltering(TextureFiltering filter);
 		TextureFiltering getTextureFiltering() const;
 		void setMipmappingEnabled(bool enabled);
@@ -242,6 +275,9 @@ namespace FIFE {
 		bool isFrameLimitEnabled() const;
 		void setFrameLimit(uint16_t framelimit);
 		uint16_t getFrameLimit() const;
+		uint32_t getDrawCallCount() const;
+		uint32_t getTextureBindCount() const;
+		uint32_t getUploadedBytes() const;
 	};
 	
 	enum MouseCursorType {
@@ -20,6 +20,16 @@
  ***************************************************************************/
 
 // Standard C++ library includes
+#include <algorithm>
+#include <functional>
+
+// Platform specific includes
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FIFE_CAMERA_SSE2
+#endif
 
 // 3rd party library includes
 
@@ -47,6 +57,7 @@
 
 #include "camera.h"
 #include "layercache.h"
+#include "staticlayercache.h"
 #include "visual.h"
 
 
@@ -77,6 +88,57 @@ namespace FIFE {
 		}
 	};
 
+	/** Applies the affine part of matrix to count points.
+	 *  The operations are done in the same order as in DoubleMatrix::operator*,
+	 *  so the vectorized paths give bit-identical results to the scalar one.
+	 */
+	static void transformPoints(const DoubleMatrix& matrix, const DoublePoint3D* in, DoublePoint3D* out, uint32_t count) {
+#if defined(__AVX__)
+		// one point per iteration, x, y and z in one register
+		const __m256d c0 = _mm256_loadu_pd(&matrix.m[0]);
+		const __m256d c1 = _mm256_loadu_pd(&matrix.m[4]);
+		const __m256d c2 = _mm256_loadu_pd(&matrix.m[8]);
+		const __m256d c3 = _mm256_loadu_pd(&matrix.m[12]);
+		for (uint32_t i = 0; i < count; ++i) {
+			const DoublePoint3D& p = in[i];
+			__m256d r = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(p.x), c0), _mm256_mul_pd(_mm256_set1_pd(p.y), c1));
+			r = _mm256_add_pd(_mm256_add_pd(r, _mm256_mul_pd(_mm256_set1_pd(p.z), c2)), c3);
+			_mm_storeu_pd(&out[i].x, _mm256_castpd256_pd128(r));
+			_mm_store_sd(&out[i].z, _mm256_extractf128_pd(r, 1));
+		}
+#elif defined(FIFE_CAMERA_SSE2)
+		// x and y in one register, z in the lower half of a second one
+		const __m128d c0 = _mm_loadu_pd(&matrix.m[0]);
+		const __m128d c1 = _mm_loadu_pd(&matrix.m[4]);
+		const __m128d c2 = _mm_loadu_pd(&matrix.m[8]);
+		const __m128d c3 = _mm_loadu_pd(&matrix.m[12]);
+		const __m128d z0 = _mm_set_sd(matrix.m[2]);
+		const __m128d z1 = _mm_set_sd(matrix.m[6]);
+		const __m128d z2 = _mm_set_sd(matrix.m[10]);
+		const __m128d z3 = _mm_set_sd(matrix.m[14]);
+		for (uint32_t i = 0; i < count; ++i) {
+			const DoublePoint3D& p = in[i];
+			const __m128d x = _mm_set1_pd(p.x);
+			const __m128d y = _mm_set1_pd(p.y);
+			const __m128d z = _mm_set1_pd(p.z);
+			__m128d xy = _mm_add_pd(_mm_mul_pd(x, c0), _mm_mul_pd(y, c1));
+			xy = _mm_add_pd(_mm_add_pd(xy, _mm_mul_pd(z, c2)), c3);
+			__m128d zz = _mm_add_sd(_mm_mul_sd(x, z0), _mm_mul_sd(y, z1));
+			zz = _mm_add_sd(_mm_add_sd(zz, _mm_mul_sd(z, z2)), z3);
+			_mm_storeu_pd(&out[i].x, xy);
+			_mm_store_sd(&out[i].z, zz);
+		}
+#else
+		const double* m = matrix.m;
+		for (uint32_t i = 0; i < count; ++i) {
+			const DoublePoint3D p = in[i];
+			out[i].x = p.x * m[0] + p.y * m[4] + p.z * m[8] + m[12];
+			out[i].y = p.x * m[1] + p.y * m[5] + p.z * m[9] + m[13];
+			out[i].z = p.x * m[2] + p.y * m[6] + p.z * m[10] + m[14];
+		}
+#endif
+	}
+
 	Camera::Camera(const std::string& id, Map* map, const Rect& viewport, RenderBackend* renderbackend) :
 		m_id(id),
 		m_map(map),
@@ -105,6 +167,7 @@ namespace FIFE {
 		m_pipeline(),
 		m_updated(false),
 		m_layerToInstances(),
+		m_pickingIndices(),
 		m_lighting(false),
 		m_light_colors(),
 		m_col_overlay(false),
@@ -430,10 +493,34 @@ namespace FIFE {
 		return pt;
 	}
 
+	void Camera::toVirtualScreenCoordinates(const ExactModelCoordinate* map_coords, DoublePoint3D* vs_coords, uint32_t count) {
+		transformPoints(m_vs_matrix, map_coords, vs_coords, count);
+	}
+
 	ScreenPoint Camera::virtualScreenToScreen(const DoublePoint3D& p) {
 		return doublePt2intPt(m_vscreen_2_screen * p);
 	}
 
+	void Camera::virtualScreenToScreen(const DoublePoint3D* p, ScreenPoint* screen_coords, uint32_t count) {
+		// transforms in small chunks, so the intermediate results stay in the cache
+		const uint32_t chunkSize = 256;
+		DoublePoint3D chunk[chunkSize];
+		for (uint32_t offset = 0; offset < count; offset += chunkSize) {
+			uint32_t size = std::min(chunkSize, count - offset);
+			transformPoints(m_vscreen_2_screen, p + offset, chunk, size);
+			for (uint32_t i = 0; i < size; ++i) {
+				screen_coords[offset + i] = doublePt2intPt(chunk[i]);
+			}
+		}
+	}
+
+	DoublePoint Camera::virtualScreenToScreenDistance(const DoublePoint3D& distance) const {
+		// only the linear part, the translation holds the camera position
+		const DoubleMatrix& m = m_vscreen_2_screen;
+		return DoublePoint(distance.x * m[0] + distance.y * m[4] + distance.z * m[8],
+			distance.x * m[1] + distance.y * m[5] + distance.z * m[9]);
+	}
+
 	DoublePoint3D Camera::screenToVirtualScreen(const ScreenPoint& p) {
 		return m_screen_2_vscreen * intPt2doublePt(p);
 	}
@@ -521,57 +608,105 @@ namespace FIFE {
 		return m_layerToInstances[layer];
 	}
 
+	void Camera::invalidatePickingIndex(Layer* layer) {
+		std::map<Layer*, PickingIndex>::iterator it = m_pickingIndices.find(layer);
+		if (it != m_pickingIndices.end()) {
+			it->second.valid = false;
+		}
+	}
+
+	/** Collects the indices stored in all visited nodes of the picking tree.
+	 */
+	class PickingTreeCollector {
+		public:
+			PickingTreeCollector(std::vector<int32_t>& indices)
+				: m_indices(indices) {
+			}
+			template<typename Node>
+			bool visit(Node* node, int32_t) {
+				std::vector<int32_t>& data = node->data();
+				m_indices.insert(m_indices.end(), data.begin(), data.end());
+				return true;
+			}
+		private:
+			std::vector<int32_t>& m_indices;
+	};
+
+	void Camera::collectPickingCandidates(Layer* layer, const Rect& area, std::vector<int32_t>& indices) {
+		const RenderList& layer_instances = m_layerToInstances[layer];
+		PickingIndex& index = m_pickingIndices[layer];
+		if (!index.valid) {
+			index.tree.clear();
+			for (uint32_t i = 0; i < layer_instances.size(); ++i) {
+				const Rect& dimensions = layer_instances[i]->dimensions;
+				index.tree.data(index.tree.find_container(dimensions)).push_back(i);
+			}
+			index.valid = true;
+		}
+
+		PickingTreeCollector collector(indices);
+		index.tree.apply_visitor(area, collector);
+		// the loose bounds only preselect, keep the items that really intersect
+		std::vector<int32_t>::iterator it = indices.begin();
+		for (; it != indices.end();) {
+			if (layer_instances[*it]->dimensions.intersects(area)) {
+				++it;
+			} else {
+				it = indices.erase(it);
+			}
+		}
+		// RenderList order is back to front, the topmost instance is picked first
+		std::sort(indices.begin(), indices.end(), std::greater<int32_t>());
+	}
+
+	/** Maps a position relative to the screen dimensions of a render item to image coordinates.
+	 */
+	static void toImageCoordinates(const RenderItem& vc, bool zoomed, int32_t& x, int32_t& y) {
+		if (zoomed) {
+			double fx = static_cast<double>(x);
+			double fy = static_cast<double>(y);
+			double fow = static_cast<double>(vc.image->getWidth());
+			double foh = static_cast<double>(vc.image->getHeight());
+			double fsw = static_cast<double>(vc.dimensions.w);
+			double fsh = static_cast<double>(vc.dimensions.h);
+			x = static_cast<int32_t>(round(fx / fsw * fow));
+			y = static_cast<int32_t>(round(fy / fsh * foh));
+		}
+	}
+
+	/** Checks if the render item has a visible pixel at the given image coordinates.
+	 * Uses the alpha masks of the images, see Image::isPixelTransparent.
+	 */
+	static bool isPixelHit(const RenderItem& vc, int32_t x, int32_t y, uint8_t alpha) {
+		std::vector<ImagePtr>* ao = vc.getAnimationOverlay();
+		if (ao) {
+			std::vector<ImagePtr>::iterator it = ao->begin();
+			for (; it != ao->end(); ++it) {
+				if (!(*it)->isPixelTransparent(x, y, alpha)) {
+					return true;
+				}
+			}
+			return false;
+		}
+		return !vc.image->isPixelTransparent(x, y, alpha);
+	}
+
 	void Camera::getMatchingInstances(ScreenPoint screen_coords, Layer& layer, std::list<Instance*>& instances, uint8_t alpha) {
 		instances.clear();
 		bool zoomed = !Mathd::Equal(m_zoom, 1.0);
-		bool special_alpha = alpha != 0;
 
 		const RenderList& layer_instances = m_layerToInstances[&layer];
-		RenderList::const_iterator instance_it = layer_instances.end();
-		while (instance_it != layer_instances.begin()) {
-			--instance_it;
-			Instance* i = (*instance_it)->instance;
-			const RenderItem& vc = **instance_it;
-			if ((vc.dimensions.contains(Point(screen_coords.x, screen_coords.y)))) {
-				if(vc.image->isSharedImage()) {
-					vc.image->forceLoadInternal();
-				}
-				uint8_t r, g, b, a = 0;
-				int32_t x = screen_coords.x - vc.dimensions.x;
-				int32_t y = screen_coords.y - vc.dimensions.y;
-				if (zoomed) {
-					double fx = static_cast<double>(x);
-					double fy = static_cast<double>(y);
-					double fow = static_cast<double>(vc.image->getWidth());
-					double foh = static_cast<double>(vc.image->getHeight());
-					double fsw = static_cast<double>(vc.dimensions.w);
-					double fsh = static_cast<double>(vc.dimensions.h);
-					x = static_cast<int32_t>(round(fx / fsw * fow));
-					y = static_cast<int32_t>(round(fy / fsh * foh));
-				}
-				if (vc.getAnimationOverlay()) {
-					std::vector<ImagePtr>* ao = vc.getAnimationOverlay();
-					std::vector<ImagePtr>::iterator it = ao->begin();
-					for (; it != ao->end(); ++it) {
-						if ((*it)->isSharedImage()) {
-							(*it)->forceLoadInternal();
-						}
-						(*it)->getPixelRGBA(x, y, &r, &g, &b, &a);
-						// instance is hit with mouse if not totally transparent
-						if (a == 0 || (special_alpha && a < alpha)) {
-							continue;
-						}
-						instances.push_back(i);
-						break;
-					}
-				} else {
-					vc.image->getPixelRGBA(x, y, &r, &g, &b, &a);
-					// instance is hit with mouse if not totally transparent
-					if (a == 0 || (special_alpha && a < alpha)) {
-						continue;
-					}
-					instances.push_back(i);
-				}
+		std::vector<int32_t> candidates;
+		collectPickingCandidates(&layer, Rect(screen_coords.x, screen_coords.y, 1, 1), candidates);
+		std::vector<int32_t>::const_iterator candidate_it = candidates.begin();
+		for (; candidate_it != candidates.end(); ++candidate_it) {
+			const RenderItem& vc = *layer_instances[*candidate_it];
+			int32_t x = screen_coords.x - vc.dimensions.x;
+			int32_t y = screen_coords.y - vc.dimensions.y;
+			toImageCoordinates(vc, zoomed, x, y);
+			// instance is hit with mouse if not totally transparent
+			if (isPixelHit(vc, x, y, alpha)) {
+				instances.push_back(vc.instance);
 			}
 		}
 	}
@@ -579,66 +714,31 @@ namespace FIFE {
 	void Camera::getMatchingInstances(Rect screen_rect, Layer& layer, std::list<Instance*>& instances, uint8_t alpha) {
 		instances.clear();
 		bool zoomed = !Mathd::Equal(m_zoom, 1.0);
-		bool special_alpha = alpha != 0;
 
 		const RenderList& layer_instances = m_layerToInstances[&layer];
-		RenderList::const_iterator instance_it = layer_instances.end();
-		while (instance_it != layer_instances.begin()) {
-			--instance_it;
-			Instance* i = (*instance_it)->instance;;
-			const RenderItem& vc = **instance_it;
-			if ((vc.dimensions.intersects(screen_rect))) {
-				if(vc.image->isSharedImage()) {
-					vc.image->forceLoadInternal();
-				}
-				uint8_t r, g, b, a = 0;
-				int32_t intersection_left = std::max(screen_rect.x, vc.dimensions.x);
-				int32_t intersection_right = std::min(screen_rect.right(), vc.dimensions.right());
-				int32_t intersection_top = std::max(screen_rect.y, vc.dimensions.y);
-				int32_t intersection_bottom = std::min(screen_rect.bottom(), vc.dimensions.bottom());
-
-				for(int32_t xx = intersection_left; xx < intersection_right; xx++) {
-					for(int32_t yy = intersection_top; yy < intersection_bottom; yy++) {
-						int32_t x = xx - vc.dimensions.x;
-						int32_t y = yy - vc.dimensions.y;
-						if (zoomed) {
-							double fx = static_cast<double>(x);
-							double fy = static_cast<double>(y);
-							double fow = static_cast<double>(vc.image->getWidth());
-							double foh = static_cast<double>(vc.image->getHeight());
-							double fsw = static_cast<double>(vc.dimensions.w);
-							double fsh = static_cast<double>(vc.dimensions.h);
-							x = static_cast<int32_t>(round(fx / fsw * fow));
-							y = static_cast<int32_t>(round(fy / fsh * foh));
-						}
-						if (vc.getAnimationOverlay()) {
-							std::vector<ImagePtr>* ao = vc.getAnimationOverlay();
-							std::vector<ImagePtr>::iterator it = ao->begin();
-							for (; it != ao->end(); ++it) {
-								if ((*it)->isSharedImage()) {
-									(*it)->forceLoadInternal();
-								}
-								(*it)->getPixelRGBA(x, y, &r, &g, &b, &a);
-								// instance is hit with mouse if not totally transparent
-								if (a == 0 || (special_alpha && a < alpha)) {
-									continue;
-								}
-								instances.push_back(i);
-								goto found_non_transparent_pixel;
-							}
-						} else {
-							vc.image->getPixelRGBA(x, y, &r, &g, &b, &a);
-							// instance is hit with mouse if not totally transparent
-							if (a == 0 || (special_alpha && a < alpha)) {
-								continue;
-							}
-							instances.push_back(i);
-							goto found_non_transparent_pixel;
-						}
+		std::vector<int32_t> candidates;
+		collectPickingCandidates(&layer, screen_rect, candidates);
+		std::vector<int32_t>::const_iterator candidate_it = candidates.begin();
+		for (; candidate_it != candidates.end(); ++candidate_it) {
+			const RenderItem& vc = *layer_instances[*candidate_it];
+			int32_t intersection_left = std::max(screen_rect.x, vc.dimensions.x);
+			int32_t intersection_right = std::min(screen_rect.right(), vc.dimensions.right());
+			int32_t intersection_top = std::max(screen_rect.y, vc.dimensions.y);
+			int32_t intersection_bottom = std::min(screen_rect.bottom(), vc.dimensions.bottom());
+
+			for(int32_t xx = intersection_left; xx < intersection_right; xx++) {
+				for(int32_t yy = intersection_top; yy < intersection_bottom; yy++) {
+					int32_t x = xx - vc.dimensions.x;
+					int32_t y = yy - vc.dimensions.y;
+					toImageCoordinates(vc, zoomed, x, y);
+					// instance is hit with mouse if not totally transparent
+					if (isPixelHit(vc, x, y, alpha)) {
+						instances.push_back(vc.instance);
+						goto found_non_transparent_pixel;
 					}
 				}
-				found_non_transparent_pixel:;
 			}
+			found_non_transparent_pixel:;
 		}
 	}
 
@@ -755,6 +855,7 @@ namespace FIFE {
 		delete m_cache[layer];
 		m_cache.erase(layer);
 		m_layerToInstances.erase(layer);
+		m_pickingIndices.erase(layer);
 		if (m_location.getLayer() == layer) {
 			m_location.reset();
 		}
@@ -900,60 +1001,6 @@ namespace FIFE {
 		}
 	}
 
-	void Camera::renderStaticLayer(Layer* layer, bool update) {
-		// ToDo: Remove this function from the camera class to something like engine pre-render.
-		// ToDo: Check if partial rendering of only updated RenderItems to existing FBO is possible/faster in our case.
-		// ToDo: Add and fix support for SDL backend, for SDL it works only on the lowest layer(alpha/transparent bug).
-		LayerCache* cache = m_cache[layer];
-		ImagePtr cacheImage = cache->getCacheImage();
-		if (!cacheImage.get()) {
-			// the cacheImage name will be, camera id + _virtual_layer_image_ + layer id
-			cacheImage = ImageManager::instance()->loadBlank(m_id+"_virtual_layer_image_"+layer->getId(), m_viewport.w, m_viewport.h);
-			cache->setCacheImage(cacheImage);
-			update = true;
-		}
-		if (update) {
-			// for the case that the viewport size is not the same as the screen size,
-			// we have to change the values for OpenGL backend
-			Rect rec(0, m_renderbackend->getHeight()-m_viewport.h, m_viewport.w, m_viewport.h);
-			if (m_renderbackend->getName() == "SDL") {
-				rec = m_viewport;
-			}
-			m_renderbackend->attachRenderTarget(cacheImage, true);
-			// here we use the new viewport size
-			m_renderbackend->pushClipArea(rec, false);
-			// render stuff to texture
-			RenderList& instancesToRender = m_layerToInstances[layer];
-			// split the RenderList into smaller parts
-			if (instancesToRender.size() > MAX_BATCH_SIZE) {
-				uint8_t batches = ceil(instancesToRender.size() / static_cast<float>(MAX_BATCH_SIZE));
-				uint32_t residual = instancesToRender.size() % MAX_BATCH_SIZE;
-				for (uint8_t i = 0; i < batches; ++i) {
-					uint32_t start = i*MAX_BATCH_SIZE;
-					uint32_t end = start + ((i+1 == batches) ? residual : MAX_BATCH_SIZE);
-					RenderList tempList(instancesToRender.begin() + start, instancesToRender.begin() + end);
-					std::list<RendererBase*>::iterator r_it = m_pipeline.begin();
-					for (; r_it != m_pipeline.end(); ++r_it) {
-						if ((*r_it)->isActivedLayer(layer)) {
-							(*r_it)->render(this, layer, tempList);
-							m_renderbackend->renderVertexArrays();
-						}
-					}
-				}
-			} else {
-				std::list<RendererBase*>::iterator r_it = m_pipeline.begin();
-				for (; r_it != m_pipeline.end(); ++r_it) {
-					if ((*r_it)->isActivedLayer(layer)) {
-						(*r_it)->render(this, layer, instancesToRender);
-						m_renderbackend->renderVertexArrays();
-					}
-				}
-			}
-			m_renderbackend->detachRenderTarget();
-			m_renderbackend->popClipArea();
-		}
-	}
-
 	void Camera::updateRenderLists() {
 		if (!m_map) {
 			FL_ERR(_log, "No map for camera found");
@@ -970,10 +1017,9 @@ namespace FIFE {
 				FL_ERR(_log, LMsg("Layer Cache miss! (This shouldn't happen!)") << (*layer_it)->getId());
 			}
 			RenderList& instancesToRender = m_layerToInstances[*layer_it];
-			if ((*layer_it)->isStatic() && m_transform == NoneTransform) {
-				continue;
+			if (cache->update(m_transform, instancesToRender)) {
+				invalidatePickingIndex(*layer_it);
 			}
-			cache->update(m_transform, instancesToRender);
 		}
 		resetUpdates();
 	}
@@ -996,10 +1042,9 @@ namespace FIFE {
 		const std::list<Layer*>& layers = m_map->getLayers();
 		std::list<Layer*>::const_iterator layer_it = layers.begin();
 		for ( ; layer_it != layers.end(); ++layer_it) {
-			// layer with static flag will rendered as one texture
+			// layer with static flag will rendered into tiles, only the dirty tiles are updated
 			if ((*layer_it)->isStatic()) {
-				renderStaticLayer(*layer_it, m_updated);
-				continue;
+				m_cache[*layer_it]->getStaticCache()->update(m_pipeline);
 			}
 		}
 
@@ -1007,13 +1052,20 @@ namespace FIFE {
 
 		layer_it = layers.begin();
 		for ( ; layer_it != layers.end(); ++layer_it) {
-			// layer with static flag will rendered as one texture
+			RenderList& instancesToRender = m_layerToInstances[*layer_it];
+			// layer with static flag will rendered as tiles, other renderers are drawn as usual
 			if ((*layer_it)->isStatic()) {
-				m_cache[*layer_it]->getCacheImage()->render(m_viewport);
+				m_cache[*layer_it]->getStaticCache()->render();
 				m_renderbackend->renderVertexArrays();
+				std::list<RendererBase*>::iterator r_it = m_pipeline.begin();
+				for (; r_it != m_pipeline.end(); ++r_it) {
+					if ((*r_it)->isActivedLayer(*layer_it) && !StaticLayerCache::isCachedRenderer(*r_it)) {
+						(*r_it)->render(this, *layer_it, instancesToRender);
+						m_renderbackend->renderVertexArrays();
+					}
+				}
 				continue;
 			}
-			RenderList& instancesToRender = m_layerToInstances[*layer_it];
 			// split the RenderList into smaller parts
 			if (instancesToRender.size() > MAX_BATCH_SIZE) {
 				uint8_t batches = ceil(instancesToRender.size() / static_cast<float>(MAX_BATCH_SIZE));
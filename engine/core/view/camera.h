@@ -36,6 +36,7 @@
 // Second block: files included from the same folder
 #include "model/structures/location.h"
 #include "util/structures/rect.h"
+#include "util/structures/loosequadtree.h"
 #include "util/math/matrix.h"
 #include "video/animation.h"
 
@@ -259,11 +260,35 @@ namespace FIFE {
 		 */
 		DoublePoint3D toVirtualScreenCoordinates(const ExactModelCoordinate& map_coords);
 
+		/** Transforms a contiguous array of points from map coordinates to virtual screen coordinates.
+		 *  Gives the same results as calling toVirtualScreenCoordinates for every point,
+		 *  but uses SSE2/AVX when available.
+		 *  @param map_coords pointer to the first of count map coordinates
+		 *  @param vs_coords pointer to the first of count points that receive the result
+		 *  @param count number of points to transform
+		 */
+		void toVirtualScreenCoordinates(const ExactModelCoordinate* map_coords, DoublePoint3D* vs_coords, uint32_t count);
+
 		/** Transforms given point from virtual screen coordinates to screen coordinates
 		 *  @return point in screen coordinates
 		 */
 		ScreenPoint virtualScreenToScreen(const DoublePoint3D& p);
 
+		/** Transforms a contiguous array of points from virtual screen coordinates to screen coordinates.
+		 *  Gives the same results as calling virtualScreenToScreen for every point,
+		 *  but uses SSE2/AVX when available.
+		 *  @param p pointer to the first of count virtual screen points
+		 *  @param screen_coords pointer to the first of count points that receive the result
+		 *  @param count number of points to transform
+		 */
+		void virtualScreenToScreen(const DoublePoint3D* p, ScreenPoint* screen_coords, uint32_t count);
+
+		/** Transforms the distance between two virtual screen points to screen pixels
+		 *  The result is not rounded and does not depend on the camera position.
+		 *  @return distance in screen pixels
+		 */
+		DoublePoint virtualScreenToScreenDistance(const DoublePoint3D& distance) const;
+
 		/** Transforms given point from screen coordinates to virtual screen coordinates
 		 *  @return point in virtual screen coordinates
 		 */
@@ -278,9 +303,14 @@ namespace FIFE {
 		bool isEnabled();
 
 		/** Returns reference to RenderList.
+		 * Call invalidatePickingIndex after changing the list.
 		 */
 		RenderList& getRenderListRef(Layer* layer);
 
+		/** Marks the picking index of the layer as outdated, it is rebuilt on the next pick.
+		 */
+		void invalidatePickingIndex(Layer* layer);
+
 		/** Returns instances that match given screen coordinate
 		 * @param screen_coords screen coordinates to be used for hit search
 		 * @param layer layer to use for search
@@ -451,9 +481,11 @@ namespace FIFE {
 		 */
 		void renderOverlay();
 
-		/** Renders the layer part that is on screen as one image.
+		/** Collects the RenderList indices of the items whose dimensions intersect the area.
+		 * The spatial index of the layer is rebuilt if the RenderList was updated since the last query.
+		 * The indices are sorted descending, so the topmost item comes first.
 		 */
-		void renderStaticLayer(Layer* layer, bool update);
+		void collectPickingCandidates(Layer* layer, const Rect& area, std::vector<int32_t>& indices);
 
 		DoubleMatrix m_matrix;
 		DoubleMatrix m_inverse_matrix;
@@ -492,6 +524,15 @@ namespace FIFE {
 		// caches layer -> instances structure between renders e.g. to fast query of mouse picking order
 		t_layer_to_instances m_layerToInstances;
 
+		// spatial index over the RenderList of a layer, built on demand for mouse picking
+		typedef LooseQuadTree<std::vector<int32_t> > PickingTree;
+		struct PickingIndex {
+			PickingIndex(): valid(false) {}
+			PickingTree tree;
+			bool valid;
+		};
+		std::map<Layer*, PickingIndex> m_pickingIndices;
+
 		std::map<Layer*,LayerCache*> m_cache;
 		MapObserver* m_map_observer;
 
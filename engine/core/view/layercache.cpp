@@ -20,6 +20,7 @@
  ***************************************************************************/
 
 // Standard C++ library includes
+#include <algorithm>
 #include <cfloat>
 
 // 3rd party library includes
@@ -45,6 +46,7 @@
 
 #include "camera.h"
 #include "layercache.h"
+#include "staticlayercache.h"
 #include "visual.h"
 
 
@@ -176,6 +178,9 @@ namespace FIFE {
 		m_layer = 0;
 		m_layerObserver = 0;
 		m_tree = 0;
+		m_looseTree = 0;
+		m_looseIndex = false;
+		m_staticCache = 0;
 		m_zMin = 0.0;
 		m_zMax = 0.0;
 		m_zoom = camera->getZoom();
@@ -201,6 +206,8 @@ namespace FIFE {
 		m_layer->removeChangeListener(m_layerObserver);
 		delete m_layerObserver;
 		delete m_tree;
+		delete m_looseTree;
+		delete m_staticCache;
 	}
 
 	void LayerCache::setLayer(Layer* layer) {
@@ -230,10 +237,20 @@ namespace FIFE {
 		m_instance_map.clear();
 		m_entriesToUpdate.clear();
 		m_freeEntries.clear();
-		m_cacheImage.reset();
+		if (m_staticCache) {
+			m_staticCache->invalidate();
+		}
 
 		delete m_tree;
-		m_tree = new CacheTree;
+		m_tree = 0;
+		delete m_looseTree;
+		m_looseTree = 0;
+		m_looseIndex = m_layer->getSpatialIndexStrategy() == SPATIAL_INDEX_LOOSE_QUADTREE;
+		if (m_looseIndex) {
+			m_looseTree = new LooseCacheTree;
+		} else {
+			m_tree = new CacheTree;
+		}
 		const std::vector<Instance*>& instances = m_layer->getInstances();
 		for(std::vector<Instance*>::const_iterator i = instances.begin();
 			i != instances.end(); ++i) {
@@ -270,6 +287,7 @@ namespace FIFE {
 		}
 
 		entry->node = 0;
+		entry->looseNode = -1;
 		entry->forceUpdate = true;
 		entry->visible = true;
 		entry->updateInfo = EntryFullUpdate;
@@ -283,6 +301,8 @@ namespace FIFE {
 		Entry* entry = m_entries[m_instance_map[instance]];
 		assert(entry->instanceIndex == m_instance_map[instance]);
 		RenderItem* item = m_renderItems[entry->instanceIndex];
+		// the area below the instance has to be redrawn
+		invalidateStaticArea(entry);
 		// removes entry from updates
 		std::set<int32_t>::iterator it = m_entriesToUpdate.find(entry->entryIndex);
 		if (it != m_entriesToUpdate.end()) {
@@ -293,6 +313,11 @@ namespace FIFE {
 			entry->node->data().erase(entry->entryIndex);
 			entry->node = 0;
 		}
+		if (entry->looseNode != -1) {
+			std::vector<int32_t>& indices = m_looseTree->data(entry->looseNode);
+			indices.erase(std::find(indices.begin(), indices.end(), entry->entryIndex));
+			entry->looseNode = -1;
+		}
 		entry->instanceIndex = -1;
 		entry->forceUpdate = false;
 		m_instance_map.erase(instance);
@@ -302,6 +327,7 @@ namespace FIFE {
 		for (RenderList::iterator it = renderList.begin(); it != renderList.end(); ++it) {
 			if ((*it)->instance == instance) {
 				renderList.erase(it);
+				m_camera->invalidatePickingIndex(m_layer);
 				break;
 			}
 		}
@@ -355,7 +381,24 @@ namespace FIFE {
 		return true;
 	}
 
+	class LooseCacheTreeCollector {
+			std::vector<int32_t>& m_indices;
+		public:
+			LooseCacheTreeCollector(std::vector<int32_t>& indices)
+			: m_indices(indices) {
+			}
+			bool visit(LayerCache::LooseCacheTree::Node* node, int32_t d) {
+				m_indices.insert(m_indices.end(), node->data().begin(), node->data().end());
+				return true;
+			}
+	};
+
 	void LayerCache::collect(const Rect& viewport, std::vector<int32_t>& index_list) {
+		if (m_looseIndex) {
+			LooseCacheTreeCollector collector(index_list);
+			m_looseTree->apply_visitor(viewport, collector);
+			return;
+		}
 		CacheTree::Node * node = m_tree->find_container(viewport);
 		CacheTreeCollector collector(index_list, viewport);
 		node->apply_visitor(collector);
@@ -366,7 +409,23 @@ namespace FIFE {
 		}
 	}
 
-	void LayerCache::update(Camera::Transform transform, RenderList& renderlist) {
+	bool LayerCache::update(Camera::Transform transform, RenderList& renderlist) {
+		// static layers are rendered into tiles
+		if (m_layer->isStatic()) {
+			if (!m_staticCache) {
+				m_staticCache = new StaticLayerCache(m_camera, this, m_layer);
+			}
+		} else if (m_staticCache) {
+			delete m_staticCache;
+			m_staticCache = 0;
+		}
+		bool changed = false;
+		// the spatial index strategy of the layer was changed, so the cache is rebuilt
+		if (m_looseIndex != (m_layer->getSpatialIndexStrategy() == SPATIAL_INDEX_LOOSE_QUADTREE)) {
+			changed = !renderlist.empty();
+			renderlist.clear();
+			reset();
+		}
 		// this is only a bit faster, but works without this block too.
 		if(!m_layer->areInstancesVisible()) {
 			FL_DBG(_log, "Layer instances hidden");
@@ -377,14 +436,15 @@ namespace FIFE {
 				entry->visible = false;
 			}
 			m_entriesToUpdate.clear();
+			changed |= !renderlist.empty();
 			renderlist.clear();
-			return;
+			return changed;
 		}
 		// if transform is none then we have only to update the instances with an update info.
 		if (transform == Camera::NoneTransform) {
 			if (!m_entriesToUpdate.empty()) {
 				std::set<int32_t> entryToRemove;
-				updateEntries(entryToRemove, renderlist);
+				changed |= updateEntries(entryToRemove, renderlist);
 				//std::cout << "update entries: " << int32_t(m_entriesToUpdate.size()) << " remove entries: " << int32_t(entryToRemove.size()) <<"\n";
 				if (!entryToRemove.empty()) {
 					std::set<int32_t>::iterator entry_it = entryToRemove.begin();
@@ -394,11 +454,21 @@ namespace FIFE {
 				}
 			}
 		} else {
+			changed = true;
 			m_zoom = m_camera->getZoom();
 			m_zoomed = !Mathd::Equal(m_zoom, 1.0);
 			m_straightZoom = Mathd::Equal(fmod(m_zoom, 1.0), 0.0);
 			// clear old renderlist
 			renderlist.clear();
+			// a pan keeps the tiles of static layers, only the changed entries are redrawn
+			bool keepTiles = m_staticCache && transform == Camera::PositionTransform;
+			std::vector<int32_t> changedEntries;
+			if (keepTiles) {
+				changedEntries.assign(m_entriesToUpdate.begin(), m_entriesToUpdate.end());
+				for (std::vector<int32_t>::iterator it = changedEntries.begin(); it != changedEntries.end(); ++it) {
+					invalidateStaticArea(m_entries[*it]);
+				}
+			}
 			// update all entries
 			if ((transform & Camera::RotationTransform) == Camera::RotationTransform ||
 				(transform & Camera::TiltTransform) == Camera::TiltTransform ||
@@ -407,6 +477,16 @@ namespace FIFE {
 			} else {
 				fullCoordinateUpdate(transform);
 			}
+			if (m_staticCache) {
+				m_staticCache->updateOrigin();
+				if (keepTiles) {
+					for (std::vector<int32_t>::iterator it = changedEntries.begin(); it != changedEntries.end(); ++it) {
+						invalidateStaticArea(m_entries[*it]);
+					}
+				} else {
+					m_staticCache->invalidate();
+				}
+			}
 
 			// create viewport coordinates to collect entries
 			Rect viewport = m_camera->getViewPort();
@@ -455,10 +535,13 @@ namespace FIFE {
 				sortRenderList(renderlist);
 			}
 		}
+		return changed;
 	}
 	
 	void LayerCache::fullUpdate(Camera::Transform transform) {
 		bool rotationChange = (transform & Camera::RotationTransform) == Camera::RotationTransform;
+		m_batchEntries.clear();
+		m_batchMapCoords.clear();
 		for (uint32_t i = 0; i != m_entries.size(); ++i) {
 			Entry* entry = m_entries[i];
 			if (entry->instanceIndex != -1) {
@@ -475,13 +558,36 @@ namespace FIFE {
 						m_entriesToUpdate.insert(entry->entryIndex);
 					}
 				}
-				updatePosition(entry);
+				m_batchEntries.push_back(i);
+				m_batchMapCoords.push_back(m_renderItems[entry->instanceIndex]->instance->getLocationRef().getMapCoordinates());
 			}
 		}
+		if (m_batchEntries.empty()) {
+			return;
+		}
+
+		// map -> virtual screen for all entries at once
+		const uint32_t count = m_batchEntries.size();
+		m_batchVirtualCoords.resize(count);
+		m_camera->toVirtualScreenCoordinates(&m_batchMapCoords[0], &m_batchVirtualCoords[0], count);
+		for (uint32_t i = 0; i != count; ++i) {
+			Entry* entry = m_entries[m_batchEntries[i]];
+			updateVirtualPosition(entry, m_batchVirtualCoords[i]);
+			m_batchVirtualCoords[i] = m_renderItems[entry->instanceIndex]->screenpoint;
+		}
+
+		// virtual screen -> screen for all entries at once
+		m_batchScreenCoords.resize(count);
+		m_camera->virtualScreenToScreen(&m_batchVirtualCoords[0], &m_batchScreenCoords[0], count);
+		for (uint32_t i = 0; i != count; ++i) {
+			setScreenCoordinate(m_renderItems[m_entries[m_batchEntries[i]]->instanceIndex], m_batchScreenCoords[i], true);
+		}
 	}
 
 	void LayerCache::fullCoordinateUpdate(Camera::Transform transform) {
 		bool zoomChange = (transform & Camera::ZoomTransform) == Camera::ZoomTransform;
+		m_batchEntries.clear();
+		m_batchVirtualCoords.clear();
 		for (uint32_t i = 0; i != m_entries.size(); ++i) {
 			Entry* entry = m_entries[i];
 			if (entry->instanceIndex != -1) {
@@ -495,12 +601,25 @@ namespace FIFE {
 					}
 					continue;
 				}
-				updateScreenCoordinate(m_renderItems[entry->instanceIndex], zoomChange);
+				m_batchEntries.push_back(i);
+				m_batchVirtualCoords.push_back(m_renderItems[entry->instanceIndex]->screenpoint);
 			}
 		}
+		if (m_batchEntries.empty()) {
+			return;
+		}
+
+		// virtual screen -> screen for all unchanged entries at once
+		const uint32_t count = m_batchEntries.size();
+		m_batchScreenCoords.resize(count);
+		m_camera->virtualScreenToScreen(&m_batchVirtualCoords[0], &m_batchScreenCoords[0], count);
+		for (uint32_t i = 0; i != count; ++i) {
+			setScreenCoordinate(m_renderItems[m_entries[m_batchEntries[i]]->instanceIndex], m_batchScreenCoords[i], zoomChange);
+		}
 	}
 
-	void LayerCache::updateEntries(std::set<int32_t>& removes, RenderList& renderlist) {
+	bool LayerCache::updateEntries(std::set<int32_t>& removes, RenderList& renderlist) {
+		bool changed = false;
 		RenderList needSorting;
 		Rect viewport = m_camera->getViewPort();
 		std::set<int32_t>::const_iterator entry_it = m_entriesToUpdate.begin();
@@ -514,6 +633,7 @@ namespace FIFE {
 			}
 			RenderItem* item = m_renderItems[entry->instanceIndex];
 			bool onScreenA = entry->visible && item->image && item->dimensions.intersects(viewport);
+			invalidateStaticArea(entry);
 			bool positionUpdate = (entry->updateInfo & EntryPositionUpdate) == EntryPositionUpdate;
 			if ((entry->updateInfo & EntryVisualUpdate) == EntryVisualUpdate) {
 				positionUpdate |= updateVisual(entry);
@@ -521,7 +641,10 @@ namespace FIFE {
 			if (positionUpdate) {
 				updatePosition(entry);
 			}
+			invalidateStaticArea(entry);
 			bool onScreenB = entry->visible && item->image && item->dimensions.intersects(viewport);
+			// a new image of the same size keeps the list and the item dimensions
+			changed |= onScreenA != onScreenB || (onScreenA && positionUpdate);
 			if (onScreenA != onScreenB) {
 				if (!onScreenA) {
 					// add to renderlist and sort
@@ -557,6 +680,7 @@ namespace FIFE {
 				sortRenderList(needSorting);
 			}
 		}
+		return changed;
 	}
 
 	bool LayerCache::updateVisual(Entry* entry) {
@@ -694,9 +818,14 @@ namespace FIFE {
 
 	void LayerCache::updatePosition(Entry* entry) {
 		RenderItem* item = m_renderItems[entry->instanceIndex];
-		Instance* instance = item->instance;
-		ExactModelCoordinate mapCoords = instance->getLocationRef().getMapCoordinates();
-		DoublePoint3D screenPosition = m_camera->toVirtualScreenCoordinates(mapCoords);
+		ExactModelCoordinate mapCoords = item->instance->getLocationRef().getMapCoordinates();
+		updateVirtualPosition(entry, m_camera->toVirtualScreenCoordinates(mapCoords));
+		updateScreenCoordinate(item);
+	}
+
+	void LayerCache::updateVirtualPosition(Entry* entry, const DoublePoint3D& virtualPosition) {
+		RenderItem* item = m_renderItems[entry->instanceIndex];
+		DoublePoint3D screenPosition = virtualPosition;
 		ImagePtr image = item->image;
 
 		if (image) {
@@ -714,9 +843,25 @@ namespace FIFE {
 		item->bbox.x = static_cast<int32_t>(screenPosition.x);
 		item->bbox.y = static_cast<int32_t>(screenPosition.y);
 
-		updateScreenCoordinate(item);
+		updateNode(entry);
+	}
+
+	void LayerCache::updateNode(Entry* entry) {
+		const Rect& bbox = m_renderItems[entry->instanceIndex]->bbox;
+		if (m_looseIndex) {
+			int32_t node = m_looseTree->find_container(bbox);
+			if (node != entry->looseNode) {
+				if (entry->looseNode != -1) {
+					std::vector<int32_t>& indices = m_looseTree->data(entry->looseNode);
+					indices.erase(std::find(indices.begin(), indices.end(), entry->entryIndex));
+				}
+				entry->looseNode = node;
+				m_looseTree->data(node).push_back(entry->entryIndex);
+			}
+			return;
+		}
 
-		CacheTree::Node* node = m_tree->find_container(item->bbox);
+		CacheTree::Node* node = m_tree->find_container(bbox);
 		if (node) {
 			if (node != entry->node) {
 				if (entry->node) {
@@ -729,7 +874,10 @@ namespace FIFE {
 	}
 
 	inline void LayerCache::updateScreenCoordinate(RenderItem* item, bool changedZoom) {
-		Point3D screenPoint = m_camera->virtualScreenToScreen(item->screenpoint);
+		setScreenCoordinate(item, m_camera->virtualScreenToScreen(item->screenpoint), changedZoom);
+	}
+
+	inline void LayerCache::setScreenCoordinate(RenderItem* item, const Point3D& screenPoint, bool changedZoom) {
 		// NOTE:
 		// One would expect this to be necessary here,
 		// however it works the same without, sofar
@@ -803,11 +951,53 @@ namespace FIFE {
 		}
 	}
 
-	ImagePtr LayerCache::getCacheImage() {
-		return m_cacheImage;
+	void LayerCache::invalidateStaticArea(Entry* entry) {
+		if (!m_staticCache || entry->instanceIndex == -1 || !entry->visible) {
+			return;
+		}
+		RenderItem* item = m_renderItems[entry->instanceIndex];
+		if (item->image) {
+			m_staticCache->invalidateArea(item->dimensions);
+		}
+	}
+
+	void LayerCache::collectArea(const Rect& area, RenderList& renderlist) {
+		// the virtual screen area has to contain all four corners, because of the camera rotation
+		DoublePoint3D corners[4] = {
+			m_camera->screenToVirtualScreen(Point3D(area.x, area.y)),
+			m_camera->screenToVirtualScreen(Point3D(area.right(), area.y)),
+			m_camera->screenToVirtualScreen(Point3D(area.x, area.bottom())),
+			m_camera->screenToVirtualScreen(Point3D(area.right(), area.bottom()))
+		};
+		double minX = corners[0].x;
+		double minY = corners[0].y;
+		double maxX = corners[0].x;
+		double maxY = corners[0].y;
+		for (uint8_t i = 1; i < 4; ++i) {
+			minX = std::min(corners[i].x, minX);
+			minY = std::min(corners[i].y, minY);
+			maxX = std::max(corners[i].x, maxX);
+			maxY = std::max(corners[i].y, maxY);
+		}
+		Rect virtualArea(static_cast<int32_t>(minX), static_cast<int32_t>(minY),
+			static_cast<int32_t>(maxX - minX), static_cast<int32_t>(maxY - minY));
+
+		std::vector<int32_t> index_list;
+		collect(virtualArea, index_list);
+		for (uint32_t i = 0; i != index_list.size(); ++i) {
+			Entry* entry = m_entries[index_list[i]];
+			RenderItem* item = m_renderItems[entry->instanceIndex];
+			if (!item->image || !entry->visible) {
+				continue;
+			}
+			if (item->dimensions.intersects(area)) {
+				renderlist.push_back(item);
+			}
+		}
+		sortRenderList(renderlist);
 	}
 
-	void LayerCache::setCacheImage(ImagePtr image) {
-		m_cacheImage = image;
+	StaticLayerCache* LayerCache::getStaticCache() {
+		return m_staticCache;
 	}
 }
@@ -37,6 +37,7 @@
 #include "util/math/matrix.h"
 #include "util/structures/rect.h"
 #include "util/structures/quadtree.h"
+#include "util/structures/loosequadtree.h"
 #include "model/metamodel/grids/cellgrid.h"
 
 #include "rendererbase.h"
@@ -45,24 +46,35 @@ namespace FIFE {
 
 	class Camera;
 	class CacheLayerChangeListener;
+	class StaticLayerCache;
 
 	class LayerCache {
 	public:
 		typedef QuadTree<std::set<int32_t> > CacheTree;
+		typedef LooseQuadTree<std::vector<int32_t> > LooseCacheTree;
 
 		LayerCache(Camera* camera);
 		~LayerCache();
 
 		void setLayer(Layer* layer);
 
-		void update(Camera::Transform transform, RenderList& renderlist);
+		/** Updates the render items and fills the render list of the layer.
+		 * @return true if the render list or the screen dimensions of its items changed
+		 */
+		bool update(Camera::Transform transform, RenderList& renderlist);
 
 		void addInstance(Instance* instance);
 		void removeInstance(Instance* instance);
 		void updateInstance(Instance* instance);
-		
-		ImagePtr getCacheImage();
-		void setCacheImage(ImagePtr image);
+
+		/** Collects the visible render items that intersect the given screen area
+		 * and sorts them in render order.
+		 */
+		void collectArea(const Rect& area, RenderList& renderlist);
+
+		/** Returns the tile cache of the layer, or 0 if the layer is not static.
+		 */
+		StaticLayerCache* getStaticCache();
 
 	private:
 		enum RenderEntryUpdateType {
@@ -76,6 +88,8 @@ namespace FIFE {
 		struct Entry {
 			// Node in m_tree;
 			CacheTree::Node* node;
+			// Node index in m_looseTree;
+			int32_t looseNode;
 			// Index in m_renderItems;
 			int32_t instanceIndex;
 			// Index in m_entries;
@@ -90,19 +104,25 @@ namespace FIFE {
 
 		void collect(const Rect& viewport, std::vector<int32_t>& indices);
 		void reset();
+		void updateNode(Entry* entry);
 		void fullUpdate(Camera::Transform transform);
 		void fullCoordinateUpdate(Camera::Transform transform);
-		void updateEntries(std::set<int32_t>& removes, RenderList& renderlist);
+		bool updateEntries(std::set<int32_t>& removes, RenderList& renderlist);
 		bool updateVisual(Entry* entry);
 		void updatePosition(Entry* entry);
+		void updateVirtualPosition(Entry* entry, const DoublePoint3D& virtualPosition);
 		void updateScreenCoordinate(RenderItem* item, bool changedZoom = true);
+		void setScreenCoordinate(RenderItem* item, const Point3D& screenPoint, bool changedZoom);
 		void sortRenderList(RenderList& renderlist);
+		void invalidateStaticArea(Entry* entry);
 
 		Camera* m_camera;
 		Layer* m_layer;
 		CacheLayerChangeListener* m_layerObserver;
 		CacheTree* m_tree;
-		ImagePtr m_cacheImage;
+		LooseCacheTree* m_looseTree;
+		bool m_looseIndex;
+		StaticLayerCache* m_staticCache;
 
 		std::map<Instance*, int32_t> m_instance_map;
 		std::vector<Entry*> m_entries;
@@ -110,6 +130,12 @@ namespace FIFE {
 		std::set<int32_t> m_entriesToUpdate;
 		std::deque<int32_t> m_freeEntries;
 
+		// buffers for the batched coordinate transformations, kept to avoid reallocations
+		std::vector<int32_t> m_batchEntries;
+		std::vector<ExactModelCoordinate> m_batchMapCoords;
+		std::vector<DoublePoint3D> m_batchVirtualCoords;
+		std::vector<Point3D> m_batchScreenCoords;
+
 		bool m_needSorting;
 		double m_zMin;
 		double m_zMax;
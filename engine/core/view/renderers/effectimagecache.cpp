@@ -0,0 +1,406 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/log/logger.h"
+#include "video/imagemanager.h"
+#include "video/outlinekernel.h"
+#include "video/renderbackend.h"
+
+#include "effectimagecache.h"
+
+namespace FIFE {
+	/** Logger to use for this source file.
+	 *  @relates Logger
+	 */
+	static Logger _log(LM_VIEWVIEW);
+
+	namespace {
+		/** Reads a pixel like Image::getPixelRGBA, pixels outside of the surface are transparent.
+		 */
+		void readPixel(const SDL_Surface* surface, int32_t x, int32_t y, uint8_t* r, uint8_t* g, uint8_t* b, uint8_t* a) {
+			if (x < 0 || x >= surface->w || y < 0 || y >= surface->h) {
+				*r = *g = *b = *a = 0;
+				return;
+			}
+			const int32_t bpp = surface->format->BytesPerPixel;
+			const uint8_t* p = static_cast<const uint8_t*>(surface->pixels) + y * surface->pitch + x * bpp;
+			uint32_t pixel = 0;
+			switch (bpp) {
+			case 1:
+				pixel = *p;
+				break;
+			case 2:
+				pixel = *reinterpret_cast<const uint16_t*>(p);
+				break;
+			case 3:
+				if (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+					pixel = p[0] << 16 | p[1] << 8 | p[2];
+				} else {
+					pixel = p[0] | p[1] << 8 | p[2] << 16;
+				}
+				break;
+			case 4:
+				pixel = *reinterpret_cast<const uint32_t*>(p);
+				break;
+			}
+			SDL_GetRGBA(pixel, surface->format, r, g, b, a);
+		}
+	}
+
+	EffectImageCache::Key::Key() :
+		image(0),
+		type(EFFECT_OUTLINE),
+		r(0),
+		g(0),
+		b(0),
+		a(0),
+		width(0),
+		threshold(0) {
+	}
+
+	bool EffectImageCache::Key::operator<(const Key& rhs) const {
+		if (image != rhs.image) {
+			return image < rhs.image;
+		}
+		if (type != rhs.type) {
+			return type < rhs.type;
+		}
+		const uint32_t color = (r << 24) | (g << 16) | (b << 8) | a;
+		const uint32_t rhsColor = (rhs.r << 24) | (rhs.g << 16) | (rhs.b << 8) | rhs.a;
+		if (color != rhsColor) {
+			return color < rhsColor;
+		}
+		if (width != rhs.width) {
+			return width < rhs.width;
+		}
+		return threshold < rhs.threshold;
+	}
+
+	EffectImageCache::Key EffectImageCache::outlineKey(ResourceHandle image, uint8_t r, uint8_t g, uint8_t b, int32_t width, int32_t threshold) {
+		Key key;
+		key.image = image;
+		key.type = EFFECT_OUTLINE;
+		key.r = r;
+		key.g = g;
+		key.b = b;
+		key.width = width;
+		key.threshold = threshold;
+		return key;
+	}
+
+	EffectImageCache::Key EffectImageCache::coloringKey(ResourceHandle image, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+		Key key;
+		key.image = image;
+		key.type = EFFECT_COLORING;
+		key.r = r;
+		key.g = g;
+		key.b = b;
+		key.a = a;
+		return key;
+	}
+
+	std::string EffectImageCache::getEffectName(const std::string& imageName, const Key& key) {
+		std::stringstream sts;
+		sts << imageName << "," << static_cast<uint32_t>(key.r) << "," <<
+			static_cast<uint32_t>(key.g) << "," << static_cast<uint32_t>(key.b) << ",";
+		if (key.type == EFFECT_OUTLINE) {
+			sts << key.width << "," << key.threshold;
+		} else {
+			sts << static_cast<uint32_t>(key.a);
+		}
+		return sts.str();
+	}
+
+	SDL_Surface* EffectImageCache::createSurface(const SDL_Surface* source, const Rect& rect, const Key& key) {
+		SDL_Surface* surface = SDL_CreateRGBSurface(0, rect.w, rect.h, 32, RMASK, GMASK, BMASK, AMASK);
+		if (key.type == EFFECT_OUTLINE) {
+			AlphaPlane alpha;
+			alpha.extract(source, rect);
+			std::vector<uint8_t> mask(rect.w * rect.h, 0);
+			if (!mask.empty()) {
+				markOutline(alpha, key.threshold, key.width, false, &mask[0], rect.w, rect.h, 0, 0);
+				fillOutline(&mask[0], surface, SDL_MapRGBA(surface->format, key.r, key.g, key.b, 255));
+			}
+			return surface;
+		}
+
+		// coloring, blends the color with the visible pixels
+		uint8_t r, g, b, a = 0;
+		float alphaFactor = static_cast<float>(key.a/255.0);
+		for (int32_t y = 0; y < rect.h; ++y) {
+			uint32_t* dst = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(surface->pixels) + y * surface->pitch);
+			for (int32_t x = 0; x < rect.w; ++x) {
+				readPixel(source, x + rect.x, y + rect.y, &r, &g, &b, &a);
+				if (a > 0) {
+					dst[x] = SDL_MapRGBA(surface->format,
+						static_cast<uint8_t>(key.r*(1.0-alphaFactor) + r*alphaFactor),
+						static_cast<uint8_t>(key.g*(1.0-alphaFactor) + g*alphaFactor),
+						static_cast<uint8_t>(key.b*(1.0-alphaFactor) + b*alphaFactor), a);
+				}
+			}
+		}
+		return surface;
+	}
+
+	EffectImageCache::EffectImageCache() :
+		m_bytes(0),
+		m_maxBytes(32 * 1024 * 1024),
+		m_hits(0),
+		m_misses(0),
+		m_evictions(0),
+		m_stop(false) {
+	}
+
+	EffectImageCache::~EffectImageCache() {
+		stop();
+		for (std::deque<Request>::iterator it = m_requests.begin(); it != m_requests.end(); ++it) {
+			SDL_FreeSurface(it->source);
+		}
+		for (std::deque<Result>::iterator it = m_results.begin(); it != m_results.end(); ++it) {
+			SDL_FreeSurface(it->surface);
+		}
+	}
+
+	ImagePtr EffectImageCache::get(const Key& key) {
+		std::map<Key, Entry>::iterator it = m_entries.find(key);
+		if (it != m_entries.end()) {
+			if (it->second.image->getState() == IResource::RES_LOADED) {
+				m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+				++m_hits;
+				return it->second.image;
+			}
+			// freed by the InstanceRenderer timer, it is created again
+			erase(it);
+		}
+		++m_misses;
+		return ImagePtr();
+	}
+
+	bool EffectImageCache::contains(const Key& key) const {
+		std::map<Key, Entry>::const_iterator it = m_entries.find(key);
+		return it != m_entries.end() && it->second.image->getState() == IResource::RES_LOADED;
+	}
+
+	void EffectImageCache::insert(const Key& key, const ImagePtr& image) {
+		std::map<Key, Entry>::iterator it = m_entries.find(key);
+		if (it != m_entries.end()) {
+			m_bytes -= it->second.bytes;
+			m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+		} else {
+			m_lru.push_front(key);
+			it = m_entries.insert(std::make_pair(key, Entry())).first;
+			it->second.lru = m_lru.begin();
+		}
+		it->second.image = image;
+		it->second.bytes = image->getSize();
+		m_bytes += it->second.bytes;
+		evict();
+	}
+
+	void EffectImageCache::clear() {
+		m_entries.clear();
+		m_lru.clear();
+		m_bytes = 0;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (std::deque<Request>::iterator it = m_requests.begin(); it != m_requests.end(); ++it) {
+			SDL_FreeSurface(it->source);
+		}
+		m_requests.clear();
+		// results of running requests are dropped by popResult()
+		m_pending.clear();
+	}
+
+	void EffectImageCache::setMaxBytes(size_t bytes) {
+		m_maxBytes = bytes;
+		evict();
+	}
+
+	size_t EffectImageCache::getMaxBytes() const {
+		return m_maxBytes;
+	}
+
+	size_t EffectImageCache::getBytes() const {
+		return m_bytes;
+	}
+
+	uint32_t EffectImageCache::getEntryCount() const {
+		return m_entries.size();
+	}
+
+	uint32_t EffectImageCache::getHitCount() const {
+		return m_hits;
+	}
+
+	uint32_t EffectImageCache::getMissCount() const {
+		return m_misses;
+	}
+
+	uint32_t EffectImageCache::getEvictionCount() const {
+		return m_evictions;
+	}
+
+	bool EffectImageCache::enqueue(const Key& key, const std::string& name, const SDL_Surface* source, const Rect& rect) {
+		if (m_pending.find(key) != m_pending.end()) {
+			return true;
+		}
+		const SDL_PixelFormat* format = source->format;
+		if (format->BytesPerPixel != 4 || rect.x < 0 || rect.y < 0 ||
+			rect.right() > source->w || rect.bottom() > source->h) {
+			return false;
+		}
+
+		// the worker gets its own copy, the image could be freed in the meantime
+		Request request;
+		request.key = key;
+		request.name = name;
+		request.source = SDL_CreateRGBSurface(0, rect.w, rect.h, 32,
+			format->Rmask, format->Gmask, format->Bmask, format->Amask);
+		for (int32_t y = 0; y < rect.h; ++y) {
+			std::memcpy(static_cast<uint8_t*>(request.source->pixels) + y * request.source->pitch,
+				static_cast<const uint8_t*>(source->pixels) + (y + rect.y) * source->pitch + rect.x * 4, rect.w * 4);
+		}
+
+		m_pending.insert(key);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_requests.push_back(request);
+			if (!m_worker.joinable()) {
+				m_stop = false;
+				m_worker = std::thread(&EffectImageCache::run, this);
+			}
+		}
+		m_condition.notify_one();
+		return true;
+	}
+
+	bool EffectImageCache::isPending(const Key& key) const {
+		return m_pending.find(key) != m_pending.end();
+	}
+
+	uint32_t EffectImageCache::getPendingCount() const {
+		return m_pending.size();
+	}
+
+	bool EffectImageCache::popResult(Result& result) {
+		for (;;) {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_results.empty()) {
+					return false;
+				}
+				result = m_results.front();
+				m_results.pop_front();
+			}
+			if (m_pending.erase(result.key) > 0) {
+				return true;
+			}
+			// dropped by clear()
+			SDL_FreeSurface(result.surface);
+		}
+	}
+
+	void EffectImageCache::evict() {
+		if (m_maxBytes == 0 || m_bytes <= m_maxBytes) {
+			return;
+		}
+		const uint32_t frame = RenderBackend::instance()->getFrameNumber();
+		uint32_t count = 0;
+		std::list<Key>::iterator lit = m_lru.end();
+		while (m_bytes > m_maxBytes && lit != m_lru.begin()) {
+			--lit;
+			std::map<Key, Entry>::iterator it = m_entries.find(*lit);
+			ImagePtr& image = it->second.image;
+			// keep images that are on screen
+			if (image->getState() == IResource::RES_LOADED && image->getLastUse() + 2 > frame) {
+				continue;
+			}
+			ImageManager* manager = ImageManager::instance();
+			if (manager->exists(image->getHandle())) {
+				manager->remove(image->getHandle());
+			}
+			// erase invalidates lit, the previous element is still valid
+			std::list<Key>::iterator next = lit;
+			++next;
+			erase(it);
+			lit = next;
+			++count;
+		}
+		m_evictions += count;
+		if (count > 0) {
+			FL_DBG(_log, LMsg("EffectImageCache::evict() - ") << "Removed " << count << " effect images.");
+		}
+	}
+
+	void EffectImageCache::erase(std::map<Key, Entry>::iterator it) {
+		m_bytes -= it->second.bytes;
+		m_lru.erase(it->second.lru);
+		m_entries.erase(it);
+	}
+
+	void EffectImageCache::run() {
+		for (;;) {
+			Request request;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				while (!m_stop && m_requests.empty()) {
+					m_condition.wait(lock);
+				}
+				if (m_stop) {
+					return;
+				}
+				request = m_requests.front();
+				m_requests.pop_front();
+			}
+
+			Result result;
+			result.key = request.key;
+			result.name = request.name;
+			result.surface = createSurface(request.source, Rect(0, 0, request.source->w, request.source->h), request.key);
+			SDL_FreeSurface(request.source);
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_results.push_back(result);
+		}
+	}
+
+	void EffectImageCache::stop() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_condition.notify_all();
+		if (m_worker.joinable()) {
+			m_worker.join();
+		}
+	}
+}
@@ -0,0 +1,225 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef FIFE_EFFECTIMAGECACHE_H
+#define FIFE_EFFECTIMAGECACHE_H
+
+// Standard C++ library includes
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+// 3rd party library includes
+#include <SDL.h>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/base/fife_stdint.h"
+#include "util/resource/resource.h"
+#include "util/structures/rect.h"
+#include "video/image.h"
+
+namespace FIFE {
+
+	/** Bounded cache for the outline and coloring images of the InstanceRenderer.
+	 *
+	 * Entries are keyed by the source image and the effect parameters. If the
+	 * cached images need more memory than the budget, the least recently used
+	 * ones are removed from the ImageManager. Images rendered during the last
+	 * two frames are kept.
+	 *
+	 * Effect surfaces can also be created by a worker thread, see enqueue().
+	 * The worker only gets a copy of the source pixels, the images are created
+	 * on the main thread with popResult().
+	 */
+	class EffectImageCache {
+	public:
+		enum EffectType {
+			EFFECT_OUTLINE = 0,
+			EFFECT_COLORING
+		};
+
+		struct Key {
+			Key();
+			bool operator<(const Key& rhs) const;
+
+			// source image
+			ResourceHandle image;
+			EffectType type;
+			uint8_t r;
+			uint8_t g;
+			uint8_t b;
+			// coloring only
+			uint8_t a;
+			// outline only
+			int32_t width;
+			int32_t threshold;
+		};
+
+		struct Result {
+			Key key;
+			// name of the effect image
+			std::string name;
+			// created surface, the receiver takes the ownership
+			SDL_Surface* surface;
+		};
+
+		/** Returns the key of an outline.
+		 */
+		static Key outlineKey(ResourceHandle image, uint8_t r, uint8_t g, uint8_t b, int32_t width, int32_t threshold);
+
+		/** Returns the key of a coloring.
+		 */
+		static Key coloringKey(ResourceHandle image, uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+
+		/** Returns the name of the effect image in the ImageManager.
+		 */
+		static std::string getEffectName(const std::string& imageName, const Key& key);
+
+		/** Creates the surface of an effect image.
+		 * Only reads the source surface, so it can be called from worker threads.
+		 * @param source The surface of the source image.
+		 * @param rect The area of the source image, e.g. the subimage rect of a shared image.
+		 * @param key The effect parameters.
+		 * @return A new 32bit surface with the size of the rect.
+		 */
+		static SDL_Surface* createSurface(const SDL_Surface* source, const Rect& rect, const Key& key);
+
+		EffectImageCache();
+		~EffectImageCache();
+
+		/** Returns the cached image or an empty pointer if there is no loaded one.
+		 * Counts as hit or miss.
+		 */
+		ImagePtr get(const Key& key);
+
+		/** Returns true if a loaded image is cached, doesn't count as hit or miss.
+		 */
+		bool contains(const Key& key) const;
+
+		/** Adds or replaces an image and removes old images if the budget is exceeded.
+		 */
+		void insert(const Key& key, const ImagePtr& image);
+
+		/** Removes all entries and drops pending requests.
+		 * The images stay in the ImageManager.
+		 */
+		void clear();
+
+		/** Sets the memory budget in bytes, 0 means unlimited. Default is 32 MB.
+		 */
+		void setMaxBytes(size_t bytes);
+		size_t getMaxBytes() const;
+
+		/** Returns the memory used by the cached images.
+		 */
+		size_t getBytes() const;
+
+		/** Returns the number of cached images.
+		 */
+		uint32_t getEntryCount() const;
+
+		uint32_t getHitCount() const;
+		uint32_t getMissCount() const;
+
+		/** Returns the number of images that were removed to meet the budget.
+		 */
+		uint32_t getEvictionCount() const;
+
+		/** Queues the creation of an effect surface on the worker thread.
+		 * The source area is copied, only 32bit surfaces are supported.
+		 * @return False if the surface can not be created in background.
+		 */
+		bool enqueue(const Key& key, const std::string& name, const SDL_Surface* source, const Rect& rect);
+
+		/** Returns true if the effect is queued or in progress.
+		 */
+		bool isPending(const Key& key) const;
+
+		/** Returns the number of queued effects.
+		 */
+		uint32_t getPendingCount() const;
+
+		/** Fetches a finished effect surface.
+		 * @return False if no surface is ready.
+		 */
+		bool popResult(Result& result);
+
+	private:
+		struct Entry {
+			ImagePtr image;
+			size_t bytes;
+			std::list<Key>::iterator lru;
+		};
+
+		struct Request {
+			Key key;
+			std::string name;
+			// copy of the source area, owned by the request
+			SDL_Surface* source;
+		};
+
+		/** Removes least recently used entries until the budget is met.
+		 */
+		void evict();
+
+		/** Removes an entry, the image stays in the ImageManager.
+		 */
+		void erase(std::map<Key, Entry>::iterator it);
+
+		/** Worker thread loop.
+		 */
+		void run();
+
+		/** Stops the worker thread.
+		 */
+		void stop();
+
+		std::map<Key, Entry> m_entries;
+		// front is the most recently used entry
+		std::list<Key> m_lru;
+		size_t m_bytes;
+		size_t m_maxBytes;
+		uint32_t m_hits;
+		uint32_t m_misses;
+		uint32_t m_evictions;
+
+		// effects that are queued or in progress, only used by the main thread
+		std::set<Key> m_pending;
+
+		// worker thread, started on first use
+		std::thread m_worker;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_condition;
+		std::deque<Request> m_requests;
+		std::deque<Result> m_results;
+		bool m_stop;
+	};
+}
+
+#endif
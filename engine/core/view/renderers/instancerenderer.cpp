@@ -30,6 +30,7 @@
 #include "video/renderbackend.h"
 #include "video/image.h"
 #include "video/imagemanager.h"
+#include "video/outlinekernel.h"
 #include "video/sdl/sdlimage.h"
 #include "video/animation.h"
 #include "util/math/fife_math.h"
@@ -44,6 +45,8 @@
 #include "model/structures/cell.h"
 #include "model/structures/cellcache.h"
 #include "video/opengl/fife_opengl.h"
+#include "video/opengl/glimage.h"
+#include "video/opengl/renderbackendopengl.h"
 
 #include "view/camera.h"
 #include "view/visual.h"
@@ -122,7 +125,8 @@ namespace FIFE {
 		RendererBase(renderbackend, position),
 		m_area_layer(false),
 		m_interval(60*1000),
-		m_timer_enabled(false) {
+		m_timer_enabled(false),
+		m_effect_cache(new EffectImageCache()) {
 		setEnabled(true);
 		if (m_renderbackend->getName() == "OpenGL" && m_renderbackend->isDepthBufferEnabled()) {
 			m_need_sorting = false;
@@ -135,6 +139,9 @@ namespace FIFE {
 				m_need_bind_coloring = false;
 			}
 		}
+		// outlines and multi color overlays can be generated at draw time
+		m_shade_effects = m_renderbackend->getName() == "OpenGL" &&
+			static_cast<RenderBackendOpenGL*>(m_renderbackend)->hasEffectShaders();
 		// init timer
 		m_timer.setInterval(m_interval);
 		m_timer.setCallback(std::bind(&InstanceRenderer::check, this));
@@ -146,7 +153,9 @@ namespace FIFE {
 		RendererBase(old),
 		m_area_layer(false),
 		m_interval(old.m_interval),
-		m_timer_enabled(false) {
+		m_timer_enabled(false),
+		m_effect_cache(new EffectImageCache()) {
+		m_effect_cache->setMaxBytes(old.m_effect_cache->getMaxBytes());
 		setEnabled(true);
 		if (m_renderbackend->getName() == "OpenGL" && m_renderbackend->isDepthBufferEnabled()) {
 			m_need_sorting = false;
@@ -159,6 +168,9 @@ namespace FIFE {
 				m_need_bind_coloring = false;
 			}
 		}
+		// outlines and multi color overlays can be generated at draw time
+		m_shade_effects = m_renderbackend->getName() == "OpenGL" &&
+			static_cast<RenderBackendOpenGL*>(m_renderbackend)->hasEffectShaders();
 		// init timer
 		m_timer.setInterval(m_interval);
 		m_timer.setCallback(std::bind(&InstanceRenderer::check, this));
@@ -177,6 +189,7 @@ namespace FIFE {
 		}
 		// delete listener
 		delete m_delete_listener;
+		delete m_effect_cache;
 	}
 
 	void InstanceRenderer::render(Camera* cam, Layer* layer, RenderList& instances) {
@@ -187,6 +200,23 @@ namespace FIFE {
 			return;
 		}
 
+		// effect images that were precomputed in background
+		if (m_effect_cache->getPendingCount() > 0) {
+			processEffectResults();
+		}
+
+		// report used images, so that frequently used ones get packed into the runtime atlas
+		ImageManager* imgManager = ImageManager::instance();
+		if (imgManager->isAtlasingEnabled()) {
+			RenderList::iterator it = instances.begin();
+			for (; it != instances.end(); ++it) {
+				const ImagePtr& image = (*it)->image;
+				if (image && !image->isSharedImage()) {
+					imgManager->notifyImageUse(image);
+				}
+			}
+		}
+
 		if(m_need_sorting) {
 			renderAlreadySorted(cam, layer, instances);
 		} else {
@@ -265,6 +295,7 @@ namespace FIFE {
 
 			uint8_t coloringColor[4] = { 0 };
 			Image* outlineImage = 0;
+			OutlineInfo* outlineInfo = 0;
 			bool recoloring = false;
 			if (any_effects) {
 				// coloring
@@ -281,12 +312,15 @@ namespace FIFE {
 				InstanceToOutlines_t::iterator outline_it = m_instance_outlines.find(instance);
 				const bool outline = outline_it != m_instance_outlines.end();
 				if (outline) {
+					// the outline shader needs no outline image
+					Image* image = isShadedOutline(outline_it->second, vc) ? 0 : bindOutline(outline_it->second, vc, cam);
 					if (lm != 0) {
 						// first render normal image without stencil and alpha test (0)
 						// so it wont look aliased and then with alpha test render only outline (its 'binary' image)
-						outlineImage = bindOutline(outline_it->second, vc, cam);
+						outlineInfo = &outline_it->second;
+						outlineImage = image;
 					} else {
-						bindOutline(outline_it->second, vc, cam)->renderZ(vc.dimensions, vertexZ, vc.transparency, static_cast<uint8_t*>(0));
+						renderOutline(image, outline_it->second, vc, true);
 					}
 				}
 			}
@@ -322,8 +356,8 @@ namespace FIFE {
 				vc.image->renderZ(vc.dimensions, vertexZ, vc.transparency, recoloring ? coloringColor : 0);
 			}
 
-			if (outlineImage) {
-				outlineImage->renderZ(vc.dimensions, vertexZ, vc.transparency, static_cast<uint8_t*>(0));
+			if (outlineInfo) {
+				renderOutline(outlineImage, *outlineInfo, vc, true);
 				m_renderbackend->changeRenderInfos(RENDER_DATA_TEXTURE_Z, 1, 4, 5, false, true, 255, REPLACE, ALWAYS);
 			}
 		}
@@ -337,6 +371,7 @@ namespace FIFE {
 
 			uint8_t coloringColor[4] = { 0 };
 			Image* outlineImage = 0;
+			OutlineInfo* outlineInfo = 0;
 			bool recoloring = false;
 			if (any_effects) {
 				// coloring
@@ -353,12 +388,15 @@ namespace FIFE {
 				InstanceToOutlines_t::iterator outline_it = m_instance_outlines.find(instance);
 				const bool outline = outline_it != m_instance_outlines.end();
 				if (outline) {
+					// the outline shader needs no outline image
+					Image* image = isShadedOutline(outline_it->second, vc) ? 0 : bindOutline(outline_it->second, vc, cam);
 					if (lm != 0) {
 						// first render normal image without stencil and alpha test (0)
 						// so it wont look aliased and then with alpha test render only outline (its 'binary' image)
-						outlineImage = bindOutline(outline_it->second, vc, cam);
+						outlineInfo = &outline_it->second;
+						outlineImage = image;
 					} else {
-						bindOutline(outline_it->second, vc, cam)->renderZ(vc.dimensions, vertexZ, vc.transparency, static_cast<uint8_t*>(0));
+						renderOutline(image, outline_it->second, vc, true);
 					}
 				}
 			}
@@ -370,8 +408,8 @@ namespace FIFE {
 				vc.image->renderZ(vc.dimensions, vertexZ, vc.transparency, recoloring ? coloringColor : 0);
 			}
 
-			if (outlineImage) {
-				outlineImage->renderZ(vc.dimensions, vertexZ, vc.transparency, static_cast<uint8_t*>(0));
+			if (outlineInfo) {
+				renderOutline(outlineImage, *outlineInfo, vc, true);
 				m_renderbackend->changeRenderInfos(RENDER_DATA_TEXCOLOR_Z, 1, 4, 5, false, true, 255, REPLACE, ALWAYS);
 			}
 		}
@@ -440,6 +478,7 @@ namespace FIFE {
 
 			uint8_t coloringColor[4] = { 0 };
 			Image* outlineImage = 0;
+			OutlineInfo* outlineInfo = 0;
 			bool recoloring = false;
 			if (any_effects) {
 				// coloring
@@ -456,12 +495,15 @@ namespace FIFE {
 				InstanceToOutlines_t::iterator outline_it = m_instance_outlines.find(instance);
 				const bool outline = outline_it != m_instance_outlines.end();
 				if (outline) {
+					// the outline shader needs no outline image
+					Image* image = isShadedOutline(outline_it->second, vc) ? 0 : bindOutline(outline_it->second, vc, cam);
 					if (lm != 0) {
 						// first render normal image without stencil and alpha test (0)
 						// so it wont look aliased and then with alpha test render only outline (its 'binary' image)
-						outlineImage = bindOutline(outline_it->second, vc, cam);
+						outlineInfo = &outline_it->second;
+						outlineImage = image;
 					} else {
-						bindOutline(outline_it->second, vc, cam)->render(vc.dimensions, vc.transparency);
+						renderOutline(image, outline_it->second, vc, false);
 					}
 				}
 				// coloring for SDL
@@ -488,9 +530,10 @@ namespace FIFE {
 					} else {
 						m_renderbackend->changeRenderInfos(RENDER_DATA_WITHOUT_Z, 1, 4, 5, true, true, 0, ZERO, ALWAYS, recoloring ? OVERLAY_TYPE_COLOR : OVERLAY_TYPE_NONE);
 					}
-					if (outlineImage) {
-						outlineImage->render(vc.dimensions, vc.transparency);
-						m_renderbackend->changeRenderInfos(RENDER_DATA_WITHOUT_Z, 1, 4, 5, false, true, 255, REPLACE, ALWAYS);
+					if (outlineInfo) {
+						renderOutline(outlineImage, *outlineInfo, vc, false);
+						// without an outline image the shader draws it, so the overlay type has to stay
+						m_renderbackend->changeRenderInfos(RENDER_DATA_WITHOUT_Z, 1, 4, 5, false, true, 255, REPLACE, ALWAYS, outlineImage ? OVERLAY_TYPE_NONE : OVERLAY_TYPE_OUTLINE);
 					}
 					continue;
 				}
@@ -503,9 +546,9 @@ namespace FIFE {
 				vc.image->render(vc.dimensions, vc.transparency, recoloring ? coloringColor : 0);
 			}
 
-			if (outlineImage) {
-				outlineImage->render(vc.dimensions, vc.transparency);
-				m_renderbackend->changeRenderInfos(RENDER_DATA_WITHOUT_Z, 1, 4, 5, false, true, 255, REPLACE, ALWAYS);
+			if (outlineInfo) {
+				renderOutline(outlineImage, *outlineInfo, vc, false);
+				m_renderbackend->changeRenderInfos(RENDER_DATA_WITHOUT_Z, 1, 4, 5, false, true, 255, REPLACE, ALWAYS, outlineImage ? OVERLAY_TYPE_NONE : OVERLAY_TYPE_OUTLINE);
 			}
 		}
 	}
@@ -549,10 +592,10 @@ namespace FIFE {
 						std::map<Color, Color>::const_iterator cit = oc->getColors().begin();
 						uint8_t factor[4] = { 0, 0, 0, cit->second.getAlpha() };
 						// multi color overlay
-						ImagePtr multiColorOverlay;
+						OverlayColors* temp = 0;
 						if (recoloring) {
 							// create temp OverlayColors
-							OverlayColors* temp = new OverlayColors(oc->getColorOverlayImage());
+							temp = new OverlayColors(oc->getColorOverlayImage());
 							float alphaFactor1 = static_cast<float>(coloringColor[3] / 255.0);
 							const std::map<Color, Color>& defaultColors = oc->getColors();
 							for (std::map<Color, Color>::const_iterator c_it = defaultColors.begin(); c_it != defaultColors.end(); ++c_it) {
@@ -568,20 +611,17 @@ namespace FIFE {
 							// create new factor
 							factor[3] = static_cast<uint8_t>(255 - factor[3]);
 							factor[3] = std::min(coloringColor[3], factor[3]);
-							// get overlay image with temp colors
-							multiColorOverlay = getMultiColorOverlay(vc, temp);
-							delete temp;
 						} else {
-							multiColorOverlay = getMultiColorOverlay(vc, oc);
 							factor[3] = 0;
 						}
 						if (withZ) {
 							(*it)->renderZ(vc.dimensions, vertexZ, vc.transparency, recoloring ? coloringColor : 0);
-							(*it)->renderZ(vc.dimensions, vertexZ, multiColorOverlay, vc.transparency, factor);
 						} else {
 							(*it)->render(vc.dimensions, vc.transparency, recoloring ? coloringColor : 0);
-							(*it)->render(vc.dimensions, multiColorOverlay, vc.transparency, factor);
 						}
+						// recolored overlay, with the temp colors if recoloring
+						renderMultiColorOverlay(*it, vc, temp ? temp : oc, factor, withZ);
+						delete temp;
 						continue;
 					}
 					// single color overlay
@@ -617,13 +657,13 @@ namespace FIFE {
 			OverlayColors* colorOverlay = vc.getColorOverlay();
 			if (colorOverlay->getColors().size() > 1) {
 				// multi color overlay
-				ImagePtr multiColorOverlay;
+				OverlayColors* temp = 0;
 				// interpolation factor
 				std::map<Color, Color>::const_iterator it = colorOverlay->getColors().begin();
 				uint8_t factor[4] = { 0, 0, 0, it->second.getAlpha() };
 				if (recoloring) {
 					// create temp OverlayColors
-					OverlayColors* temp = new OverlayColors(colorOverlay->getColorOverlayImage());
+					temp = new OverlayColors(colorOverlay->getColorOverlayImage());
 					float alphaFactor1 = static_cast<float>(coloringColor[3] / 255.0);
 					const std::map<Color, Color>& defaultColors = colorOverlay->getColors();
 					for (std::map<Color, Color>::const_iterator c_it = defaultColors.begin(); c_it != defaultColors.end(); ++c_it) {
@@ -639,21 +679,17 @@ namespace FIFE {
 					// create new factor
 					factor[3] = static_cast<uint8_t>(255 - factor[3]);
 					factor[3] = std::min(coloringColor[3], factor[3]);
-					// get overlay image with temp colors
-					multiColorOverlay = getMultiColorOverlay(vc, temp);
-					delete temp;
-				}
-				if (!multiColorOverlay) {
-					multiColorOverlay = getMultiColorOverlay(vc);
+				} else {
 					factor[3] = 0;
 				}
 				if (withZ) {
 					vc.image->renderZ(vc.dimensions, vertexZ, vc.transparency, recoloring ? coloringColor : 0);
-					vc.image->renderZ(vc.dimensions, vertexZ, multiColorOverlay, vc.transparency, factor);
 				} else {
 					vc.image->render(vc.dimensions, vc.transparency, recoloring ? coloringColor : 0);
-					vc.image->render(vc.dimensions, multiColorOverlay, vc.transparency, factor);
 				}
+				// recolored overlay, with the temp colors if recoloring
+				renderMultiColorOverlay(vc.image, vc, temp ? temp : colorOverlay, factor, withZ);
+				delete temp;
 			} else {
 				// single color overlay
 				std::map<Color, Color>::const_iterator color_it = colorOverlay->getColors().begin();
@@ -686,21 +722,48 @@ namespace FIFE {
 		}
 	}
 
-	inline bool aboveThreshold(int32_t threshold, int32_t alpha, int32_t prev_alpha) {
-		if(threshold > 1) {
-			// new behavior
-			if (((alpha - threshold) >= 0 || (prev_alpha - threshold) >= 0) && (alpha != prev_alpha)) {
-				return true;
+	bool InstanceRenderer::isShadedOutline(const OutlineInfo& info, const RenderItem& vc) const {
+		// multi outlines combine several images
+		return m_shade_effects && !vc.getAnimationOverlay() &&
+			info.width <= RenderBackendOpenGL::MAX_SHADER_OUTLINE_WIDTH;
+	}
+
+	void InstanceRenderer::renderOutline(Image* outline, const OutlineInfo& info, RenderItem& vc, bool withZ) {
+		if (outline) {
+			if (withZ) {
+				outline->renderZ(vc.dimensions, vc.vertexZ, vc.transparency, static_cast<uint8_t*>(0));
 			} else {
-				return false;
+				outline->render(vc.dimensions, vc.transparency);
 			}
+			return;
+		}
+		// generated by the outline shader at draw time
+		const uint8_t rgb[3] = { info.r, info.g, info.b };
+		GLImage* image = static_cast<GLImage*>(vc.image.get());
+		if (withZ) {
+			image->renderOutlineZ(vc.dimensions, vc.vertexZ, vc.transparency, rgb, info.width, info.threshold);
 		} else {
-			// old behavior
-			if((alpha == 0 || prev_alpha == 0) && (alpha != prev_alpha)) {
-				return true;
+			image->renderOutline(vc.dimensions, vc.transparency, rgb, info.width, info.threshold);
+		}
+	}
+
+	void InstanceRenderer::renderMultiColorOverlay(const ImagePtr& image, const RenderItem& vc, OverlayColors* colors, uint8_t const* factor, bool withZ) {
+		const std::map<Color, Color>& colorMap = colors->getColors();
+		if (m_shade_effects && colorMap.size() <= RenderBackendOpenGL::MAX_SHADER_COLOR_ENTRIES) {
+			// the color table shader replaces the colors at draw time
+			GLImage* img = static_cast<GLImage*>(image.get());
+			if (withZ) {
+				img->renderColorTableZ(vc.dimensions, vc.vertexZ, colors->getColorOverlayImage(), colorMap, vc.transparency, factor);
 			} else {
-				return false;
+				img->renderColorTable(vc.dimensions, colors->getColorOverlayImage(), colorMap, vc.transparency, factor);
 			}
+			return;
+		}
+		ImagePtr multiColorOverlay = getMultiColorOverlay(vc, colors);
+		if (withZ) {
+			image->renderZ(vc.dimensions, vc.vertexZ, multiColorOverlay, vc.transparency, factor);
+		} else {
+			image->render(vc.dimensions, multiColorOverlay, vc.transparency, factor);
 		}
 	}
 
@@ -725,92 +788,11 @@ namespace FIFE {
 		// NOTE: Since r3721 outline is just the 'border' so to render everything correctly
 		// we need to first render normal image, and then its outline.
 		// This helps much with lighting stuff and doesn't require from us to copy image.
-
-		bool found = false;
-		// create name
-		std::stringstream sts;
-		sts << vc.image.get()->getName() << "," << static_cast<uint32_t>(info.r) << "," <<
-			static_cast<uint32_t>(info.g) << "," << static_cast<uint32_t>(info.b) << "," << info.width;
-		// search image
-		if (ImageManager::instance()->exists(sts.str())) {
-			info.outline = ImageManager::instance()->getPtr(sts.str());
-			if (isValidImage(info.outline)) {
-				removeFromCheck(info.outline);
-				// mark outline as not dirty since we found it here
-				info.dirty = false;
-				return info.outline.get();
-			}
-			found = true;
-		}
-
-
-		// With lazy loading we can come upon a situation where we need to generate outline from
-		// uninitialised shared image
-		if(vc.image->isSharedImage()) {
-			vc.image->forceLoadInternal();
-		}
-
-		SDL_Surface* outline_surface = SDL_CreateRGBSurface(0,
-			vc.image->getWidth(), vc.image->getHeight(), 32,
-			RMASK, GMASK, BMASK, AMASK);
-
-		// TODO: optimize...
-		uint8_t r, g, b, a = 0;
-
-		// vertical sweep
-		for (int32_t x = 0; x < outline_surface->w; x ++) {
-			int32_t prev_a = 0;
-			for (int32_t y = 0; y < outline_surface->h; y ++) {
-				vc.image->getPixelRGBA(x, y, &r, &g, &b, &a);
-				if (aboveThreshold(info.threshold, static_cast<int32_t>(a), prev_a)) {
-					if (a < prev_a) {
-						for (int32_t yy = y; yy < y + info.width; yy++) {
-							Image::putPixel(outline_surface, x, yy, info.r, info.g, info.b);
-						}
-					} else {
-						for (int32_t yy = y - info.width; yy < y; yy++) {
-							Image::putPixel(outline_surface, x, yy, info.r, info.g, info.b);
-						}
-					}
-				}
-				prev_a = a;
-			}
-		}
-		// horizontal sweep
-		for (int32_t y = 0; y < outline_surface->h; y ++) {
-			int32_t prev_a = 0;
-			for (int32_t x = 0; x < outline_surface->w; x ++) {
-				vc.image->getPixelRGBA(x, y, &r, &g, &b, &a);
-				if (aboveThreshold(info.threshold, static_cast<int32_t>(a), prev_a)) {
-					if (a < prev_a) {
-						for (int32_t xx = x; xx < x + info.width; xx++) {
-							Image::putPixel(outline_surface, xx, y, info.r, info.g, info.b);
-						}
-					} else {
-						for (int32_t xx = x - info.width; xx < x; xx++) {
-							Image::putPixel(outline_surface, xx, y, info.r, info.g, info.b);
-						}
-					}
-				}
-				prev_a = a;
-			}
-		}
-
-		// In case of OpenGL backend, SDLImage needs to be converted
-		Image* img = m_renderbackend->createImage(sts.str(), outline_surface);
-		img->setState(IResource::RES_LOADED);
-
-		if (found) {
-			// image exists but is not "loaded"
-			removeFromCheck(info.outline);
-			ImagePtr temp(img);
-			info.outline.get()->copySubimage(0, 0, temp);
-			info.outline.get()->setState(IResource::RES_LOADED);
-		} else {
-			// create and add image
-			info.outline = ImageManager::instance()->add(img);
-		}
-		// mark outline as not dirty since we created/recreated it here
+		EffectImageCache::Key key = EffectImageCache::outlineKey(vc.image->getHandle(),
+			info.r, info.g, info.b, info.width, info.threshold);
+		info.outline = getEffectImage(vc.image, key);
+		removeFromCheck(info.outline);
+		// mark outline as not dirty since we found or created it here
 		info.dirty = false;
 
 		return info.outline.get();
@@ -841,8 +823,9 @@ namespace FIFE {
 		sts << static_cast<uint32_t>(info.r) << "," <<
 			static_cast<uint32_t>(info.g) << "," << static_cast<uint32_t>(info.b) << "," << info.width;
 		// search image
-		if (ImageManager::instance()->exists(sts.str())) {
-			info.outline = ImageManager::instance()->getPtr(sts.str());
+		ImagePtr cached = ImageManager::instance()->find(sts.str());
+		if (cached) {
+			info.outline = cached;
 			if (isValidImage(info.outline)) {
 				removeFromCheck(info.outline);
 				// mark outline as not dirty since we found it here
@@ -855,59 +838,20 @@ namespace FIFE {
 		SDL_Surface* outline_surface = SDL_CreateRGBSurface(0, mw, mh, 32,
 			RMASK, GMASK, BMASK, AMASK);
 
-		// TODO: optimize...
-		uint8_t r, g, b, a = 0;
-
+		// all overlays are centered and combined into one outline
+		AlphaPlane alpha;
+		std::vector<uint8_t> mask(mw * mh, 0);
 		it = animationOverlays->begin();
 		for (; it != animationOverlays->end(); ++it) {
-			// vertical sweep
-			for (uint32_t x = 0; x < (*it)->getWidth(); x++) {
-				int32_t prev_a = 0;
-				for (uint32_t y = 0; y < (*it)->getHeight(); y++) {
-					(*it)->getPixelRGBA(x, y, &r, &g, &b, &a);
-					if (aboveThreshold(info.threshold, static_cast<int32_t>(a), prev_a)) {
-						if (a < prev_a) {
-							for (uint32_t yy = y; yy < y + info.width; yy++) {
-								int32_t tx = x + (mw/2 - (*it)->getWidth()/2);
-								int32_t ty = yy + (mh/2 - (*it)->getHeight()/2);
-								Image::putPixel(outline_surface, tx, ty, info.r, info.g, info.b);
-							}
-						} else {
-							for (uint32_t yy = y - info.width; yy < y; yy++) {
-								int32_t tx = x + (mw/2 - (*it)->getWidth()/2);
-								int32_t ty = yy + (mh/2 - (*it)->getHeight()/2);
-								Image::putPixel(outline_surface, tx, ty, info.r, info.g, info.b);
-							}
-						}
-					}
-					prev_a = a;
-				}
-			}
-
-			// horizontal sweep
-			for (uint32_t y = 0; y < (*it)->getHeight(); y++) {
-				int32_t prev_a = 0;
-				for (uint32_t x = 0; x < (*it)->getWidth(); x++) {
-					(*it)->getPixelRGBA(x, y, &r, &g, &b, &a);
-					if (aboveThreshold(info.threshold, static_cast<int32_t>(a), prev_a)) {
-						if (a < prev_a) {
-							for (uint32_t xx = x; xx < x + info.width; xx++) {
-								int32_t tx = xx + (mw/2 - (*it)->getWidth()/2);
-								int32_t ty = y + (mh/2 - (*it)->getHeight()/2);
-								Image::putPixel(outline_surface, tx, ty, info.r, info.g, info.b);
-							}
-						} else {
-							for (uint32_t xx = x - info.width; xx < x; xx++) {
-								int32_t tx = xx + (mw/2 - (*it)->getWidth()/2);
-								int32_t ty = y + (mh/2 - (*it)->getHeight()/2);
-								Image::putPixel(outline_surface, tx, ty, info.r, info.g, info.b);
-							}
-						}
-					}
-					prev_a = a;
-				}
-			}
+			const Rect rect = (*it)->isSharedImage() ? (*it)->getSubImageRect() :
+				Rect(0, 0, (*it)->getWidth(), (*it)->getHeight());
+			alpha.extract((*it)->getSurface(), rect);
+			// the old per pixel loops used unsigned coordinates, runs that would start
+			// above or left of the overlay were skipped, markOutline keeps that behavior
+			markOutline(alpha, info.threshold, info.width, true, &mask[0], mw, mh,
+				mw/2 - (*it)->getWidth()/2, mh/2 - (*it)->getHeight()/2);
 		}
+		fillOutline(&mask[0], outline_surface, SDL_MapRGBA(outline_surface->format, info.r, info.g, info.b, 255));
 
 		// In case of OpenGL backend, SDLImage needs to be converted
 		Image* img = m_renderbackend->createImage(sts.str(), outline_surface);
@@ -944,61 +888,11 @@ namespace FIFE {
 			addToCheck(info.overlay);
 		}
 
-		bool found = false;
-		// create name
-		std::stringstream sts;
-		sts << vc.image.get()->getName() << "," << static_cast<uint32_t>(info.r) << "," <<
-			static_cast<uint32_t>(info.g) << "," << static_cast<uint32_t>(info.b) << "," << static_cast<uint32_t>(info.a);
-		// search image
-		if (ImageManager::instance()->exists(sts.str())) {
-			info.overlay = ImageManager::instance()->getPtr(sts.str());
-			valid = isValidImage(info.overlay);
-			if (valid) {
-				removeFromCheck(info.overlay);
-				// mark overlay as not dirty since we found it here
-				info.dirty = false;
-				return info.overlay.get();
-			}
-			found = true;
-		}
-
-		// With lazy loading we can come upon a situation where we need to generate coloring from
-		// uninitialised shared image
-		if(vc.image->isSharedImage()) {
-			vc.image->forceLoadInternal();
-		}
-
-		// not found so we create it
-		SDL_Surface* overlay_surface = SDL_CreateRGBSurface(0,
-			vc.image->getWidth(), vc.image->getHeight(), 32,
-			RMASK, GMASK, BMASK, AMASK);
-
-		uint8_t r, g, b, a = 0;
-		float alphaFactor = static_cast<float>(info.a/255.0);
-		for (int32_t x = 0; x < overlay_surface->w; x ++) {
-			for (int32_t y = 0; y < overlay_surface->h; y ++) {
-				vc.image->getPixelRGBA(x, y, &r, &g, &b, &a);
-				if (a > 0) {
-					Image::putPixel(overlay_surface, x, y, info.r*(1.0-alphaFactor) + r*alphaFactor, info.g*(1.0-alphaFactor) + g*alphaFactor, info.b*(1.0-alphaFactor) + b*alphaFactor, a);
-				}
-			}
-		}
-
-		// In case of OpenGL backend, SDLImage needs to be converted
-		Image* img = m_renderbackend->createImage(sts.str(), overlay_surface);
-
-		if (found) {
-			// image exists but is not "loaded"
-			removeFromCheck(info.overlay);
-			ImagePtr temp(img);
-			info.overlay.get()->copySubimage(0, 0, temp);
-			info.overlay.get()->setState(IResource::RES_LOADED);
-		} else {
-			// add image
-			img->setState(IResource::RES_LOADED);
-			info.overlay = ImageManager::instance()->add(img);
-		}
-		// mark overlay as not dirty since we created/recreated it here
+		EffectImageCache::Key key = EffectImageCache::coloringKey(vc.image->getHandle(),
+			info.r, info.g, info.b, info.a);
+		info.overlay = getEffectImage(vc.image, key);
+		removeFromCheck(info.overlay);
+		// mark overlay as not dirty since we found or created it here
 		info.dirty = false;
 
 		return info.overlay.get();
@@ -1019,9 +913,10 @@ namespace FIFE {
 		}
 		bool exist = false;
 		bool found = false;
-		if (ImageManager::instance()->exists(sts.str())) {
+		ImagePtr cached = ImageManager::instance()->find(sts.str());
+		if (cached) {
 			exist = true;
-			colorOverlay = ImageManager::instance()->getPtr(sts.str());
+			colorOverlay = cached;
 			if (isValidImage(colorOverlay)) {
 				removeFromCheck(colorOverlay);
 				found = true;
@@ -1092,7 +987,7 @@ namespace FIFE {
 			// already exists in the map so lets just update its outline info
 			OutlineInfo& info = insertiter.first->second;
 
-			if (info.r != r || info.g != g || info.b != b || info.width != width) {
+			if (info.r != r || info.g != g || info.b != b || info.width != width || info.threshold != threshold) {
 				// only update the outline info if its changed since the last call
 				// flag the outline info as dirty so it will get processed during rendering
 				info.r = r;
@@ -1328,6 +1223,7 @@ namespace FIFE {
 		removeAllIgnoreLight();
 		// removes the references to the effect images
 		m_check_images.clear();
+		m_effect_cache->clear();
 	}
 
 	void InstanceRenderer::setRemoveInterval(uint32_t interval) {
@@ -1368,7 +1264,8 @@ namespace FIFE {
 		// free unused images
 		while (it != m_check_images.end()) {
 			if (now - it->timestamp > m_interval) {
-				if (isValidImage(it->image)) {
+				// images removed by the effect cache are released with the entry
+				if (isValidImage(it->image) && ImageManager::instance()->exists(it->image->getHandle())) {
 					ImageManager::instance()->free(it->image.get()->getName());
 				}
 				it = m_check_images.erase(it);
@@ -1420,4 +1317,133 @@ namespace FIFE {
 		}
 		return false;
 	}
+
+	void InstanceRenderer::precomputeOutlines(AnimationPtr animation, int32_t r, int32_t g, int32_t b, int32_t width, int32_t threshold, bool background) {
+		// the outline shader needs no images
+		if (m_shade_effects && width <= RenderBackendOpenGL::MAX_SHADER_OUTLINE_WIDTH) {
+			return;
+		}
+		for (uint32_t i = 0; i < animation->getFrameCount(); ++i) {
+			ImagePtr frame = animation->getFrame(i);
+			if (!frame) {
+				continue;
+			}
+			EffectImageCache::Key key = EffectImageCache::outlineKey(frame->getHandle(),
+				static_cast<uint8_t>(r), static_cast<uint8_t>(g), static_cast<uint8_t>(b), width, threshold);
+			if (!m_effect_cache->contains(key)) {
+				createEffectImage(frame, key, background);
+			}
+		}
+	}
+
+	void InstanceRenderer::precomputeColoring(AnimationPtr animation, int32_t r, int32_t g, int32_t b, int32_t a, bool background) {
+		for (uint32_t i = 0; i < animation->getFrameCount(); ++i) {
+			ImagePtr frame = animation->getFrame(i);
+			if (!frame) {
+				continue;
+			}
+			EffectImageCache::Key key = EffectImageCache::coloringKey(frame->getHandle(),
+				static_cast<uint8_t>(r), static_cast<uint8_t>(g), static_cast<uint8_t>(b), static_cast<uint8_t>(a));
+			if (!m_effect_cache->contains(key)) {
+				createEffectImage(frame, key, background);
+			}
+		}
+	}
+
+	void InstanceRenderer::setEffectCacheSize(size_t bytes) {
+		m_effect_cache->setMaxBytes(bytes);
+	}
+
+	size_t InstanceRenderer::getEffectCacheSize() const {
+		return m_effect_cache->getMaxBytes();
+	}
+
+	size_t InstanceRenderer::getEffectCacheBytes() const {
+		return m_effect_cache->getBytes();
+	}
+
+	uint32_t InstanceRenderer::getEffectCacheEntryCount() const {
+		return m_effect_cache->getEntryCount();
+	}
+
+	uint32_t InstanceRenderer::getEffectCacheHitCount() const {
+		return m_effect_cache->getHitCount();
+	}
+
+	uint32_t InstanceRenderer::getEffectCacheMissCount() const {
+		return m_effect_cache->getMissCount();
+	}
+
+	uint32_t InstanceRenderer::getPendingEffectCount() const {
+		return m_effect_cache->getPendingCount();
+	}
+
+	ImagePtr InstanceRenderer::getEffectImage(const ImagePtr& source, const EffectImageCache::Key& key) {
+		ImagePtr image = m_effect_cache->get(key);
+		if (image) {
+			return image;
+		}
+		return createEffectImage(source, key, false);
+	}
+
+	ImagePtr InstanceRenderer::createEffectImage(const ImagePtr& source, const EffectImageCache::Key& key, bool background) {
+		// another renderer could have created it already
+		const std::string name = EffectImageCache::getEffectName(source->getName(), key);
+		ImagePtr cached = ImageManager::instance()->find(name);
+		if (isValidImage(cached)) {
+			m_effect_cache->insert(key, cached);
+			return cached;
+		}
+		if (background && m_effect_cache->isPending(key)) {
+			return ImagePtr();
+		}
+
+		// With lazy loading we can come upon a situation where we need to generate the effect from
+		// uninitialised shared image
+		if (source->isSharedImage()) {
+			source->forceLoadInternal();
+		} else if (source->getState() != IResource::RES_LOADED) {
+			source->load();
+		}
+		const Rect rect = source->isSharedImage() ? source->getSubImageRect() :
+			Rect(0, 0, source->getWidth(), source->getHeight());
+		if (background && m_effect_cache->enqueue(key, name, source->getSurface(), rect)) {
+			return ImagePtr();
+		}
+
+		ImagePtr image = addEffectImage(name, EffectImageCache::createSurface(source->getSurface(), rect, key));
+		m_effect_cache->insert(key, image);
+		return image;
+	}
+
+	ImagePtr InstanceRenderer::addEffectImage(const std::string& name, SDL_Surface* surface) {
+		// In case of OpenGL backend, SDLImage needs to be converted
+		Image* img = m_renderbackend->createImage(name, surface);
+		img->setState(IResource::RES_LOADED);
+
+		ImagePtr cached = ImageManager::instance()->find(name);
+		if (cached) {
+			// image exists but is not "loaded"
+			removeFromCheck(cached);
+			ImagePtr temp(img);
+			cached->copySubimage(0, 0, temp);
+			cached->setState(IResource::RES_LOADED);
+			return cached;
+		}
+		return ImageManager::instance()->add(img);
+	}
+
+	void InstanceRenderer::processEffectResults() {
+		EffectImageCache::Result result;
+		while (m_effect_cache->popResult(result)) {
+			ImagePtr cached = ImageManager::instance()->find(result.name);
+			if (isValidImage(cached)) {
+				// created in the meantime
+				SDL_FreeSurface(result.surface);
+				m_effect_cache->insert(result.key, cached);
+				continue;
+			}
+			m_effect_cache->insert(result.key, addEffectImage(result.name, result.surface));
+		}
+	}
 }
@@ -34,6 +34,9 @@
 // Second block: files included from the same folder
 #include "view/rendererbase.h"
 #include "util/time/timer.h"
+#include "video/animation.h"
+
+#include "effectimagecache.h"
 
 namespace FIFE {
 	class Location;
@@ -145,6 +148,53 @@ namespace FIFE {
 		 */
 		bool needColorBinding() { return m_need_bind_coloring; }
 
+		/** Returns true if outlines and multi color overlays are rendered by shaders
+		 *  of the OpenGL backend. In this case no images are created for them.
+		 *  @see RenderBackend::setShadersEnabled
+		 */
+		bool hasEffectShaders() const { return m_shade_effects; }
+
+		/** Creates the outline images for all frames of the animation in advance,
+		 *  so outlined instances don't have to create them while the animation runs.
+		 *  @param background If true, the images are created by a worker thread
+		 *         and added during the next render calls.
+		 */
+		void precomputeOutlines(AnimationPtr animation, int32_t r, int32_t g, int32_t b, int32_t width, int32_t threshold = 1, bool background = false);
+
+		/** Creates the coloring images for all frames of the animation in advance.
+		 *  @see precomputeOutlines
+		 */
+		void precomputeColoring(AnimationPtr animation, int32_t r, int32_t g, int32_t b, int32_t a = 128, bool background = false);
+
+		/** Sets the memory budget for cached outline and coloring images in bytes.
+		 *  0 means unlimited, default is 32 MB.
+		 */
+		void setEffectCacheSize(size_t bytes);
+
+		/** Gets the memory budget for cached outline and coloring images in bytes.
+		 */
+		size_t getEffectCacheSize() const;
+
+		/** Gets the memory used by cached outline and coloring images in bytes.
+		 */
+		size_t getEffectCacheBytes() const;
+
+		/** Gets the number of cached outline and coloring images.
+		 */
+		uint32_t getEffectCacheEntryCount() const;
+
+		/** Gets the number of effect images that were found in the cache.
+		 */
+		uint32_t getEffectCacheHitCount() const;
+
+		/** Gets the number of effect images that had to be created.
+		 */
+		uint32_t getEffectCacheMissCount() const;
+
+		/** Gets the number of effect images that are created in background.
+		 */
+		uint32_t getPendingEffectCount() const;
+
 	private:
 		bool m_area_layer;
 		uint32_t m_interval;
@@ -152,6 +202,7 @@ namespace FIFE {
 		std::list<std::string> m_unlit_groups;
 		bool m_need_sorting;
 		bool m_need_bind_coloring;
+		bool m_shade_effects;
 
 		enum InstanceRendererEffect {
 			NOTHING = 0x00,
@@ -226,6 +277,9 @@ namespace FIFE {
 		typedef std::map<Instance*, Effect> InstanceToEffects_t;
 		InstanceToEffects_t m_assigned_instances;
 
+		// outline and coloring images
+		EffectImageCache* m_effect_cache;
+
 		void renderOverlay(RenderDataType type, RenderItem* item, uint8_t const* coloringColor, bool recoloring);
 
 		/** Binds new outline (if needed) to the instance's OutlineInfo
@@ -236,6 +290,35 @@ namespace FIFE {
 
 		ImagePtr getMultiColorOverlay(const RenderItem& vc, OverlayColors* colors = 0);
 
+		/** Returns true if the outline is rendered by the outline shader instead of an outline image.
+		 */
+		bool isShadedOutline(const OutlineInfo& info, const RenderItem& vc) const;
+
+		/** Renders the outline image or, if it is 0, the outline with the outline shader.
+		 */
+		void renderOutline(Image* outline, const OutlineInfo& info, RenderItem& vc, bool withZ);
+
+		/** Renders the multi color overlay of the image, with the color table shader if possible.
+		 */
+		void renderMultiColorOverlay(const ImagePtr& image, const RenderItem& vc, OverlayColors* colors, uint8_t const* factor, bool withZ);
+
+		/** Returns the effect image from the cache or creates it.
+		 */
+		ImagePtr getEffectImage(const ImagePtr& source, const EffectImageCache::Key& key);
+
+		/** Creates the effect image, or queues it if background is true.
+		 *  @return The image or an empty pointer if it was queued.
+		 */
+		ImagePtr createEffectImage(const ImagePtr& source, const EffectImageCache::Key& key, bool background);
+
+		/** Creates the effect image from the surface and adds it to the ImageManager.
+		 */
+		ImagePtr addEffectImage(const std::string& name, SDL_Surface* surface);
+
+		/** Adds the effect images that were created in background.
+		 */
+		void processEffectResults();
+
 		void renderUnsorted(Camera* cam, Layer* layer, RenderList& instances);
 		void renderAlreadySorted(Camera* cam, Layer* layer, RenderList& instances);
 
@@ -47,6 +47,15 @@ namespace FIFE {
 		static InstanceRenderer* getInstance(IRendererContainer* cnt);
 		void setRemoveInterval(uint32_t interval);
 		uint32_t getRemoveInterval() const;
+		void precomputeOutlines(AnimationPtr animation, int32_t r, int32_t g, int32_t b, int32_t width, int32_t threshold = 1, bool background = false);
+		void precomputeColoring(AnimationPtr animation, int32_t r, int32_t g, int32_t b, int32_t a = 128, bool background = false);
+		void setEffectCacheSize(size_t bytes);
+		size_t getEffectCacheSize() const;
+		size_t getEffectCacheBytes() const;
+		uint32_t getEffectCacheEntryCount() const;
+		uint32_t getEffectCacheHitCount() const;
+		uint32_t getEffectCacheMissCount() const;
+		uint32_t getPendingEffectCount() const;
 	private:
 		InstanceRenderer(RenderBackend* renderbackend, int32_t position);
 	};
@@ -45,7 +45,7 @@ namespace FIFE {
 			Camera *m_camera;
 			RenderVisitor(RenderBackend * rb, Layer * layer, Camera *camera);
 			~RenderVisitor();
-			template<typename T> bool visit(QuadNode<T,InstanceTree::MIN_TREE_SIZE>* node, int32_t d);
+			template<typename Node> bool visit(Node* node, int32_t d);
 
 	};
 
@@ -0,0 +1,270 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "model/structures/layer.h"
+#include "util/log/logger.h"
+#include "video/imagemanager.h"
+#include "video/renderbackend.h"
+
+#include "camera.h"
+#include "layercache.h"
+#include "rendererbase.h"
+#include "renderitem.h"
+#include "staticlayercache.h"
+
+namespace FIFE {
+	/** Logger to use for this source file.
+	 *  @relates Logger
+	 */
+	static Logger _log(LM_CAMERA);
+
+	// tile index of a position in layer space, rounded towards negative infinity
+	static int32_t tileIndex(int32_t pos) {
+		const int32_t size = StaticLayerCache::TILE_SIZE;
+		return pos >= 0 ? pos / size : -((size - 1 - pos) / size);
+	}
+
+	StaticLayerCache::StaticLayerCache(Camera* camera, LayerCache* cache, Layer* layer):
+		m_camera(camera),
+		m_cache(cache),
+		m_layer(layer),
+		m_instancesVisible(layer->areInstancesVisible()),
+		m_frame(0),
+		m_renderedTiles(0),
+		m_nextImageId(0) {
+		updateOrigin();
+	}
+
+	StaticLayerCache::~StaticLayerCache() {
+		for (TileMap::iterator it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+			freeTile(it->second);
+		}
+	}
+
+	void StaticLayerCache::updateOrigin() {
+		ScreenPoint origin = m_camera->toScreenCoordinates(ExactModelCoordinate());
+		m_origin.x = origin.x;
+		m_origin.y = origin.y;
+		m_virtualOrigin = m_camera->toVirtualScreenCoordinates(ExactModelCoordinate());
+	}
+
+	void StaticLayerCache::invalidate() {
+		for (TileMap::iterator it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+			it->second.dirty = true;
+		}
+	}
+
+	void StaticLayerCache::invalidateArea(const Rect& area) {
+		if (area.w <= 0 || area.h <= 0 || m_tiles.empty()) {
+			return;
+		}
+		// the tile position of an item can differ by one pixel from its screen position
+		const int32_t x1 = tileIndex(area.x - 1 - m_origin.x);
+		const int32_t y1 = tileIndex(area.y - 1 - m_origin.y);
+		const int32_t x2 = tileIndex(area.right() - m_origin.x);
+		const int32_t y2 = tileIndex(area.bottom() - m_origin.y);
+		for (TileMap::iterator it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+			const TileKey& key = it->first;
+			if (key.first >= x1 && key.first <= x2 && key.second >= y1 && key.second <= y2) {
+				it->second.dirty = true;
+			}
+		}
+	}
+
+	void StaticLayerCache::update(const std::list<RendererBase*>& pipeline) {
+		++m_frame;
+		m_renderedTiles = 0;
+		bool visible = m_layer->areInstancesVisible();
+		if (visible != m_instancesVisible) {
+			m_instancesVisible = visible;
+			invalidate();
+		}
+		if (!visible) {
+			return;
+		}
+
+		TileKey first;
+		TileKey last;
+		getVisibleTiles(first, last);
+		uint32_t visibleTiles = 0;
+		for (int32_t y = first.second; y <= last.second; ++y) {
+			for (int32_t x = first.first; x <= last.first; ++x) {
+				TileKey key(x, y);
+				TileMap::iterator it = m_tiles.find(key);
+				if (it == m_tiles.end()) {
+					Tile tile;
+					tile.dirty = true;
+					tile.lastUse = 0;
+					it = m_tiles.insert(std::make_pair(key, tile)).first;
+				}
+				Tile& tile = it->second;
+				tile.lastUse = m_frame;
+				if (tile.dirty || !tile.image) {
+					renderTile(key, tile, pipeline);
+				}
+				++visibleTiles;
+			}
+		}
+		// keeps some tiles around the viewport for pans
+		evictTiles(visibleTiles * 2 + 8);
+	}
+
+	void StaticLayerCache::render() {
+		if (!m_instancesVisible) {
+			return;
+		}
+		TileKey first;
+		TileKey last;
+		getVisibleTiles(first, last);
+		for (int32_t y = first.second; y <= last.second; ++y) {
+			for (int32_t x = first.first; x <= last.first; ++x) {
+				TileKey key(x, y);
+				TileMap::iterator it = m_tiles.find(key);
+				if (it != m_tiles.end() && it->second.image) {
+					it->second.image->render(getTileArea(key));
+				}
+			}
+		}
+	}
+
+	bool StaticLayerCache::isCachedRenderer(RendererBase* renderer) {
+		return renderer->getName() == "InstanceRenderer";
+	}
+
+	uint32_t StaticLayerCache::getTileCount() const {
+		return m_tiles.size();
+	}
+
+	uint32_t StaticLayerCache::getRenderedTileCount() const {
+		return m_renderedTiles;
+	}
+
+	void StaticLayerCache::getVisibleTiles(TileKey& first, TileKey& last) const {
+		const Rect& viewport = m_camera->getViewPort();
+		first.first = tileIndex(viewport.x - m_origin.x);
+		first.second = tileIndex(viewport.y - m_origin.y);
+		last.first = tileIndex(viewport.right() - 1 - m_origin.x);
+		last.second = tileIndex(viewport.bottom() - 1 - m_origin.y);
+	}
+
+	Rect StaticLayerCache::getTileArea(const TileKey& key) const {
+		return Rect(m_origin.x + key.first * TILE_SIZE, m_origin.y + key.second * TILE_SIZE, TILE_SIZE, TILE_SIZE);
+	}
+
+	void StaticLayerCache::renderTile(const TileKey& key, Tile& tile, const std::list<RendererBase*>& pipeline) {
+		RenderBackend* renderbackend = RenderBackend::instance();
+		if (!tile.image) {
+			// the tile name will be, camera id + _static_tile_ + layer id + _ + running number
+			std::ostringstream name;
+			name << m_camera->getId() << "_static_tile_" << m_layer->getId() << "_" << m_nextImageId++;
+			tile.image = ImageManager::instance()->loadBlank(name.str(), TILE_SIZE, TILE_SIZE);
+		}
+
+		// the screen positions are rounded after the camera position is added, so
+		// they can differ by one pixel from the tile positions
+		Rect area = getTileArea(key);
+		RenderList items;
+		m_cache->collectArea(Rect(area.x - 1, area.y - 1, area.w + 2, area.h + 2), items);
+		// moves the items into tile space, based on the unrounded distance to the
+		// map origin, so neighbouring tiles agree on the positions after a pan
+		std::vector<Point> screenPositions;
+		screenPositions.reserve(items.size());
+		for (RenderList::iterator it = items.begin(); it != items.end(); ++it) {
+			RenderItem* item = *it;
+			screenPositions.push_back(Point(item->dimensions.x, item->dimensions.y));
+			Point offset = doublePt2intPt(m_camera->virtualScreenToScreenDistance(item->screenpoint - m_virtualOrigin));
+			item->dimensions.x = offset.x - key.first * TILE_SIZE;
+			item->dimensions.y = offset.y - key.second * TILE_SIZE;
+		}
+
+		// for the case that the tile size is not the same as the screen size,
+		// we have to change the values for OpenGL backend
+		Rect rec(0, renderbackend->getHeight() - TILE_SIZE, TILE_SIZE, TILE_SIZE);
+		if (renderbackend->getName() == "SDL") {
+			rec = Rect(0, 0, TILE_SIZE, TILE_SIZE);
+		}
+		renderbackend->attachRenderTarget(tile.image, true);
+		renderbackend->pushClipArea(rec, false);
+		if (!items.empty()) {
+			std::list<RendererBase*>::const_iterator r_it = pipeline.begin();
+			for (; r_it != pipeline.end(); ++r_it) {
+				if ((*r_it)->isActivedLayer(m_layer) && isCachedRenderer(*r_it)) {
+					(*r_it)->render(m_camera, m_layer, items);
+					renderbackend->renderVertexArrays();
+				}
+			}
+		}
+		renderbackend->detachRenderTarget();
+		renderbackend->popClipArea();
+
+		std::vector<Point>::const_iterator pit = screenPositions.begin();
+		for (RenderList::iterator it = items.begin(); it != items.end(); ++it, ++pit) {
+			(*it)->dimensions.x = pit->x;
+			(*it)->dimensions.y = pit->y;
+		}
+		tile.dirty = false;
+		++m_renderedTiles;
+	}
+
+	void StaticLayerCache::evictTiles(uint32_t maxTiles) {
+		if (m_tiles.size() <= maxTiles) {
+			return;
+		}
+		// sorts the tiles by last use, the oldest are removed first
+		std::vector<std::pair<uint32_t, TileKey> > candidates;
+		candidates.reserve(m_tiles.size());
+		for (TileMap::iterator it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+			if (it->second.lastUse != m_frame) {
+				candidates.push_back(std::make_pair(it->second.lastUse, it->first));
+			}
+		}
+		std::sort(candidates.begin(), candidates.end());
+		uint32_t count = m_tiles.size() - maxTiles;
+		for (uint32_t i = 0; i < count && i < candidates.size(); ++i) {
+			TileMap::iterator it = m_tiles.find(candidates[i].second);
+			freeTile(it->second);
+			m_tiles.erase(it);
+		}
+		FL_DBG(_log, LMsg("StaticLayerCache::evictTiles() - ") << "layer " << m_layer->getId() << " keeps " << m_tiles.size() << " tiles");
+	}
+
+	void StaticLayerCache::freeTile(Tile& tile) {
+		if (!tile.image) {
+			return;
+		}
+		ImageManager* manager = ImageManager::instance();
+		if (manager && manager->exists(tile.image->getHandle())) {
+			manager->remove(tile.image);
+		}
+		tile.image.reset();
+	}
+}
@@ -0,0 +1,128 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef FIFE_VIEW_STATICLAYERCACHE_H
+#define FIFE_VIEW_STATICLAYERCACHE_H
+
+// Standard C++ library includes
+#include <list>
+#include <map>
+#include <utility>
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/structures/point.h"
+#include "util/structures/rect.h"
+#include "video/image.h"
+
+namespace FIFE {
+
+	class Camera;
+	class Layer;
+	class LayerCache;
+	class RendererBase;
+
+	/** Renders a static layer into fixed-size tiles and reuses them between frames.
+	 *
+	 * The tiles are placed relative to the screen position of the map origin,
+	 * so they stay valid while the camera pans. The items are drawn into a tile at
+	 * their distance to the map origin, rounded independently of the camera
+	 * position, so tiles rendered during different frames fit together. Changed instances only invalidate
+	 * the tiles below their old and new screen area, a zoom, rotation or tilt
+	 * of the camera invalidates all tiles. Only the InstanceRenderer output is
+	 * stored in the tiles, other renderers are drawn every frame.
+	 */
+	class StaticLayerCache {
+	public:
+		/** Size of one tile in pixels.
+		 */
+		static const int32_t TILE_SIZE = 256;
+
+		StaticLayerCache(Camera* camera, LayerCache* cache, Layer* layer);
+		~StaticLayerCache();
+
+		/** Recalculates the screen position of the map origin.
+		 * Has to be called after the screen coordinates of the render items were updated.
+		 */
+		void updateOrigin();
+
+		/** Marks all tiles as dirty.
+		 */
+		void invalidate();
+
+		/** Marks the tiles that intersect the given screen area as dirty.
+		 * The area has to be based on the current origin.
+		 */
+		void invalidateArea(const Rect& area);
+
+		/** Renders the dirty tiles that are on screen. Has to be called before
+		 * the viewport clip area is set, because the tiles are used as render targets.
+		 */
+		void update(const std::list<RendererBase*>& pipeline);
+
+		/** Renders the tiles that are on screen.
+		 */
+		void render();
+
+		/** Returns true if the output of the renderer is stored in the tiles.
+		 */
+		static bool isCachedRenderer(RendererBase* renderer);
+
+		/** Returns the number of tiles, including those that are off screen.
+		 */
+		uint32_t getTileCount() const;
+
+		/** Returns the number of tiles that were rendered during the last update.
+		 */
+		uint32_t getRenderedTileCount() const;
+
+	private:
+		typedef std::pair<int32_t, int32_t> TileKey;
+		struct Tile {
+			ImagePtr image;
+			bool dirty;
+			uint32_t lastUse;
+		};
+		typedef std::map<TileKey, Tile> TileMap;
+
+		void getVisibleTiles(TileKey& first, TileKey& last) const;
+		Rect getTileArea(const TileKey& key) const;
+		void renderTile(const TileKey& key, Tile& tile, const std::list<RendererBase*>& pipeline);
+		void evictTiles(uint32_t maxTiles);
+		void freeTile(Tile& tile);
+
+		Camera* m_camera;
+		LayerCache* m_cache;
+		Layer* m_layer;
+		TileMap m_tiles;
+		Point m_origin;
+		DoublePoint3D m_virtualOrigin;
+		bool m_instancesVisible;
+		uint32_t m_frame;
+		uint32_t m_renderedTiles;
+		uint32_t m_nextImageId;
+	};
+}
+#endif
@@ -0,0 +1,220 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <SDL.h>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "model/model.h"
+#include "model/metamodel/object.h"
+#include "model/metamodel/grids/squaregrid.h"
+#include "model/structures/instance.h"
+#include "model/structures/layer.h"
+#include "model/structures/map.h"
+#include "util/base/exception.h"
+#include "util/time/timemanager.h"
+#include "vfs/vfs.h"
+#include "vfs/vfsdirectory.h"
+#include "video/animationmanager.h"
+#include "video/devicecaps.h"
+#include "video/imagemanager.h"
+#include "video/opengl/fife_opengl.h"
+#include "video/opengl/renderbackendopengl.h"
+#include "view/camera.h"
+#include "view/renderers/instancerenderer.h"
+#include "view/visual.h"
+
+using namespace FIFE;
+
+// Renders instances with different images with and without runtime atlasing
+// and compares the pixels and the draw call and texture bind counters.
+// Needs an OpenGL capable driver without a display, e.g. Mesa llvmpipe
+// through the SDL offscreen video driver (SDL 2.0.12 or later).
+
+static const int32_t SCREEN_SIZE = 256;
+static const int32_t CRATE_FRAMES = 9;
+// larger than half of the atlas page, never packed
+static const std::string LARGE_FILE = "tests/data/rpgfont.png";
+
+struct RenderResult {
+	RenderResult() : rendered(false), drawCalls(0), textureBinds(0), atlasPages(0), atlasedImages(0), largeUses(0), largeShared(false) {}
+	bool rendered;
+	uint32_t drawCalls;
+	uint32_t textureBinds;
+	uint32_t atlasPages;
+	uint32_t atlasedImages;
+	uint32_t largeUses;
+	bool largeShared;
+	std::vector<uint8_t> pixels;
+};
+
+// Environment
+struct environment {
+	boost::shared_ptr<TimeManager> timemanager;
+	boost::shared_ptr<VFS> vfs;
+
+	environment()
+		: timemanager(new TimeManager()),
+		  vfs(new VFS()) {
+		vfs->addSource(new VFSDirectory(vfs.get()));
+	}
+};
+
+static std::string crateFile(int32_t frame) {
+	if (frame == 0) {
+		return "tests/data/crate/full_s_000.png";
+	}
+	std::ostringstream file;
+	file << "tests/data/crate/full_s_000" << frame << ".png";
+	return file.str();
+}
+
+static RenderResult renderCrates(bool atlasing) {
+	RenderResult result;
+	environment env;
+	SDL_Color colorkey = { 255, 0, 255, 0 };
+	RenderBackendOpenGL renderbackend(colorkey);
+	// keeps a driver that was selected by the user
+	SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+	try {
+		renderbackend.init("");
+		renderbackend.createMainScreen(ScreenMode(SCREEN_SIZE, SCREEN_SIZE, 32, SDL_WINDOW_OPENGL), "FIFE", "");
+	} catch (Exception& e) {
+		std::cout << "test_atlas_gl: no OpenGL context, " << e.what() << std::endl;
+		return result;
+	}
+
+	ImageManager imagemanager;
+	AnimationManager animationmanager;
+	imagemanager.setAtlasingEnabled(atlasing);
+	imagemanager.setAtlasingThreshold(1);
+	boost::scoped_ptr<InstanceRenderer> prototype(new InstanceRenderer(&renderbackend, 10));
+	std::vector<RendererBase*> renderers;
+	renderers.push_back(prototype.get());
+	Model model(&renderbackend, renderers);
+	model.adoptCellGrid(new SquareGrid());
+
+	Map* map = model.createMap("map");
+	Layer* layer = map->createLayer("layer", model.getCellGrid("square"));
+	// neighbouring instances use different images, so without an atlas
+	// every instance needs its own texture
+	std::vector<Object*> objects;
+	for (int32_t frame = 0; frame < CRATE_FRAMES; ++frame) {
+		std::ostringstream id;
+		id << "crate_" << frame;
+		ImagePtr image = imagemanager.load(crateFile(frame));
+		Object* object = model.createObject(id.str(), "atlas_test");
+		ObjectVisual::create(object)->addStaticImage(0, image->getHandle());
+		objects.push_back(object);
+	}
+	for (int32_t y = -2; y <= 2; ++y) {
+		for (int32_t x = -2; x <= 2; ++x) {
+			Object* object = objects[(x + 2 + (y + 2) * 5) % CRATE_FRAMES];
+			InstanceVisual::create(layer->createInstance(object, ExactModelCoordinate(x, y)));
+		}
+	}
+	ImagePtr large = imagemanager.load(LARGE_FILE);
+	Object* largeObject = model.createObject("large", "atlas_test");
+	ObjectVisual::create(largeObject)->addStaticImage(0, large->getHandle());
+	InstanceVisual::create(layer->createInstance(largeObject, ExactModelCoordinate(0, -2.6)));
+
+	Camera* camera = map->addCamera("camera", Rect(0, 0, SCREEN_SIZE, SCREEN_SIZE));
+	camera->setCellImageDimensions(48, 48);
+	camera->setLocation(Location(layer));
+	InstanceRenderer::getInstance(camera)->activateAllLayers(map);
+
+	// the first frame reports the uses, the next ones are drawn from the atlas
+	result.pixels.resize(SCREEN_SIZE * SCREEN_SIZE * 4);
+	for (int32_t frame = 0; frame < 4; ++frame) {
+		// as Engine::pump does before rendering
+		imagemanager.packAtlasCandidates();
+		renderbackend.startFrame();
+		if (frame == 3) {
+			// the counters of the previous frame
+			result.drawCalls = renderbackend.getDrawCallCount();
+			result.textureBinds = renderbackend.getTextureBindCount();
+		}
+		camera->update();
+		camera->render();
+		renderbackend.renderVertexArrays();
+		if (frame == 2) {
+			glReadPixels(0, 0, SCREEN_SIZE, SCREEN_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, &result.pixels[0]);
+		}
+		renderbackend.endFrame();
+	}
+	result.atlasPages = imagemanager.getAtlasPageCount();
+	result.atlasedImages = imagemanager.getAtlasedImageCount();
+	result.largeUses = large->getAtlasUses();
+	result.largeShared = large->isSharedImage();
+	result.rendered = true;
+	return result;
+}
+
+TEST(atlas_gl_batches) {
+	RenderResult separate = renderCrates(false);
+	RenderResult atlased = renderCrates(true);
+	if (!separate.rendered || !atlased.rendered) {
+		return;
+	}
+	std::cout << "without atlas: " << separate.drawCalls << " draw calls, " << separate.textureBinds << " texture binds" << std::endl;
+	std::cout << "with atlas: " << atlased.drawCalls << " draw calls, " << atlased.textureBinds << " texture binds" << std::endl;
+
+	CHECK_EQUAL(0u, separate.atlasPages);
+	CHECK_EQUAL(0u, separate.atlasedImages);
+	CHECK_EQUAL(1u, atlased.atlasPages);
+	CHECK_EQUAL(static_cast<uint32_t>(CRATE_FRAMES), atlased.atlasedImages);
+
+	// the crates share one texture, only the large image needs its own
+	CHECK(separate.textureBinds >= static_cast<uint32_t>(CRATE_FRAMES));
+	CHECK(atlased.textureBinds <= 3);
+	CHECK(atlased.drawCalls < separate.drawCalls);
+	CHECK(atlased.drawCalls <= 3);
+
+	// the large image was rejected once and is not queued again
+	CHECK(!atlased.largeShared);
+	CHECK_EQUAL(1u, atlased.largeUses);
+
+	CHECK(separate.pixels == atlased.pixels);
+}
+
+// need this here because SDL redefines
+// main to SDL_main in SDL_main.h
+#ifdef main
+#undef main
+#endif
+
+int main() {
+	return UnitTest::RunAllTests();
+}
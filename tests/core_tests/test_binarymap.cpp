@@ -0,0 +1,299 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "loaders/native/map/binarymaploader.h"
+#include "loaders/native/map/maploader.h"
+#include "model/model.h"
+#include "model/metamodel/object.h"
+#include "model/metamodel/grids/squaregrid.h"
+#include "model/structures/cell.h"
+#include "model/structures/cellcache.h"
+#include "model/structures/instance.h"
+#include "model/structures/layer.h"
+#include "model/structures/map.h"
+#include "model/structures/trigger.h"
+#include "model/structures/triggercontroller.h"
+#include "savers/native/map/binarymapsaver.h"
+#include "savers/native/map/mapsaver.h"
+#include "util/time/timemanager.h"
+#include "video/animationmanager.h"
+#include "video/imagemanager.h"
+#include "view/rendererbase.h"
+#include "view/visual.h"
+#include "vfs/vfs.h"
+#include "vfs/vfsdirectory.h"
+
+using namespace FIFE;
+
+static const std::string XML_MAP = "tests/data/binarymap_tmp.xml";
+static const std::string BINARY_MAP = "tests/data/binarymap_tmp.fbm";
+
+// Environment, the model has no render backend, so maps can't have cameras
+struct environment {
+	boost::shared_ptr<TimeManager> timemanager;
+	boost::scoped_ptr<VFS> vfs;
+	ImageManager imageManager;
+	AnimationManager animationManager;
+	Model model;
+
+	environment()
+		: timemanager(new TimeManager()),
+		  vfs(new VFS()),
+		  model(NULL, std::vector<RendererBase*>()) {
+		vfs->addSource(new VFSDirectory(vfs.get()));
+		model.adoptCellGrid(new SquareGrid());
+		Object* obj = model.createObject("tree", "test");
+		obj->setBlocking(true);
+		obj = model.createObject("grass", "test");
+		obj->setCellStackPosition(0);
+		model.createObject("rock", "test");
+	}
+};
+
+static Instance* addInstance(Layer* layer, Object* object, const ExactModelCoordinate& pos, const std::string& id = "") {
+	Instance* instance = layer->createInstance(object, pos, id);
+	InstanceVisual::create(instance);
+	return instance;
+}
+
+// creates a map with a walkable ground layer filled with size x size instances and an object layer
+static Map* createMap(Model& model, const std::string& id, int32_t size) {
+	Map* map = model.createMap(id);
+	Layer* ground = map->createLayer("ground", model.getCellGrid("square"));
+	ground->setWalkable(true);
+	Layer* objects = map->createLayer("objects", model.getCellGrid("square"));
+	objects->setInteract(true, "ground");
+	objects->setLayerTransparency(64);
+
+	Object* grass = model.getObject("grass", "test");
+	Object* tree = model.getObject("tree", "test");
+	Object* rock = model.getObject("rock", "test");
+	for (int32_t y = 0; y < size; ++y) {
+		for (int32_t x = 0; x < size; ++x) {
+			addInstance(ground, grass, ExactModelCoordinate(x, y));
+			if ((x * 7 + y * 3) % 11 == 0) {
+				Instance* instance = addInstance(objects, (x + y) % 2 ? tree : rock, ExactModelCoordinate(x + 0.5, y, 0.25));
+				instance->setRotation((x * 45) % 360);
+				instance->getVisual<InstanceVisual>()->setStackPosition(x % 3);
+			}
+		}
+	}
+	Instance* named = addInstance(objects, rock, ExactModelCoordinate(1, 2), "named_rock");
+	named->setCellStackPosition(3);
+	named->setCost("mud", 4.5);
+
+	map->initializeCellCaches();
+	CellCache* cache = ground->getCellCache();
+	cache->setDefaultCostMultiplier(2.0);
+	// cells are only created when the cache is finalized, so they are created here like the map loaders do
+	Cell* cell = cache->createCell(ModelCoordinate(2, 3));
+	cell->setCostMultiplier(3.0);
+	cell->setCellType(CTYPE_CELL_BLOCKER);
+	cache->registerCost("road", 0.5);
+	cache->addCellToCost("road", cache->createCell(ModelCoordinate(4, 4)));
+	cache->addCellToArea("village", cache->createCell(ModelCoordinate(5, 5)));
+	map->finalizeCellCaches();
+
+	Trigger* trigger = map->getTriggerController()->createTrigger("enter_village");
+	trigger->assign(ground, ModelCoordinate(5, 5));
+	trigger->enableForInstance(named);
+	trigger->addTriggerCondition(INSTANCE_TRIGGER_LOCATION);
+	return map;
+}
+
+static bool sameInstances(Layer* a, Layer* b) {
+	const std::vector<Instance*>& instancesA = a->getInstances();
+	const std::vector<Instance*>& instancesB = b->getInstances();
+	if (instancesA.size() != instancesB.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < instancesA.size(); ++i) {
+		Instance* ia = instancesA[i];
+		Instance* ib = instancesB[i];
+		if (ia->getObject() != ib->getObject() ||
+			ia->getId() != ib->getId() ||
+			ia->getLocationRef().getExactLayerCoordinates() != ib->getLocationRef().getExactLayerCoordinates() ||
+			ia->getRotation() != ib->getRotation() ||
+			ia->isBlocking() != ib->isBlocking() ||
+			ia->getCellStackPosition() != ib->getCellStackPosition() ||
+			ia->getVisual<InstanceVisual>()->getStackPosition() != ib->getVisual<InstanceVisual>()->getStackPosition()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+TEST(binarymap_roundtrip) {
+	environment env;
+	Map* original = createMap(env.model, "roundtrip", 20);
+	BinaryMapSaver saver;
+	saver.save(*original, BINARY_MAP, std::vector<std::string>());
+
+	BinaryMapLoader loader(&env.model, env.vfs.get(), &env.imageManager, NULL);
+	CHECK(loader.isLoadable(BINARY_MAP));
+	// the map exists already
+	CHECK_THROW(loader.load(BINARY_MAP), NameClash);
+
+	env.model.deleteMap(original);
+	Map* loaded = loader.load(BINARY_MAP);
+	CHECK(loaded != NULL);
+	if (!loaded) {
+		return;
+	}
+	CHECK_EQUAL(std::string("roundtrip"), loaded->getId());
+	CHECK_EQUAL(2u, loaded->getLayers().size());
+
+	Layer* ground = loaded->getLayer("ground");
+	Layer* objects = loaded->getLayer("objects");
+	CHECK(ground && ground->isWalkable());
+	CHECK(objects && objects->isInteract());
+	if (!ground || !objects) {
+		return;
+	}
+	CHECK_EQUAL(std::string("ground"), objects->getWalkableId());
+	CHECK_EQUAL(64, objects->getLayerTransparency());
+	CHECK_EQUAL(400u, ground->getInstances().size());
+
+	// the generator creates the same instances again
+	Map* reference = createMap(env.model, "reference", 20);
+	CHECK(sameInstances(reference->getLayer("ground"), ground));
+	CHECK(sameInstances(reference->getLayer("objects"), objects));
+
+	Instance* named = objects->getInstance("named_rock");
+	CHECK(named != NULL);
+	if (named) {
+		CHECK_EQUAL(3, named->getCellStackPosition());
+		CHECK_EQUAL(std::string("mud"), named->getCostId());
+		CHECK_CLOSE(4.5, named->getCost(), 0.0001);
+	}
+
+	CellCache* cache = ground->getCellCache();
+	CHECK(cache != NULL);
+	if (cache) {
+		CHECK_CLOSE(2.0, cache->getDefaultCostMultiplier(), 0.0001);
+		Cell* cell = cache->getCell(ModelCoordinate(2, 3));
+		CHECK_CLOSE(3.0, cell->getCostMultiplier(), 0.0001);
+		CHECK_EQUAL(CTYPE_CELL_BLOCKER, cell->getCellType());
+		CHECK(cache->existsCostForCell("road", cache->getCell(ModelCoordinate(4, 4))));
+		CHECK(cache->isCellInArea("village", cache->getCell(ModelCoordinate(5, 5))));
+	}
+
+	std::vector<Trigger*> triggers = loaded->getTriggerController()->getAllTriggers();
+	CHECK_EQUAL(1u, triggers.size());
+	if (!triggers.empty()) {
+		CHECK_EQUAL(std::string("enter_village"), triggers[0]->getName());
+		CHECK_EQUAL(1u, triggers[0]->getAssignedCells().size());
+		CHECK_EQUAL(1u, triggers[0]->getEnabledInstances().size());
+		CHECK_EQUAL(1u, triggers[0]->getTriggerConditions().size());
+	}
+	std::remove(BINARY_MAP.c_str());
+}
+
+TEST(binarymap_damaged_file) {
+	environment env;
+	Map* original = createMap(env.model, "damaged", 10);
+	BinaryMapSaver saver;
+	saver.save(*original, BINARY_MAP, std::vector<std::string>());
+	env.model.deleteMap(original);
+
+	// cut the file in the middle of the instance array
+	std::vector<char> content;
+	{
+		std::ifstream file(BINARY_MAP.c_str(), std::ios::binary);
+		content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	{
+		std::ofstream file(BINARY_MAP.c_str(), std::ios::binary | std::ios::trunc);
+		file.write(&content[0], content.size() / 2);
+	}
+
+	BinaryMapLoader loader(&env.model, env.vfs.get(), &env.imageManager, NULL);
+	CHECK(loader.load(BINARY_MAP) == NULL);
+	CHECK(env.model.getMaps().empty());
+
+	// xml files are no binary maps
+	CHECK(!loader.isLoadable("tests/data/crate_full_001.xml"));
+	std::remove(BINARY_MAP.c_str());
+}
+
+// Loads a generated map with 200k instances from xml and from the binary format, prints the timings
+TEST(binarymap_benchmark) {
+	const int32_t size = 400;
+	double xmlTime = 0;
+	double binaryTime = 0;
+	{
+		environment env;
+		Map* map = createMap(env.model, "benchmark", size);
+		MapSaver xmlSaver;
+		xmlSaver.save(*map, XML_MAP, std::vector<std::string>());
+		BinaryMapSaver binarySaver;
+		binarySaver.save(*map, BINARY_MAP, std::vector<std::string>());
+		env.model.deleteMap(map);
+
+		MapLoader xmlLoader(&env.model, env.vfs.get(), &env.imageManager, NULL);
+		std::clock_t begin = std::clock();
+		map = xmlLoader.load(XML_MAP);
+		xmlTime = double(std::clock() - begin) / CLOCKS_PER_SEC;
+		CHECK(map != NULL);
+		if (map) {
+			CHECK_EQUAL(static_cast<size_t>(size * size), map->getLayer("ground")->getInstances().size());
+			env.model.deleteMap(map);
+		}
+
+		BinaryMapLoader binaryLoader(&env.model, env.vfs.get(), &env.imageManager, NULL);
+		begin = std::clock();
+		map = binaryLoader.load(BINARY_MAP);
+		binaryTime = double(std::clock() - begin) / CLOCKS_PER_SEC;
+		CHECK(map != NULL);
+		if (map) {
+			CHECK_EQUAL(static_cast<size_t>(size * size), map->getLayer("ground")->getInstances().size());
+		}
+	}
+	std::cout << "map with " << size * size << " ground instances" << std::endl;
+	std::cout << "  xml load:    " << xmlTime << "s" << std::endl;
+	std::cout << "  binary load: " << binaryTime << "s" << std::endl;
+	std::remove(XML_MAP.c_str());
+	std::remove(BINARY_MAP.c_str());
+}
+
+int main() {
+	return UnitTest::RunAllTests();
+}
@@ -0,0 +1,188 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "video/sdl/sdlblendingfunctions.h"
+
+using namespace FIFE;
+
+typedef void (*BlendRow)(const uint8_t* src, uint8_t* dst, uint32_t alpha, int32_t n);
+
+struct BlendFormat {
+	const char* name;
+	BlendRow function;
+	int32_t srcBytes;
+	int32_t dstBytes;
+};
+
+static const BlendFormat FORMATS[] = {
+	{ "RGBA8_to_RGBA8", SDL_BlendRow_RGBA8_to_RGBA8, 4, 4 },
+	{ "RGBA8_to_RGB8", SDL_BlendRow_RGBA8_to_RGB8, 4, 3 },
+	{ "RGBA8_to_RGB565", SDL_BlendRow_RGBA8_to_RGB565, 4, 2 },
+	{ "RGBA4_to_RGB565", SDL_BlendRow_RGBA4_to_RGB565, 2, 2 }
+};
+static const int32_t FORMAT_COUNT = sizeof(FORMATS) / sizeof(FORMATS[0]);
+
+static const BlendInstructionSet SIMD_SETS[] = { BLEND_SSE2, BLEND_AVX2, BLEND_NEON };
+static const char* SIMD_NAMES[] = { "SSE2", "AVX2", "NEON" };
+static const int32_t SIMD_COUNT = sizeof(SIMD_SETS) / sizeof(SIMD_SETS[0]);
+
+// Random bytes, a quarter of the pixels fully transparent and a quarter opaque,
+// so that the skipped and the blended pixels are both covered.
+static std::vector<uint8_t> randomPixels(int32_t n, int32_t bytes) {
+	std::vector<uint8_t> data(n * bytes + 32);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<uint8_t>(rand());
+	}
+	for (int32_t i = 0; i < n; ++i) {
+		int32_t mode = rand() % 4;
+		if (mode > 1) {
+			continue;
+		}
+		uint8_t value = mode == 0 ? 0x00 : 0xFF;
+		if (bytes == 4) {
+			data[i * 4 + 3] = value;
+		} else if (bytes == 2) {
+			// RGBA4 keeps the alpha in the lowest nibble
+			data[i * 2] = static_cast<uint8_t>((data[i * 2] & 0xF0) | (value & 0x0F));
+		}
+	}
+	return data;
+}
+
+static bool blendMatches(const BlendFormat& format, BlendInstructionSet set, int32_t n, uint32_t alpha) {
+	std::vector<uint8_t> src = randomPixels(n, format.srcBytes);
+	std::vector<uint8_t> expected = randomPixels(n, format.dstBytes);
+	std::vector<uint8_t> result = expected;
+
+	SDL_SetBlendInstructionSet(BLEND_SCALAR);
+	format.function(&src[0], &expected[0], alpha, n);
+	SDL_SetBlendInstructionSet(set);
+	format.function(&src[0], &result[0], alpha, n);
+	// the bytes after the row have to stay untouched too
+	return expected == result;
+}
+
+TEST(blend_scalar_always_supported) {
+	CHECK(SDL_IsBlendInstructionSetSupported(BLEND_SCALAR));
+	CHECK(SDL_SetBlendInstructionSet(BLEND_SCALAR));
+	CHECK(SDL_GetBlendInstructionSet() == BLEND_SCALAR);
+}
+
+TEST(blend_simd_matches_scalar) {
+	srand(42);
+	const BlendInstructionSet initial = SDL_GetBlendInstructionSet();
+	const uint32_t alphas[] = { 0, 1, 15, 127, 128, 200, 254, 255 };
+	for (int32_t s = 0; s < SIMD_COUNT; ++s) {
+		if (!SDL_IsBlendInstructionSetSupported(SIMD_SETS[s])) {
+			std::cout << SIMD_NAMES[s] << " not supported, skipped" << std::endl;
+			continue;
+		}
+		for (int32_t f = 0; f < FORMAT_COUNT; ++f) {
+			int32_t failures = 0;
+			// all widths around the vector sizes, including the scalar tails
+			for (int32_t n = 1; n <= 70; ++n) {
+				for (size_t a = 0; a < sizeof(alphas) / sizeof(alphas[0]); ++a) {
+					if (!blendMatches(FORMATS[f], SIMD_SETS[s], n, alphas[a])) {
+						++failures;
+					}
+				}
+			}
+			for (int32_t i = 0; i < 50; ++i) {
+				if (!blendMatches(FORMATS[f], SIMD_SETS[s], 1 + rand() % 2048, rand() % 256)) {
+					++failures;
+				}
+			}
+			if (failures) {
+				std::cout << SIMD_NAMES[s] << " " << FORMATS[f].name << ": " << failures << " mismatches" << std::endl;
+			}
+			CHECK_EQUAL(0, failures);
+		}
+	}
+	SDL_SetBlendInstructionSet(initial);
+}
+
+TEST(blend_alpha_out_of_range) {
+	// alpha above 255 always takes the scalar path
+	srand(7);
+	for (int32_t s = 0; s < SIMD_COUNT; ++s) {
+		if (!SDL_IsBlendInstructionSetSupported(SIMD_SETS[s])) {
+			continue;
+		}
+		for (int32_t f = 0; f < FORMAT_COUNT; ++f) {
+			CHECK(blendMatches(FORMATS[f], SIMD_SETS[s], 64, 256));
+		}
+	}
+}
+
+TEST(blend_benchmark) {
+	const BlendInstructionSet initial = SDL_GetBlendInstructionSet();
+	const int32_t widths[] = { 32, 64, 256, 1024 };
+	const int32_t pixels = 1 << 23;
+	BlendInstructionSet sets[SIMD_COUNT + 1];
+	const char* names[SIMD_COUNT + 1];
+	sets[0] = BLEND_SCALAR;
+	names[0] = "scalar";
+	for (int32_t s = 0; s < SIMD_COUNT; ++s) {
+		sets[s + 1] = SIMD_SETS[s];
+		names[s + 1] = SIMD_NAMES[s];
+	}
+
+	std::cout << "blending " << pixels << " pixels per row width, seconds:" << std::endl;
+	for (int32_t f = 0; f < FORMAT_COUNT; ++f) {
+		for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+			const int32_t n = widths[w];
+			std::vector<uint8_t> src = randomPixels(n, FORMATS[f].srcBytes);
+			std::vector<uint8_t> dst = randomPixels(n, FORMATS[f].dstBytes);
+			std::cout << "  " << FORMATS[f].name << " width " << n << ":";
+			for (int32_t s = 0; s <= SIMD_COUNT; ++s) {
+				if (!SDL_SetBlendInstructionSet(sets[s])) {
+					continue;
+				}
+				clock_t start = clock();
+				for (int32_t r = pixels / n; r > 0; --r) {
+					FORMATS[f].function(&src[0], &dst[0], 200, n);
+				}
+				std::cout << " " << names[s] << " " << double(clock() - start) / CLOCKS_PER_SEC;
+			}
+			std::cout << std::endl;
+		}
+	}
+	SDL_SetBlendInstructionSet(initial);
+}
+
+int main() {
+	return UnitTest::RunAllTests();
+}
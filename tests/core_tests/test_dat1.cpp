@@ -20,8 +20,11 @@
  ***************************************************************************/
 
 // Standard C++ library includes
+#include <chrono>
+#include <future>
 #include <iostream>
 #include <iomanip>
+#include <thread>
 
 // Platform specific includes
 #include "fife_unittest.h"
@@ -91,6 +94,48 @@ TEST(DAT1_test){
 	delete fcomp;
 }
 
+/** Opens a file and returns its length, used as worker thread.
+ * The worker shares the VFS, so a blocked worker does not outlive it.
+ */
+static uint32_t openLength(boost::shared_ptr<FIFE::VFS> vfs, const std::string& file) {
+	FIFE::RawData* data = vfs->open(file);
+	uint32_t length = data->getDataLength();
+	delete data;
+	return length;
+}
+
+TEST(DAT_open_from_worker){
+	// the image loading workers open files while the main thread uses the VFS,
+	// opening an archive entry opens the archive again and must not deadlock
+	boost::shared_ptr<FIFE::VFS> vfs(new FIFE::VFS());
+	vfs->addSource(new FIFE::VFSDirectory(vfs.get()));
+	vfs->addSource(new FIFE::DAT1(vfs.get(), COMPRESSED_FILE));
+	vfs->addSource(new FIFE::DAT2(vfs.get(), "tests/data/dat2vfstest.dat"));
+
+	FIFE::RawData* fraw = vfs->open(RAW_FILE);
+	uint32_t expected = fraw->getDataLength();
+
+	std::packaged_task<uint32_t(boost::shared_ptr<FIFE::VFS>, const std::string&)> dat1(openLength);
+	std::packaged_task<uint32_t(boost::shared_ptr<FIFE::VFS>, const std::string&)> dat2(openLength);
+	std::future<uint32_t> dat1Length = dat1.get_future();
+	std::future<uint32_t> dat2Length = dat2.get_future();
+	// detached, a deadlocked worker fails the test instead of blocking it
+	std::thread(std::move(dat1), vfs, std::string("dat1vfstest.map")).detach();
+	std::thread(std::move(dat2), vfs, std::string("dat2vfstest.map")).detach();
+
+	bool dat1Ready = dat1Length.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+	bool dat2Ready = dat2Length.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+	CHECK(dat1Ready);
+	CHECK(dat2Ready);
+	if (dat1Ready) {
+		CHECK_EQUAL(expected, dat1Length.get());
+	}
+	if (dat2Ready) {
+		CHECK_EQUAL(expected, dat2Length.get());
+	}
+	delete fraw;
+}
+
 int main() {
 	return UnitTest::RunAllTests();
 }
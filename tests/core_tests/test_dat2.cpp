@@ -20,8 +20,15 @@
  ***************************************************************************/
 
 // Standard C++ library includes
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include <sstream>
+#include <vector>
 
 // Platform specific includes
 #include "fife_unittest.h"
@@ -100,6 +107,65 @@ TEST(DAT2_test){
 
 }
 
+static void write32(std::ofstream& out, uint32_t value) {
+	for (uint32_t i = 0; i < 4; ++i) {
+		out.put(static_cast<char>((value >> (i * 8)) & 0xff));
+	}
+}
+
+TEST(DAT2_index_benchmark) {
+	const std::string generated = "fifetestindex.dat";
+	const uint32_t count = 100000;
+
+	// 16 bytes of data per file, followed by the file list
+	std::vector<std::string> names;
+	std::ofstream out(generated.c_str(), std::ios::binary);
+	for (uint32_t i = 0; i < count; ++i) {
+		std::ostringstream name;
+		name << "art\\critters\\dir" << (i % 500) << "\\file" << i << ".frm";
+		names.push_back(name.str());
+		write32(out, i);
+		write32(out, i * 3);
+		write32(out, i * 5);
+		write32(out, i * 7);
+	}
+	uint32_t listStart = static_cast<uint32_t>(out.tellp());
+	write32(out, count);
+	for (uint32_t i = 0; i < count; ++i) {
+		write32(out, names[i].size());
+		out.write(names[i].c_str(), names[i].size());
+		out.put(0);
+		write32(out, 16);
+		write32(out, 16);
+		write32(out, i * 16);
+	}
+	uint32_t listLength = static_cast<uint32_t>(out.tellp()) - listStart;
+	write32(out, listLength);
+	write32(out, static_cast<uint32_t>(out.tellp()) + 4);
+	out.close();
+	{
+		boost::shared_ptr<VFS> vfs(new VFS());
+		vfs->addSource(new VFSDirectory(vfs.get()));
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		vfs->addSource(new DAT2(vfs.get(), generated));
+		double addTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		CHECK(vfs->exists("art/critters/dir0/file0.frm"));
+		CHECK(vfs->exists("art/critters/dir499/file99999.frm"));
+		CHECK(!vfs->exists("art/critters/dir0/file1.frm"));
+		CHECK_EQUAL(200u, vfs->listFiles("art/critters/dir7").size());
+
+		std::unique_ptr<RawData> data(vfs->open("art/critters/dir345/file12345.frm"));
+		CHECK_EQUAL(16u, data->getDataLength());
+		data->setIndex(4);
+		CHECK_EQUAL(12345u * 3, data->read32Little());
+
+		std::cout << count << " DAT2 entries: add " << addTime << "s" << std::endl;
+	}
+	std::remove(generated.c_str());
+}
+
 int main() {
 	return UnitTest::RunAllTests();
 }
@@ -0,0 +1,307 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <SDL.h>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "model/model.h"
+#include "model/metamodel/object.h"
+#include "model/metamodel/grids/squaregrid.h"
+#include "model/structures/instance.h"
+#include "model/structures/layer.h"
+#include "model/structures/map.h"
+#include "util/base/exception.h"
+#include "util/time/timemanager.h"
+#include "vfs/vfs.h"
+#include "vfs/vfsdirectory.h"
+#include "video/animation.h"
+#include "video/animationmanager.h"
+#include "video/devicecaps.h"
+#include "video/imagemanager.h"
+#include "video/opengl/renderbackendopengl.h"
+#include "video/sdl/renderbackendsdl.h"
+#include "view/camera.h"
+#include "view/renderers/effectimagecache.h"
+#include "view/renderers/instancerenderer.h"
+#include "view/visual.h"
+
+using namespace FIFE;
+
+static const int32_t CRATE_FRAMES = 9;
+static const int32_t SCREEN_SIZE = 256;
+
+// Environment
+struct environment {
+	boost::shared_ptr<TimeManager> timemanager;
+	boost::shared_ptr<VFS> vfs;
+
+	environment()
+		: timemanager(new TimeManager()),
+		  vfs(new VFS()) {
+		vfs->addSource(new VFSDirectory(vfs.get()));
+	}
+};
+
+static std::string crateFile(int32_t frame) {
+	if (frame == 0) {
+		return "tests/data/crate/full_s_000.png";
+	}
+	std::ostringstream file;
+	file << "tests/data/crate/full_s_000" << frame << ".png";
+	return file.str();
+}
+
+TEST_FIXTURE(environment, effectimagecache_keys) {
+	SDL_Color colorkey = { 255, 0, 255, 0 };
+	RenderBackendSDL renderbackend(colorkey);
+	ImageManager imagemanager;
+	ImagePtr first = imagemanager.loadBlank("first", 8, 8);
+	ImagePtr second = imagemanager.loadBlank("second", 8, 8);
+
+	// every parameter of the key on its own
+	std::vector<EffectImageCache::Key> keys;
+	keys.push_back(EffectImageCache::outlineKey(first->getHandle(), 255, 0, 0, 1, 1));
+	keys.push_back(EffectImageCache::outlineKey(second->getHandle(), 255, 0, 0, 1, 1));
+	keys.push_back(EffectImageCache::outlineKey(first->getHandle(), 0, 255, 0, 1, 1));
+	keys.push_back(EffectImageCache::outlineKey(first->getHandle(), 0, 0, 255, 1, 1));
+	keys.push_back(EffectImageCache::outlineKey(first->getHandle(), 255, 0, 0, 2, 1));
+	keys.push_back(EffectImageCache::outlineKey(first->getHandle(), 255, 0, 0, 1, 2));
+	// same parameters as the first outline, but a coloring
+	keys.push_back(EffectImageCache::coloringKey(first->getHandle(), 255, 0, 0, 0));
+	keys.push_back(EffectImageCache::coloringKey(first->getHandle(), 255, 0, 0, 128));
+	keys.push_back(EffectImageCache::coloringKey(second->getHandle(), 255, 0, 0, 128));
+
+	EffectImageCache cache;
+	cache.setMaxBytes(0);
+	std::vector<ImagePtr> images;
+	std::set<std::string> names;
+	for (size_t i = 0; i < keys.size(); ++i) {
+		for (size_t j = 0; j < keys.size(); ++j) {
+			// equal only to itself
+			const bool equal = !(keys[i] < keys[j]) && !(keys[j] < keys[i]);
+			CHECK_EQUAL(i == j, equal);
+		}
+		const std::string name = EffectImageCache::getEffectName(i == 1 || i == 8 ? "second" : "first", keys[i]);
+		names.insert(name);
+		images.push_back(imagemanager.loadBlank(name, 4, 4));
+		cache.insert(keys[i], images.back());
+	}
+	CHECK_EQUAL(keys.size(), names.size());
+	CHECK_EQUAL(static_cast<uint32_t>(keys.size()), cache.getEntryCount());
+	for (size_t i = 0; i < keys.size(); ++i) {
+		CHECK(cache.contains(keys[i]));
+		CHECK(cache.get(keys[i]) == images[i]);
+	}
+	CHECK_EQUAL(static_cast<uint32_t>(keys.size()), cache.getHitCount());
+	CHECK_EQUAL(0u, cache.getMissCount());
+
+	// unknown parameters are a miss
+	CHECK(!cache.get(EffectImageCache::outlineKey(first->getHandle(), 255, 0, 0, 3, 1)));
+	CHECK_EQUAL(1u, cache.getMissCount());
+
+	// replacing keeps one entry per key
+	ImagePtr replacement = imagemanager.loadBlank("replacement", 4, 4);
+	cache.insert(keys[0], replacement);
+	CHECK_EQUAL(static_cast<uint32_t>(keys.size()), cache.getEntryCount());
+	CHECK(cache.get(keys[0]) == replacement);
+}
+
+TEST_FIXTURE(environment, effectimagecache_eviction) {
+	SDL_Color colorkey = { 255, 0, 255, 0 };
+	RenderBackendSDL renderbackend(colorkey);
+	ImageManager imagemanager;
+	ImagePtr source = imagemanager.loadBlank("source", 8, 8);
+
+	// images rendered during the last two frames are kept, these were never rendered
+	renderbackend.startFrame();
+	renderbackend.startFrame();
+
+	EffectImageCache cache;
+	const size_t imageBytes = 16 * 16 * 4;
+	cache.setMaxBytes(imageBytes * 4);
+	std::vector<ResourceHandle> handles;
+	for (int32_t width = 1; width <= 20; ++width) {
+		EffectImageCache::Key key = EffectImageCache::outlineKey(source->getHandle(), 255, 0, 0, width, 1);
+		ImagePtr image = imagemanager.loadBlank(EffectImageCache::getEffectName("source", key), 16, 16);
+		CHECK_EQUAL(imageBytes, image->getSize());
+		handles.push_back(image->getHandle());
+		cache.insert(key, image);
+		CHECK(cache.getBytes() <= cache.getMaxBytes());
+	}
+	CHECK_EQUAL(4u, cache.getEntryCount());
+	CHECK_EQUAL(16u, cache.getEvictionCount());
+	CHECK_EQUAL(imageBytes * 4, cache.getBytes());
+
+	// the least recently used images were removed from the manager
+	for (size_t i = 0; i < handles.size(); ++i) {
+		CHECK_EQUAL(i >= 16, imagemanager.exists(handles[i]));
+	}
+	for (int32_t width = 17; width <= 20; ++width) {
+		CHECK(cache.contains(EffectImageCache::outlineKey(source->getHandle(), 255, 0, 0, width, 1)));
+	}
+
+	// a smaller budget evicts right away
+	cache.setMaxBytes(imageBytes);
+	CHECK_EQUAL(1u, cache.getEntryCount());
+	CHECK(cache.getBytes() <= cache.getMaxBytes());
+	CHECK(cache.contains(EffectImageCache::outlineKey(source->getHandle(), 255, 0, 0, 20, 1)));
+}
+
+// Precomputes the outlines and colorings of an animation, synchronously or on
+// the worker, and renders instances that use the frames with outlines.
+static void precompute(bool background) {
+	environment env;
+	SDL_Color colorkey = { 255, 0, 255, 0 };
+	RenderBackendOpenGL renderbackend(colorkey);
+	// the outlines are images
+	renderbackend.setShadersEnabled(false);
+	// keeps a driver that was selected by the user
+	SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+	try {
+		renderbackend.init("");
+		renderbackend.createMainScreen(ScreenMode(SCREEN_SIZE, SCREEN_SIZE, 32, SDL_WINDOW_OPENGL), "FIFE", "");
+	} catch (Exception& e) {
+		std::cout << "test_effectimagecache: no OpenGL context, " << e.what() << std::endl;
+		return;
+	}
+
+	ImageManager imagemanager;
+	AnimationManager animationmanager;
+	boost::scoped_ptr<InstanceRenderer> prototype(new InstanceRenderer(&renderbackend, 10));
+	std::vector<RendererBase*> renderers;
+	renderers.push_back(prototype.get());
+	Model model(&renderbackend, renderers);
+	model.adoptCellGrid(new SquareGrid());
+
+	AnimationPtr animation = animationmanager.create("crate_animation");
+	Map* map = model.createMap("map");
+	Layer* layer = map->createLayer("layer", model.getCellGrid("square"));
+	std::vector<Instance*> instances;
+	for (int32_t frame = 0; frame < CRATE_FRAMES; ++frame) {
+		ImagePtr image = imagemanager.load(crateFile(frame));
+		animation->addFrame(image, 100);
+		// one instance per frame
+		std::ostringstream id;
+		id << "crate_" << frame;
+		Object* object = model.createObject(id.str(), "effect_test");
+		ObjectVisual::create(object)->addStaticImage(0, image->getHandle());
+		Instance* instance = layer->createInstance(object, ExactModelCoordinate(frame % 3 - 1, frame / 3 - 1));
+		InstanceVisual::create(instance);
+		instances.push_back(instance);
+	}
+
+	Camera* camera = map->addCamera("camera", Rect(0, 0, SCREEN_SIZE, SCREEN_SIZE));
+	camera->setCellImageDimensions(48, 48);
+	camera->setLocation(Location(layer));
+	InstanceRenderer* renderer = InstanceRenderer::getInstance(camera);
+	renderer->activateAllLayers(map);
+	CHECK(!renderer->hasEffectShaders());
+
+	const size_t imagesBefore = imagemanager.getTotalResources();
+	renderer->precomputeOutlines(animation, 255, 64, 0, 2, 1, background);
+	renderer->precomputeColoring(animation, 0, 64, 255, 128, background);
+	if (background) {
+		CHECK_EQUAL(static_cast<uint32_t>(CRATE_FRAMES * 2), renderer->getPendingEffectCount());
+	}
+
+	// the results of the worker are added while rendering
+	std::chrono::steady_clock::time_point timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	for (int32_t frame = 0; frame < 2 || renderer->getPendingEffectCount() > 0; ++frame) {
+		if (std::chrono::steady_clock::now() > timeout) {
+			break;
+		}
+		renderbackend.startFrame();
+		camera->update();
+		camera->render();
+		renderbackend.renderVertexArrays();
+		renderbackend.endFrame();
+		if (renderer->getPendingEffectCount() > 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	CHECK_EQUAL(0u, renderer->getPendingEffectCount());
+	CHECK_EQUAL(static_cast<uint32_t>(CRATE_FRAMES * 2), renderer->getEffectCacheEntryCount());
+	CHECK_EQUAL(imagesBefore + CRATE_FRAMES * 2, imagemanager.getTotalResources());
+	CHECK(renderer->getEffectCacheBytes() > 0);
+	// nothing was looked up yet
+	CHECK_EQUAL(0u, renderer->getEffectCacheHitCount());
+	CHECK_EQUAL(0u, renderer->getEffectCacheMissCount());
+
+	// the outlines of the precomputed frames are found
+	for (size_t i = 0; i < instances.size(); ++i) {
+		renderer->addOutlined(instances[i], 255, 64, 0, 2, 1);
+	}
+	renderbackend.startFrame();
+	camera->update();
+	camera->render();
+	renderbackend.renderVertexArrays();
+	renderbackend.endFrame();
+	CHECK_EQUAL(static_cast<uint32_t>(CRATE_FRAMES), renderer->getEffectCacheHitCount());
+	CHECK_EQUAL(0u, renderer->getEffectCacheMissCount());
+	CHECK_EQUAL(imagesBefore + CRATE_FRAMES * 2, imagemanager.getTotalResources());
+
+	// another width was not precomputed
+	renderer->addOutlined(instances[0], 255, 64, 0, 3, 1);
+	renderbackend.startFrame();
+	camera->update();
+	camera->render();
+	renderbackend.renderVertexArrays();
+	renderbackend.endFrame();
+	CHECK_EQUAL(1u, renderer->getEffectCacheMissCount());
+	CHECK_EQUAL(static_cast<uint32_t>(CRATE_FRAMES * 2 + 1), renderer->getEffectCacheEntryCount());
+	CHECK_EQUAL(imagesBefore + CRATE_FRAMES * 2 + 1, imagemanager.getTotalResources());
+}
+
+TEST(effectimagecache_precompute) {
+	precompute(false);
+}
+
+TEST(effectimagecache_precompute_background) {
+	precompute(true);
+}
+
+// need this here because SDL redefines
+// main to SDL_main in SDL_main.h
+#ifdef main
+#undef main
+#endif
+
+int main() {
+	return UnitTest::RunAllTests();
+}
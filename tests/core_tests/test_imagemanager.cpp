@@ -0,0 +1,143 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <string>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+#include <boost/shared_ptr.hpp>
+#include <SDL.h>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/structures/rect.h"
+#include "util/time/timemanager.h"
+#include "vfs/vfs.h"
+#include "vfs/vfsdirectory.h"
+#include "video/imagemanager.h"
+#include "video/sdl/renderbackendsdl.h"
+
+using namespace FIFE;
+
+static const std::string ATLAS_FILE = "tests/data/rpg_tiles_01.png";
+static const std::string SUBIMAGE_NAME = "rpg_tiles_01_sub";
+
+// Environment
+struct environment {
+	boost::shared_ptr<TimeManager> timemanager;
+	boost::shared_ptr<VFS> vfs;
+
+	environment()
+		: timemanager(new TimeManager()),
+		  vfs(new VFS()) {
+		vfs->addSource(new VFSDirectory(vfs.get()));
+	}
+};
+
+enum SubimageAccess {
+	ACCESS_GET_NAME,
+	ACCESS_GET_HANDLE,
+	ACCESS_LOAD,
+	ACCESS_RELOAD_NAME,
+	ACCESS_RELOAD_HANDLE
+};
+
+// Loads a subimage whose atlas was removed from the manager, so loading
+// creates the atlas again. With the given number of additional images
+// the creation rehashes the maps of the manager.
+static void loadSubimage(SubimageAccess access, uint32_t fillers) {
+	ImageManager imagemanager;
+	ImagePtr atlas = imagemanager.load(ATLAS_FILE);
+	ImagePtr subimage = imagemanager.create(SUBIMAGE_NAME);
+	subimage->useSharedImage(atlas, Rect(32, 32, 32, 32));
+	const ResourceHandle handle = subimage->getHandle();
+	subimage->free();
+	imagemanager.remove(atlas);
+	atlas.reset();
+	for (uint32_t i = 0; i < fillers; ++i) {
+		imagemanager.loadBlank(4, 4);
+	}
+	subimage.reset();
+	CHECK(!imagemanager.exists(ATLAS_FILE));
+
+	ImagePtr loaded;
+	switch (access) {
+		case ACCESS_GET_NAME:
+			loaded = imagemanager.get(SUBIMAGE_NAME);
+			break;
+		case ACCESS_GET_HANDLE:
+			loaded = imagemanager.get(handle);
+			break;
+		case ACCESS_LOAD:
+			loaded = imagemanager.load(SUBIMAGE_NAME);
+			break;
+		case ACCESS_RELOAD_NAME:
+			imagemanager.reload(SUBIMAGE_NAME);
+			loaded = imagemanager.getPtr(handle);
+			break;
+		case ACCESS_RELOAD_HANDLE:
+			imagemanager.reload(handle);
+			loaded = imagemanager.getPtr(handle);
+			break;
+	}
+
+	CHECK(imagemanager.exists(ATLAS_FILE));
+	CHECK_EQUAL(fillers + 2, imagemanager.getTotalResources());
+	CHECK(loaded);
+	if (!loaded) {
+		return;
+	}
+	CHECK_EQUAL(handle, loaded->getHandle());
+	CHECK(loaded->isSharedImage());
+	CHECK(loaded->getState() == IResource::RES_LOADED);
+	CHECK_EQUAL(32u, loaded->getWidth());
+	CHECK_EQUAL(32u, loaded->getHeight());
+	// the manager and this test hold the image
+	CHECK_EQUAL(3u, loaded.useCount());
+}
+
+TEST_FIXTURE(environment, imagemanager_subimage_creates_atlas) {
+	SDL_Color colorkey = { 255, 0, 255, 0 };
+	RenderBackendSDL renderbackend(colorkey);
+	const SubimageAccess accesses[] = { ACCESS_GET_NAME, ACCESS_GET_HANDLE, ACCESS_LOAD,
+		ACCESS_RELOAD_NAME, ACCESS_RELOAD_HANDLE };
+	// the maps grow at 70% load, one of the counts rehashes while the atlas is created
+	for (uint32_t a = 0; a < sizeof(accesses) / sizeof(accesses[0]); ++a) {
+		for (uint32_t fillers = 0; fillers < 48; ++fillers) {
+			loadSubimage(accesses[a], fillers);
+		}
+	}
+}
+
+// need this here because SDL redefines
+// main to SDL_main in SDL_main.h
+#ifdef main
+#undef main
+#endif
+
+int main() {
+	return UnitTest::RunAllTests();
+}
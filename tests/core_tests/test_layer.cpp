@@ -0,0 +1,243 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+#include <boost/shared_ptr.hpp>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "model/model.h"
+#include "model/metamodel/object.h"
+#include "model/metamodel/grids/squaregrid.h"
+#include "model/structures/cell.h"
+#include "model/structures/cellcache.h"
+#include "model/structures/instance.h"
+#include "model/structures/instancetree.h"
+#include "model/structures/layer.h"
+#include "model/structures/map.h"
+#include "util/time/timemanager.h"
+#include "view/rendererbase.h"
+
+using namespace FIFE;
+
+// Environment
+struct environment {
+	boost::shared_ptr<TimeManager> timemanager;
+	Model model;
+
+	environment()
+		: timemanager(new TimeManager()),
+		  model(NULL, std::vector<RendererBase*>()) {
+		model.adoptCellGrid(new SquareGrid());
+		Object* obj = model.createObject("tree", "test");
+		obj->setBlocking(true);
+		model.createObject("grass", "test");
+	}
+};
+
+class CountingListener : public LayerChangeListener {
+public:
+	CountingListener() : created(0), batches(0) {}
+
+	virtual void onLayerChanged(Layer* layer, std::vector<Instance*>& changedInstances) {}
+	virtual void onInstanceCreate(Layer* layer, Instance* instance) { ++created; }
+	virtual void onInstanceDelete(Layer* layer, Instance* instance) {}
+	virtual void onInstancesCreate(Layer* layer, const std::vector<Instance*>& instances) {
+		++batches;
+		LayerChangeListener::onInstancesCreate(layer, instances);
+	}
+
+	int32_t created;
+	int32_t batches;
+};
+
+// ground layer with grass on every cell and an interact layer with some trees
+static void createDescriptors(Model& model, int32_t size, std::vector<InstanceDescriptor>& ground, std::vector<InstanceDescriptor>& objects) {
+	Object* grass = model.getObject("grass", "test");
+	Object* tree = model.getObject("tree", "test");
+	for (int32_t y = 0; y < size; ++y) {
+		for (int32_t x = 0; x < size; ++x) {
+			ground.push_back(InstanceDescriptor(grass, ExactModelCoordinate(x, y)));
+			if ((x * 7 + y * 3) % 11 == 0) {
+				objects.push_back(InstanceDescriptor(tree, ExactModelCoordinate(x + 0.25, y - 0.25)));
+			}
+		}
+	}
+	objects.push_back(InstanceDescriptor(NULL, ExactModelCoordinate(0, 0)));
+	objects.push_back(InstanceDescriptor(tree, ExactModelCoordinate(-3, size + 2), "outside"));
+}
+
+static Map* createMap(Model& model, const std::string& id) {
+	Map* map = model.createMap(id);
+	Layer* ground = map->createLayer("ground", model.getCellGrid("square"));
+	ground->setWalkable(true);
+	Layer* objects = map->createLayer("objects", model.getCellGrid("square"));
+	objects->setInteract(true, "ground");
+	return map;
+}
+
+static void createSingle(Layer* layer, const std::vector<InstanceDescriptor>& descriptors) {
+	for (std::vector<InstanceDescriptor>::const_iterator it = descriptors.begin(); it != descriptors.end(); ++it) {
+		if (it->object) {
+			layer->createInstance(it->object, it->position, it->id);
+		}
+	}
+}
+
+TEST(layer_create_instances) {
+	environment env;
+	std::vector<InstanceDescriptor> groundDescriptors;
+	std::vector<InstanceDescriptor> objectDescriptors;
+	createDescriptors(env.model, 30, groundDescriptors, objectDescriptors);
+
+	Map* bulk = createMap(env.model, "bulk");
+	CountingListener listener;
+	bulk->getLayer("objects")->addChangeListener(&listener);
+	std::vector<Instance*> ground = bulk->getLayer("ground")->createInstances(groundDescriptors);
+	std::vector<Instance*> objects = bulk->getLayer("objects")->createInstances(objectDescriptors);
+	bulk->getLayer("objects")->removeChangeListener(&listener);
+
+	CHECK_EQUAL(groundDescriptors.size(), ground.size());
+	CHECK_EQUAL(objectDescriptors.size() - 1, objects.size());
+	CHECK_EQUAL(1, listener.batches);
+	CHECK_EQUAL(static_cast<int32_t>(objects.size()), listener.created);
+	CHECK(objects.back()->getId() == "outside");
+	CHECK(bulk->getLayer("objects")->getInstance("outside") == objects.back());
+	for (size_t i = 0; i < ground.size(); ++i) {
+		CHECK(ground[i]->getObject() == groundDescriptors[i].object);
+		CHECK(ground[i]->getLocationRef().getExactLayerCoordinates() == groundDescriptors[i].position);
+	}
+
+	// the instance trees and cell caches match the ones built instance by instance
+	Map* single = createMap(env.model, "single");
+	createSingle(single->getLayer("ground"), groundDescriptors);
+	createSingle(single->getLayer("objects"), objectDescriptors);
+
+	bulk->initializeCellCaches();
+	bulk->finalizeCellCaches();
+	single->initializeCellCaches();
+	single->finalizeCellCaches();
+
+	for (int32_t y = -5; y < 36; ++y) {
+		for (int32_t x = -5; x < 36; ++x) {
+			ModelCoordinate mc(x, y);
+			InstanceTree::InstanceList bulkInstances;
+			InstanceTree::InstanceList singleInstances;
+			bulk->getLayer("objects")->getInstanceTree()->findInstances(mc, 0, 0, bulkInstances);
+			single->getLayer("objects")->getInstanceTree()->findInstances(mc, 0, 0, singleInstances);
+			CHECK_EQUAL(singleInstances.size(), bulkInstances.size());
+
+			Cell* bulkCell = bulk->getLayer("ground")->getCellCache()->getCell(mc);
+			Cell* singleCell = single->getLayer("ground")->getCellCache()->getCell(mc);
+			CHECK_EQUAL(singleCell == NULL, bulkCell == NULL);
+			if (bulkCell && singleCell) {
+				CHECK_EQUAL(singleCell->getInstances().size(), bulkCell->getInstances().size());
+				CHECK_EQUAL(singleCell->getCellType(), bulkCell->getCellType());
+			}
+		}
+	}
+}
+
+TEST(layer_create_instances_listener_resize) {
+	environment env;
+	std::vector<InstanceDescriptor> groundDescriptors;
+	std::vector<InstanceDescriptor> objectDescriptors;
+	createDescriptors(env.model, 10, groundDescriptors, objectDescriptors);
+
+	Map* map = createMap(env.model, "map");
+	map->getLayer("ground")->createInstances(groundDescriptors);
+	map->initializeCellCaches();
+	map->finalizeCellCaches();
+
+	// instances created after the cache exists are added by its listener,
+	// the cache grows once to fit the instance outside of the ground
+	std::vector<Instance*> objects = map->getLayer("objects")->createInstances(objectDescriptors);
+	CellCache* cache = map->getLayer("ground")->getCellCache();
+	for (std::vector<Instance*>::iterator it = objects.begin(); it != objects.end(); ++it) {
+		Cell* cell = cache->getCell((*it)->getLocationRef().getLayerCoordinates());
+		CHECK(cell);
+		if (cell) {
+			CHECK(cell->getInstances().count(*it) == 1);
+			CHECK_EQUAL(CTYPE_DYNAMIC_BLOCKER, cell->getCellType());
+		}
+	}
+}
+
+TEST(layer_create_instances_benchmark) {
+	environment env;
+	std::vector<InstanceDescriptor> groundDescriptors;
+	std::vector<InstanceDescriptor> objectDescriptors;
+	createDescriptors(env.model, 400, groundDescriptors, objectDescriptors);
+
+	clock_t start = clock();
+	Map* single = createMap(env.model, "single");
+	createSingle(single->getLayer("ground"), groundDescriptors);
+	createSingle(single->getLayer("objects"), objectDescriptors);
+	single->initializeCellCaches();
+	single->finalizeCellCaches();
+	clock_t singleTime = clock() - start;
+
+	start = clock();
+	Map* bulk = createMap(env.model, "bulk");
+	bulk->getLayer("ground")->createInstances(groundDescriptors);
+	bulk->getLayer("objects")->createInstances(objectDescriptors);
+	bulk->initializeCellCaches();
+	bulk->finalizeCellCaches();
+	clock_t bulkTime = clock() - start;
+
+	std::cout << groundDescriptors.size() + objectDescriptors.size() << " instances with cell caches, "
+		<< "single: " << singleTime * 1000 / CLOCKS_PER_SEC << " ms, "
+		<< "bulk: " << bulkTime * 1000 / CLOCKS_PER_SEC << " ms" << std::endl;
+
+	CHECK_EQUAL(single->getLayer("ground")->getInstances().size(), bulk->getLayer("ground")->getInstances().size());
+
+	// instances created next to an existing cell cache, the cache has to grow to fit them
+	for (std::vector<InstanceDescriptor>::iterator it = objectDescriptors.begin(); it != objectDescriptors.end(); ++it) {
+		it->position.x = -it->position.x;
+	}
+	start = clock();
+	createSingle(single->getLayer("objects"), objectDescriptors);
+	singleTime = clock() - start;
+
+	start = clock();
+	bulk->getLayer("objects")->createInstances(objectDescriptors);
+	bulkTime = clock() - start;
+
+	std::cout << objectDescriptors.size() << " instances next to a cell cache, "
+		<< "single: " << singleTime * 1000 / CLOCKS_PER_SEC << " ms, "
+		<< "bulk: " << bulkTime * 1000 / CLOCKS_PER_SEC << " ms" << std::endl;
+
+	CHECK_EQUAL(single->getLayer("objects")->getInstances().size(), bulk->getLayer("objects")->getInstances().size());
+}
+
+int main() {
+	return UnitTest::RunAllTests();
+}
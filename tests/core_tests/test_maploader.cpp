@@ -0,0 +1,154 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "loaders/native/map/maploader.h"
+#include "model/model.h"
+#include "model/metamodel/object.h"
+#include "util/time/timemanager.h"
+#include "video/animationmanager.h"
+#include "video/imagemanager.h"
+#include "view/rendererbase.h"
+#include "vfs/fife_boost_filesystem.h"
+#include "vfs/vfs.h"
+#include "vfs/vfsdirectory.h"
+
+using namespace FIFE;
+
+static const std::string IMPORT_DIRECTORY = "tests/data/maploader_tmp";
+static const int32_t IMPORT_FILES = 40;
+
+struct environment {
+	boost::shared_ptr<TimeManager> timemanager;
+	boost::scoped_ptr<VFS> vfs;
+	ImageManager imageManager;
+	AnimationManager animationManager;
+	Model model;
+
+	environment()
+		: timemanager(new TimeManager()),
+		  vfs(new VFS()),
+		  model(NULL, std::vector<RendererBase*>()) {
+		vfs->addSource(new VFSDirectory(vfs.get()));
+	}
+};
+
+static std::string objectId(int32_t index) {
+	std::ostringstream id;
+	id << "object_" << (index < 10 ? "0" : "") << index;
+	return id.str();
+}
+
+static std::string importFile(const std::string& directory, int32_t index) {
+	return directory + "/" + objectId(index) + ".xml";
+}
+
+// every object inherits from the object of the previous file, which only
+// works if the files are registered in order
+static void writeImportFiles() {
+	bfs::create_directories(bfs::path(IMPORT_DIRECTORY + "/nested"));
+	for (int32_t i = 0; i < IMPORT_FILES; ++i) {
+		std::ofstream file(importFile(IMPORT_DIRECTORY, i).c_str());
+		file << "<?fife type=\"object\"?>\n<assets>\n";
+		file << "\t<object id=\"" << objectId(i) << "\" namespace=\"imports\"";
+		if (i > 0) {
+			file << " parent=\"" << objectId(i - 1) << "\"";
+		}
+		file << " blocking=\"" << (i % 2) << "\" />\n";
+		file << "</assets>\n";
+	}
+	// nested directories are loaded after the files of their parent
+	std::ofstream nested(importFile(IMPORT_DIRECTORY + "/nested", IMPORT_FILES).c_str());
+	nested << "<assets><object id=\"" << objectId(IMPORT_FILES) << "\" namespace=\"imports\" parent=\""
+		<< objectId(IMPORT_FILES - 1) << "\" /></assets>\n";
+
+	// broken files are skipped without affecting the others
+	std::ofstream broken((IMPORT_DIRECTORY + "/broken.xml").c_str());
+	broken << "<assets><object id=\"broken\"";
+}
+
+static void removeImportFiles() {
+	bfs::remove_all(bfs::path(IMPORT_DIRECTORY));
+}
+
+TEST(maploader_import_directory) {
+	writeImportFiles();
+	{
+		environment env;
+		MapLoader loader(&env.model, env.vfs.get(), &env.imageManager, NULL);
+		loader.loadImportDirectory(IMPORT_DIRECTORY);
+
+		for (int32_t i = 0; i <= IMPORT_FILES; ++i) {
+			Object* object = env.model.getObject(objectId(i), "imports");
+			CHECK(object);
+			if (!object) {
+				continue;
+			}
+			std::string directory = i < IMPORT_FILES ? IMPORT_DIRECTORY : IMPORT_DIRECTORY + "/nested";
+			CHECK_EQUAL(bfs::path(importFile(directory, i)).string(), object->getFilename());
+			if (i > 0) {
+				CHECK(object->getInherited() == env.model.getObject(objectId(i - 1), "imports"));
+			}
+		}
+		CHECK(!env.model.getObject("broken", "imports"));
+	}
+	removeImportFiles();
+}
+
+TEST(maploader_import_file) {
+	writeImportFiles();
+	{
+		environment env;
+		MapLoader loader(&env.model, env.vfs.get(), &env.imageManager, NULL);
+		loader.loadImportFile(objectId(0) + ".xml", IMPORT_DIRECTORY);
+		loader.loadImportFile(objectId(1) + ".xml", IMPORT_DIRECTORY);
+		loader.loadImportFile("missing.xml", IMPORT_DIRECTORY);
+
+		Object* first = env.model.getObject(objectId(0), "imports");
+		Object* second = env.model.getObject(objectId(1), "imports");
+		CHECK(first);
+		CHECK(second);
+		CHECK(second && second->getInherited() == first);
+		CHECK(second && second->isBlocking());
+		CHECK(!env.model.getObject(objectId(2), "imports"));
+	}
+	removeImportFiles();
+}
+
+int main() {
+	return UnitTest::RunAllTests();
+}
@@ -0,0 +1,462 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+#include <boost/filesystem/convenience.hpp>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "vfs/vfs.h"
+#include "vfs/vfsdirectory.h"
+#include "vfs/zip/zipsource.h"
+#include "vfs/raw/rawdata.h"
+#include "vfs/raw/rawdatafile.h"
+#include "vfs/raw/rawdatamappedfile.h"
+#include "util/base/exception.h"
+
+using namespace FIFE;
+
+// counts the heap allocations, to compare the copying and the view based access.
+// Every replaced form allocates with malloc and releases with free, so any
+// new/delete pairing the library picks stays consistent.
+// GCC 11 and later flag the free calls in the replaced delete forms with
+// -Wmismatched-new-delete, because they don't see that new uses malloc too.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static uint32_t s_allocations = 0;
+
+static void* countedAlloc(std::size_t size) throw() {
+	++s_allocations;
+	return malloc(size ? size : 1);
+}
+
+void* operator new(std::size_t size) {
+	void* p = countedAlloc(size);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](std::size_t size) {
+	void* p = countedAlloc(size);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) throw() {
+	return countedAlloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) throw() {
+	return countedAlloc(size);
+}
+
+void operator delete(void* p) throw() {
+	free(p);
+}
+
+void operator delete[](void* p) throw() {
+	free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) throw() {
+	free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) throw() {
+	free(p);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* p, std::size_t) throw() {
+	free(p);
+}
+
+void operator delete[](void* p, std::size_t) throw() {
+	free(p);
+}
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+static const std::string COMPRESSED_FILE = "tests/data/testmap.zip";
+static const std::string RAW_FILE = "tests/data/test.map";
+static const std::string SMALL_FILES_DIR = "fifemappedtestdir";
+static const uint32_t SMALL_FILES = 2000;
+static const uint32_t SMALL_FILE_SIZE = 1024;
+
+/** Directory source that always uses the stream based RawDataFile,
+ * used as reference for the mapped files.
+ */
+class StreamDirectory : public VFSDirectory {
+public:
+	StreamDirectory(VFS* vfs, const std::string& root = "./") : VFSDirectory(vfs, root) {}
+
+	virtual RawData* open(const std::string& file) const {
+		return new RawData(new RawDataFile(file));
+	}
+};
+
+static std::string smallFileName(uint32_t index) {
+	std::ostringstream name;
+	name << SMALL_FILES_DIR << "/file" << index << ".bin";
+	return name.str();
+}
+
+static void createSmallFiles() {
+	boost::filesystem::create_directory(SMALL_FILES_DIR);
+	std::vector<char> content(SMALL_FILE_SIZE);
+	for (uint32_t i = 0; i < SMALL_FILES; ++i) {
+		for (uint32_t j = 0; j < SMALL_FILE_SIZE; ++j) {
+			content[j] = static_cast<char>(i * 31 + j);
+		}
+		std::ofstream file(smallFileName(i).c_str(), std::ios::binary);
+		file.write(&content[0], content.size());
+	}
+}
+
+static void removeSmallFiles() {
+	boost::filesystem::remove_all(SMALL_FILES_DIR);
+}
+
+/** Parses the data the way the loaders do, a few bytes per read call.
+ */
+static uint32_t parseData(RawData* data) {
+	uint32_t sum = 0;
+	while (data->getCurrentIndex() + 5 <= data->getDataLength()) {
+		sum += data->read32Little();
+		sum += data->read8();
+	}
+	return sum;
+}
+
+TEST(mapped_file_matches_stream) {
+	if (!RawDataMappedFile::isSupported()) {
+		std::cout << "memory mapping is not supported on this platform" << std::endl;
+		return;
+	}
+
+	RawData stream(new RawDataFile(RAW_FILE));
+	RawData mapped(new RawDataMappedFile(RAW_FILE));
+	CHECK(stream.getData() == 0);
+	CHECK(mapped.getData() != 0);
+	CHECK_EQUAL(stream.getDataLength(), mapped.getDataLength());
+
+	std::vector<uint8_t> streamBytes = stream.getDataInBytes();
+	std::vector<uint8_t> mappedBytes = mapped.getDataInBytes();
+	CHECK(streamBytes == mappedBytes);
+	CHECK(memcmp(&streamBytes[0], mapped.getData(), streamBytes.size()) == 0);
+
+	stream.setIndex(100);
+	mapped.setIndex(100);
+	CHECK_EQUAL(stream.read32Little(), mapped.read32Little());
+	CHECK_EQUAL(stream.read16Big(), mapped.read16Big());
+	CHECK_EQUAL(stream.readString(32), mapped.readString(32));
+
+	mapped.setIndex(mapped.getDataLength() - 2);
+	CHECK_THROW(mapped.read32Little(), IndexOverflow);
+
+	CHECK_THROW(RawDataMappedFile("does-not-exist"), CannotOpenFile);
+}
+
+static const std::string LARGE_FILE = "fifelargetestfile.bin";
+// the file is sparse, only the marker at the end is written
+static const uint64_t LARGE_FILE_MARKER = 0x140000000ULL;
+
+static void checkLargeFile(RawData& data) {
+	CHECK(data.getDataLength() == LARGE_FILE_MARKER + 8);
+
+	data.setIndex(LARGE_FILE_MARKER);
+	CHECK_EQUAL(0x12345678u, data.read32Little());
+	CHECK_EQUAL(std::string("fife"), data.readString(4));
+	CHECK(data.getCurrentIndex() == LARGE_FILE_MARKER + 8);
+	CHECK_THROW(data.read8(), IndexOverflow);
+
+	data.moveIndex(-12);
+	CHECK_EQUAL(0u, data.read32Little());
+	CHECK_THROW(data.moveIndex(-static_cast<int64_t>(LARGE_FILE_MARKER) - 8), IndexOverflow);
+
+	uint8_t bytes[4];
+	data.readAt(LARGE_FILE_MARKER + 4, bytes, 4);
+	CHECK(memcmp(bytes, "fife", 4) == 0);
+	CHECK_THROW(data.readAt(LARGE_FILE_MARKER + 6, bytes, 4), IndexOverflow);
+}
+
+TEST(large_file) {
+	{
+		std::ofstream out(LARGE_FILE.c_str(), std::ios::binary);
+		out.seekp(static_cast<std::streamoff>(LARGE_FILE_MARKER));
+		const uint8_t marker[] = { 0x78, 0x56, 0x34, 0x12, 'f', 'i', 'f', 'e' };
+		out.write(reinterpret_cast<const char*>(marker), sizeof(marker));
+	}
+
+	RawData stream(new RawDataFile(LARGE_FILE));
+	checkLargeFile(stream);
+	if (RawDataMappedFile::isSupported() && sizeof(size_t) > 4) {
+		RawData mapped(new RawDataMappedFile(LARGE_FILE));
+		CHECK(mapped.getData() != 0);
+		checkLargeFile(mapped);
+	}
+	std::remove(LARGE_FILE.c_str());
+}
+
+/** Creates a VFS with a directory source, either mapped or stream based, and the zip archive.
+ * Only one VFS can exist at a time.
+ */
+static VFS* createZipVFS(bool mapped, ZipSource** zip) {
+	VFS* vfs = new VFS();
+	if (mapped) {
+		vfs->addSource(new VFSDirectory(vfs));
+	} else {
+		vfs->addSource(new StreamDirectory(vfs));
+	}
+	*zip = new ZipSource(vfs, COMPRESSED_FILE);
+	vfs->addSource(*zip);
+	return vfs;
+}
+
+TEST(mapped_zip_matches_stream) {
+	ZipSource* zip = 0;
+	std::vector<uint8_t> rawBytes;
+	std::vector<uint8_t> mappedBytes;
+	std::vector<uint8_t> streamBytes;
+	{
+		std::unique_ptr<VFS> vfs(createZipVFS(true, &zip));
+		std::unique_ptr<RawData> raw(vfs->open(RAW_FILE));
+		std::unique_ptr<RawData> data(vfs->open("ziptest_content/maps/test.map"));
+		rawBytes = raw->getDataInBytes();
+		mappedBytes = data->getDataInBytes();
+	}
+	{
+		std::unique_ptr<VFS> vfs(createZipVFS(false, &zip));
+		std::unique_ptr<RawData> data(vfs->open("ziptest_content/maps/test.map"));
+		streamBytes = data->getDataInBytes();
+	}
+	CHECK(rawBytes == mappedBytes);
+	CHECK(rawBytes == streamBytes);
+}
+
+/** Opens and parses all entries of the zip archive a few times.
+ * @return The time needed in seconds.
+ */
+static double benchmarkZip(bool mapped, uint32_t rounds, uint32_t& sum, uint32_t& entryCount) {
+	ZipSource* zip = 0;
+	std::unique_ptr<VFS> vfs(createZipVFS(mapped, &zip));
+
+	std::vector<std::string> entries;
+	std::vector<std::string> dirs(1, "ziptest_content");
+	while (!dirs.empty()) {
+		std::string dir = dirs.back();
+		dirs.pop_back();
+		std::set<std::string> files = zip->listFiles(dir);
+		for (std::set<std::string>::iterator it = files.begin(); it != files.end(); ++it) {
+			entries.push_back(dir + "/" + *it);
+		}
+		std::set<std::string> subdirs = zip->listDirectories(dir);
+		for (std::set<std::string>::iterator it = subdirs.begin(); it != subdirs.end(); ++it) {
+			dirs.push_back(dir + "/" + *it);
+		}
+	}
+	entryCount = entries.size();
+
+	clock_t start = clock();
+	for (uint32_t round = 0; round < rounds; ++round) {
+		for (std::vector<std::string>::iterator it = entries.begin(); it != entries.end(); ++it) {
+			std::unique_ptr<RawData> data(zip->open(*it));
+			sum += parseData(data.get());
+		}
+	}
+	return double(clock() - start) / CLOCKS_PER_SEC;
+}
+
+TEST(mapped_file_benchmark) {
+	createSmallFiles();
+
+	const uint32_t rounds = 5;
+	double streamTime = 0.0;
+	double mappedTime = 0.0;
+	uint32_t streamSum = 0;
+	uint32_t mappedSum = 0;
+	for (uint32_t round = 0; round < rounds; ++round) {
+		clock_t start = clock();
+		for (uint32_t i = 0; i < SMALL_FILES; ++i) {
+			RawData data(new RawDataFile(smallFileName(i)));
+			streamSum += parseData(&data);
+		}
+		streamTime += double(clock() - start) / CLOCKS_PER_SEC;
+
+		start = clock();
+		for (uint32_t i = 0; i < SMALL_FILES; ++i) {
+			std::unique_ptr<RawData> data(RawDataMappedFile::isSupported() ?
+				new RawData(new RawDataMappedFile(smallFileName(i))) :
+				new RawData(new RawDataFile(smallFileName(i))));
+			mappedSum += parseData(data.get());
+		}
+		mappedTime += double(clock() - start) / CLOCKS_PER_SEC;
+	}
+	removeSmallFiles();
+	CHECK_EQUAL(streamSum, mappedSum);
+
+	std::cout << SMALL_FILES << " files of " << SMALL_FILE_SIZE << " bytes, " << rounds << " rounds" << std::endl;
+	std::cout << "  stream: " << streamTime << "s" << std::endl;
+	std::cout << "  mapped: " << mappedTime << "s" << std::endl;
+
+	// all entries of the zip archive, the archive itself is read through
+	// the stream source or mapped
+	const uint32_t zipRounds = 200;
+	uint32_t entries = 0;
+	streamSum = 0;
+	mappedSum = 0;
+	streamTime = benchmarkZip(false, zipRounds, streamSum, entries);
+	mappedTime = benchmarkZip(true, zipRounds, mappedSum, entries);
+	CHECK(entries > 0);
+	CHECK_EQUAL(streamSum, mappedSum);
+
+	std::cout << entries << " zip entries, " << zipRounds << " rounds" << std::endl;
+	std::cout << "  stream: " << streamTime << "s" << std::endl;
+	std::cout << "  mapped: " << mappedTime << "s" << std::endl;
+}
+
+TEST(data_view) {
+	// stream based source, the view is an owned copy
+	RawData stream(new RawDataFile(RAW_FILE));
+	std::vector<uint8_t> bytes = stream.getDataInBytes();
+	stream.setIndex(10);
+	const uint8_t* view = stream.getDataView();
+	CHECK(view != 0);
+	CHECK(stream.getCurrentIndex() == 10);
+	CHECK(memcmp(view, &bytes[0], bytes.size()) == 0);
+	const char* text = stream.getDataAsText();
+	CHECK(text[bytes.size()] == 0);
+	CHECK(memcmp(text, &bytes[0], bytes.size()) == 0);
+
+	// mapped source, the view points into the mapping
+	if (RawDataMappedFile::isSupported()) {
+		RawData mapped(new RawDataMappedFile(RAW_FILE));
+		CHECK(mapped.getDataView() == mapped.getData());
+		CHECK(memcmp(mapped.getDataView(), &bytes[0], bytes.size()) == 0);
+		text = mapped.getDataAsText();
+		CHECK(text[bytes.size()] == 0);
+		CHECK(memcmp(text, &bytes[0], bytes.size()) == 0);
+	}
+
+	// lines
+	RawData streamLines(new RawDataFile(RAW_FILE));
+	std::vector<std::string> lines;
+	std::string line;
+	while (streamLines.getLine(line)) {
+		lines.push_back(line);
+	}
+	RawData viewLines(new RawDataFile(RAW_FILE));
+	CHECK(viewLines.getDataInLines() == lines);
+}
+
+TEST(data_view_benchmark) {
+	const uint32_t rounds = 200;
+	uint32_t copyAllocations = 0;
+	uint32_t viewAllocations = 0;
+	double copyTime = 0.0;
+	double viewTime = 0.0;
+	size_t copySum = 0;
+	size_t viewSum = 0;
+
+	for (uint32_t round = 0; round < rounds; ++round) {
+		RawData* data = RawDataMappedFile::isSupported() ?
+			new RawData(new RawDataMappedFile(RAW_FILE)) : new RawData(new RawDataFile(RAW_FILE));
+
+		// the way the loaders accessed the data before
+		uint32_t allocations = s_allocations;
+		clock_t start = clock();
+		{
+			std::unique_ptr<uint8_t[]> darray(new uint8_t[data->getDataLength()]);
+			data->readInto(darray.get(), data->getDataLength());
+			copySum += darray[data->getDataLength() / 2];
+			data->setIndex(0);
+			std::string text = data->readString(data->getDataLength());
+			copySum += strlen(text.c_str());
+			data->setIndex(0);
+			std::string line;
+			char c;
+			while (data->getCurrentIndex() < data->getDataLength()) {
+				line = "";
+				while (data->getCurrentIndex() < data->getDataLength() && (c = data->read8()) != '\n') {
+					line += c;
+				}
+				copySum += line.size();
+			}
+		}
+		copyTime += double(clock() - start) / CLOCKS_PER_SEC;
+		copyAllocations += s_allocations - allocations;
+
+		data->setIndex(0);
+		allocations = s_allocations;
+		start = clock();
+		{
+			const uint8_t* view = data->getDataView();
+			viewSum += view[data->getDataLength() / 2];
+			viewSum += strlen(data->getDataAsText());
+			std::string line;
+			while (data->getLine(line)) {
+				viewSum += line.size();
+			}
+		}
+		viewTime += double(clock() - start) / CLOCKS_PER_SEC;
+		viewAllocations += s_allocations - allocations;
+
+		delete data;
+	}
+	CHECK_EQUAL(copySum, viewSum);
+
+	std::cout << RAW_FILE << ", " << rounds << " rounds" << std::endl;
+	std::cout << "  copies: " << copyTime << "s, " << copyAllocations << " allocations" << std::endl;
+	std::cout << "  views:  " << viewTime << "s, " << viewAllocations << " allocations" << std::endl;
+}
+
+int main() {
+	return UnitTest::RunAllTests();
+}
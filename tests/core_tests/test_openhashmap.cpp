@@ -0,0 +1,228 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/structures/openhashmap.h"
+
+using namespace FIFE;
+
+typedef OpenHashMap<std::string, int, StringHash> NameMap;
+typedef OpenHashMap<uint64_t, int, IntegerHash> HandleMap;
+
+static const int BENCH_ENTRIES = 100000;
+static const int BENCH_ROUNDS = 10;
+
+static std::string makeName(int i) {
+	std::ostringstream name;
+	name << "objects/buildings/house_" << (i % 97) << "/frame_" << i << ".png";
+	return name.str();
+}
+
+TEST(openhashmap_insert_find) {
+	NameMap map;
+	CHECK(map.empty());
+	CHECK(map.find("missing") == map.end());
+
+	for (int i = 0; i < 1000; ++i) {
+		std::pair<NameMap::iterator, bool> res = map.insert(NameMap::value_type(makeName(i), i));
+		CHECK(res.second);
+	}
+	CHECK_EQUAL(1000u, map.size());
+
+	// duplicate insert keeps the old value
+	std::pair<NameMap::iterator, bool> dup = map.insert(NameMap::value_type(makeName(5), 42));
+	CHECK(!dup.second);
+	CHECK_EQUAL(5, dup.first->second);
+
+	for (int i = 0; i < 1000; ++i) {
+		NameMap::iterator it = map.find(makeName(i));
+		CHECK(it != map.end());
+		CHECK_EQUAL(i, it->second);
+	}
+	CHECK(map.find("objects/missing.png") == map.end());
+	CHECK_EQUAL(0u, map.count("objects/missing.png"));
+
+	// lookup with a precomputed hash
+	std::string name = makeName(17);
+	CHECK_EQUAL(17, map.find(name, StringHash()(name))->second);
+
+	map["extra"] = 7;
+	CHECK_EQUAL(7, map["extra"]);
+	CHECK_EQUAL(1001u, map.size());
+}
+
+TEST(openhashmap_erase_reinsert) {
+	HandleMap map;
+	for (uint64_t i = 0; i < 5000; ++i) {
+		map.insert(HandleMap::value_type(i, static_cast<int>(i)));
+	}
+	for (uint64_t i = 0; i < 5000; i += 2) {
+		CHECK_EQUAL(1u, map.erase(i));
+	}
+	CHECK_EQUAL(2500u, map.size());
+	CHECK_EQUAL(0u, map.erase(0));
+
+	for (uint64_t i = 0; i < 5000; ++i) {
+		CHECK_EQUAL((i % 2) ? 1u : 0u, map.count(i));
+	}
+
+	// reinserting reuses deleted slots and triggers rehashes
+	for (uint64_t i = 0; i < 20000; i += 2) {
+		map.insert(HandleMap::value_type(i, static_cast<int>(i)));
+	}
+	for (uint64_t i = 0; i < 5000; ++i) {
+		HandleMap::iterator it = map.find(i);
+		CHECK(it != map.end());
+		CHECK_EQUAL(static_cast<int>(i), it->second);
+	}
+
+	// erase while iterating
+	HandleMap::iterator it = map.begin();
+	while (it != map.end()) {
+		if (it->first >= 5000) {
+			map.erase(it++);
+		} else {
+			++it;
+		}
+	}
+	CHECK_EQUAL(5000u, map.size());
+
+	map.clear();
+	CHECK(map.empty());
+	CHECK(map.begin() == map.end());
+}
+
+TEST(openhashmap_iteration) {
+	HandleMap map;
+	uint64_t sum = 0;
+	for (uint64_t i = 1; i <= 1000; ++i) {
+		map.insert(HandleMap::value_type(i, 1));
+		sum += i;
+	}
+	uint64_t visited = 0;
+	size_t count = 0;
+	const HandleMap& cmap = map;
+	for (HandleMap::const_iterator it = cmap.begin(); it != cmap.end(); ++it) {
+		visited += it->first;
+		++count;
+	}
+	CHECK_EQUAL(sum, visited);
+	CHECK_EQUAL(map.size(), count);
+}
+
+// Compares the lookups the resource managers do per frame, with the number
+// of images a large map loads. Not a correctness test, the timings are printed.
+TEST(openhashmap_benchmark) {
+	std::vector<std::string> names;
+	names.reserve(BENCH_ENTRIES);
+	for (int i = 0; i < BENCH_ENTRIES; ++i) {
+		names.push_back(makeName(i));
+	}
+
+	std::map<std::string, int> stdNames;
+	std::map<uint64_t, int> stdHandles;
+	NameMap hashNames;
+	HandleMap hashHandles;
+	std::vector<size_t> hashes;
+	hashes.reserve(BENCH_ENTRIES);
+	for (int i = 0; i < BENCH_ENTRIES; ++i) {
+		stdNames.insert(std::make_pair(names[i], i));
+		stdHandles.insert(std::make_pair(static_cast<uint64_t>(i), i));
+		hashes.push_back(StringHash()(names[i]));
+		hashNames.insert(NameMap::value_type(names[i], i), hashes[i]);
+		hashHandles.insert(HandleMap::value_type(static_cast<uint64_t>(i), i));
+	}
+
+	long check = 0;
+	clock_t start = clock();
+	for (int r = 0; r < BENCH_ROUNDS; ++r) {
+		for (int i = 0; i < BENCH_ENTRIES; ++i) {
+			check += stdNames.find(names[i])->second;
+		}
+	}
+	double stdNameTime = double(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (int r = 0; r < BENCH_ROUNDS; ++r) {
+		for (int i = 0; i < BENCH_ENTRIES; ++i) {
+			check -= hashNames.find(names[i])->second;
+		}
+	}
+	double hashNameTime = double(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (int r = 0; r < BENCH_ROUNDS; ++r) {
+		for (int i = 0; i < BENCH_ENTRIES; ++i) {
+			check += hashNames.find(names[i], hashes[i])->second;
+		}
+	}
+	double cachedNameTime = double(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (int r = 0; r < BENCH_ROUNDS; ++r) {
+		for (int i = 0; i < BENCH_ENTRIES; ++i) {
+			check -= stdHandles.find(static_cast<uint64_t>(i))->second;
+		}
+	}
+	double stdHandleTime = double(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (int r = 0; r < BENCH_ROUNDS; ++r) {
+		for (int i = 0; i < BENCH_ENTRIES; ++i) {
+			check += hashHandles.find(static_cast<uint64_t>(i))->second;
+		}
+	}
+	double hashHandleTime = double(clock() - start) / CLOCKS_PER_SEC;
+
+	// every lookup found the right value
+	long expected = 0;
+	for (int i = 0; i < BENCH_ENTRIES; ++i) {
+		expected += i;
+	}
+	CHECK_EQUAL(expected * BENCH_ROUNDS, check);
+
+	std::cout << BENCH_ENTRIES << " entries, " << BENCH_ROUNDS << " lookup rounds" << std::endl;
+	std::cout << "  name   std::map:             " << stdNameTime << "s" << std::endl;
+	std::cout << "  name   OpenHashMap:          " << hashNameTime << "s" << std::endl;
+	std::cout << "  name   OpenHashMap (hashed): " << cachedNameTime << "s" << std::endl;
+	std::cout << "  handle std::map:             " << stdHandleTime << "s" << std::endl;
+	std::cout << "  handle OpenHashMap:          " << hashHandleTime << "s" << std::endl;
+}
+
+int main() {
+	return UnitTest::RunAllTests();
+}
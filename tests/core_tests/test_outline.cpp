@@ -0,0 +1,309 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+#include <SDL.h>
+#include <SDL_image.h>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "video/outlinekernel.h"
+#include "vfs/fife_boost_filesystem.h"
+
+using namespace FIFE;
+
+static const std::string SPRITE_DIR = "tests/data";
+
+// The per pixel outline of InstanceRenderer before the outline kernel,
+// kept as reference for the results.
+static uint8_t refAlpha(SDL_Surface* s, int32_t x, int32_t y) {
+	uint32_t pixel = *reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(s->pixels) + y * s->pitch + x * 4);
+	uint8_t r, g, b, a;
+	SDL_GetRGBA(pixel, s->format, &r, &g, &b, &a);
+	return a;
+}
+
+static void refPut(SDL_Surface* s, int32_t x, int32_t y, uint32_t color) {
+	if (x < 0 || x >= s->w || y < 0 || y >= s->h) {
+		return;
+	}
+	*reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(s->pixels) + y * s->pitch + x * 4) = color;
+}
+
+static bool refAboveThreshold(int32_t threshold, int32_t alpha, int32_t prev_alpha) {
+	if (threshold > 1) {
+		return ((alpha - threshold) >= 0 || (prev_alpha - threshold) >= 0) && (alpha != prev_alpha);
+	}
+	return (alpha == 0 || prev_alpha == 0) && (alpha != prev_alpha);
+}
+
+static void refOutline(SDL_Surface* src, SDL_Surface* out, int32_t threshold, int32_t width, uint32_t color) {
+	for (int32_t x = 0; x < out->w; x++) {
+		int32_t prev_a = 0;
+		for (int32_t y = 0; y < out->h; y++) {
+			int32_t a = refAlpha(src, x, y);
+			if (refAboveThreshold(threshold, a, prev_a)) {
+				if (a < prev_a) {
+					for (int32_t yy = y; yy < y + width; yy++) refPut(out, x, yy, color);
+				} else {
+					for (int32_t yy = y - width; yy < y; yy++) refPut(out, x, yy, color);
+				}
+			}
+			prev_a = a;
+		}
+	}
+	for (int32_t y = 0; y < out->h; y++) {
+		int32_t prev_a = 0;
+		for (int32_t x = 0; x < out->w; x++) {
+			int32_t a = refAlpha(src, x, y);
+			if (refAboveThreshold(threshold, a, prev_a)) {
+				if (a < prev_a) {
+					for (int32_t xx = x; xx < x + width; xx++) refPut(out, xx, y, color);
+				} else {
+					for (int32_t xx = x - width; xx < x; xx++) refPut(out, xx, y, color);
+				}
+			}
+			prev_a = a;
+		}
+	}
+}
+
+// multi outline with the unsigned loops of the old bindMultiOutline
+static void refMultiOutline(SDL_Surface* src, SDL_Surface* out, int32_t threshold, int32_t width, uint32_t color) {
+	const uint32_t w = src->w;
+	const uint32_t h = src->h;
+	const uint32_t mw = out->w;
+	const uint32_t mh = out->h;
+	for (uint32_t x = 0; x < w; x++) {
+		int32_t prev_a = 0;
+		for (uint32_t y = 0; y < h; y++) {
+			int32_t a = refAlpha(src, x, y);
+			if (refAboveThreshold(threshold, a, prev_a)) {
+				if (a < prev_a) {
+					for (uint32_t yy = y; yy < y + width; yy++) refPut(out, x + (mw/2 - w/2), yy + (mh/2 - h/2), color);
+				} else {
+					for (uint32_t yy = y - width; yy < y; yy++) refPut(out, x + (mw/2 - w/2), yy + (mh/2 - h/2), color);
+				}
+			}
+			prev_a = a;
+		}
+	}
+	for (uint32_t y = 0; y < h; y++) {
+		int32_t prev_a = 0;
+		for (uint32_t x = 0; x < w; x++) {
+			int32_t a = refAlpha(src, x, y);
+			if (refAboveThreshold(threshold, a, prev_a)) {
+				if (a < prev_a) {
+					for (uint32_t xx = x; xx < x + width; xx++) refPut(out, xx + (mw/2 - w/2), y + (mh/2 - h/2), color);
+				} else {
+					for (uint32_t xx = x - width; xx < x; xx++) refPut(out, xx + (mw/2 - w/2), y + (mh/2 - h/2), color);
+				}
+			}
+			prev_a = a;
+		}
+	}
+}
+
+static SDL_Surface* createSurface(int32_t w, int32_t h) {
+	return SDL_CreateRGBSurface(0, w, h, 32, RMASK, GMASK, BMASK, AMASK);
+}
+
+// random sprite with soft edges, some fully transparent and some opaque areas
+static SDL_Surface* createRandomSprite(int32_t w, int32_t h) {
+	SDL_Surface* s = createSurface(w, h);
+	for (int32_t y = 0; y < h; ++y) {
+		for (int32_t x = 0; x < w; ++x) {
+			int32_t dx = x - w / 2;
+			int32_t dy = y - h / 2;
+			uint8_t a = 0;
+			if (dx * dx + dy * dy < (w * h) / 6) {
+				a = (rand() % 4 == 0) ? static_cast<uint8_t>(rand() % 256) : 255;
+			} else if (rand() % 16 == 0) {
+				a = static_cast<uint8_t>(rand() % 256);
+			}
+			refPut(s, x, y, SDL_MapRGBA(s->format, 10, 20, 30, a));
+		}
+	}
+	return s;
+}
+
+static SDL_Surface* kernelOutline(SDL_Surface* src, int32_t threshold, int32_t width, uint32_t color) {
+	SDL_Surface* out = createSurface(src->w, src->h);
+	AlphaPlane alpha;
+	alpha.extract(src, Rect(0, 0, src->w, src->h));
+	std::vector<uint8_t> mask(src->w * src->h, 0);
+	markOutline(alpha, threshold, width, false, &mask[0], out->w, out->h, 0, 0);
+	fillOutline(&mask[0], out, color);
+	return out;
+}
+
+static bool samePixels(SDL_Surface* a, SDL_Surface* b) {
+	for (int32_t y = 0; y < a->h; ++y) {
+		if (memcmp(static_cast<uint8_t*>(a->pixels) + y * a->pitch,
+			static_cast<uint8_t*>(b->pixels) + y * b->pitch, a->w * 4) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static std::vector<SDL_Surface*> loadSprites() {
+	std::vector<SDL_Surface*> sprites;
+	SDL_Surface* format = createSurface(1, 1);
+	boost::system::error_code error;
+	bfs::recursive_directory_iterator it(bfs::path(SPRITE_DIR), error), end;
+	for (; !error && it != end; it.increment(error)) {
+		if (!bfs::is_regular_file(it->path()) || GetExtension(it->path()) != ".png") {
+			continue;
+		}
+		SDL_Surface* img = IMG_Load(it->path().string().c_str());
+		if (img) {
+			sprites.push_back(SDL_ConvertSurface(img, format->format, 0));
+			SDL_FreeSurface(img);
+		}
+	}
+	SDL_FreeSurface(format);
+	return sprites;
+}
+
+TEST(outline_matches_reference) {
+	srand(42);
+	const int32_t sizes[][2] = { {1, 1}, {3, 7}, {17, 33}, {64, 64}, {100, 37}, {129, 250} };
+	const int32_t thresholds[] = { -1, 0, 1, 2, 128, 255, 256 };
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+		SDL_Surface* src = createRandomSprite(sizes[s][0], sizes[s][1]);
+		uint32_t color = SDL_MapRGBA(src->format, 255, 128, 0, 255);
+		for (size_t t = 0; t < sizeof(thresholds) / sizeof(thresholds[0]); ++t) {
+			for (int32_t width = 0; width <= 4; ++width) {
+				SDL_Surface* expected = createSurface(src->w, src->h);
+				refOutline(src, expected, thresholds[t], width, color);
+				SDL_Surface* result = kernelOutline(src, thresholds[t], width, color);
+				CHECK(samePixels(expected, result));
+				SDL_FreeSurface(expected);
+				SDL_FreeSurface(result);
+			}
+		}
+		SDL_FreeSurface(src);
+	}
+}
+
+TEST(multi_outline_matches_reference) {
+	srand(7);
+	SDL_Surface* src = createRandomSprite(45, 31);
+	uint32_t color = SDL_MapRGBA(src->format, 0, 255, 0, 255);
+	for (int32_t width = 1; width <= 5; ++width) {
+		SDL_Surface* expected = createSurface(64, 50);
+		refMultiOutline(src, expected, 1, width, color);
+
+		SDL_Surface* result = createSurface(64, 50);
+		AlphaPlane alpha;
+		alpha.extract(src, Rect(0, 0, src->w, src->h));
+		std::vector<uint8_t> mask(64 * 50, 0);
+		markOutline(alpha, 1, width, true, &mask[0], 64, 50, 64/2 - src->w/2, 50/2 - src->h/2);
+		fillOutline(&mask[0], result, color);
+
+		CHECK(samePixels(expected, result));
+		SDL_FreeSurface(expected);
+		SDL_FreeSurface(result);
+	}
+	SDL_FreeSurface(src);
+}
+
+TEST(outline_subimage) {
+	srand(3);
+	SDL_Surface* atlas = createRandomSprite(80, 60);
+	SDL_Surface* sub = createSurface(30, 20);
+	SDL_Rect rect = { 25, 15, 30, 20 };
+	SDL_SetSurfaceBlendMode(atlas, SDL_BLENDMODE_NONE);
+	SDL_BlitSurface(atlas, &rect, sub, NULL);
+	uint32_t color = SDL_MapRGBA(atlas->format, 1, 2, 3, 255);
+
+	SDL_Surface* expected = createSurface(30, 20);
+	refOutline(sub, expected, 1, 2, color);
+
+	SDL_Surface* result = createSurface(30, 20);
+	AlphaPlane alpha;
+	alpha.extract(atlas, Rect(25, 15, 30, 20));
+	std::vector<uint8_t> mask(30 * 20, 0);
+	markOutline(alpha, 1, 2, false, &mask[0], 30, 20, 0, 0);
+	fillOutline(&mask[0], result, color);
+	CHECK(samePixels(expected, result));
+
+	SDL_FreeSurface(atlas);
+	SDL_FreeSurface(sub);
+	SDL_FreeSurface(expected);
+	SDL_FreeSurface(result);
+}
+
+TEST(outline_sprites) {
+	std::vector<SDL_Surface*> sprites = loadSprites();
+	if (sprites.empty()) {
+		std::cout << "outline_sprites: no sprites found, run from the repository root" << std::endl;
+		return;
+	}
+	const int32_t rounds = 20;
+	double refTime = 0;
+	double kernelTime = 0;
+	for (size_t i = 0; i < sprites.size(); ++i) {
+		SDL_Surface* src = sprites[i];
+		uint32_t color = SDL_MapRGBA(src->format, 255, 0, 0, 255);
+		SDL_Surface* expected = createSurface(src->w, src->h);
+
+		clock_t start = clock();
+		for (int32_t r = 0; r < rounds; ++r) {
+			refOutline(src, expected, 1, 2, color);
+		}
+		refTime += double(clock() - start) / CLOCKS_PER_SEC;
+
+		SDL_Surface* result = NULL;
+		start = clock();
+		for (int32_t r = 0; r < rounds; ++r) {
+			SDL_FreeSurface(result);
+			result = kernelOutline(src, 1, 2, color);
+		}
+		kernelTime += double(clock() - start) / CLOCKS_PER_SEC;
+
+		CHECK(samePixels(expected, result));
+		SDL_FreeSurface(expected);
+		SDL_FreeSurface(result);
+		SDL_FreeSurface(src);
+	}
+	std::cout << sprites.size() << " sprites, " << rounds << " rounds" << std::endl;
+	std::cout << "  per pixel outline: " << refTime << "s" << std::endl;
+	std::cout << "  outline kernel:    " << kernelTime << "s" << std::endl;
+}
+
+int main() {
+	return UnitTest::RunAllTests();
+}
@@ -0,0 +1,361 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <iostream>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <SDL.h>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "model/model.h"
+#include "model/metamodel/object.h"
+#include "model/metamodel/grids/squaregrid.h"
+#include "model/structures/instance.h"
+#include "model/structures/layer.h"
+#include "model/structures/map.h"
+#include "util/base/exception.h"
+#include "util/time/timemanager.h"
+#include "video/color.h"
+#include "vfs/vfs.h"
+#include "vfs/vfsdirectory.h"
+#include "video/animationmanager.h"
+#include "video/devicecaps.h"
+#include "video/imagemanager.h"
+#include "video/opengl/fife_opengl.h"
+#include "video/opengl/renderbackendopengl.h"
+#include "view/camera.h"
+#include "view/renderers/instancerenderer.h"
+#include "view/visual.h"
+
+using namespace FIFE;
+
+// Renders outlined and recolored instances with the outline and color table
+// shaders and with generated images and compares the results. Needs an OpenGL 2.0 capable driver without a display,
+// e.g. Mesa llvmpipe through the SDL offscreen video driver (SDL 2.0.12 or later).
+
+static const std::string SPRITE_FILE = "tests/data/mushroom_007.png";
+static const int32_t SCREEN_SIZE = 128;
+
+enum Lighting {
+	LIGHTING_NONE,
+	LIGHTING_ON,
+	// the instances belong to an ignored light group
+	LIGHTING_IGNORED
+};
+
+struct RenderResult {
+	RenderResult() : rendered(false), shaded(false), imagesBefore(0), imagesAfter(0) {}
+	bool rendered;
+	bool shaded;
+	size_t imagesBefore;
+	size_t imagesAfter;
+	std::vector<uint8_t> pixels;
+};
+
+// Environment
+struct environment {
+	boost::shared_ptr<TimeManager> timemanager;
+	boost::shared_ptr<VFS> vfs;
+
+	environment()
+		: timemanager(new TimeManager()),
+		  vfs(new VFS()) {
+		vfs->addSource(new VFSDirectory(vfs.get()));
+	}
+};
+
+static RenderResult renderOutlines(bool shaders, Lighting lighting, bool mipmapping) {
+	RenderResult result;
+	environment env;
+	SDL_Color colorkey = { 255, 0, 255, 0 };
+	RenderBackendOpenGL renderbackend(colorkey);
+	renderbackend.setShadersEnabled(shaders);
+	renderbackend.setMipmappingEnabled(mipmapping);
+	// keeps a driver that was selected by the user
+	SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+	try {
+		renderbackend.init("");
+		renderbackend.createMainScreen(ScreenMode(SCREEN_SIZE, SCREEN_SIZE, 32, SDL_WINDOW_OPENGL), "FIFE", "");
+	} catch (Exception& e) {
+		std::cout << "test_outline_gl: no OpenGL context, " << e.what() << std::endl;
+		return result;
+	}
+	if (lighting != LIGHTING_NONE) {
+		renderbackend.setLightingModel(1);
+	}
+
+	ImageManager imagemanager;
+	AnimationManager animationmanager;
+	// the cameras use copies, so it is created after the shaders are known
+	boost::scoped_ptr<InstanceRenderer> prototype(new InstanceRenderer(&renderbackend, 10));
+	std::vector<RendererBase*> renderers;
+	renderers.push_back(prototype.get());
+	Model model(&renderbackend, renderers);
+	model.adoptCellGrid(new SquareGrid());
+
+	ImagePtr image = imagemanager.load(SPRITE_FILE);
+	Object* object = model.createObject("mushroom", "outline_test");
+	ObjectVisual* objectVisual = ObjectVisual::create(object);
+	objectVisual->addStaticImage(0, image->getHandle());
+
+	Map* map = model.createMap("map");
+	Layer* layer = map->createLayer("layer", model.getCellGrid("square"));
+	std::vector<Instance*> instances;
+	for (int32_t y = -1; y <= 1; ++y) {
+		for (int32_t x = -1; x <= 1; ++x) {
+			Instance* instance = layer->createInstance(object, ExactModelCoordinate(x, y));
+			InstanceVisual::create(instance);
+			instances.push_back(instance);
+		}
+	}
+
+	Camera* camera = map->addCamera("camera", Rect(0, 0, SCREEN_SIZE, SCREEN_SIZE));
+	camera->setCellImageDimensions(32, 32);
+	camera->setLocation(Location(layer));
+	if (mipmapping) {
+		// the images are minified, so the smaller mipmap levels are used
+		camera->setZoom(0.5);
+	}
+	InstanceRenderer* renderer = InstanceRenderer::getInstance(camera);
+	renderer->activateAllLayers(map);
+	if (lighting == LIGHTING_IGNORED) {
+		std::list<std::string> groups;
+		groups.push_back("outline_test");
+		renderer->addIgnoreLight(groups);
+	}
+	for (size_t i = 0; i < instances.size(); ++i) {
+		renderer->addOutlined(instances[i], 255, 64, 0, 1 + static_cast<int32_t>(i % 3));
+	}
+	result.shaded = renderer->hasEffectShaders();
+	result.imagesBefore = imagemanager.getTotalResources();
+
+	// the first frame loads the images
+	result.pixels.resize(SCREEN_SIZE * SCREEN_SIZE * 4);
+	for (int32_t frame = 0; frame < 2; ++frame) {
+		renderbackend.startFrame();
+		camera->update();
+		camera->render();
+		renderbackend.renderVertexArrays();
+		if (frame == 1) {
+			glReadPixels(0, 0, SCREEN_SIZE, SCREEN_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, &result.pixels[0]);
+		}
+		renderbackend.endFrame();
+	}
+	result.imagesAfter = imagemanager.getTotalResources();
+	result.rendered = true;
+	return result;
+}
+
+static void compareOutlines(Lighting lighting) {
+	RenderResult images = renderOutlines(false, lighting, false);
+	RenderResult shaded = renderOutlines(true, lighting, false);
+	if (!images.rendered || !shaded.rendered) {
+		return;
+	}
+	if (!shaded.shaded) {
+		std::cout << "test_outline_gl: the driver has no outline shader support" << std::endl;
+		return;
+	}
+	CHECK(!images.shaded);
+	CHECK(images.pixels == shaded.pixels);
+	// the images path creates one outline image per outline width
+	CHECK_EQUAL(images.imagesBefore + 3, images.imagesAfter);
+	CHECK_EQUAL(shaded.imagesBefore, shaded.imagesAfter);
+
+	size_t outlinePixels = 0;
+	for (size_t i = 0; i < shaded.pixels.size(); i += 4) {
+		if (shaded.pixels[i] == 255 && shaded.pixels[i + 1] == 64 && shaded.pixels[i + 2] == 0) {
+			++outlinePixels;
+		}
+	}
+	CHECK(outlinePixels > 0);
+}
+
+TEST(outline_gl_unlit) {
+	compareOutlines(LIGHTING_NONE);
+}
+
+TEST(outline_gl_lit) {
+	compareOutlines(LIGHTING_ON);
+}
+
+TEST(outline_gl_ignored_light) {
+	compareOutlines(LIGHTING_IGNORED);
+}
+
+TEST(outline_gl_mipmapped) {
+	RenderResult images = renderOutlines(false, LIGHTING_NONE, true);
+	RenderResult shaded = renderOutlines(true, LIGHTING_NONE, true);
+	if (!images.rendered || !shaded.rendered) {
+		return;
+	}
+	// the shaders read single texels, with mipmaps the outline images are used
+	CHECK(!shaded.shaded);
+	CHECK(images.pixels == shaded.pixels);
+	CHECK_EQUAL(images.imagesBefore + 3, images.imagesAfter);
+	CHECK_EQUAL(shaded.imagesBefore + 3, shaded.imagesAfter);
+}
+
+// The most frequent opaque colors of the image, used as overlay colors.
+static std::vector<Color> overlayColors(const ImagePtr& image, size_t count) {
+	std::map<Color, uint32_t> frequency;
+	for (uint32_t y = 0; y < image->getHeight(); ++y) {
+		for (uint32_t x = 0; x < image->getWidth(); ++x) {
+			uint8_t r, g, b, a;
+			image->getPixelRGBA(x, y, &r, &g, &b, &a);
+			if (a == 255) {
+				++frequency[Color(r, g, b, a)];
+			}
+		}
+	}
+	std::vector<Color> colors;
+	while (colors.size() < count && !frequency.empty()) {
+		std::map<Color, uint32_t>::iterator best = frequency.begin();
+		for (std::map<Color, uint32_t>::iterator it = frequency.begin(); it != frequency.end(); ++it) {
+			if (it->second > best->second) {
+				best = it;
+			}
+		}
+		colors.push_back(best->first);
+		frequency.erase(best);
+	}
+	return colors;
+}
+
+static RenderResult renderColorTable(bool shaders, bool recolor) {
+	RenderResult result;
+	environment env;
+	SDL_Color colorkey = { 255, 0, 255, 0 };
+	RenderBackendOpenGL renderbackend(colorkey);
+	renderbackend.setShadersEnabled(shaders);
+	// keeps a driver that was selected by the user
+	SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+	try {
+		renderbackend.init("");
+		renderbackend.createMainScreen(ScreenMode(SCREEN_SIZE, SCREEN_SIZE, 32, SDL_WINDOW_OPENGL), "FIFE", "");
+	} catch (Exception& e) {
+		std::cout << "test_outline_gl: no OpenGL context, " << e.what() << std::endl;
+		return result;
+	}
+
+	ImageManager imagemanager;
+	AnimationManager animationmanager;
+	boost::scoped_ptr<InstanceRenderer> prototype(new InstanceRenderer(&renderbackend, 10));
+	std::vector<RendererBase*> renderers;
+	renderers.push_back(prototype.get());
+	Model model(&renderbackend, renderers);
+	model.adoptCellGrid(new SquareGrid());
+
+	ImagePtr image = imagemanager.load(SPRITE_FILE);
+	Object* object = model.createObject("mushroom", "outline_test");
+	ObjectVisual::create(object)->addStaticImage(0, image->getHandle());
+
+	Map* map = model.createMap("map");
+	Layer* layer = map->createLayer("layer", model.getCellGrid("square"));
+	std::vector<Instance*> instances;
+	for (int32_t y = -1; y <= 1; ++y) {
+		for (int32_t x = -1; x <= 1; ++x) {
+			Instance* instance = layer->createInstance(object, ExactModelCoordinate(x, y));
+			InstanceVisual::create(instance);
+			instances.push_back(instance);
+		}
+	}
+	// the image is its own overlay, its most frequent colors are replaced
+	const std::vector<Color> colors = overlayColors(image, 3);
+	CHECK_EQUAL(3u, colors.size());
+	OverlayColors overlay(image);
+	const uint8_t replacements[3][4] = { { 255, 0, 0, 96 }, { 0, 255, 0, 96 }, { 0, 0, 255, 96 } };
+	for (size_t i = 0; i < colors.size(); ++i) {
+		const uint8_t* rgba = replacements[i];
+		overlay.changeColor(colors[i], Color(rgba[0], rgba[1], rgba[2], rgba[3]));
+	}
+	if (recolor) {
+		instances[0]->addStaticColorOverlay(0, overlay);
+	}
+
+	Camera* camera = map->addCamera("camera", Rect(0, 0, SCREEN_SIZE, SCREEN_SIZE));
+	camera->setCellImageDimensions(32, 32);
+	camera->setLocation(Location(layer));
+	InstanceRenderer* renderer = InstanceRenderer::getInstance(camera);
+	renderer->activateAllLayers(map);
+	result.shaded = renderer->hasEffectShaders();
+	result.imagesBefore = imagemanager.getTotalResources();
+
+	// the first frame loads the images
+	result.pixels.resize(SCREEN_SIZE * SCREEN_SIZE * 4);
+	for (int32_t frame = 0; frame < 2; ++frame) {
+		renderbackend.startFrame();
+		camera->update();
+		camera->render();
+		renderbackend.renderVertexArrays();
+		if (frame == 1) {
+			glReadPixels(0, 0, SCREEN_SIZE, SCREEN_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, &result.pixels[0]);
+		}
+		renderbackend.endFrame();
+	}
+	result.imagesAfter = imagemanager.getTotalResources();
+	result.rendered = true;
+	return result;
+}
+
+TEST(color_table_gl) {
+	RenderResult plain = renderColorTable(true, false);
+	RenderResult images = renderColorTable(false, true);
+	RenderResult shaded = renderColorTable(true, true);
+	if (!plain.rendered || !images.rendered || !shaded.rendered) {
+		return;
+	}
+	if (!shaded.shaded) {
+		std::cout << "test_outline_gl: the driver has no color table shader support" << std::endl;
+		return;
+	}
+	CHECK(!images.shaded);
+	CHECK(images.pixels == shaded.pixels);
+	// the images path creates the recolored overlay image, the shader none
+	CHECK_EQUAL(images.imagesBefore + 1, images.imagesAfter);
+	CHECK_EQUAL(shaded.imagesBefore, shaded.imagesAfter);
+
+	// the overlay was drawn
+	CHECK(plain.pixels != shaded.pixels);
+}
+
+// need this here because SDL redefines
+// main to SDL_main in SDL_main.h
+#ifdef main
+#undef main
+#endif
+
+int main() {
+	return UnitTest::RunAllTests();
+}
@@ -0,0 +1,244 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <list>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/structures/rect.h"
+#include "util/structures/quadtree.h"
+#include "util/structures/loosequadtree.h"
+
+using namespace FIFE;
+
+typedef QuadTree<std::list<int32_t>, 2> LinkedTree;
+typedef LooseQuadTree<std::vector<int32_t>, 2> FlatTree;
+
+static std::vector<Point> points;
+
+// collects like InstanceTree::findInstances
+class LinkedCollector {
+	public:
+		std::vector<int32_t>& result;
+		Rect rect;
+		LinkedCollector(std::vector<int32_t>& r, const Rect& re): result(r), rect(re) {}
+		bool visit(LinkedTree::Node* node, int32_t = -1) {
+			for (std::list<int32_t>::iterator it = node->data().begin(); it != node->data().end(); ++it) {
+				if (rect.contains(points[*it])) {
+					result.push_back(*it);
+				}
+			}
+			return true;
+		}
+};
+
+class FlatCollector {
+	public:
+		std::vector<int32_t>& result;
+		Rect rect;
+		FlatCollector(std::vector<int32_t>& r, const Rect& re): result(r), rect(re) {}
+		bool visit(FlatTree::Node* node, int32_t) {
+			for (std::vector<int32_t>::iterator it = node->data().begin(); it != node->data().end(); ++it) {
+				if (rect.contains(points[*it])) {
+					result.push_back(*it);
+				}
+			}
+			return true;
+		}
+};
+
+static void findLinked(LinkedTree& tree, const Rect& rect, std::vector<int32_t>& result) {
+	LinkedTree::Node* node = tree.find_container(rect);
+	LinkedCollector collector(result, rect);
+	node->apply_visitor(collector);
+	node = node->parent();
+	while (node) {
+		collector.visit(node);
+		node = node->parent();
+	}
+}
+
+static void findFlat(FlatTree& tree, const Rect& rect, std::vector<int32_t>& result) {
+	FlatCollector collector(result, rect);
+	tree.apply_visitor(rect, collector);
+}
+
+static Point randomPoint(int32_t range) {
+	return Point(rand() % (2 * range) - range, rand() % (2 * range) - range);
+}
+
+static Rect randomRect(int32_t range, int32_t maxSize) {
+	Point p = randomPoint(range);
+	return Rect(p.x, p.y, rand() % maxSize, rand() % maxSize);
+}
+
+TEST(loose_quadtree_point_queries)
+{
+	srand(42);
+	const int32_t count = 5000;
+	points.clear();
+	LinkedTree linked;
+	FlatTree flat;
+	std::vector<LinkedTree::Node*> linkedNodes;
+	std::vector<int32_t> flatNodes;
+	for (int32_t i = 0; i < count; ++i) {
+		points.push_back(randomPoint(500));
+		linkedNodes.push_back(linked.find_container(points[i].x, points[i].y, 0, 0));
+		linkedNodes.back()->data().push_back(i);
+		flatNodes.push_back(flat.find_container(points[i].x, points[i].y, 0, 0));
+		flat.data(flatNodes.back()).push_back(i);
+	}
+
+	for (int32_t i = 0; i < 500; ++i) {
+		Rect rect = randomRect(600, 100);
+		std::vector<int32_t> a;
+		std::vector<int32_t> b;
+		findLinked(linked, rect, a);
+		findFlat(flat, rect, b);
+		std::sort(a.begin(), a.end());
+		std::sort(b.begin(), b.end());
+		CHECK(a == b);
+	}
+}
+
+TEST(loose_quadtree_rect_queries)
+{
+	srand(23);
+	FlatTree flat;
+	std::vector<Rect> rects;
+	for (int32_t i = 0; i < 2000; ++i) {
+		rects.push_back(randomRect(1000, 300));
+		flat.data(flat.find_container(rects.back())).push_back(i);
+	}
+
+	for (int32_t i = 0; i < 200; ++i) {
+		Rect rect = randomRect(1200, 400);
+		class Collector {
+			public:
+				std::vector<int32_t> found;
+				bool visit(FlatTree::Node* node, int32_t) {
+					found.insert(found.end(), node->data().begin(), node->data().end());
+					return true;
+				}
+		} collector;
+		flat.apply_visitor(rect, collector);
+		std::sort(collector.found.begin(), collector.found.end());
+		// every intersecting rectangle has to be found
+		for (int32_t j = 0; j < static_cast<int32_t>(rects.size()); ++j) {
+			if (rects[j].intersects(rect)) {
+				CHECK(std::binary_search(collector.found.begin(), collector.found.end(), j));
+			}
+		}
+	}
+}
+
+// insert, move and query mix of moving units, prints the timings
+TEST(quadtree_moving_units_benchmark)
+{
+	const int32_t units = 20000;
+	const int32_t steps = 50;
+	const int32_t range = 2000;
+
+	srand(7);
+	points.clear();
+	for (int32_t i = 0; i < units; ++i) {
+		points.push_back(randomPoint(range));
+	}
+	std::vector<Point> start = points;
+	size_t linkedFound = 0;
+	size_t flatFound = 0;
+
+	std::clock_t begin = std::clock();
+	{
+		LinkedTree tree;
+		std::vector<LinkedTree::Node*> nodes;
+		for (int32_t i = 0; i < units; ++i) {
+			nodes.push_back(tree.find_container(points[i].x, points[i].y, 0, 0));
+			nodes.back()->data().push_back(i);
+		}
+		for (int32_t s = 0; s < steps; ++s) {
+			for (int32_t i = s % 4; i < units; i += 4) {
+				nodes[i]->data().remove(i);
+				points[i].x += rand() % 3 - 1;
+				points[i].y += rand() % 3 - 1;
+				nodes[i] = tree.find_container(points[i].x, points[i].y, 0, 0);
+				nodes[i]->data().push_back(i);
+			}
+			for (int32_t q = 0; q < 100; ++q) {
+				std::vector<int32_t> result;
+				findLinked(tree, randomRect(range, 64), result);
+				linkedFound += result.size();
+			}
+		}
+	}
+	double linkedTime = double(std::clock() - begin) / CLOCKS_PER_SEC;
+
+	srand(7);
+	points = start;
+	for (int32_t i = 0; i < units; ++i) {
+		randomPoint(range);
+	}
+	begin = std::clock();
+	{
+		FlatTree tree;
+		std::vector<int32_t> nodes;
+		for (int32_t i = 0; i < units; ++i) {
+			nodes.push_back(tree.find_container(points[i].x, points[i].y, 0, 0));
+			tree.data(nodes.back()).push_back(i);
+		}
+		for (int32_t s = 0; s < steps; ++s) {
+			for (int32_t i = s % 4; i < units; i += 4) {
+				std::vector<int32_t>& data = tree.data(nodes[i]);
+				data.erase(std::find(data.begin(), data.end(), i));
+				points[i].x += rand() % 3 - 1;
+				points[i].y += rand() % 3 - 1;
+				nodes[i] = tree.find_container(points[i].x, points[i].y, 0, 0);
+				tree.data(nodes[i]).push_back(i);
+			}
+			for (int32_t q = 0; q < 100; ++q) {
+				std::vector<int32_t> result;
+				findFlat(tree, randomRect(range, 64), result);
+				flatFound += result.size();
+			}
+		}
+	}
+	double flatTime = double(std::clock() - begin) / CLOCKS_PER_SEC;
+
+	CHECK_EQUAL(linkedFound, flatFound);
+	std::cout << "QuadTree: " << linkedTime << "s, LooseQuadTree: " << flatTime << "s" << std::endl;
+}
+
+int main() {
+	return UnitTest::RunAllTests();
+}
@@ -0,0 +1,312 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+#include <boost/shared_ptr.hpp>
+#include <SDL.h>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "util/base/exception.h"
+#include "util/structures/rect.h"
+#include "util/time/timemanager.h"
+#include "vfs/vfs.h"
+#include "vfs/vfsdirectory.h"
+#include "video/imagemanager.h"
+#include "video/sdl/renderbackendsdl.h"
+#include "video/sdl/sdlimage.h"
+
+using namespace FIFE;
+
+// Renders images with tint and alpha through the SDL backend, batched with
+// SDL_RenderGeometry and quad by quad with SDL_RenderCopy, and compares the
+// pixels with each other and with plain SDL_RenderCopy calls. Uses the
+// software renderer of a surface, so no window or display is needed.
+
+static const int32_t SCREEN_SIZE = 256;
+static const int32_t CRATE_FRAMES = 9;
+// quads of the compared scene and of the timed scene
+static const int32_t SCENE_QUADS = 64;
+static const int32_t TIMED_QUADS = 2000;
+static const int32_t TIMED_FRAMES = 20;
+// consecutive quads drawn with the same image
+static const int32_t RUN_LENGTH = 4;
+
+enum DrawMode {
+	// SDLImage::render, flushed with SDL_RenderGeometry
+	DRAW_GEOMETRY,
+	// SDLImage::render, flushed with SDL_RenderCopy
+	DRAW_COPY,
+	// SDL_RenderCopy calls of the test itself
+	DRAW_REFERENCE
+};
+
+struct RenderResult {
+	RenderResult() : rendered(false), geometry(false), drawCalls(0), textureBinds(0), milliseconds(0.0) {}
+	bool rendered;
+	bool geometry;
+	uint32_t drawCalls;
+	uint32_t textureBinds;
+	double milliseconds;
+	std::vector<uint8_t> pixels;
+};
+
+// Environment
+struct environment {
+	boost::shared_ptr<TimeManager> timemanager;
+	boost::shared_ptr<VFS> vfs;
+
+	environment()
+		: timemanager(new TimeManager()),
+		  vfs(new VFS()) {
+		vfs->addSource(new VFSDirectory(vfs.get()));
+	}
+};
+
+// Draws on the software renderer of the given surface instead of a window.
+class SoftwareRenderBackend : public RenderBackendSDL {
+public:
+	SoftwareRenderBackend(const SDL_Color& colorkey, SDL_Surface* surface, bool geometry) :
+		RenderBackendSDL(colorkey) {
+		m_renderer = SDL_CreateSoftwareRenderer(surface);
+		m_screen = surface;
+		m_target = surface;
+		m_rgba_format = *(surface->format);
+		m_renderGeometry = geometry;
+	}
+
+	bool hasRenderer() const {
+		return m_renderer != NULL;
+	}
+};
+
+static std::string crateFile(int32_t frame) {
+	if (frame == 0) {
+		return "tests/data/crate/full_s_000.png";
+	}
+	std::ostringstream file;
+	file << "tests/data/crate/full_s_000" << frame << ".png";
+	return file.str();
+}
+
+static SDL_Surface* createScreen() {
+	return SDL_CreateRGBSurfaceWithFormat(0, SCREEN_SIZE, SCREEN_SIZE, 32, SDL_PIXELFORMAT_ARGB8888);
+}
+
+static void readPixels(SDL_Renderer* renderer, std::vector<uint8_t>& pixels) {
+	pixels.resize(SCREEN_SIZE * SCREEN_SIZE * 4);
+	SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888, &pixels[0], SCREEN_SIZE * 4);
+}
+
+// Overlapping images with runs of the same texture, each quad with one of
+// the tints and one of the alpha values.
+static void drawScene(SoftwareRenderBackend& renderbackend, const std::vector<ImagePtr>& images,
+	const std::vector<SDL_Texture*>& textures, int32_t quads, DrawMode mode) {
+	static const uint8_t tints[][4] = {
+		{ 255, 255, 255, 255 },
+		{ 255, 128, 64, 255 },
+		{ 64, 200, 255, 160 },
+		{ 255, 255, 255, 80 }
+	};
+	static const uint8_t alphas[] = { 255, 200, 96 };
+	for (int32_t i = 0; i < quads; ++i) {
+		const int32_t index = (i / RUN_LENGTH) % CRATE_FRAMES;
+		const ImagePtr& image = images[index];
+		const Rect rect((i * 37) % (SCREEN_SIZE - 32) - 16, (i * 23) % (SCREEN_SIZE - 40) - 20,
+			image->getWidth(), image->getHeight());
+		// the first tint is passed as no tint
+		const uint8_t* rgb = (i % 4 == 0) ? NULL : tints[i % 4];
+		const uint8_t alpha = alphas[i % 3];
+		if (mode != DRAW_REFERENCE) {
+			image->render(rect, alpha, rgb);
+			continue;
+		}
+		// the tint alpha fades the image together with the alpha
+		const uint8_t* tint = tints[i % 4];
+		SDL_Rect dst = { rect.x, rect.y, rect.w, rect.h };
+		SDL_SetTextureColorMod(textures[index], tint[0], tint[1], tint[2]);
+		SDL_SetTextureAlphaMod(textures[index], static_cast<uint8_t>(tint[3] * alpha / 255));
+		SDL_RenderCopy(renderbackend.getRenderer(), textures[index], NULL, &dst);
+	}
+}
+
+static RenderResult renderCrates(DrawMode mode) {
+	RenderResult result;
+	environment env;
+	SDL_Surface* screen = createScreen();
+	SDL_Color colorkey = { 255, 0, 255, 0 };
+	{
+		SoftwareRenderBackend renderbackend(colorkey, screen, mode == DRAW_GEOMETRY);
+		if (!renderbackend.hasRenderer()) {
+			std::cout << "test_sdl_batch: no software renderer, " << SDL_GetError() << std::endl;
+			SDL_FreeSurface(screen);
+			return result;
+		}
+		ImageManager imagemanager;
+		std::vector<ImagePtr> images;
+		std::vector<SDL_Texture*> textures;
+		for (int32_t frame = 0; frame < CRATE_FRAMES; ++frame) {
+			ImagePtr image = imagemanager.load(crateFile(frame));
+			images.push_back(image);
+			if (mode == DRAW_REFERENCE) {
+				SDL_Texture* texture = SDL_CreateTextureFromSurface(renderbackend.getRenderer(), image->getSurface());
+				SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+				textures.push_back(texture);
+			}
+		}
+
+		renderbackend.startFrame();
+		renderbackend.clearBackBuffer();
+		drawScene(renderbackend, images, textures, SCENE_QUADS, mode);
+		renderbackend.renderVertexArrays();
+		readPixels(renderbackend.getRenderer(), result.pixels);
+		renderbackend.endFrame();
+
+		const uint64_t start = SDL_GetPerformanceCounter();
+		for (int32_t frame = 0; frame < TIMED_FRAMES; ++frame) {
+			renderbackend.startFrame();
+			renderbackend.clearBackBuffer();
+			drawScene(renderbackend, images, textures, TIMED_QUADS, mode);
+			renderbackend.endFrame();
+		}
+		const uint64_t end = SDL_GetPerformanceCounter();
+		// the counters are reported for the previous frame
+		renderbackend.startFrame();
+		result.milliseconds = static_cast<double>(end - start) * 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency()) / TIMED_FRAMES;
+		result.drawCalls = renderbackend.getDrawCallCount();
+		result.textureBinds = renderbackend.getTextureBindCount();
+		result.geometry = renderbackend.isRenderGeometryEnabled();
+
+		std::vector<SDL_Texture*>::iterator it = textures.begin();
+		for (; it != textures.end(); ++it) {
+			SDL_DestroyTexture(*it);
+		}
+		images.clear();
+		imagemanager.removeAll();
+		result.rendered = true;
+	}
+	SDL_FreeSurface(screen);
+	return result;
+}
+
+// Draws two images, the first one is freed while its quad waits in the batch.
+static RenderResult renderFreed(bool geometry, bool freeImage) {
+	RenderResult result;
+	environment env;
+	SDL_Surface* screen = createScreen();
+	SDL_Color colorkey = { 255, 0, 255, 0 };
+	{
+		SoftwareRenderBackend renderbackend(colorkey, screen, geometry);
+		if (!renderbackend.hasRenderer()) {
+			SDL_FreeSurface(screen);
+			return result;
+		}
+		ImageManager imagemanager;
+		ImagePtr first = imagemanager.load(crateFile(0));
+		ImagePtr second = imagemanager.load(crateFile(1));
+		const uint8_t tint[] = { 255, 128, 64, 160 };
+
+		renderbackend.startFrame();
+		renderbackend.clearBackBuffer();
+		try {
+			first->render(Rect(10, 10, first->getWidth(), first->getHeight()), 200, tint);
+			first->render(Rect(40, 30, first->getWidth(), first->getHeight()), 255);
+			if (freeImage) {
+				// destroys the texture of the pending quads
+				first->free();
+			}
+			second->render(Rect(60, 50, second->getWidth(), second->getHeight()), 255);
+			renderbackend.renderVertexArrays();
+			readPixels(renderbackend.getRenderer(), result.pixels);
+			renderbackend.endFrame();
+			result.rendered = true;
+		} catch (Exception& e) {
+			std::cout << "test_sdl_batch: " << e.what() << std::endl;
+		}
+		result.geometry = renderbackend.isRenderGeometryEnabled();
+
+		first.reset();
+		second.reset();
+		imagemanager.removeAll();
+	}
+	SDL_FreeSurface(screen);
+	return result;
+}
+
+TEST(sdl_batch_pixels) {
+	RenderResult reference = renderCrates(DRAW_REFERENCE);
+	RenderResult copied = renderCrates(DRAW_COPY);
+	RenderResult batched = renderCrates(DRAW_GEOMETRY);
+	if (!reference.rendered || !copied.rendered || !batched.rendered) {
+		return;
+	}
+	std::cout << "SDL_RenderCopy: " << copied.milliseconds << " ms per frame, " << copied.drawCalls << " draw calls" << std::endl;
+	std::cout << "SDL_RenderGeometry: " << batched.milliseconds << " ms per frame, " << batched.drawCalls << " draw calls" << std::endl;
+
+	// the fallback draws every quad, the batch once per run of a texture
+	CHECK(!copied.geometry);
+	CHECK_EQUAL(static_cast<uint32_t>(TIMED_QUADS), copied.drawCalls);
+#ifdef FIFE_SDL_RENDER_GEOMETRY
+	CHECK(batched.geometry);
+	CHECK_EQUAL(static_cast<uint32_t>(TIMED_QUADS / RUN_LENGTH), batched.drawCalls);
+#endif
+	CHECK_EQUAL(copied.textureBinds, batched.textureBinds);
+
+	// tint and alpha are applied alike in all paths
+	CHECK(reference.pixels == copied.pixels);
+	CHECK(reference.pixels == batched.pixels);
+}
+
+TEST(sdl_batch_flush_before_destroy) {
+	const bool modes[] = { true, false };
+	for (uint32_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i) {
+		RenderResult kept = renderFreed(modes[i], false);
+		RenderResult freed = renderFreed(modes[i], true);
+		if (!kept.rendered) {
+			continue;
+		}
+		// the quads of the freed image were drawn before its texture was destroyed
+		CHECK(freed.rendered);
+		CHECK_EQUAL(kept.geometry, freed.geometry);
+		CHECK(kept.pixels == freed.pixels);
+	}
+}
+
+// need this here because SDL redefines
+// main to SDL_main in SDL_main.h
+#ifdef main
+#undef main
+#endif
+
+int main() {
+	return UnitTest::RunAllTests();
+}
@@ -0,0 +1,227 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+#include <SDL.h>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "loaders/native/video/imageloader.h"
+#include "loaders/native/video/texturecache.h"
+#include "vfs/fife_boost_filesystem.h"
+#include "vfs/raw/rawdata.h"
+#include "vfs/vfs.h"
+#include "vfs/vfsdirectory.h"
+
+using namespace FIFE;
+
+static const std::string CACHE_DIR = "tests/data/texturecache_tmp";
+static const std::string ASSET_DIRS[] = { "tests/data", "tests/fife_test" };
+
+static SDL_Surface* createTestSurface(int w, int h) {
+	SDL_Surface* surface = SDL_CreateRGBSurface(0, w, h, 32, RMASK, GMASK, BMASK, AMASK);
+	for (int y = 0; y < h; ++y) {
+		uint32_t* row = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(surface->pixels) + y * surface->pitch);
+		for (int x = 0; x < w; ++x) {
+			row[x] = (x * 7) ^ (y << 8) ^ 0xff000000;
+		}
+	}
+	return surface;
+}
+
+static bool samePixels(SDL_Surface* a, SDL_Surface* b) {
+	if (a->w != b->w || a->h != b->h) {
+		return false;
+	}
+	for (int y = 0; y < a->h; ++y) {
+		if (memcmp(static_cast<uint8_t*>(a->pixels) + y * a->pitch,
+			static_cast<uint8_t*>(b->pixels) + y * b->pitch, a->w * 4) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static std::vector<uint8_t> readFile(const std::string& path) {
+	std::ifstream file(path.c_str(), std::ios::binary);
+	return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+TEST(texturecache_roundtrip) {
+	TextureCache cache(CACHE_DIR);
+	cache.clear();
+
+	SDL_Surface* surface = createTestSurface(37, 23);
+	uint8_t content[] = { 1, 2, 3, 4 };
+	TextureCache::SourceStamp stamp = TextureCache::getContentStamp(content, sizeof(content));
+
+	CHECK(cache.read("images/test.png", stamp, surface->format) == NULL);
+	CHECK(cache.write("images/test.png", stamp, surface));
+
+	SDL_Surface* cached = cache.read("images/test.png", stamp, surface->format);
+	CHECK(cached != NULL);
+	if (cached) {
+		CHECK(samePixels(surface, cached));
+		SDL_FreeSurface(cached);
+	}
+	// any 32bit format is accepted without a format
+	cached = cache.read("images/test.png", stamp, NULL);
+	CHECK(cached != NULL);
+	SDL_FreeSurface(cached);
+
+	CHECK_EQUAL(2u, cache.getHitCount());
+	CHECK_EQUAL(1u, cache.getMissCount());
+	CHECK_EQUAL(1u, cache.getWriteCount());
+
+	SDL_FreeSurface(surface);
+	cache.clear();
+}
+
+TEST(texturecache_invalidation) {
+	TextureCache cache(CACHE_DIR);
+	cache.clear();
+
+	SDL_Surface* surface = createTestSurface(16, 16);
+	uint8_t content[] = { 1, 2, 3, 4 };
+	TextureCache::SourceStamp stamp = TextureCache::getContentStamp(content, sizeof(content));
+	cache.write("images/test.png", stamp, surface);
+
+	// changed source file
+	content[2] = 9;
+	TextureCache::SourceStamp changed = TextureCache::getContentStamp(content, sizeof(content));
+	CHECK(cache.read("images/test.png", changed, surface->format) == NULL);
+
+	// other file name
+	CHECK(cache.read("images/other.png", stamp, surface->format) == NULL);
+
+	// other pixel format
+	SDL_Surface* bgra = SDL_CreateRGBSurface(0, 1, 1, 32, BMASK, GMASK, RMASK, AMASK);
+	CHECK(cache.read("images/test.png", stamp, bgra->format) == NULL);
+	SDL_FreeSurface(bgra);
+
+	SDL_FreeSurface(surface);
+	cache.clear();
+}
+
+TEST(texturecache_file_stamp) {
+	bfs::create_directories(bfs::path(CACHE_DIR));
+	const std::string name = "stamp.png";
+	const std::string path = CACHE_DIR + "/" + name;
+	{
+		std::ofstream file(path.c_str(), std::ios::binary);
+		file << "not an image";
+	}
+	const uint64_t size = bfs::file_size(path);
+
+	// the name is relative to the root of the directory source, not to the working directory
+	VFS vfs;
+	VFSDirectory directory(&vfs, CACHE_DIR);
+	std::unique_ptr<RawData> data(directory.open(name));
+	CHECK_EQUAL(bfs::path(path).string(), bfs::path(data->getHostPath()).string());
+
+	// written just now, so it could still change in the same second
+	TextureCache::SourceStamp stamp;
+	CHECK(!TextureCache::getFileStamp(data->getHostPath(), size, stamp));
+
+	bfs::last_write_time(bfs::path(path), std::time(0) - 60);
+	CHECK(TextureCache::getFileStamp(data->getHostPath(), size, stamp));
+	CHECK(!TextureCache::getFileStamp(name, size, stamp));
+	CHECK(!TextureCache::getFileStamp("", size, stamp));
+
+	data.reset();
+	bfs::remove(bfs::path(path));
+}
+
+// Measures a cold start (decode and write every image) against a warm start
+// (read every image from the cache) on the test and demo assets.
+TEST(texturecache_benchmark) {
+	std::vector<std::string> files;
+	for (size_t d = 0; d < sizeof(ASSET_DIRS) / sizeof(ASSET_DIRS[0]); ++d) {
+		boost::system::error_code error;
+		bfs::recursive_directory_iterator it(bfs::path(ASSET_DIRS[d]), error), end;
+		for (; !error && it != end; it.increment(error)) {
+			if (bfs::is_regular_file(it->path()) && GetExtension(it->path()) == ".png") {
+				files.push_back(it->path().string());
+			}
+		}
+	}
+	if (files.empty()) {
+		std::cout << "texturecache_benchmark: no images found, run from the repository root" << std::endl;
+		return;
+	}
+
+	SDL_Surface* target = SDL_CreateRGBSurface(0, 1, 1, 32, RMASK, GMASK, BMASK, AMASK);
+	TextureCache cache(CACHE_DIR);
+	cache.clear();
+
+	clock_t start = clock();
+	for (size_t i = 0; i < files.size(); ++i) {
+		std::vector<uint8_t> data = readFile(files[i]);
+		TextureCache::SourceStamp stamp;
+		if (!TextureCache::getFileStamp(files[i], data.size(), stamp)) {
+			stamp = TextureCache::getContentStamp(&data[0], data.size());
+		}
+		SDL_Surface* surface = ImageLoader::decode(&data[0], data.size(), target->format);
+		cache.write(files[i], stamp, surface);
+		SDL_FreeSurface(surface);
+	}
+	double coldTime = double(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (size_t i = 0; i < files.size(); ++i) {
+		TextureCache::SourceStamp stamp;
+		if (!TextureCache::getFileStamp(files[i], bfs::file_size(files[i]), stamp)) {
+			std::vector<uint8_t> data = readFile(files[i]);
+			stamp = TextureCache::getContentStamp(&data[0], data.size());
+		}
+		SDL_Surface* surface = cache.read(files[i], stamp, target->format);
+		CHECK(surface != NULL);
+		SDL_FreeSurface(surface);
+	}
+	double warmTime = double(clock() - start) / CLOCKS_PER_SEC;
+
+	CHECK_EQUAL(files.size(), cache.getHitCount());
+	std::cout << files.size() << " images" << std::endl;
+	std::cout << "  cold start (decode + write): " << coldTime << "s" << std::endl;
+	std::cout << "  warm start (cache read):     " << warmTime << "s" << std::endl;
+
+	SDL_FreeSurface(target);
+	cache.clear();
+}
+
+int main() {
+	return UnitTest::RunAllTests();
+}
@@ -0,0 +1,337 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2019 by the FIFE team                              *
+ *   http://www.fifengine.net                                              *
+ *   This file is part of FIFE.                                            *
+ *                                                                         *
+ *   FIFE is free software; you can redistribute it and/or                 *
+ *   modify it under the terms of the GNU Lesser General Public            *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2.1 of the License, or (at your option) any later version.    *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+// Standard C++ library includes
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Platform specific includes
+#include "fife_unittest.h"
+
+// 3rd party library includes
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <SDL.h>
+
+// FIFE includes
+// These includes are split up in two parts, separated by one empty line
+// First block: files included from the FIFE root src directory
+// Second block: files included from the same folder
+#include "model/model.h"
+#include "model/metamodel/object.h"
+#include "model/metamodel/grids/squaregrid.h"
+#include "model/structures/instance.h"
+#include "model/structures/layer.h"
+#include "model/structures/location.h"
+#include "model/structures/map.h"
+#include "util/base/exception.h"
+#include "util/structures/rect.h"
+#include "util/time/timemanager.h"
+#include "vfs/vfs.h"
+#include "vfs/vfsdirectory.h"
+#include "video/animationmanager.h"
+#include "video/devicecaps.h"
+#include "video/imagemanager.h"
+#include "video/opengl/fife_opengl.h"
+#include "video/opengl/renderbackendopengl.h"
+#include "view/camera.h"
+#include "view/renderers/instancerenderer.h"
+#include "view/visual.h"
+
+using namespace FIFE;
+
+// Renders the same frames with client side arrays and with vertex buffers,
+// streamed through a persistently mapped or an orphaned buffer, and compares
+// the pixels and the uploaded bytes. Needs an OpenGL capable driver without a
+// display, e.g. Mesa llvmpipe through the SDL offscreen video driver.
+
+static const std::string CRATE_FILE = "tests/data/crate/full_s_000.png";
+static const std::string SPRITE_FILE = "tests/data/mushroom_007.png";
+static const int32_t SCREEN_SIZE = 256;
+// frames without changes, followed by frames with one moving instance
+static const int32_t IDLE_FRAMES = 3;
+static const int32_t MOVING_FRAMES = 4;
+// quads of one stream submission and submissions per frame, more than one
+// segment of the persistently mapped buffer is written per frame and the
+// orphaned buffer wraps every few frames
+static const int32_t STREAM_QUADS = 2500;
+static const int32_t STREAM_SUBMISSIONS = 8;
+static const int32_t STREAM_FRAMES = 8;
+
+enum VertexArrays {
+	ARRAYS_CLIENT,
+	ARRAYS_PERSISTENT,
+	ARRAYS_ORPHANED
+};
+
+struct RenderResult {
+	RenderResult() : rendered(false), mapped(false) {}
+	bool rendered;
+	bool mapped;
+	// uploaded bytes per frame
+	std::vector<uint32_t> bytes;
+	// pixels per frame
+	std::vector<std::vector<uint8_t> > pixels;
+};
+
+// Environment
+struct environment {
+	boost::shared_ptr<TimeManager> timemanager;
+	boost::shared_ptr<VFS> vfs;
+
+	environment()
+		: timemanager(new TimeManager()),
+		  vfs(new VFS()) {
+		vfs->addSource(new VFSDirectory(vfs.get()));
+	}
+};
+
+static bool createScreen(RenderBackendOpenGL& renderbackend, VertexArrays arrays) {
+	renderbackend.setVertexBufferEnabled(arrays != ARRAYS_CLIENT);
+	renderbackend.setPersistentMappingEnabled(arrays == ARRAYS_PERSISTENT);
+	// keeps a driver that was selected by the user
+	SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+	try {
+		renderbackend.init("");
+		renderbackend.createMainScreen(ScreenMode(SCREEN_SIZE, SCREEN_SIZE, 32, SDL_WINDOW_OPENGL), "FIFE", "");
+	} catch (Exception& e) {
+		std::cout << "test_vertexbuffer_gl: no OpenGL context, " << e.what() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static void readPixels(RenderResult& result) {
+	result.pixels.push_back(std::vector<uint8_t>(SCREEN_SIZE * SCREEN_SIZE * 4));
+	glReadPixels(0, 0, SCREEN_SIZE, SCREEN_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, &result.pixels.back()[0]);
+}
+
+// A static layer, a layer whose instances don't move and a layer with one
+// moving instance. Only the moving instance starts to move after the idle frames.
+static RenderResult renderLayers(VertexArrays arrays) {
+	RenderResult result;
+	environment env;
+	SDL_Color colorkey = { 255, 0, 255, 0 };
+	RenderBackendOpenGL renderbackend(colorkey);
+	if (!createScreen(renderbackend, arrays)) {
+		return result;
+	}
+
+	ImageManager imagemanager;
+	AnimationManager animationmanager;
+	boost::scoped_ptr<InstanceRenderer> prototype(new InstanceRenderer(&renderbackend, 10));
+	std::vector<RendererBase*> renderers;
+	renderers.push_back(prototype.get());
+	Model model(&renderbackend, renderers);
+	model.adoptCellGrid(new SquareGrid());
+
+	ImagePtr crateImage = imagemanager.load(CRATE_FILE);
+	Object* crate = model.createObject("crate", "vertexbuffer_test");
+	ObjectVisual::create(crate)->addStaticImage(0, crateImage->getHandle());
+	ImagePtr mushroomImage = imagemanager.load(SPRITE_FILE);
+	Object* mushroom = model.createObject("mushroom", "vertexbuffer_test");
+	ObjectVisual::create(mushroom)->addStaticImage(0, mushroomImage->getHandle());
+
+	Map* map = model.createMap("map");
+	Layer* ground = map->createLayer("ground", model.getCellGrid("square"));
+	ground->setStatic(true);
+	Layer* idle = map->createLayer("idle", model.getCellGrid("square"));
+	Layer* moving = map->createLayer("moving", model.getCellGrid("square"));
+	for (int32_t y = -3; y <= 3; ++y) {
+		for (int32_t x = -3; x <= 3; ++x) {
+			InstanceVisual::create(ground->createInstance(crate, ExactModelCoordinate(x, y)));
+			InstanceVisual::create(idle->createInstance(mushroom, ExactModelCoordinate(x, y)));
+		}
+	}
+	Instance* mover = moving->createInstance(crate, ExactModelCoordinate(-2, 0.5));
+	InstanceVisual::create(mover);
+
+	Camera* camera = map->addCamera("camera", Rect(0, 0, SCREEN_SIZE, SCREEN_SIZE));
+	camera->setCellImageDimensions(32, 32);
+	camera->setLocation(Location(idle));
+	InstanceRenderer::getInstance(camera)->activateAllLayers(map);
+
+	for (int32_t frame = 0; frame <= IDLE_FRAMES + MOVING_FRAMES; ++frame) {
+		renderbackend.startFrame();
+		if (frame > 0) {
+			// the bytes of the previous frame
+			result.bytes.push_back(renderbackend.getUploadedBytes());
+		}
+		if (frame == IDLE_FRAMES + MOVING_FRAMES) {
+			renderbackend.endFrame();
+			break;
+		}
+		if (frame >= IDLE_FRAMES) {
+			Location location(moving);
+			location.setExactLayerCoordinates(ExactModelCoordinate(-2 + 0.25 * (frame - IDLE_FRAMES + 1), 0.5));
+			mover->setLocation(location);
+		}
+		model.update();
+		camera->update();
+		camera->render();
+		renderbackend.renderVertexArrays();
+		readPixels(result);
+		renderbackend.endFrame();
+	}
+	result.mapped = renderbackend.isStreamBufferMapped();
+	result.rendered = true;
+	return result;
+}
+
+// Draws many quads that move in every frame, directly through the backend.
+static RenderResult renderStream(VertexArrays arrays) {
+	RenderResult result;
+	environment env;
+	SDL_Color colorkey = { 255, 0, 255, 0 };
+	RenderBackendOpenGL renderbackend(colorkey);
+	if (!createScreen(renderbackend, arrays)) {
+		return result;
+	}
+
+	ImageManager imagemanager;
+	ImagePtr image = imagemanager.load(SPRITE_FILE);
+	for (int32_t frame = 0; frame <= STREAM_FRAMES; ++frame) {
+		renderbackend.startFrame();
+		if (frame > 0) {
+			result.bytes.push_back(renderbackend.getUploadedBytes());
+		}
+		if (frame == STREAM_FRAMES) {
+			renderbackend.endFrame();
+			break;
+		}
+		// the quads don't cover the whole screen
+		renderbackend.clearBackBuffer();
+		for (int32_t submission = 0; submission < STREAM_SUBMISSIONS; ++submission) {
+			for (int32_t quad = 0; quad < STREAM_QUADS; ++quad) {
+				const int32_t i = quad + submission * STREAM_QUADS + frame * 7;
+				image->render(Rect((i * 13) % (SCREEN_SIZE - 8), (i * 7 / 3) % (SCREEN_SIZE - 8), 8, 8));
+			}
+			renderbackend.renderVertexArrays();
+		}
+		readPixels(result);
+		renderbackend.endFrame();
+	}
+	result.mapped = renderbackend.isStreamBufferMapped();
+	result.rendered = true;
+	return result;
+}
+
+static void printBytes(const std::string& name, const RenderResult& result) {
+	std::cout << name << " uploaded bytes:";
+	for (size_t i = 0; i < result.bytes.size(); ++i) {
+		std::cout << " " << result.bytes[i];
+	}
+	std::cout << std::endl;
+}
+
+static void checkMapping(VertexArrays arrays, const RenderResult& buffered) {
+	if (arrays == ARRAYS_PERSISTENT && !buffered.mapped) {
+		std::cout << "test_vertexbuffer_gl: the driver has no persistent mapping, orphaning was used" << std::endl;
+	}
+	CHECK(arrays == ARRAYS_PERSISTENT || !buffered.mapped);
+}
+
+static bool compareFrames(const RenderResult& client, const RenderResult& buffered) {
+	CHECK_EQUAL(client.pixels.size(), buffered.pixels.size());
+	if (client.pixels.size() != buffered.pixels.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < client.pixels.size(); ++i) {
+		CHECK(client.pixels[i] == buffered.pixels[i]);
+	}
+	return true;
+}
+
+static void checkLayers(VertexArrays arrays) {
+	RenderResult client = renderLayers(ARRAYS_CLIENT);
+	RenderResult buffered = renderLayers(arrays);
+	if (!client.rendered || !buffered.rendered) {
+		return;
+	}
+	printBytes("client arrays", client);
+	printBytes(buffered.mapped ? "persistent mapping" : "orphaning", buffered);
+	checkMapping(arrays, buffered);
+	if (!compareFrames(client, buffered)) {
+		return;
+	}
+
+	// client arrays submit the whole frame again, the first frame also draws the static layer tiles
+	for (int32_t frame = 1; frame < IDLE_FRAMES; ++frame) {
+		CHECK(client.bytes[frame] > 0);
+		CHECK(client.bytes[frame] < client.bytes[0]);
+	}
+	// with vertex buffers the second identical frame uploads nothing
+	CHECK(buffered.bytes[0] > 0);
+	for (int32_t frame = 1; frame < IDLE_FRAMES; ++frame) {
+		CHECK_EQUAL(0u, buffered.bytes[frame]);
+	}
+	// the submissions are retained by their position in the frame, not by the
+	// layer flag. The static layer only draws its tiles and the idle layer is not
+	// static, but both are reused while only the moving instance is streamed.
+	for (int32_t frame = IDLE_FRAMES; frame < IDLE_FRAMES + MOVING_FRAMES; ++frame) {
+		CHECK(buffered.bytes[frame] > 0);
+		CHECK(buffered.bytes[frame] * 8 < client.bytes[frame]);
+	}
+	CHECK(client.pixels[IDLE_FRAMES - 1] != client.pixels[IDLE_FRAMES]);
+}
+
+static void checkStream(VertexArrays arrays) {
+	RenderResult client = renderStream(ARRAYS_CLIENT);
+	RenderResult buffered = renderStream(arrays);
+	if (!client.rendered || !buffered.rendered) {
+		return;
+	}
+	printBytes("client arrays", client);
+	printBytes(buffered.mapped ? "persistent mapping" : "orphaning", buffered);
+	checkMapping(arrays, buffered);
+	compareFrames(client, buffered);
+	// changing data is uploaded in every frame, from the second frame on through the stream buffer
+	for (size_t frame = 0; frame < buffered.bytes.size(); ++frame) {
+		CHECK(buffered.bytes[frame] >= client.bytes[frame]);
+	}
+}
+
+TEST(vertexbuffer_gl_persistent_layers) {
+	checkLayers(ARRAYS_PERSISTENT);
+}
+
+TEST(vertexbuffer_gl_orphaned_layers) {
+	checkLayers(ARRAYS_ORPHANED);
+}
+
+TEST(vertexbuffer_gl_persistent_stream) {
+	checkStream(ARRAYS_PERSISTENT);
+}
+
+TEST(vertexbuffer_gl_orphaned_stream) {
+	checkStream(ARRAYS_ORPHANED);
+}
+
+// need this here because SDL redefines
+// main to SDL_main in SDL_main.h
+#ifdef main
+#undef main
+#endif
+
+int main() {
+	return UnitTest::RunAllTests();
+}
@@ -20,6 +20,11 @@
  ***************************************************************************/
 
 // Standard C++ library includes
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
 
 // Platform specific includes
 #include "fife_unittest.h"
@@ -40,6 +45,10 @@
 #include "vfs/raw/rawdata.h"
 #include "util/base/exception.h"
 #include "vfs/directoryprovider.h"
+#include "vfs/dat/dat1.h"
+#include "vfs/dat/dat2.h"
+#include "vfs/raw/rawdatafile.h"
+#include "vfs/zip/zipsource.h"
 
 static const std::string FIFE_TEST_DIR = "fifetestdir";
 using namespace FIFE;
@@ -68,6 +77,141 @@ TEST(test_is_directory)
 
 }
 
+static std::vector<uint8_t> readAll(RawData* data) {
+	std::vector<uint8_t> result(data->getDataLength());
+	if (!result.empty()) {
+		data->readInto(&result[0], result.size());
+	}
+	return result;
+}
+
+/** Opens and reads the files, counts the reads that don't match the expected content.
+ */
+static void readWorker(VFS* vfs, const std::vector<std::string>* files, const std::vector<std::vector<uint8_t> >* expected,
+	uint32_t thread, uint32_t rounds, std::atomic<uint32_t>* failures) {
+	for (uint32_t round = 0; round < rounds; ++round) {
+		size_t index = (round * 7 + thread * 3) % files->size();
+		try {
+			if (!vfs->exists((*files)[index])) {
+				++*failures;
+				continue;
+			}
+			std::unique_ptr<RawData> data(vfs->open((*files)[index]));
+			const std::vector<uint8_t>& reference = (*expected)[index];
+			if (data->getDataLength() != reference.size()) {
+				++*failures;
+				continue;
+			}
+			// read in one go, as a view and in small chunks
+			if (round % 3 == 0) {
+				if (readAll(data.get()) != reference) {
+					++*failures;
+				}
+			} else if (round % 3 == 1) {
+				if (!reference.empty() && memcmp(data->getDataView(), &reference[0], reference.size()) != 0) {
+					++*failures;
+				}
+			} else {
+				uint8_t chunk[1000];
+				while (data->getCurrentIndex() < data->getDataLength()) {
+					uint32_t offset = data->getCurrentIndex();
+					uint32_t length = std::min<uint32_t>(sizeof(chunk), data->getDataLength() - offset);
+					data->readInto(chunk, length);
+					if (memcmp(chunk, &reference[offset], length) != 0) {
+						++*failures;
+						break;
+					}
+				}
+			}
+			if (vfs->listFiles("tests/data").empty() || !vfs->isDirectory("ziptest_content/testdir1")) {
+				++*failures;
+			}
+		} catch (const Exception&) {
+			++*failures;
+		}
+	}
+}
+
+static uint32_t readConcurrently(VFS* vfs, const std::vector<std::string>& files,
+	const std::vector<std::vector<uint8_t> >& expected, uint32_t threads, uint32_t rounds) {
+	std::atomic<uint32_t> failures(0);
+	std::vector<std::thread> workers;
+	for (uint32_t t = 0; t < threads; ++t) {
+		workers.push_back(std::thread(readWorker, vfs, &files, &expected, t, rounds, &failures));
+	}
+	for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it) {
+		it->join();
+	}
+	return failures;
+}
+
+/** Reads random blocks of a shared RawData with readAt.
+ */
+static void readAtWorker(const RawData* data, const std::vector<uint8_t>* expected, uint32_t thread, std::atomic<uint32_t>* failures) {
+	std::vector<uint8_t> buffer(4096);
+	for (uint32_t i = 0; i < 2000; ++i) {
+		uint32_t offset = ((i * 7919 + thread * 104729) * 13) % (expected->size() - buffer.size());
+		data->readAt(offset, &buffer[0], buffer.size());
+		if (memcmp(&buffer[0], &(*expected)[offset], buffer.size()) != 0) {
+			++*failures;
+		}
+	}
+}
+
+TEST(concurrent_reads) {
+	boost::shared_ptr<VFS> vfs(new VFS());
+	vfs->addSource(new VFSDirectory(vfs.get()));
+	vfs->addSource(new ZipSource(vfs.get(), "tests/data/testmap.zip"));
+	vfs->addSource(new DAT1(vfs.get(), "tests/data/dat1vfstest.dat"));
+	vfs->addSource(new DAT2(vfs.get(), "tests/data/dat2vfstest.dat"));
+
+	std::vector<std::string> files;
+	files.push_back("tests/data/test.map");
+	files.push_back("tests/data/crate_full_001.xml");
+	files.push_back("tests/data/rpgfont.png");
+	files.push_back("content/maps/test.map");
+	files.push_back("ziptest_content/maps/test.map");
+	files.push_back("ziptest_content/testdir1/file");
+	files.push_back("dat1vfstest.map");
+	files.push_back("dat2vfstest.map");
+
+	// the expected content, read by one thread
+	std::vector<std::vector<uint8_t> > expected;
+	for (std::vector<std::string>::const_iterator it = files.begin(); it != files.end(); ++it) {
+		std::unique_ptr<RawData> data(vfs->open(*it));
+		expected.push_back(readAll(data.get()));
+	}
+	CHECK(expected[0] == expected[3]);
+	CHECK(expected[0] == expected[6]);
+
+	const uint32_t threads = 8;
+	CHECK_EQUAL(0u, readConcurrently(vfs.get(), files, expected, threads, 60));
+
+	// once more with the zip entries streamed
+	const uint32_t threshold = ZipSource::getStreamingThreshold();
+	ZipSource::setStreamingThreshold(64 * 1024);
+	CHECK_EQUAL(0u, readConcurrently(vfs.get(), files, expected, threads, 60));
+	ZipSource::setStreamingThreshold(threshold);
+}
+
+TEST(concurrent_positional_reads) {
+	// one file handle shared by all threads
+	RawData data(new RawDataFile("tests/data/test.map"));
+	std::vector<uint8_t> expected = readAll(&data);
+	CHECK(expected.size() > 100000);
+
+	std::atomic<uint32_t> failures(0);
+	std::vector<std::thread> workers;
+	for (uint32_t t = 0; t < 8; ++t) {
+		workers.push_back(std::thread(readAtWorker, &data, &expected, t, &failures));
+	}
+	for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it) {
+		it->join();
+	}
+	CHECK_EQUAL(0u, failures);
+	CHECK_THROW(data.readAt(expected.size() - 10, &expected[0], 11), IndexOverflow);
+}
+
 int main() {
 	return UnitTest::RunAllTests();
 }
@@ -20,13 +20,24 @@
  ***************************************************************************/
 
 // Standard C++ library includes
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
 
 // Platform specific includes
 #include "fife_unittest.h"
 
 // 3rd party library includes
+#include "zlib.h"
 
 // FIFE includes
 // These includes are split up in two parts, separated by one empty line
@@ -38,6 +49,8 @@
 #include "vfs/vfsdirectory.h"
 #include "vfs/zip/zipsource.h"
 #include "vfs/raw/rawdata.h"
+#include "vfs/zip/zipfilesource.h"
+#include "vfs/zip/zipstreamsource.h"
 #include "util/base/exception.h"
 
 using namespace FIFE;
@@ -115,6 +128,519 @@ TEST(test_decoder) {
 	delete fcomp;
 }
 
+static const std::string GENERATED_ZIP = "fifetestzip.zip";
+
+struct ZipTestEntry {
+	std::string name;
+	std::vector<uint8_t> data;
+	bool deflate;
+};
+
+static void write16(std::ofstream& out, uint16_t value) {
+	uint8_t bytes[2] = { static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8) };
+	out.write(reinterpret_cast<char*>(bytes), 2);
+}
+
+static void write32(std::ofstream& out, uint32_t value) {
+	write16(out, static_cast<uint16_t>(value));
+	write16(out, static_cast<uint16_t>(value >> 16));
+}
+
+static void write64(std::ofstream& out, uint64_t value) {
+	write32(out, static_cast<uint32_t>(value));
+	write32(out, static_cast<uint32_t>(value >> 32));
+}
+
+/** Writes a zip archive with local headers, central directory and end of central directory record.
+ */
+static void writeZip(const std::string& filename, const std::vector<ZipTestEntry>& entries) {
+	std::ofstream out(filename.c_str(), std::ios::binary);
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> crcs;
+	std::vector<uint32_t> compressedSizes;
+	for (std::vector<ZipTestEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+		const uint8_t* bytes = it->data.empty() ? 0 : &it->data[0];
+		crcs.push_back(crc32(crc32(0, Z_NULL, 0), bytes, it->data.size()));
+		std::vector<uint8_t> comp;
+		if (it->deflate) {
+			z_stream stream;
+			memset(&stream, 0, sizeof(stream));
+			deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+			comp.resize(deflateBound(&stream, it->data.size()));
+			stream.next_in = const_cast<uint8_t*>(bytes);
+			stream.avail_in = it->data.size();
+			stream.next_out = &comp[0];
+			stream.avail_out = comp.size();
+			deflate(&stream, Z_FINISH);
+			comp.resize(stream.total_out);
+			deflateEnd(&stream);
+		} else {
+			comp = it->data;
+		}
+
+		offsets.push_back(static_cast<uint32_t>(out.tellp()));
+		write32(out, 0x04034b50);
+		write16(out, 20);
+		write16(out, 0);
+		write16(out, it->deflate ? 8 : 0);
+		write32(out, 0);
+		write32(out, crcs.back());
+		write32(out, comp.size());
+		write32(out, it->data.size());
+		write16(out, it->name.size());
+		write16(out, 0);
+		out.write(it->name.c_str(), it->name.size());
+		if (!comp.empty()) {
+			out.write(reinterpret_cast<char*>(&comp[0]), comp.size());
+		}
+		compressedSizes.push_back(comp.size());
+	}
+
+	uint32_t directoryOffset = static_cast<uint32_t>(out.tellp());
+	for (size_t i = 0; i < entries.size(); ++i) {
+		write32(out, 0x02014b50);
+		write16(out, 20);
+		write16(out, 20);
+		write16(out, 0);
+		write16(out, entries[i].deflate ? 8 : 0);
+		write32(out, 0);
+		write32(out, crcs[i]);
+		write32(out, compressedSizes[i]);
+		write32(out, entries[i].data.size());
+		write16(out, entries[i].name.size());
+		write16(out, 0);
+		write16(out, 0);
+		write16(out, 0);
+		write16(out, 0);
+		write32(out, 0);
+		write32(out, offsets[i]);
+		out.write(entries[i].name.c_str(), entries[i].name.size());
+	}
+	uint32_t directorySize = static_cast<uint32_t>(out.tellp()) - directoryOffset;
+	write32(out, 0x06054b50);
+	write16(out, 0);
+	write16(out, 0);
+	write16(out, entries.size());
+	write16(out, entries.size());
+	write32(out, directorySize);
+	write32(out, directoryOffset);
+	write16(out, 0);
+}
+
+/** Compressible test data, words from a small dictionary in random order.
+ */
+static std::vector<uint8_t> createTestData(uint32_t size, uint32_t seed) {
+	static const char* words[] = { "fife ", "engine ", "zip ", "stream ", "map ", "layer ", "instance ", "\n" };
+	std::vector<uint8_t> data;
+	data.reserve(size);
+	srand(seed);
+	while (data.size() < size) {
+		const char* word = words[rand() % 8];
+		for (; *word && data.size() < size; ++word) {
+			data.push_back(static_cast<uint8_t>(*word));
+		}
+	}
+	return data;
+}
+
+TEST(stream_matches_inflate) {
+	environment env;
+	const uint32_t threshold = ZipSource::getStreamingThreshold();
+
+	std::vector<ZipTestEntry> entries(2);
+	entries[0].name = "big.txt";
+	entries[0].data = createTestData(5 * ZipStreamSource::RESTART_INTERVAL + 12345, 1);
+	entries[0].deflate = true;
+	entries[1].name = "stored.txt";
+	entries[1].data = createTestData(300000, 2);
+	entries[1].deflate = false;
+	writeZip(GENERATED_ZIP, entries);
+	{
+		boost::shared_ptr<VFS> vfs(new VFS());
+		vfs->addSource(new VFSDirectory(vfs.get()));
+		vfs->addSource(new ZipSource(vfs.get(), GENERATED_ZIP));
+		vfs->addSource(new ZipSource(vfs.get(), COMPRESSED_FILE));
+
+		// stream everything
+		ZipSource::setStreamingThreshold(0);
+
+		std::unique_ptr<RawData> raw(vfs->open(RAW_FILE));
+		std::unique_ptr<RawData> streamed(vfs->open("ziptest_content/maps/test.map"));
+		CHECK(streamed->getData() == 0);
+		CHECK(raw->getDataInBytes() == streamed->getDataInBytes());
+
+		for (size_t e = 0; e < entries.size(); ++e) {
+			const std::vector<uint8_t>& expected = entries[e].data;
+			std::unique_ptr<RawData> data(vfs->open(entries[e].name));
+			CHECK_EQUAL(expected.size(), data->getDataLength());
+
+			// sequential reads in small pieces
+			std::vector<uint8_t> buffer(4096);
+			bool equal = true;
+			for (uint32_t pos = 0; pos < expected.size(); pos += buffer.size()) {
+				uint32_t count = std::min<uint32_t>(buffer.size(), expected.size() - pos);
+				data->readInto(&buffer[0], count);
+				equal = equal && memcmp(&buffer[0], &expected[pos], count) == 0;
+			}
+			CHECK(equal);
+
+			// random seeks, backwards and forwards
+			srand(3);
+			for (uint32_t i = 0; i < 200; ++i) {
+				uint32_t pos = rand() % expected.size();
+				uint32_t count = std::min<uint32_t>(rand() % 100000, expected.size() - pos);
+				std::vector<uint8_t> piece(count + 1);
+				data->setIndex(pos);
+				data->readInto(&piece[0], count);
+				equal = equal && memcmp(&piece[0], &expected[pos], count) == 0;
+			}
+			CHECK(equal);
+		}
+
+		// the limit of inflated bytes makes even small entries stream
+		ZipSource::setStreamingThreshold(threshold);
+		ZipSource::setMaxInflatedBytes(0);
+		std::unique_ptr<RawData> limited(vfs->open("ziptest_content/maps/test.map"));
+		CHECK(limited->getData() == 0);
+		ZipSource::setMaxInflatedBytes(64 * 1024 * 1024);
+		std::unique_ptr<RawData> inflated(vfs->open("ziptest_content/maps/test.map"));
+		CHECK(inflated->getData() != 0);
+	}
+	std::remove(GENERATED_ZIP.c_str());
+}
+
+TEST(stream_benchmark) {
+	environment env;
+	const uint32_t threshold = ZipSource::getStreamingThreshold();
+
+	std::vector<ZipTestEntry> entries(1);
+	entries[0].name = "big.txt";
+	entries[0].data = createTestData(32 * 1024 * 1024, 4);
+	entries[0].deflate = true;
+	writeZip(GENERATED_ZIP, entries);
+	{
+		boost::shared_ptr<VFS> vfs(new VFS());
+		vfs->addSource(new VFSDirectory(vfs.get()));
+		vfs->addSource(new ZipSource(vfs.get(), GENERATED_ZIP));
+
+		// read the header only, then the whole entry in chunks
+		std::vector<uint8_t> buffer(64 * 1024);
+		for (uint32_t mode = 0; mode < 2; ++mode) {
+			ZipSource::setStreamingThreshold(mode == 0 ? 0xffffffff : 0);
+
+			clock_t start = clock();
+			std::unique_ptr<RawData> header(vfs->open(entries[0].name));
+			header->readInto(&buffer[0], 64);
+			double headerTime = double(clock() - start) / CLOCKS_PER_SEC;
+
+			start = clock();
+			std::unique_ptr<RawData> data(vfs->open(entries[0].name));
+			while (data->getCurrentIndex() < data->getDataLength()) {
+				data->readInto(&buffer[0], std::min<uint32_t>(buffer.size(), data->getDataLength() - data->getCurrentIndex()));
+			}
+			double readTime = double(clock() - start) / CLOCKS_PER_SEC;
+
+			std::cout << (mode == 0 ? "inflated" : "streamed") << " 32 MB entry: header " << headerTime
+				<< "s, complete " << readTime << "s, inflated bytes held " << ZipFileSource::getInflatedBytes() << std::endl;
+		}
+	}
+	ZipSource::setStreamingThreshold(threshold);
+	std::remove(GENERATED_ZIP.c_str());
+}
+
+TEST(index_benchmark) {
+	environment env;
+	const uint32_t archives = 5;
+	const uint32_t filesPerArchive = 10000;
+
+	std::vector<std::string> names;
+	std::vector<std::string> archiveNames;
+	for (uint32_t a = 0; a < archives; ++a) {
+		std::vector<ZipTestEntry> entries(filesPerArchive);
+		for (uint32_t i = 0; i < filesPerArchive; ++i) {
+			std::ostringstream name;
+			name << "objects/set" << a << "/dir" << (i % 100) << "/file" << i << ".xml";
+			entries[i].name = name.str();
+			entries[i].data = createTestData(16, a * filesPerArchive + i);
+			entries[i].deflate = false;
+			names.push_back(entries[i].name);
+		}
+		std::ostringstream archive;
+		archive << "fifetestindex" << a << ".zip";
+		archiveNames.push_back(archive.str());
+		writeZip(archive.str(), entries);
+	}
+	{
+		boost::shared_ptr<VFS> vfs(new VFS());
+		std::vector<VFSSource*> sources;
+		sources.push_back(new VFSDirectory(vfs.get()));
+		vfs->addSource(sources.back());
+		clock_t start = clock();
+		for (uint32_t a = 0; a < archives; ++a) {
+			sources.push_back(new ZipSource(vfs.get(), archiveNames[a]));
+			vfs->addSource(sources.back());
+		}
+		double addTime = double(clock() - start) / CLOCKS_PER_SEC;
+
+		// ask every source in turn, as the lookup did before the index
+		start = clock();
+		uint32_t found = 0;
+		for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+			for (std::vector<VFSSource*>::const_iterator source = sources.begin(); source != sources.end(); ++source) {
+				if ((*source)->fileExists(*it)) {
+					++found;
+					break;
+				}
+			}
+		}
+		double linearTime = double(clock() - start) / CLOCKS_PER_SEC;
+		CHECK_EQUAL(names.size(), found);
+
+		start = clock();
+		found = 0;
+		for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+			if (vfs->exists(*it)) {
+				++found;
+			}
+		}
+		double indexTime = double(clock() - start) / CLOCKS_PER_SEC;
+		CHECK_EQUAL(names.size(), found);
+		CHECK(!vfs->exists("objects/set0/dir0"));
+		CHECK(vfs->isDirectory("objects/set0/dir0"));
+		CHECK(!vfs->exists("objects/set0/dir0/missing.xml"));
+
+		start = clock();
+		for (uint32_t i = 0; i < names.size(); i += 10) {
+			std::unique_ptr<RawData> data(vfs->open(names[i]));
+			CHECK_EQUAL(16u, data->getDataLength());
+		}
+		double openTime = double(clock() - start) / CLOCKS_PER_SEC;
+
+		start = clock();
+		size_t listed = 0;
+		for (uint32_t a = 0; a < archives; ++a) {
+			std::ostringstream set;
+			set << "objects/set" << a;
+			std::set<std::string> dirs = vfs->listDirectories(set.str());
+			CHECK_EQUAL(100u, dirs.size());
+			for (std::set<std::string>::const_iterator it = dirs.begin(); it != dirs.end(); ++it) {
+				listed += vfs->listFiles(set.str() + "/" + *it).size();
+			}
+		}
+		double listTime = double(clock() - start) / CLOCKS_PER_SEC;
+		CHECK_EQUAL(names.size(), listed);
+
+		std::cout << names.size() << " files in " << archives << " archives: add " << addTime
+			<< "s, exists per source " << linearTime << "s, exists by index " << indexTime
+			<< "s, open " << names.size() / 10 << " files " << openTime << "s, list " << listTime << "s" << std::endl;
+	}
+	for (uint32_t a = 0; a < archives; ++a) {
+		std::remove(archiveNames[a].c_str());
+	}
+}
+
+TEST(central_directory_benchmark) {
+	environment env;
+	const uint32_t count = 100000;
+
+	std::vector<ZipTestEntry> entries(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		std::ostringstream name;
+		name << "objects/dir" << (i % 500) << "/file" << i << ".xml";
+		entries[i].name = name.str();
+		entries[i].data = createTestData(16, i);
+		entries[i].deflate = false;
+	}
+	writeZip(GENERATED_ZIP, entries);
+	{
+		boost::shared_ptr<VFS> vfs(new VFS());
+		vfs->addSource(new VFSDirectory(vfs.get()));
+
+		// the entry count of the end record overflows, the index must not rely on it
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		vfs->addSource(new ZipSource(vfs.get(), GENERATED_ZIP));
+		double addTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		CHECK(vfs->exists(entries[0].name));
+		CHECK(vfs->exists(entries[count - 1].name));
+		CHECK_EQUAL(200u, vfs->listFiles("objects/dir7").size());
+
+		std::unique_ptr<RawData> data(vfs->open(entries[77777].name));
+		CHECK_EQUAL(16u, data->getDataLength());
+		std::vector<uint8_t> content(16);
+		data->readInto(&content[0], content.size());
+		CHECK(content == entries[77777].data);
+
+		std::cout << count << " zip entries: add " << addTime << "s" << std::endl;
+	}
+	std::remove(GENERATED_ZIP.c_str());
+}
+
+static const std::string GENERATED_ZIP64 = "fifetestzip64.zip";
+// offset of the second entry, behind the 32 bit border
+static const uint64_t ZIP64_GAP = 0x140000000ULL;
+// size of the stored entry, only the last bytes are written
+static const uint64_t ZIP64_HUGE_SIZE = 0x100000010ULL;
+static const char ZIP64_MARKER[] = "fife zip64 tail!";
+
+/** Writes a sparse Zip64 archive: a small entry at the start, a stored entry behind the 4GB border
+ * and a stored entry that is bigger than 4GB. Its crc is not checked by the reader and left 0.
+ */
+static void writeZip64(const std::string& filename, const std::vector<uint8_t>& small, const std::vector<uint8_t>& far) {
+	std::vector<ZipTestEntry> entries(2);
+	entries[0].name = "small.txt";
+	entries[0].data = small;
+	entries[0].deflate = false;
+	entries[1].name = "far/far.txt";
+	entries[1].data = far;
+	entries[1].deflate = false;
+	std::vector<uint64_t> offsets;
+
+	std::ofstream out(filename.c_str(), std::ios::binary);
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (i == 1) {
+			out.seekp(static_cast<std::streamoff>(ZIP64_GAP));
+		}
+		offsets.push_back(static_cast<uint64_t>(out.tellp()));
+		write32(out, 0x04034b50);
+		write16(out, 20);
+		write16(out, 0);
+		write16(out, 0);
+		write32(out, 0);
+		write32(out, crc32(crc32(0, Z_NULL, 0), &entries[i].data[0], entries[i].data.size()));
+		write32(out, entries[i].data.size());
+		write32(out, entries[i].data.size());
+		write16(out, entries[i].name.size());
+		write16(out, 0);
+		out.write(entries[i].name.c_str(), entries[i].name.size());
+		out.write(reinterpret_cast<const char*>(&entries[i].data[0]), entries[i].data.size());
+	}
+
+	// the huge entry keeps its sizes in the Zip64 extra field of the local header
+	const std::string hugeName = "huge.bin";
+	offsets.push_back(static_cast<uint64_t>(out.tellp()));
+	write32(out, 0x04034b50);
+	write16(out, 45);
+	write16(out, 0);
+	write16(out, 0);
+	write32(out, 0);
+	write32(out, 0);
+	write32(out, 0xffffffff);
+	write32(out, 0xffffffff);
+	write16(out, hugeName.size());
+	write16(out, 20);
+	out.write(hugeName.c_str(), hugeName.size());
+	write16(out, 0x0001);
+	write16(out, 16);
+	write64(out, ZIP64_HUGE_SIZE);
+	write64(out, ZIP64_HUGE_SIZE);
+	out.seekp(static_cast<std::streamoff>(ZIP64_HUGE_SIZE - 16), std::ios::cur);
+	out.write(ZIP64_MARKER, 16);
+
+	const uint64_t directoryOffset = static_cast<uint64_t>(out.tellp());
+	for (size_t i = 0; i < 3; ++i) {
+		const bool huge = i == 2;
+		const std::string& name = huge ? hugeName : entries[i].name;
+		const uint32_t size = huge ? 0xffffffff : static_cast<uint32_t>(entries[i].data.size());
+		const bool farOffset = offsets[i] >= 0xffffffff;
+		const uint16_t extraLength = (huge ? 16 : 0) + (farOffset ? 8 : 0);
+		write32(out, 0x02014b50);
+		write16(out, 45);
+		write16(out, extraLength ? 45 : 20);
+		write16(out, 0);
+		write16(out, 0);
+		write32(out, 0);
+		write32(out, huge ? 0 : crc32(crc32(0, Z_NULL, 0), &entries[i].data[0], entries[i].data.size()));
+		write32(out, size);
+		write32(out, size);
+		write16(out, name.size());
+		write16(out, extraLength ? extraLength + 4 : 0);
+		write16(out, 0);
+		write16(out, 0);
+		write16(out, 0);
+		write32(out, 0);
+		write32(out, farOffset ? 0xffffffff : static_cast<uint32_t>(offsets[i]));
+		out.write(name.c_str(), name.size());
+		if (extraLength) {
+			write16(out, 0x0001);
+			write16(out, extraLength);
+			if (huge) {
+				write64(out, ZIP64_HUGE_SIZE);
+				write64(out, ZIP64_HUGE_SIZE);
+			}
+			if (farOffset) {
+				write64(out, offsets[i]);
+			}
+		}
+	}
+
+	// Zip64 end record and locator, the classic end record only holds placeholders
+	const uint64_t zip64Offset = static_cast<uint64_t>(out.tellp());
+	write32(out, 0x06064b50);
+	write64(out, 44);
+	write16(out, 45);
+	write16(out, 45);
+	write32(out, 0);
+	write32(out, 0);
+	write64(out, 3);
+	write64(out, 3);
+	write64(out, zip64Offset - directoryOffset);
+	write64(out, directoryOffset);
+	write32(out, 0x07064b50);
+	write32(out, 0);
+	write64(out, zip64Offset);
+	write32(out, 1);
+	write32(out, 0x06054b50);
+	write16(out, 0);
+	write16(out, 0);
+	write16(out, 0xffff);
+	write16(out, 0xffff);
+	write32(out, 0xffffffff);
+	write32(out, 0xffffffff);
+	write16(out, 0);
+}
+
+TEST(zip64_archive) {
+	environment env;
+	std::vector<uint8_t> small = createTestData(3000, 1);
+	std::vector<uint8_t> far = createTestData(20000, 2);
+	writeZip64(GENERATED_ZIP64, small, far);
+	{
+		boost::shared_ptr<VFS> vfs(new VFS());
+		vfs->addSource(new VFSDirectory(vfs.get()));
+		vfs->addSource(new ZipSource(vfs.get(), GENERATED_ZIP64));
+
+		CHECK(vfs->exists("small.txt"));
+		CHECK(vfs->exists("far/far.txt"));
+		CHECK(vfs->exists("huge.bin"));
+
+		std::unique_ptr<RawData> data(vfs->open("small.txt"));
+		CHECK(data->getDataInBytes() == small);
+
+		// the local header lies behind the 4GB border
+		data.reset(vfs->open("far/far.txt"));
+		CHECK(data->getDataInBytes() == far);
+
+		// the entry is streamed, its size and offsets need 64 bit
+		data.reset(vfs->open("huge.bin"));
+		CHECK(data->getDataLength() == ZIP64_HUGE_SIZE);
+		uint8_t tail[16];
+		data->setIndex(ZIP64_HUGE_SIZE - 16);
+		data->readInto(tail, 16);
+		CHECK(memcmp(tail, ZIP64_MARKER, 16) == 0);
+		CHECK(data->getCurrentIndex() == ZIP64_HUGE_SIZE);
+		CHECK_THROW(data->read8(), IndexOverflow);
+
+		// the unwritten part in front of the tail reads as zeros
+		data->setIndex(ZIP64_HUGE_SIZE - 20);
+		CHECK_EQUAL(0u, data->read32Little());
+		CHECK_EQUAL(0x65666966u, data->read32Little());
+		data->readAt(0x80000000ULL, tail, 4);
+		CHECK(tail[0] == 0 && tail[3] == 0);
+	}
+	std::remove(GENERATED_ZIP64.c_str());
+}
+
 int main() {
 	return UnitTest::RunAllTests();
 }
@@ -0,0 +1,114 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+# ####################################################################
+#  Copyright (C) 2005-2019 by the FIFE team
+#  http://www.fifengine.net
+#  This file is part of FIFE.
+#
+#  FIFE is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU Lesser General Public
+#  License as published by the Free Software Foundation; either
+#  version 2.1 of the License, or (at your option) any later version.
+#
+#  This library is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#  Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public
+#  License along with this library; if not, write to the
+#  Free Software Foundation, Inc.,
+#  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+# ####################################################################
+
+
+""" Converts xml maps into the binary map format.
+
+The map is loaded with the native xml map loader and written with the
+BinaryMapSaver. The binary map keeps the imports of the xml map, so the
+object files have to stay next to the converted map.
+
+usage: map_converter.py map.xml [more maps] [--font path]
+"""
+
+from __future__ import print_function
+
+import os, sys, time
+import xml.etree.ElementTree as ET
+
+TOOLS_DIR = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(TOOLS_DIR, '..', 'engine', 'python'))
+
+from fife import fife
+
+def getImportFiles(path):
+	""" returns the imports of the xml map as files relative to the map,
+	directory imports are replaced by the xml files in the directory """
+	mapDir = os.path.dirname(path)
+	files = []
+	for element in ET.parse(path).getroot().findall('import'):
+		_file = element.get('file')
+		_dir = element.get('dir')
+		if _file:
+			files.append(os.path.join(_dir, _file) if _dir else _file)
+		elif _dir:
+			for root, dirs, names in os.walk(os.path.join(mapDir, _dir)):
+				dirs[:] = [d for d in dirs if d != '.svn']
+				for name in sorted(names):
+					if os.path.splitext(name)[1] in ('.xml', '.zip'):
+						files.append(os.path.relpath(os.path.join(root, name), mapDir))
+	return files
+
+def convert(engine, path):
+	model = engine.getModel()
+	loader = fife.MapLoader(model, engine.getVFS(), engine.getImageManager(), engine.getRenderBackend())
+	start = time.time()
+	map = loader.load(path)
+	if not map:
+		print("Could not load", path)
+		return False
+	print("Loaded %s in %.2fs" % (path, time.time() - start))
+
+	target = os.path.splitext(path)[0] + '.fbm'
+	saver = fife.BinaryMapSaver()
+	saver.save(map, target, getImportFiles(path))
+	model.deleteMap(map)
+
+	start = time.time()
+	binaryLoader = fife.BinaryMapLoader(model, engine.getVFS(), engine.getImageManager(), engine.getRenderBackend())
+	map = binaryLoader.load(target)
+	if not map:
+		print("Could not load the converted map", target)
+		return False
+	print("Wrote %s, it loads in %.2fs" % (target, time.time() - start))
+	model.deleteMap(map)
+	return True
+
+def main(args):
+	font = os.path.join(TOOLS_DIR, '..', 'tests', 'data', 'FreeMono.ttf')
+	if '--font' in args:
+		index = args.index('--font')
+		font = args[index + 1]
+		del args[index:index + 2]
+	if not args:
+		print(__doc__)
+		return 1
+
+	engine = fife.Engine()
+	settings = engine.getSettings()
+	settings.setRenderBackend('SDL')
+	settings.setScreenWidth(1)
+	settings.setScreenHeight(1)
+	settings.setDefaultFontPath(font)
+	engine.init()
+
+	result = 0
+	for path in args:
+		if not convert(engine, path):
+			result = 1
+	engine.destroy()
+	return result
+
+if __name__ == '__main__':
+	sys.exit(main(sys.argv[1:]))